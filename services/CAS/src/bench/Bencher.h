@@ -0,0 +1,22 @@
+#pragma once
+#include "../core/solver/EquationSolver.h"
+#include "../core/solver/Simplifier.h"
+#include "../core/solver/Isolator.h"
+
+/* Exposes the individual rules so they can be timed one by one */
+class Bencher: public Simplifier, public EquationSolver, public Isolator {
+public:
+    using Simplifier::reduceUnary;
+    using Simplifier::distributeMinusUnaryInBinary;
+    using Simplifier::mergeBinaryWithRightUnary;
+    using Simplifier::distributeMultiplyBinary;
+    using Simplifier::evaluateConstantBinary;
+    using Simplifier::evaluateSpecialCases;
+    using Simplifier::seperateIntoUnary;
+    using Simplifier::combineLikeTerms;
+
+    using EquationSolver::normalizeEquation;
+    using EquationSolver::solve;
+
+    using Isolator::isolateVariable;
+};
@@ -0,0 +1,315 @@
+#include "Bencher.h"
+#include "../workload/WorkloadGenerator.h"
+#include "../core/parser/FlatTree.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+// Count every heap allocation made by the process, only the
+// difference over the timed region is reported
+static std::atomic<size_t> allocationCount{0};
+static std::atomic<size_t> allocationBytes{0};
+
+// None of these are inlined, so the compiler does not pair malloc() from new with a delete
+// and warn (-Wmismatched-new-delete)
+[[gnu::noinline]] void *operator new(std::size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocationBytes.fetch_add(size, std::memory_order_relaxed);
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+[[gnu::noinline]] void operator delete(void *ptr) noexcept { std::free(ptr); }
+[[gnu::noinline]] void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+struct BenchCase {
+    std::string name;
+    // Build n fresh inputs, not timed
+    std::function<void(size_t n)> prepare;
+    // Run the i-th operation, timed
+    std::function<void(size_t i)> op;
+    // Work per operation, used for throughput (tokens, nodes, bytes...)
+    size_t itemsPerOp;
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double nsPerOp;
+    double allocsPerOp;
+    double bytesAllocatedPerOp;
+    double opsPerSec;
+    double itemsPerSec;
+};
+
+static std::unique_ptr<ASTNode> parseExpr(const std::string &expr) {
+    Parser parser(std::make_unique<Lexer>(expr));
+    return parser.parse();
+}
+
+static size_t countNodes(const ASTNode *node) {
+    if (node->getNodeType() == NodeType::BinaryOp) {
+        const BinaryOpNode *binaryNode = static_cast<const BinaryOpNode *>(node);
+        return 1 + countNodes(binaryNode->getLeft()) + countNodes(binaryNode->getRight());
+    } else if (node->getNodeType() == NodeType::UnaryOp) {
+        return 1 + countNodes(static_cast<const UnaryOpNode *>(node)->getOperand());
+    }
+    return 1;
+}
+
+static BenchResult runCase(BenchCase &bench, double minTimeMs) {
+    using Clock = std::chrono::steady_clock;
+    // Warm up caches and the allocator
+    bench.prepare(1);
+    bench.op(0);
+
+    size_t batch = 1;
+    size_t iterations = 0;
+    double totalNs = 0;
+    size_t totalAllocs = 0;
+    size_t totalBytes = 0;
+    while (totalNs < minTimeMs * 1e6) {
+        bench.prepare(batch);
+        size_t allocsBefore = allocationCount.load(std::memory_order_relaxed);
+        size_t bytesBefore = allocationBytes.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        for (size_t i = 0; i < batch; i++) {
+            bench.op(i);
+        }
+        auto end = Clock::now();
+        totalAllocs += allocationCount.load(std::memory_order_relaxed) - allocsBefore;
+        totalBytes += allocationBytes.load(std::memory_order_relaxed) - bytesBefore;
+        totalNs += std::chrono::duration<double, std::nano>(end - start).count();
+        iterations += batch;
+        if (batch < (1u << 16)) batch *= 2;
+    }
+
+    double nsPerOp = totalNs / iterations;
+    return {
+        bench.name,
+        iterations,
+        nsPerOp,
+        (double)totalAllocs / iterations,
+        (double)totalBytes / iterations,
+        1e9 / nsPerOp,
+        1e9 / nsPerOp * bench.itemsPerOp,
+    };
+}
+
+/* Time an operation that consumes or mutates a parsed tree, one fresh clone per op */
+static BenchCase treeCase(
+    const std::string &name,
+    const std::string &expr,
+    std::function<void(std::unique_ptr<ASTNode> &)> fn
+) {
+    auto source = std::make_shared<std::unique_ptr<ASTNode>>(parseExpr(expr));
+    auto inputs = std::make_shared<std::vector<std::unique_ptr<ASTNode>>>();
+    return {
+        name,
+        [source, inputs](size_t n) {
+            inputs->clear();
+            for (size_t i = 0; i < n; i++) inputs->push_back((*source)->clone());
+        },
+        [inputs, fn](size_t i) { fn((*inputs)[i]); },
+        countNodes(source->get())
+    };
+}
+
+static BenchCase solveCase(
+    const std::string &name,
+    const std::vector<std::string> &equations,
+    const std::string &variable
+) {
+    auto sources = std::make_shared<std::vector<std::unique_ptr<ASTNode>>>();
+    size_t nodes = 0;
+    for (const auto &eq : equations) {
+        sources->push_back(parseExpr(eq));
+        nodes += countNodes(sources->back().get());
+    }
+    auto inputs = std::make_shared<std::vector<std::vector<std::unique_ptr<ASTNode>>>>();
+    return {
+        name,
+        [sources, inputs](size_t n) {
+            inputs->clear();
+            for (size_t i = 0; i < n; i++) {
+                std::vector<std::unique_ptr<ASTNode>> system;
+                for (auto &eq : *sources) system.push_back(eq->clone());
+                inputs->push_back(std::move(system));
+            }
+        },
+        [inputs, variable](size_t i) {
+            Bencher solver;
+            SolveResult result = solver.solve((*inputs)[i], variable);
+            if (!result.result) {
+                throw std::runtime_error("Benchmark system has no solution");
+            }
+        },
+        nodes
+    };
+}
+
+static BenchCase workloadCase(const WorkloadSpec &spec) {
+    Workload workload = WorkloadGenerator::generate(spec);
+    return solveCase(
+        "EquationSolver::solve/" + WorkloadGenerator::kindName(spec.kind) + std::to_string(spec.size),
+        workload.equations,
+        workload.target
+    );
+}
+
+static std::vector<BenchCase> allCases() {
+    std::vector<BenchCase> cases;
+
+    const std::string lexerInput = "x + a*(b - 3.25) / (c ^ 2) - 4*y + (z - 1)*(z + 1) = 12";
+    size_t lexerTokens = 0;
+    {
+        Lexer lexer(lexerInput);
+        while (lexer.getNextToken().getType() != TokenType::END) lexerTokens++;
+    }
+    cases.push_back({
+        "Lexer::getNextToken",
+        [](size_t) {},
+        [lexerInput](size_t) {
+            Lexer lexer(lexerInput);
+            while (lexer.getNextToken().getType() != TokenType::END) {}
+        },
+        lexerTokens
+    });
+
+    size_t parserNodes = countNodes(parseExpr(lexerInput).get());
+    cases.push_back({
+        "Parser::parse",
+        [](size_t) {},
+        [lexerInput](size_t) {
+            Parser parser(std::make_unique<Lexer>(lexerInput));
+            parser.parse();
+        },
+        parserNodes
+    });
+
+    // Each rule gets an input it actually rewrites
+    cases.push_back(treeCase("Simplifier::reduceUnary", "+-+--x + -(-(-y)) - +-z",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::reduceUnary(node); }));
+    cases.push_back(treeCase("Simplifier::distributeMinusUnaryInBinary", "-(a + b - c) + -(d - (e + f))",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::distributeMinusUnaryInBinary(node); }));
+    cases.push_back(treeCase("Simplifier::mergeBinaryWithRightUnary", "a + -b - -c + -d - +e",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::mergeBinaryWithRightUnary(node); }));
+    cases.push_back(treeCase("Simplifier::distributeMultiplyBinary", "3*(2*(x+1)) + (a - b)*c",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::distributeMultiplyBinary(node); }));
+    cases.push_back(treeCase("Simplifier::evaluateConstantBinary", "2 + 3 * (4 - 1) - 4*(a-2) + 7 - 5",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::evaluateConstantBinary(node); }));
+    cases.push_back(treeCase("Simplifier::evaluateSpecialCases", "0*x + 1*y - 0 + 3 - 3 + 0 + z/1",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::evaluateSpecialCases(node); }));
+    cases.push_back(treeCase("Simplifier::seperateIntoUnary", "2*x + 3*y - 4*z + 5",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::seperateIntoUnary(node); }));
+    cases.push_back(treeCase("Simplifier::combineLikeTerms", "2*x + 3*x - y + 4 - 1 + y - 2 + 3",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::combineLikeTerms(node); }));
+    cases.push_back(treeCase("Simplifier::simplify", "(x + (-b - 2)) - (b * c) + 3*(2*(x+1)) - 2*x = 0",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::simplify(node); }));
+
+    cases.push_back(treeCase("Isolator::isolateVariable", "(x + a) - (b * c) = 0",
+        [](std::unique_ptr<ASTNode> &node) { Bencher::isolateVariable(node, "b"); }));
+
+    // Same read-only passes over the pointer tree and the flat layout
+    std::string sumInput = "v0 * 1";
+    for (int i = 1; i < 256; i++) {
+        sumInput += (i % 2 ? " + v" : " - v") + std::to_string(i % 16) + " * " + std::to_string(i % 9 + 1);
+    }
+    auto pointerTree = std::make_shared<std::unique_ptr<ASTNode>>(parseExpr(sumInput));
+    auto flatTree = std::make_shared<FlatTree>(FlatTree::fromAst(pointerTree->get()));
+    cases.push_back({"ASTNode::hash", [](size_t) {},
+        [pointerTree](size_t) { volatile size_t hash = (*pointerTree)->hash(); (void)hash; }, flatTree->size()});
+    cases.push_back({"FlatTree::hash", [](size_t) {},
+        [flatTree](size_t) { volatile size_t hash = flatTree->hash(); (void)hash; }, flatTree->size()});
+    cases.push_back({"ASTNode::toString", [](size_t) {},
+        [pointerTree](size_t) { (*pointerTree)->toString(); }, flatTree->size()});
+    cases.push_back({"FlatTree::toString", [](size_t) {},
+        [flatTree](size_t) { flatTree->toString(); }, flatTree->size()});
+    cases.push_back({"FlatTree::fromAst", [](size_t) {},
+        [pointerTree](size_t) { FlatTree::fromAst(pointerTree->get()); }, flatTree->size()});
+
+    cases.push_back(solveCase("EquationSolver::solve/chain4",
+        {"x + a = b * c", "a = b + 2", "c = 3", "b = 4"}, "x"));
+    cases.push_back(solveCase("EquationSolver::solve/linear2",
+        {"x + y = 3", "x - y = 1"}, "x"));
+
+    // Scaling points from the synthetic generator
+    for (int size : {8, 16, 32}) {
+        cases.push_back(workloadCase({WorkloadKind::LinearChain, size}));
+    }
+    for (int size : {16, 64}) {
+        cases.push_back(workloadCase({WorkloadKind::DeepNested, size}));
+        cases.push_back(workloadCase({WorkloadKind::LikeTerms, size}));
+    }
+
+    return cases;
+}
+
+static std::string toJson(const std::vector<BenchResult> &results, double minTimeMs) {
+    std::ostringstream out;
+    out << "{\n  \"context\": {\"min_time_ms\": " << minTimeMs << "},\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchResult &r = results[i];
+        out << "    {\"name\": \"" << r.name << "\""
+            << ", \"iterations\": " << r.iterations
+            << ", \"ns_per_op\": " << r.nsPerOp
+            << ", \"allocs_per_op\": " << r.allocsPerOp
+            << ", \"bytes_allocated_per_op\": " << r.bytesAllocatedPerOp
+            << ", \"ops_per_sec\": " << r.opsPerSec
+            << ", \"items_per_sec\": " << r.itemsPerSec
+            << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+    return out.str();
+}
+
+int main(int argc, char *argv[]) {
+    std::string filter = "";
+    std::string outPath = "";
+    double minTimeMs = 200;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << "Options:\n";
+            std::cout << "  --filter <substr>    Only run benchmarks whose name contains substr\n";
+            std::cout << "  --min-time-ms <ms>   Minimum measured time per benchmark (default 200)\n";
+            std::cout << "  --out <file>         Write the JSON report to a file instead of stdout\n";
+            return 0;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (arg == "--min-time-ms" && i + 1 < argc) {
+            minTimeMs = std::stod(argv[++i]);
+        } else if (arg == "--out" && i + 1 < argc) {
+            outPath = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::vector<BenchResult> results;
+    for (BenchCase &bench : allCases()) {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos) {
+            continue;
+        }
+        std::cerr << "Running " << bench.name << "...\n";
+        results.push_back(runCase(bench, minTimeMs));
+    }
+
+    std::string json = toJson(results, minTimeMs);
+    if (outPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream file(outPath);
+        file << json;
+    }
+    return 0;
+}
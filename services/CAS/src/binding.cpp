@@ -3,87 +3,489 @@
 #include "core/solver/Simplifier.h"
 #include "core/solver/Isolator.h"
 #include "core/solver/EquationSolver.h"
+#include "core/cache/ResultCache.h"
+#include "core/parser/Printer.h"
+#include "service/CasService.h"
+#include "service/SolveStream.h"
+#include "service/SolverSession.h"
+#include "utils/ThreadPool.h"
+#include "utils/Stats.h"
 
 #define dbg(...) // Remove dbg statements in binding
 
 namespace py = pybind11;
 
-// Strip unnecessary outer parentheses from expression string
-std::string cleanOutput(const std::string& str) {
-    std::string result = str;
-    while (result.size() >= 2 && result.front() == '(' && result.back() == ')') {
-        // Check if these parens actually wrap the whole expression
-        int depth = 0;
-        bool wrapsWhole = true;
-        for (size_t i = 0; i < result.size() - 1; i++) {
-            if (result[i] == '(') depth++;
-            else if (result[i] == ')') depth--;
-            if (depth == 0) {
-                wrapsWhole = false;
-                break;
+py::dict metricsToDict(const SolveMetrics &metrics) {
+    py::dict result;
+    result["iterations"] = metrics.iterations;
+    result["states_expanded"] = metrics.statesExpanded;
+    result["duplicates_skipped"] = metrics.duplicatesSkipped;
+    result["states_pruned"] = metrics.statesPruned;
+    result["peak_queue_size"] = metrics.peakQueueSize;
+    result["clones"] = metrics.clones;
+    result["isolations"] = metrics.isolations;
+    result["simplify_calls"] = metrics.simplifyCalls;
+    result["substitutions"] = metrics.substitutions;
+    result["shared_rewrites"] = metrics.sharedRewrites;
+    result["best_distinct_variables"] = metrics.bestDistinctVariables;
+    result["normalize_ns"] = metrics.normalizeNs;
+    result["search_ns"] = metrics.searchNs;
+    result["simplify_ns"] = metrics.simplifyNs;
+    result["isolate_ns"] = metrics.isolateNs;
+    result["total_ns"] = metrics.totalNs;
+    result["termination"] = SolveMetrics::terminationName(metrics.termination);
+    if (metrics.numeric.attempted) {
+        const NumericReport &report = metrics.numeric;
+        py::dict numeric;
+        numeric["converged"] = report.converged;
+        numeric["reason"] = report.reason;
+        numeric["answer"] = report.answer;
+        numeric["starts"] = report.starts;
+        numeric["iterations"] = report.iterations;
+        numeric["residual_evaluations"] = report.residualEvaluations;
+        numeric["residual_norm"] = report.residualNorm;
+        numeric["last_step"] = report.lastStep;
+        numeric["values"] = report.values;
+        numeric["total_ns"] = report.totalNs;
+        result["numeric"] = numeric;
+    }
+    if (metrics.polynomial.attempted) {
+        const PolynomialReport &report = metrics.polynomial;
+        py::dict polynomial;
+        polynomial["degree"] = report.degree;
+        polynomial["roots"] = report.roots;
+        polynomial["answer"] = report.answer;
+        polynomial["total_ns"] = report.totalNs;
+        result["polynomial"] = polynomial;
+    }
+    return result;
+}
+
+py::dict eventToDict(const SolveEvent &event) {
+    py::dict result;
+    result["kind"] = SolveEvent::kindName(event.kind);
+    result["text"] = event.text;
+    result["iteration"] = event.iteration;
+    result["queue_size"] = event.queueSize;
+    result["best_distinct_variables"] = event.bestDistinctVariables;
+    if (event.kind == SolveEventKind::Finished) {
+        result["result"] = event.text;
+        result["steps"] = event.steps;
+        result["termination"] = SolveMetrics::terminationName(event.termination);
+    }
+    return result;
+}
+
+py::dict outcomeToDict(const SolveOutcome &outcome) {
+    py::dict result;
+    result["result"] = outcome.result;
+    result["steps"] = outcome.steps;
+    result["metrics"] = metricsToDict(outcome.metrics);
+    result["status"] = outcome.status;
+    result["cached"] = outcome.cached;
+    return result;
+}
+
+/*
+* Workers behind the *_async functions, never destroyed: joining at interpreter
+* shutdown would need the GIL that the finalizing thread holds
+*/
+ThreadPool &asyncPool() {
+    static ThreadPool *pool = new ThreadPool();
+    return *pool;
+}
+
+/* Python side of one *_async call, only touched with the GIL held */
+struct AsyncCall {
+    py::object loop;
+    py::object future;
+    // Keeps a caller's SolveBudget alive while the pool uses it
+    py::object budgetRef;
+    SolveBudget *budget = nullptr;
+    SolveBudget ownBudget;
+};
+
+/*
+* Create a future on the running loop, run work() on the pool without the GIL
+* and resolve the future from the loop thread with toPython(work())
+* Cancelling the future cancels the budget token, so the C++ side stops early
+*/
+template <typename Result>
+py::object runAsync(
+    py::object budget,
+    std::function<Result(SolveBudget *)> work,
+    std::function<py::object(const Result &)> toPython
+) {
+    auto call = std::make_shared<AsyncCall>();
+    call->loop = py::module_::import("asyncio").attr("get_running_loop")();
+    call->future = call->loop.attr("create_future")();
+    if (!budget.is_none()) {
+        call->budgetRef = budget;
+        call->budget = budget.cast<SolveBudget *>();
+    } else {
+        call->budget = &call->ownBudget;
+    }
+
+    CancellationToken token = call->budget->token;
+    call->future.attr("add_done_callback")(py::cpp_function([token](py::object future) mutable {
+        if (future.attr("cancelled")().cast<bool>()) {
+            token.cancel();
+        }
+    }));
+
+    asyncPool().submit([call, work, toPython]() mutable {
+        // Nothing may escape a pool thread, every failure goes to the future instead
+        Result result{};
+        bool failed = false;
+        std::string error;
+        try {
+            result = work(call->budget);
+        } catch (const std::exception &e) {
+            failed = true;
+            error = e.what();
+        } catch (...) {
+            failed = true;
+            error = "Unknown error";
+        }
+
+        py::gil_scoped_acquire acquire;
+        std::shared_ptr<AsyncCall> held = std::move(call);
+        py::object value;
+        if (!failed) {
+            try {
+                value = toPython(result);
+            } catch (const std::exception &e) {
+                // py::cast_error, py::error_already_set...
+                failed = true;
+                error = e.what();
+            } catch (...) {
+                failed = true;
+                error = "Unknown error converting the result";
             }
         }
-        if (wrapsWhole) {
-            result = result.substr(1, result.size() - 2);
-        } else {
-            break;
+        if (failed) {
+            value = py::str(error);
         }
-    }
-    return result;
+        try {
+            py::object settle = py::cpp_function([](py::object future, py::object value, bool failed) {
+                // The awaiting task may have been cancelled meanwhile
+                if (future.attr("done")().cast<bool>()) return;
+                if (failed) {
+                    future.attr("set_exception")(py::module_::import("builtins").attr("RuntimeError")(value));
+                } else {
+                    future.attr("set_result")(value);
+                }
+            });
+            held->loop.attr("call_soon_threadsafe")(settle, held->future, value, failed);
+        } catch (const std::exception &) {
+            // Loop already closed, nobody is waiting for this result
+        }
+    });
+    return call->future;
 }
 
 PYBIND11_MODULE(cas, m) {
     m.doc() = "Computer Algebra System (CAS) module";
-    m.def("simplify", [](const std::string &expr) {
-        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(expr);
-        Parser parser(std::move(lexer));
-        std::unique_ptr<ASTNode> root = parser.parse();
-        Simplifier::simplify(root);
-        return cleanOutput(root->toString());
-    }, "Simplify a mathematical expression");
+
+    py::class_<CancellationToken>(m, "CancellationToken")
+        .def(py::init<>())
+        .def("cancel", &CancellationToken::cancel, "Ask every call using this token to stop, safe from any thread")
+        .def("reset", &CancellationToken::reset)
+        .def_property_readonly("cancelled", &CancellationToken::isCancelled);
+
+    py::class_<SolveBudget>(m, "SolveBudget")
+        .def(py::init<>())
+        .def_readwrite("timeout_ms", &SolveBudget::timeoutMs)
+        .def_readwrite("max_nodes", &SolveBudget::maxNodes)
+        .def_readwrite("max_queue_size", &SolveBudget::maxQueueSize)
+        .def_readwrite("max_memory_bytes", &SolveBudget::maxMemoryBytes)
+        .def_readwrite("token", &SolveBudget::token)
+        .def_property_readonly("status", [](const SolveBudget &budget) {
+            return SolveBudget::statusName(budget.getStatus());
+        });
+
+    py::enum_<SearchStrategy>(m, "SearchStrategy")
+        .value("BEST_FIRST", SearchStrategy::BestFirst)
+        .value("BEAM", SearchStrategy::Beam)
+        .value("BFS", SearchStrategy::BreadthFirst);
+
+    py::enum_<PriorityFunction>(m, "PriorityFunction")
+        .value("DISTINCT_VARIABLES", PriorityFunction::DistinctVariables)
+        .value("OCCURRENCES", PriorityFunction::Occurrences)
+        .value("WEIGHTED", PriorityFunction::Weighted);
+
+    py::class_<SolverOptions>(m, "SolverOptions")
+        .def(py::init<>())
+        .def_readwrite("strategy", &SolverOptions::strategy)
+        .def_readwrite("priority", &SolverOptions::priority)
+        .def_readwrite("beam_width", &SolverOptions::beamWidth)
+        .def_readwrite("distinct_weight", &SolverOptions::distinctWeight)
+        .def_readwrite("occurrence_weight", &SolverOptions::occurrenceWeight)
+        .def_readwrite("depth_weight", &SolverOptions::depthWeight)
+        .def_readwrite("max_iterations", &SolverOptions::maxIterations)
+        .def_readwrite("max_iterations_without_improvement", &SolverOptions::maxIterationsWithoutImprovement)
+        .def_readwrite("expansion_ratio", &SolverOptions::expansionRatio)
+        .def_readwrite("record_steps", &SolverOptions::recordSteps)
+        .def_readwrite("share_subexpressions", &SolverOptions::shareSubexpressions)
+        .def_readwrite("polynomial_roots", &SolverOptions::polynomialRoots)
+        .def_readwrite("numeric_fallback", &SolverOptions::numericFallback)
+        .def_property("newton_method", [](const SolverOptions &options) {
+            return SolverOptions::newtonMethodName(options.newton.method);
+        }, [](SolverOptions &options, const std::string &name) {
+            options.newton.method = SolverOptions::parseNewtonMethod(name);
+        }, "line_search or trust_region")
+        .def_property("newton_max_iterations", [](const SolverOptions &options) {
+            return options.newton.maxIterations;
+        }, [](SolverOptions &options, int value) { options.newton.maxIterations = value; })
+        .def_property("newton_tolerance", [](const SolverOptions &options) {
+            return options.newton.tolerance;
+        }, [](SolverOptions &options, double value) { options.newton.tolerance = value; })
+        .def_property("starting_points", [](const SolverOptions &options) {
+            return options.newton.startingPoints;
+        }, [](SolverOptions &options, const std::vector<std::unordered_map<std::string, double>> &points) {
+            options.newton.startingPoints = points;
+        }, "[{variable: value}], tried in order before the random starts, missing variables start at 1")
+        .def_property("random_starts", [](const SolverOptions &options) {
+            return options.newton.randomStarts;
+        }, [](SolverOptions &options, int value) { options.newton.randomStarts = value; })
+        .def_property("newton_max_nodes", [](const SolverOptions &options) {
+            return options.newton.maxNodes;
+        }, [](SolverOptions &options, std::size_t value) { options.newton.maxNodes = value; },
+        "Larger equations are not differentiated (reason too_large), 0 for no limit")
+        .def_property_readonly("key", &SolverOptions::key)
+        .def_static("parse_strategy", &SolverOptions::parseStrategy)
+        .def_static("parse_priority", &SolverOptions::parsePriority);
+
+    m.def("simplify", [](const std::string &expr, SolveBudget *budget) {
+        // Only C++ objects inside, let other Python threads run (and cancel us)
+        py::gil_scoped_release release;
+        return CasService::simplify(expr, budget).simplified;
+    }, py::arg("expr"), py::arg("budget") = nullptr,
+    "Simplify a mathematical expression, stops early (check budget.status) when the budget runs out");
+
+    m.def("substitute", [](
+        const std::string &expr,
+        const std::unordered_map<std::string, std::string> &values,
+        SolveBudget *budget
+    ) {
+        py::gil_scoped_release release;
+        return CasService::substitute(expr, values, budget).simplified;
+    }, py::arg("expr"), py::arg("values"), py::arg("budget") = nullptr,
+    "Replace variables by expressions ({'a': '2', 'b': 'c + 1'}) in one pass, then simplify once");
 
     m.def("isolate", [](const std::string &equation, const std::string &variable) {
-        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(equation);
-        Parser parser(std::move(lexer));
-        std::unique_ptr<ASTNode> root = parser.parse();
-        if (root->getNodeType() != NodeType::BinaryOp || static_cast<BinaryOpNode*>(root.get())->getToken().getType() != ASSIGN) {
-            throw std::runtime_error("Input is not a valid equation");
-        }
-        Isolator::isolateVariable(root, variable, false);
-        return cleanOutput(root->toString());
+        return CasService::isolate(equation, variable);
     }, "Isolate a variable in an equation");
 
-    m.def("solve", [](const std::vector<std::string> &equations, const std::string &variable) {
-        std::vector<std::unique_ptr<ASTNode>> astEquations;
-        for (const auto &eq : equations) {
-            std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(eq);
-            Parser parser(std::move(lexer));
-            astEquations.push_back(parser.parse());
+    m.def("differentiate", [](const std::string &expr, const std::string &variable) {
+        return CasService::differentiate(expr, variable);
+    }, py::arg("expr"), py::arg("variable"), "Derivative of an expression with respect to variable, simplified");
+
+    m.def("solve", [](
+        const std::vector<std::string> &equations,
+        const std::string &variable,
+        const SolverOptions *options,
+        SolveBudget *budget
+    ) {
+        SolveOutcome outcome;
+        {
+            py::gil_scoped_release release;
+            outcome = CasService::solve(equations, variable, options ? *options : SolverOptions(), budget);
         }
-        EquationSolver solver;
-        SolveResult solution = solver.solve(astEquations, variable);
-        
-        py::dict result;
-        if (solution.result) {
-            result["result"] = cleanOutput(solution.result->toString());
-        } else {
-            result["result"] = "";
+        return outcomeToDict(outcome);
+    }, py::arg("equations"), py::arg("variable"), py::arg("options") = nullptr, py::arg("budget") = nullptr,
+    "Solve a system of equations for a specific variable, with optional SolverOptions and SolveBudget");
+
+    m.def("solve_all", [](const std::vector<std::string> &equations, SolveBudget *budget) {
+        SolveAllOutcome outcome;
+        {
+            py::gil_scoped_release release;
+            outcome = CasService::solveAll(equations, budget);
+        }
+        py::dict variables;
+        for (const auto &[variable, answer] : outcome.variables) {
+            py::dict entry;
+            entry["status"] = answer.status;
+            entry["value"] = answer.value;
+            entry["depends_on"] = answer.dependsOn;
+            variables[py::str(variable)] = entry;
         }
-        
-        // Clean steps too (format is "Prefix: equation")
-        std::vector<std::string> cleanedSteps;
-        for (const auto& step : solution.steps) {
-            size_t colonPos = step.find(": ");
-            if (colonPos != std::string::npos) {
-                std::string prefix = step.substr(0, colonPos + 2);
-                std::string equation = step.substr(colonPos + 2);
-                cleanedSteps.push_back(prefix + cleanOutput(equation));
-            } else {
-                cleanedSteps.push_back(cleanOutput(step));
+        py::dict result;
+        result["variables"] = variables;
+        result["inconsistent_equations"] = outcome.inconsistentEquations;
+        result["redundant_equations"] = outcome.redundantEquations;
+        result["metrics"] = metricsToDict(outcome.metrics);
+        result["status"] = outcome.status;
+        return result;
+    }, py::arg("equations"), py::arg("budget") = nullptr,
+    "Solve for every variable at once: {variable: {status, value, depends_on}}, status is solved, "
+    "dependent (value uses free variables), free, inconsistent or unsolved");
+
+    m.def("simplify_async", [](const std::string &expr, py::object budget) {
+        return runAsync<std::string>(budget, [expr](SolveBudget *budget) {
+            return CasService::simplify(expr, budget).simplified;
+        }, [](const std::string &simplified) -> py::object {
+            return py::str(simplified);
+        });
+    }, py::arg("expr"), py::arg("budget") = py::none(),
+    "Awaitable simplify, runs on the internal pool, must be called from a running event loop");
+
+    m.def("solve_async", [](
+        const std::vector<std::string> &equations,
+        const std::string &variable,
+        const SolverOptions *options,
+        py::object budget
+    ) {
+        SolverOptions copied = options ? *options : SolverOptions();
+        return runAsync<SolveOutcome>(budget, [equations, variable, copied](SolveBudget *budget) {
+            return CasService::solve(equations, variable, copied, budget);
+        }, [](const SolveOutcome &outcome) -> py::object {
+            return outcomeToDict(outcome);
+        });
+    }, py::arg("equations"), py::arg("variable"), py::arg("options") = nullptr, py::arg("budget") = py::none(),
+    "Awaitable solve, same result as solve(). Cancelling the awaitable cancels the budget token");
+
+    m.def("async_pool_size", []() {
+        return asyncPool().size();
+    }, "Threads behind simplify_async/solve_async");
+
+    m.def("async_pending", []() {
+        return asyncPool().pending();
+    }, "Async calls waiting for a pool thread");
+
+    py::class_<SolveStream>(m, "SolveStream")
+        .def("__iter__", [](SolveStream &stream) -> SolveStream & { return stream; }, py::return_value_policy::reference_internal)
+        .def("__next__", [](SolveStream &stream) {
+            SolveEvent event;
+            bool more;
+            {
+                // Waiting on the solver thread, do not hold up the interpreter
+                py::gil_scoped_release release;
+                more = stream.next(event);
             }
+            if (!more) throw py::stop_iteration();
+            return eventToDict(event);
+        })
+        .def("cancel", &SolveStream::cancel, "Stop the search early, the stream still ends with a finished event")
+        .def_property_readonly("cancelled", &SolveStream::cancelled);
+
+    py::class_<SparseJacobian>(m, "Jacobian")
+        .def(py::init([](const std::vector<std::string> &equations, const std::vector<std::string> &variables) {
+            py::gil_scoped_release release;
+            return CasService::jacobian(equations, variables);
+        }), py::arg("equations"), py::arg("variables") = std::vector<std::string>(),
+        "Sparse Jacobian of lhs - rhs per equation, columns in the order of variables (default: all, sorted)")
+        .def_readonly("variables", &SparseJacobian::variables)
+        .def_readonly("row_start", &SparseJacobian::rowStart, "Entries of row i are row_start[i] .. row_start[i + 1] - 1")
+        .def_readonly("columns", &SparseJacobian::columns)
+        .def_property_readonly("derivatives", [](const SparseJacobian &jacobian) {
+            std::vector<std::string> printed;
+            for (const PTree &derivative : jacobian.derivatives) {
+                printed.push_back(Printer::print(derivative->thaw().get()));
+            }
+            return printed;
+        })
+        .def_property_readonly("instructions", [](const SparseJacobian &jacobian) {
+            return jacobian.compiled.instructions();
+        }, "Size of the compiled program shared by all residuals and entries")
+        .def("evaluate", [](const SparseJacobian &jacobian, const std::vector<double> &point) {
+            std::vector<double> values = jacobian.compiled.evaluate(point);
+            std::vector<double> residuals(values.begin(), values.begin() + jacobian.rows());
+            std::vector<double> entries(values.begin() + jacobian.rows(), values.end());
+            py::dict result;
+            result["residuals"] = residuals;
+            result["entries"] = entries;
+            return result;
+        }, py::arg("point"), "{residuals, entries} at point, which has one value per variable in column order");
+
+    py::class_<SolverSession>(m, "SolverSession")
+        .def(py::init<>())
+        .def("set", [](SolverSession &session, const std::string &id, const std::string &equation) {
+            py::gil_scoped_release release;
+            session.set(id, equation);
+        }, py::arg("id"), py::arg("equation"), "Add or replace one equation, raises on parse errors and keeps the old one")
+        .def("add", [](SolverSession &session, const std::string &equation) {
+            py::gil_scoped_release release;
+            return session.add(equation);
+        }, py::arg("equation"), "Add an equation under a new id and return the id")
+        .def("remove", &SolverSession::remove, py::arg("id"))
+        .def("clear", &SolverSession::clear)
+        .def("list", &SolverSession::list, "(id, equation) pairs in the order they were added")
+        .def("__len__", &SolverSession::size)
+        .def("solve", [](
+            SolverSession &session,
+            const std::string &variable,
+            const SolverOptions *options,
+            SolveBudget *budget
+        ) {
+            SolveOutcome outcome;
+            {
+                py::gil_scoped_release release;
+                outcome = session.solve(variable, options ? *options : SolverOptions(), budget);
+            }
+            return outcomeToDict(outcome);
+        }, py::arg("variable"), py::arg("options") = nullptr, py::arg("budget") = nullptr,
+        "Solve the current equations, answers are reused until an equation they depend on changes")
+        .def_property_readonly("hits", &SolverSession::hits)
+        .def_property_readonly("misses", &SolverSession::misses);
+
+    m.def("solve_stream", [](
+        const std::vector<std::string> &equations,
+        const std::string &variable,
+        const SolverOptions *options,
+        const SolveBudget *budget
+    ) {
+        return new SolveStream(equations, variable, options ? *options : SolverOptions(), budget ? *budget : SolveBudget());
+    }, py::arg("equations"), py::arg("variable"), py::arg("options") = nullptr, py::arg("budget") = nullptr,
+    "Solve in the background, iterate the returned stream for started/step/finished events");
+
+    m.def("stats", []() {
+        StatsSnapshot snapshot = Stats::snapshot();
+        py::dict rules;
+        for (const RuleStats &r : snapshot.rules) {
+            py::dict rule;
+            rule["invocations"] = r.invocations;
+            rule["fires"] = r.fires;
+            rule["nanos"] = r.nanos;
+            rule["nodes_visited"] = r.nodesVisited;
+            rules[py::str(r.name)] = rule;
+        }
+        py::dict pipelines;
+        for (const PipelineStats &p : snapshot.pipelines) {
+            py::dict pipeline;
+            pipeline["calls"] = p.calls;
+            pipeline["iterations"] = p.iterations;
+            pipeline["max_iterations"] = p.maxIterations;
+            pipelines[py::str(p.name)] = pipeline;
         }
-        result["steps"] = cleanedSteps;
+        py::dict result;
+        result["rules"] = rules;
+        result["pipelines"] = pipelines;
         return result;
-    }, "Solve a system of equations for a specific variable");
+    }, "Per-rule invocations/fires/nanos/nodes visited and per-pipeline iteration counts, summed over threads");
+
+    m.def("reset_stats", []() {
+        Stats::reset();
+    }, "Zero every rule and pipeline counter");
+
+    m.def("cache_stats", []() {
+        CacheStats stats = ResultCache::instance().stats();
+        py::dict result;
+        result["hits"] = stats.hits;
+        result["misses"] = stats.misses;
+        result["evictions"] = stats.evictions;
+        result["entries"] = stats.entries;
+        result["bytes"] = stats.bytes;
+        result["max_bytes"] = stats.maxBytes;
+        return result;
+    }, "Hit/miss/eviction counters and size of the result cache");
+
+    m.def("cache_set_max_bytes", [](std::size_t maxBytes) {
+        ResultCache::instance().setMaxBytes(maxBytes);
+    }, py::arg("max_bytes"), "Limit the result cache size, 0 disables caching");
+
+    m.def("cache_clear", []() {
+        ResultCache::instance().clear();
+    }, "Drop every cached result and reset the counters");
 }
 
@@ -0,0 +1,175 @@
+#include "ResultCache.h"
+#include <algorithm>
+#include <utility>
+
+namespace {
+    /*
+    * A prepared equation with the terms of its sums sorted, so the order they were
+    * written in does not matter: -1 + x = 0 and x - 1 = 0 both give "(+x -1 = 0)"
+    */
+    std::string equationKey(const PTree &equation) {
+        bool assign = equation->getNodeType() == NodeType::BinaryOp && equation->getToken().getType() == ASSIGN;
+        std::vector<std::string> terms;
+        // Explicit stack, a prepared sum can be a million terms deep
+        std::vector<std::pair<const PersistentNode *, bool>> pending{{assign ? equation->getLeft().get() : equation.get(), true}};
+        while (!pending.empty()) {
+            auto [node, positive] = pending.back();
+            pending.pop_back();
+            TokenType type = node->getToken().getType();
+            if (node->getNodeType() == NodeType::BinaryOp && (type == PLUS || type == MINUS)) {
+                pending.push_back({node->getLeft().get(), positive});
+                pending.push_back({node->getRight().get(), type == PLUS ? positive : !positive});
+            } else if (node->getNodeType() == NodeType::UnaryOp && type == MINUS) {
+                pending.push_back({node->getOperand().get(), !positive});
+            } else {
+                terms.push_back((positive ? "+" : "-") + node->toString());
+            }
+        }
+        std::sort(terms.begin(), terms.end());
+        std::string key = "(";
+        for (std::size_t i = 0; i < terms.size(); i++) {
+            key += (i > 0 ? " " : "") + terms[i];
+        }
+        return key + (assign ? " = " + equation->getRight()->toString() : "") + ")";
+    }
+}
+
+ResultCache &ResultCache::instance() {
+    static ResultCache cache;
+    return cache;
+}
+
+std::string ResultCache::systemKey(
+    const std::vector<PTree> &equations,
+    const std::string &variable,
+    const std::string &optionsKey
+) {
+    std::vector<std::string> printed;
+    printed.reserve(equations.size());
+    for (const PTree &eq : equations) {
+        printed.push_back(equationKey(eq));
+    }
+    // Equation order does not change the system
+    std::sort(printed.begin(), printed.end());
+
+    std::string key = "solve|";
+    for (size_t i = 0; i < printed.size(); i++) {
+        if (i > 0) key += ";";
+        key += printed[i];
+    }
+    key += "|" + variable;
+    if (!optionsKey.empty()) {
+        key += "|" + optionsKey;
+    }
+    return key;
+}
+
+std::string ResultCache::expressionKey(std::unique_ptr<ASTNode> &expression) {
+    return "simplify|" + expression->toString();
+}
+
+std::uint64_t ResultCache::hashKey(const std::string &key) {
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : key) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::size_t ResultCache::entryBytes(const std::string &key, const CachedResult &value) {
+    std::size_t total = sizeof(Entry) + key.size() + value.result.size();
+    for (const std::string &step : value.steps) {
+        total += sizeof(std::string) + step.size();
+    }
+    // The metrics are inline in Entry, only the reports' strings and containers are extra
+    const NumericReport &numeric = value.metrics.numeric;
+    total += numeric.reason.size() + numeric.answer.size();
+    for (const auto &[variable, number] : numeric.values) {
+        // Red-black tree node: three pointers and the color next to the pair
+        total += 4 * sizeof(void *) + sizeof(std::pair<const std::string, double>) + variable.size();
+    }
+    const PolynomialReport &polynomial = value.metrics.polynomial;
+    total += polynomial.answer.size();
+    for (const std::string &root : polynomial.roots) {
+        total += sizeof(std::string) + root.size();
+    }
+    return total;
+}
+
+bool ResultCache::lookup(const std::string &key, CachedResult &out) {
+    std::uint64_t hash = ResultCache::hashKey(key);
+    std::lock_guard<std::mutex> lock(ResultCache::mutex);
+
+    auto it = ResultCache::index.find(hash);
+    if (it == ResultCache::index.end() || it->second->key != key) {
+        ResultCache::misses++;
+        return false;
+    }
+    ResultCache::lru.splice(ResultCache::lru.begin(), ResultCache::lru, it->second);
+    out = it->second->value;
+    ResultCache::hits++;
+    return true;
+}
+
+void ResultCache::insert(const std::string &key, CachedResult value) {
+    std::uint64_t hash = ResultCache::hashKey(key);
+    std::size_t size = ResultCache::entryBytes(key, value);
+    std::lock_guard<std::mutex> lock(ResultCache::mutex);
+
+    // Replace the old entry (same key, or a colliding one)
+    auto it = ResultCache::index.find(hash);
+    if (it != ResultCache::index.end()) {
+        ResultCache::bytes -= it->second->bytes;
+        ResultCache::lru.erase(it->second);
+        ResultCache::index.erase(it);
+    }
+
+    // Would never fit, do not flush the whole cache for it
+    if (size > ResultCache::maxBytes) {
+        return;
+    }
+    ResultCache::evictUntil(ResultCache::maxBytes - size);
+
+    ResultCache::lru.push_front(Entry{key, hash, std::move(value), size});
+    ResultCache::index[hash] = ResultCache::lru.begin();
+    ResultCache::bytes += size;
+}
+
+void ResultCache::evictUntil(std::size_t limit) {
+    while (ResultCache::bytes > limit && !ResultCache::lru.empty()) {
+        Entry &last = ResultCache::lru.back();
+        ResultCache::bytes -= last.bytes;
+        ResultCache::index.erase(last.hash);
+        ResultCache::lru.pop_back();
+        ResultCache::evictions++;
+    }
+}
+
+void ResultCache::setMaxBytes(std::size_t newMaxBytes) {
+    std::lock_guard<std::mutex> lock(ResultCache::mutex);
+    ResultCache::maxBytes = newMaxBytes;
+    ResultCache::evictUntil(newMaxBytes);
+}
+
+void ResultCache::clear() {
+    std::lock_guard<std::mutex> lock(ResultCache::mutex);
+    ResultCache::lru.clear();
+    ResultCache::index.clear();
+    ResultCache::bytes = 0;
+    ResultCache::hits = 0;
+    ResultCache::misses = 0;
+    ResultCache::evictions = 0;
+}
+
+CacheStats ResultCache::stats() const {
+    std::lock_guard<std::mutex> lock(ResultCache::mutex);
+    CacheStats s;
+    s.hits = ResultCache::hits;
+    s.misses = ResultCache::misses;
+    s.evictions = ResultCache::evictions;
+    s.entries = ResultCache::lru.size();
+    s.bytes = ResultCache::bytes;
+    s.maxBytes = ResultCache::maxBytes;
+    return s;
+}
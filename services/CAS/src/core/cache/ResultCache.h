@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../parser/Nodes.h"
+#include "../parser/PersistentNode.h"
+#include "../solver/SolveMetrics.h"
+
+struct CachedResult {
+    std::string result;
+    std::vector<std::string> steps;
+    // Metrics of the solve that produced the entry
+    SolveMetrics metrics;
+};
+
+struct CacheStats {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0;
+    std::size_t maxBytes = 0;
+};
+
+/*
+* Bounded, thread-safe LRU cache of final simplify/solve outputs.
+* Entries are addressed by a 64-bit hash of a canonical key, the key itself
+* is kept in the entry so a hash collision is treated as a miss.
+*/
+class ResultCache {
+public:
+    static const std::size_t DEFAULT_MAX_BYTES = 64 * 1024 * 1024;
+
+    ResultCache(std::size_t maxBytes = DEFAULT_MAX_BYTES) : maxBytes(maxBytes) {}
+
+    /* Process-wide instance used by the Python module */
+    static ResultCache &instance();
+
+    /*
+    * Canonical key for a system and a target variable, from the equations as returned by
+    * EquationSolver::prepareEquation. Equations are printed from the tree (so whitespace does
+    * not matter) with the terms of the left side sorted, then sorted themselves, so
+    * x + 1 = 2, 1 + x = 2 and x = 2 - 1 all share one entry
+    * e.g., ["b = 4", "x+a = b"], x -> "solve|(+a +x -b = 0);(+b -4 = 0)|x"
+    * optionsKey (SolverOptions::key) is appended when given, different options may give different results
+    */
+    static std::string systemKey(
+        const std::vector<PTree> &equations,
+        const std::string &variable,
+        const std::string &optionsKey = ""
+    );
+
+    /* Canonical key for a parsed expression, e.g., "2*x + 3" -> "simplify|((2 * x) + 3)" */
+    static std::string expressionKey(std::unique_ptr<ASTNode> &expression);
+
+    /* FNV-1a, stable across runs and platforms */
+    static std::uint64_t hashKey(const std::string &key);
+
+    /* Copy the cached value into out and mark it most recently used */
+    bool lookup(const std::string &key, CachedResult &out);
+    void insert(const std::string &key, CachedResult value);
+
+    /* Shrinking the limit evicts least recently used entries right away */
+    void setMaxBytes(std::size_t newMaxBytes);
+    void clear();
+    CacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::uint64_t hash;
+        CachedResult value;
+        std::size_t bytes;
+    };
+
+    static std::size_t entryBytes(const std::string &key, const CachedResult &value);
+    void evictUntil(std::size_t limit);
+
+    mutable std::mutex mutex;
+    // Front is the most recently used entry
+    std::list<Entry> lru;
+    std::unordered_map<std::uint64_t, std::list<Entry>::iterator> index;
+
+    std::size_t maxBytes;
+    std::size_t bytes = 0;
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+};
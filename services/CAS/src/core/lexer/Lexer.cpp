@@ -73,6 +73,10 @@ Token Lexer::number() {
         result += currentChar;
         advance();
     }
+    // Canonical exact form, "2.50" and "5/2" print and hash the same
+    if (!Rational::isCanonical(result)) {
+        result = Rational::parse(result).toString();
+    }
     return Token(TokenType::NUMBER, result);
 }
 
@@ -4,6 +4,7 @@
 #include <stdexcept>
 #include <string>
 #include <tuple>
+#include "../number/Rational.h"
 
 enum TokenType {
     // Atoms
@@ -39,23 +40,16 @@ public:
     TokenType getType() const { return type; }
     const std::string &getValue() const { return value; }
 
-    static double getNumericValue(const Token &token) {
+    /* Exact value of a NUMBER token, leading +/- signs are folded in */
+    static Rational getNumericValue(const Token &token) {
         if (token.getType() != NUMBER) {
             throw std::runtime_error("Token is not a number");
         }
-        bool negate = false;
-        int start = 0;
-        std::string tokenStr = token.getValue();
-        for(int i = 0; i < tokenStr.size(); i++) {
-            if (tokenStr[i] == '-') {
-                negate = !negate;
-            } else if (tokenStr[i] != '+') {
-                start = i;
-                break;
-            }
-        }
-        std::string val = (negate? "-": "") + tokenStr.substr(start);
-        return std::stod(val);
+        return Rational::parse(token.getValue());
+    }
+    /* NUMBER token for |value|, negative values are expressed with a unary minus by the callers */
+    static Token fromNumber(const Rational &value) {
+        return Token(NUMBER, value.abs().toString());
     }
 
     static char operationToChr(const TokenType &op);
@@ -0,0 +1,284 @@
+#include "BigInt.h"
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+BigInt::BigInt(std::int64_t value) {
+    BigInt::negative = value < 0;
+    // Negate in unsigned space so INT64_MIN works too
+    std::uint64_t magnitude = BigInt::negative ? ~static_cast<std::uint64_t>(value) + 1 : static_cast<std::uint64_t>(value);
+    while (magnitude) {
+        BigInt::limbs.push_back(static_cast<std::uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+void BigInt::trim() {
+    while (!BigInt::limbs.empty() && BigInt::limbs.back() == 0) {
+        BigInt::limbs.pop_back();
+    }
+    if (BigInt::limbs.empty()) {
+        BigInt::negative = false;
+    }
+}
+
+BigInt BigInt::parse(const std::string &str) {
+    BigInt result;
+    size_t i = 0;
+    bool negative = false;
+    if (i < str.size() && (str[i] == '-' || str[i] == '+')) {
+        negative = str[i] == '-';
+        i++;
+    }
+    if (i == str.size()) {
+        throw std::runtime_error("Invalid integer: " + str);
+    }
+    for (; i < str.size(); i++) {
+        if (!std::isdigit(static_cast<unsigned char>(str[i]))) {
+            throw std::runtime_error("Invalid integer: " + str);
+        }
+        // result = result * 10 + digit
+        std::uint64_t carry = str[i] - '0';
+        for (std::uint32_t &limb : result.limbs) {
+            std::uint64_t cur = static_cast<std::uint64_t>(limb) * 10 + carry;
+            limb = static_cast<std::uint32_t>(cur);
+            carry = cur >> 32;
+        }
+        if (carry) {
+            result.limbs.push_back(static_cast<std::uint32_t>(carry));
+        }
+    }
+    result.negative = negative;
+    result.trim();
+    return result;
+}
+
+std::string BigInt::toString() const {
+    if (BigInt::isZero()) {
+        return "0";
+    }
+    // Peel off 9 decimal digits at a time
+    std::vector<std::uint32_t> magnitude = BigInt::limbs;
+    std::string digits;
+    while (!magnitude.empty()) {
+        std::uint32_t chunk = BigInt::divSmall(magnitude, 1000000000u);
+        while (!magnitude.empty() && magnitude.back() == 0) {
+            magnitude.pop_back();
+        }
+        for (int d = 0; d < 9; d++) {
+            digits.push_back(static_cast<char>('0' + chunk % 10));
+            chunk /= 10;
+            if (magnitude.empty() && chunk == 0) break;
+        }
+    }
+    if (BigInt::negative) {
+        digits.push_back('-');
+    }
+    std::reverse(digits.begin(), digits.end());
+    return digits;
+}
+
+bool BigInt::fitsInt64() const {
+    if (BigInt::limbs.size() > 2) return false;
+    std::uint64_t magnitude = 0;
+    for (size_t i = BigInt::limbs.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | BigInt::limbs[i];
+    }
+    std::uint64_t limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max());
+    return BigInt::negative ? magnitude <= limit + 1 : magnitude <= limit;
+}
+
+std::int64_t BigInt::toInt64() const {
+    std::uint64_t magnitude = 0;
+    for (size_t i = BigInt::limbs.size(); i-- > 0;) {
+        magnitude = (magnitude << 32) | BigInt::limbs[i];
+    }
+    return BigInt::negative ? static_cast<std::int64_t>(~magnitude + 1) : static_cast<std::int64_t>(magnitude);
+}
+
+double BigInt::toDouble() const {
+    double result = 0;
+    for (size_t i = BigInt::limbs.size(); i-- > 0;) {
+        result = result * 4294967296.0 + BigInt::limbs[i];
+    }
+    return BigInt::negative ? -result : result;
+}
+
+BigInt BigInt::operator-() const {
+    BigInt result = *this;
+    if (!result.isZero()) {
+        result.negative = !result.negative;
+    }
+    return result;
+}
+
+BigInt BigInt::abs() const {
+    BigInt result = *this;
+    result.negative = false;
+    return result;
+}
+
+int BigInt::compareMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b) {
+    if (a.size() != b.size()) {
+        return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0;) {
+        if (a[i] != b[i]) {
+            return a[i] < b[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+std::vector<std::uint32_t> BigInt::addMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b) {
+    const std::vector<std::uint32_t> &longer = a.size() >= b.size() ? a : b;
+    const std::vector<std::uint32_t> &shorter = a.size() >= b.size() ? b : a;
+    std::vector<std::uint32_t> result(longer.size() + 1, 0);
+    std::uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); i++) {
+        std::uint64_t cur = carry + longer[i] + (i < shorter.size() ? shorter[i] : 0);
+        result[i] = static_cast<std::uint32_t>(cur);
+        carry = cur >> 32;
+    }
+    result[longer.size()] = static_cast<std::uint32_t>(carry);
+    return result;
+}
+
+std::vector<std::uint32_t> BigInt::subMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b) {
+    std::vector<std::uint32_t> result(a.size(), 0);
+    std::int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        std::int64_t cur = static_cast<std::int64_t>(a[i]) - borrow - (i < b.size() ? b[i] : 0);
+        borrow = cur < 0 ? 1 : 0;
+        result[i] = static_cast<std::uint32_t>(cur + (borrow << 32));
+    }
+    return result;
+}
+
+std::uint32_t BigInt::divSmall(std::vector<std::uint32_t> &a, std::uint32_t divisor) {
+    std::uint64_t remainder = 0;
+    for (size_t i = a.size(); i-- > 0;) {
+        std::uint64_t cur = (remainder << 32) | a[i];
+        a[i] = static_cast<std::uint32_t>(cur / divisor);
+        remainder = cur % divisor;
+    }
+    return static_cast<std::uint32_t>(remainder);
+}
+
+BigInt BigInt::operator+(const BigInt &other) const {
+    BigInt result;
+    if (BigInt::negative == other.negative) {
+        result.limbs = BigInt::addMagnitude(BigInt::limbs, other.limbs);
+        result.negative = BigInt::negative;
+    } else if (BigInt::compareMagnitude(BigInt::limbs, other.limbs) >= 0) {
+        result.limbs = BigInt::subMagnitude(BigInt::limbs, other.limbs);
+        result.negative = BigInt::negative;
+    } else {
+        result.limbs = BigInt::subMagnitude(other.limbs, BigInt::limbs);
+        result.negative = other.negative;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::operator-(const BigInt &other) const {
+    return *this + (-other);
+}
+
+BigInt BigInt::operator*(const BigInt &other) const {
+    BigInt result;
+    if (BigInt::isZero() || other.isZero()) {
+        return result;
+    }
+    result.limbs.assign(BigInt::limbs.size() + other.limbs.size(), 0);
+    for (size_t i = 0; i < BigInt::limbs.size(); i++) {
+        std::uint64_t carry = 0;
+        for (size_t j = 0; j < other.limbs.size(); j++) {
+            std::uint64_t cur = static_cast<std::uint64_t>(BigInt::limbs[i]) * other.limbs[j] + result.limbs[i + j] + carry;
+            result.limbs[i + j] = static_cast<std::uint32_t>(cur);
+            carry = cur >> 32;
+        }
+        result.limbs[i + other.limbs.size()] = static_cast<std::uint32_t>(carry);
+    }
+    result.negative = BigInt::negative != other.negative;
+    result.trim();
+    return result;
+}
+
+void BigInt::divMod(const BigInt &a, const BigInt &b, BigInt &quotient, BigInt &remainder) {
+    if (b.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+    quotient = BigInt();
+    remainder = BigInt();
+    if (BigInt::compareMagnitude(a.limbs, b.limbs) < 0) {
+        remainder = a;
+        return;
+    }
+
+    if (b.limbs.size() == 1) {
+        quotient.limbs = a.limbs;
+        std::uint32_t rest = BigInt::divSmall(quotient.limbs, b.limbs[0]);
+        if (rest) {
+            remainder.limbs.push_back(rest);
+        }
+    } else {
+        // Shift-subtract, one bit at a time
+        quotient.limbs.assign(a.limbs.size(), 0);
+        for (size_t bit = a.limbs.size() * 32; bit-- > 0;) {
+            // remainder = remainder * 2 + bit
+            std::uint32_t carry = (a.limbs[bit / 32] >> (bit % 32)) & 1;
+            for (std::uint32_t &limb : remainder.limbs) {
+                std::uint32_t next = limb >> 31;
+                limb = (limb << 1) | carry;
+                carry = next;
+            }
+            if (carry) {
+                remainder.limbs.push_back(carry);
+            }
+            if (BigInt::compareMagnitude(remainder.limbs, b.limbs) >= 0) {
+                remainder.limbs = BigInt::subMagnitude(remainder.limbs, b.limbs);
+                remainder.trim();
+                quotient.limbs[bit / 32] |= 1u << (bit % 32);
+            }
+        }
+    }
+    // Truncating: quotient sign from both, remainder keeps the dividend's sign
+    quotient.negative = a.negative != b.negative;
+    remainder.negative = a.negative;
+    quotient.trim();
+    remainder.trim();
+}
+
+BigInt BigInt::operator/(const BigInt &other) const {
+    BigInt quotient, remainder;
+    BigInt::divMod(*this, other, quotient, remainder);
+    return quotient;
+}
+
+BigInt BigInt::operator%(const BigInt &other) const {
+    BigInt quotient, remainder;
+    BigInt::divMod(*this, other, quotient, remainder);
+    return remainder;
+}
+
+BigInt BigInt::gcd(BigInt a, BigInt b) {
+    a = a.abs();
+    b = b.abs();
+    while (!b.isZero()) {
+        BigInt rest = a % b;
+        a = std::move(b);
+        b = std::move(rest);
+    }
+    return a;
+}
+
+bool BigInt::operator<(const BigInt &other) const {
+    if (BigInt::negative != other.negative) {
+        return BigInt::negative;
+    }
+    int cmp = BigInt::compareMagnitude(BigInt::limbs, other.limbs);
+    return BigInt::negative ? cmp > 0 : cmp < 0;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+* Arbitrary precision signed integer, sign + magnitude in base 2^32 limbs
+* Only used when Rational overflows its 64-bit fast path, so the algorithms
+* are the plain schoolbook ones
+*/
+class BigInt {
+private:
+    bool negative = false;
+    // Little endian, no leading zero limbs, empty for 0
+    std::vector<std::uint32_t> limbs;
+
+    void trim();
+
+    static int compareMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b);
+    static std::vector<std::uint32_t> addMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b);
+    /* a - b, requires |a| >= |b| */
+    static std::vector<std::uint32_t> subMagnitude(const std::vector<std::uint32_t> &a, const std::vector<std::uint32_t> &b);
+    /* Divide in place by a single limb, returns the remainder */
+    static std::uint32_t divSmall(std::vector<std::uint32_t> &a, std::uint32_t divisor);
+
+public:
+    BigInt() {}
+    BigInt(std::int64_t value);
+
+    /* Decimal digits with an optional leading '-' */
+    static BigInt parse(const std::string &str);
+    std::string toString() const;
+
+    bool isZero() const { return limbs.empty(); }
+    bool isNegative() const { return negative; }
+    int sign() const { return isZero() ? 0 : (negative ? -1 : 1); }
+
+    bool fitsInt64() const;
+    /* Only valid when fitsInt64() */
+    std::int64_t toInt64() const;
+    double toDouble() const;
+
+    BigInt operator-() const;
+    BigInt abs() const;
+
+    BigInt operator+(const BigInt &other) const;
+    BigInt operator-(const BigInt &other) const;
+    BigInt operator*(const BigInt &other) const;
+    /* Truncating division, throws on division by zero */
+    BigInt operator/(const BigInt &other) const;
+    BigInt operator%(const BigInt &other) const;
+    static void divMod(const BigInt &a, const BigInt &b, BigInt &quotient, BigInt &remainder);
+
+    static BigInt gcd(BigInt a, BigInt b);
+
+    bool operator==(const BigInt &other) const { return negative == other.negative && limbs == other.limbs; }
+    bool operator!=(const BigInt &other) const { return !(*this == other); }
+    bool operator<(const BigInt &other) const;
+};
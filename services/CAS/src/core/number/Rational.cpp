@@ -0,0 +1,307 @@
+#include "Rational.h"
+#include <cctype>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+    const std::int64_t SMALL_MAX = std::numeric_limits<std::int64_t>::max();
+
+    unsigned __int128 gcdWide(unsigned __int128 a, unsigned __int128 b) {
+        while (b) {
+            unsigned __int128 rest = a % b;
+            a = b;
+            b = rest;
+        }
+        return a;
+    }
+
+    BigInt wideToBig(__int128 value) {
+        bool negative = value < 0;
+        unsigned __int128 magnitude = negative ? -static_cast<unsigned __int128>(value) : static_cast<unsigned __int128>(value);
+        BigInt result;
+        BigInt base(std::int64_t(1) << 32);
+        for (int shift = 96; shift >= 0; shift -= 32) {
+            result = result * base + BigInt(static_cast<std::int64_t>((magnitude >> shift) & 0xffffffffu));
+        }
+        return negative ? -result : result;
+    }
+
+    bool allDigits(const std::string &str, size_t from, size_t to) {
+        if (from >= to) return false;
+        for (size_t i = from; i < to; i++) {
+            if (!std::isdigit(static_cast<unsigned char>(str[i]))) return false;
+        }
+        return true;
+    }
+}
+
+Rational::Rational(std::int64_t num, std::int64_t den) {
+    *this = Rational::fromWide(num, den);
+}
+
+Rational Rational::fromWide(__int128 num, __int128 den) {
+    if (den == 0) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (den < 0) {
+        num = -num;
+        den = -den;
+    }
+    // Integers need no reduction
+    if (den == 1 && num >= -SMALL_MAX && num <= SMALL_MAX) {
+        Rational result;
+        result.num = static_cast<std::int64_t>(num);
+        return result;
+    }
+    unsigned __int128 magnitude = num < 0 ? -static_cast<unsigned __int128>(num) : static_cast<unsigned __int128>(num);
+    // 128-bit division is a library call, stay in 64 bits when possible
+    unsigned __int128 g = (magnitude >> 64) == 0 && (static_cast<unsigned __int128>(den) >> 64) == 0
+        ? std::gcd(static_cast<std::uint64_t>(magnitude), static_cast<std::uint64_t>(den))
+        : gcdWide(magnitude, den);
+    if (g > 1) {
+        num /= static_cast<__int128>(g);
+        den /= static_cast<__int128>(g);
+    }
+    // Symmetric range so negation never overflows
+    if (num >= -SMALL_MAX && num <= SMALL_MAX && den <= SMALL_MAX) {
+        Rational result;
+        result.num = static_cast<std::int64_t>(num);
+        result.den = static_cast<std::int64_t>(den);
+        return result;
+    }
+    Rational result;
+    result.big = std::make_shared<const Big>(Big{wideToBig(num), wideToBig(den)});
+    return result;
+}
+
+Rational Rational::fromBig(BigInt num, BigInt den) {
+    if (den.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (den.isNegative()) {
+        num = -num;
+        den = -den;
+    }
+    BigInt g = BigInt::gcd(num, den);
+    if (!g.isZero() && g != BigInt(1)) {
+        num = num / g;
+        den = den / g;
+    }
+    if (num.fitsInt64() && den.fitsInt64()) {
+        std::int64_t smallNum = num.toInt64();
+        std::int64_t smallDen = den.toInt64();
+        if (smallNum >= -SMALL_MAX) {
+            Rational result;
+            result.num = smallNum;
+            result.den = smallDen;
+            return result;
+        }
+    }
+    Rational result;
+    result.big = std::make_shared<const Big>(Big{std::move(num), std::move(den)});
+    return result;
+}
+
+BigInt Rational::numerator() const {
+    return Rational::big ? Rational::big->num : BigInt(Rational::num);
+}
+
+BigInt Rational::denominator() const {
+    return Rational::big ? Rational::big->den : BigInt(Rational::den);
+}
+
+Rational Rational::parse(const std::string &str) {
+    size_t start = 0;
+    bool negative = false;
+    while (start < str.size() && (str[start] == '-' || str[start] == '+')) {
+        negative ^= str[start] == '-';
+        start++;
+    }
+
+    // Plain integers (nearly every token) without allocating
+    if (str.size() - start <= 18 && allDigits(str, start, str.size())) {
+        std::int64_t value = 0;
+        for (size_t i = start; i < str.size(); i++) value = value * 10 + (str[i] - '0');
+        return Rational(negative ? -value : value);
+    }
+
+    Rational result;
+    size_t slash = str.find('/', start);
+    if (slash != std::string::npos) {
+        if (!allDigits(str, start, slash) || !allDigits(str, slash + 1, str.size())) {
+            throw std::runtime_error("Invalid number: " + str);
+        }
+        result = Rational::fromBig(
+            BigInt::parse(str.substr(start, slash - start)),
+            BigInt::parse(str.substr(slash + 1))
+        );
+    } else {
+        // Printed doubles may carry an exponent, e.g. 1.5e-07
+        size_t exponentAt = str.find_first_of("eE", start);
+        std::string mantissa = str.substr(start, exponentAt == std::string::npos ? std::string::npos : exponentAt - start);
+        size_t dot = mantissa.find('.');
+        std::string intPart = mantissa.substr(0, dot);
+        std::string fracPart = dot == std::string::npos ? "" : mantissa.substr(dot + 1);
+        std::string digits = intPart + fracPart;
+        if (!allDigits(digits, 0, digits.size())) {
+            throw std::runtime_error("Invalid number: " + str);
+        }
+        if (digits.size() <= 18) {
+            // Fits int64 as is, 10^18 too
+            std::int64_t value = 0;
+            for (char c : digits) value = value * 10 + (c - '0');
+            std::int64_t scale = 1;
+            for (size_t i = 0; i < fracPart.size(); i++) scale *= 10;
+            result = Rational::fromWide(value, scale);
+        } else {
+            BigInt scale(1);
+            for (size_t i = 0; i < fracPart.size(); i++) scale = scale * BigInt(10);
+            result = Rational::fromBig(BigInt::parse(digits), scale);
+        }
+        if (exponentAt != std::string::npos) {
+            size_t exponentStart = exponentAt + 1;
+            bool negativeExponent = false;
+            if (exponentStart < str.size() && (str[exponentStart] == '-' || str[exponentStart] == '+')) {
+                negativeExponent = str[exponentStart] == '-';
+                exponentStart++;
+            }
+            if (exponentStart == str.size() || str.size() - exponentStart > 4 || !allDigits(str, exponentStart, str.size())) {
+                throw std::runtime_error("Invalid number: " + str);
+            }
+            std::int64_t exponent = std::stoll(str.substr(exponentStart));
+            // pow throws beyond MAX_EXPONENT
+            result = result * Rational(10).pow(Rational(negativeExponent ? -exponent : exponent));
+        }
+    }
+    return negative ? -result : result;
+}
+
+bool Rational::isCanonical(const std::string &str) {
+    size_t slash = str.find('/');
+    size_t end = slash == std::string::npos ? str.size() : slash;
+    if (!allDigits(str, 0, end) || (str[0] == '0' && (end > 1 || slash != std::string::npos))) {
+        return false;
+    }
+    if (slash == std::string::npos) {
+        return true;
+    }
+    return allDigits(str, slash + 1, str.size()) && str[slash + 1] != '0' && str.substr(slash + 1) != "1";
+}
+
+std::string Rational::toString() const {
+    if (Rational::big) {
+        std::string out = Rational::big->num.toString();
+        if (Rational::big->den != BigInt(1)) {
+            out += "/" + Rational::big->den.toString();
+        }
+        return out;
+    }
+    std::string out = std::to_string(Rational::num);
+    if (Rational::den != 1) {
+        out += "/" + std::to_string(Rational::den);
+    }
+    return out;
+}
+
+double Rational::toDouble() const {
+    if (Rational::big) {
+        return Rational::big->num.toDouble() / Rational::big->den.toDouble();
+    }
+    return static_cast<double>(Rational::num) / static_cast<double>(Rational::den);
+}
+
+Rational Rational::operator-() const {
+    if (Rational::big) {
+        Rational result;
+        result.big = std::make_shared<const Big>(Big{-Rational::big->num, Rational::big->den});
+        return result;
+    }
+    Rational result;
+    result.num = -Rational::num;
+    result.den = Rational::den;
+    return result;
+}
+
+Rational Rational::operator+(const Rational &other) const {
+    if (!Rational::big && !other.big) {
+        if (Rational::den == 1 && other.den == 1) {
+            return Rational::fromWide(static_cast<__int128>(Rational::num) + other.num, 1);
+        }
+        std::int64_t g = std::gcd(Rational::den, other.den);
+        __int128 n = static_cast<__int128>(Rational::num) * (other.den / g) + static_cast<__int128>(other.num) * (Rational::den / g);
+        __int128 d = static_cast<__int128>(Rational::den) * (other.den / g);
+        return Rational::fromWide(n, d);
+    }
+    return Rational::fromBig(
+        Rational::numerator() * other.denominator() + other.numerator() * Rational::denominator(),
+        Rational::denominator() * other.denominator()
+    );
+}
+
+Rational Rational::operator-(const Rational &other) const {
+    return *this + (-other);
+}
+
+Rational Rational::operator*(const Rational &other) const {
+    if (!Rational::big && !other.big) {
+        return Rational::fromWide(
+            static_cast<__int128>(Rational::num) * other.num,
+            static_cast<__int128>(Rational::den) * other.den
+        );
+    }
+    return Rational::fromBig(Rational::numerator() * other.numerator(), Rational::denominator() * other.denominator());
+}
+
+Rational Rational::operator/(const Rational &other) const {
+    if (other.isZero()) {
+        throw std::runtime_error("Division by zero");
+    }
+    if (!Rational::big && !other.big) {
+        return Rational::fromWide(
+            static_cast<__int128>(Rational::num) * other.den,
+            static_cast<__int128>(Rational::den) * other.num
+        );
+    }
+    return Rational::fromBig(Rational::numerator() * other.denominator(), Rational::denominator() * other.numerator());
+}
+
+Rational Rational::pow(const Rational &exponent) const {
+    if (!exponent.isInteger()) {
+        throw std::domain_error("Non-integer exponent has no exact value: " + exponent.toString());
+    }
+    std::int64_t exp = exponent.num;
+    if (exp > Rational::MAX_EXPONENT || exp < -Rational::MAX_EXPONENT) {
+        throw std::domain_error("Exponent too large for exact evaluation: " + exponent.toString());
+    }
+    Rational base = *this;
+    if (exp < 0) {
+        base = Rational(1) / base;
+        exp = -exp;
+    }
+    Rational result(1);
+    while (exp) {
+        if (exp & 1) result = result * base;
+        exp >>= 1;
+        if (exp) base = base * base;
+    }
+    return result;
+}
+
+bool Rational::operator==(const Rational &other) const {
+    // Values that fit are never stored big, so mixed representations differ
+    if (!Rational::big && !other.big) {
+        return Rational::num == other.num && Rational::den == other.den;
+    }
+    if (Rational::big && other.big) {
+        return Rational::big->num == other.big->num && Rational::big->den == other.big->den;
+    }
+    return false;
+}
+
+bool Rational::operator<(const Rational &other) const {
+    if (!Rational::big && !other.big) {
+        return static_cast<__int128>(Rational::num) * other.den < static_cast<__int128>(other.num) * Rational::den;
+    }
+    return Rational::numerator() * other.denominator() < other.numerator() * Rational::denominator();
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "BigInt.h"
+
+/*
+* Exact rational number, always reduced with a positive denominator
+* Numerator and denominator live inline as int64 (the fast path, no allocation).
+* An operation whose reduced result does not fit switches to a shared BigInt pair,
+* and results that fit again come back to the fast path.
+*
+* Printed as "3", "-3" or "1/3", decimals parse exactly ("0.25" -> 1/4)
+*/
+class Rational {
+private:
+    struct Big {
+        BigInt num;
+        BigInt den;
+    };
+
+    std::int64_t num = 0;
+    std::int64_t den = 1;
+    // Set only when the value does not fit the fast path
+    std::shared_ptr<const Big> big;
+
+    static Rational fromWide(__int128 num, __int128 den);
+    static Rational fromBig(BigInt num, BigInt den);
+
+public:
+    Rational() {}
+    Rational(std::int64_t value) : num(value) {}
+    /* Any sign, reduced here, throws on a zero denominator */
+    Rational(std::int64_t num, std::int64_t den);
+
+    /* "12", "-3/4", "0.125", ".5", "2.", "1.5e-07" */
+    static Rational parse(const std::string &str);
+    /* True when str is exactly what toString() prints for a non-negative value */
+    static bool isCanonical(const std::string &str);
+    std::string toString() const;
+    double toDouble() const;
+    /* Of the reduced form, the sign is on the numerator and the denominator is positive */
+    BigInt numerator() const;
+    BigInt denominator() const;
+
+    bool isSmall() const { return !big; }
+    bool isZero() const { return !big && num == 0; }
+    bool isOne() const { return !big && num == 1 && den == 1; }
+    bool isInteger() const { return !big && den == 1; }
+    bool isNegative() const { return big ? big->num.isNegative() : num < 0; }
+    int sign() const { return big ? big->num.sign() : (num > 0) - (num < 0); }
+
+    Rational operator-() const;
+    Rational abs() const { return isNegative() ? -*this : *this; }
+
+    Rational operator+(const Rational &other) const;
+    Rational operator-(const Rational &other) const;
+    Rational operator*(const Rational &other) const;
+    /* Throws on division by zero */
+    Rational operator/(const Rational &other) const;
+    Rational &operator+=(const Rational &other) { return *this = *this + other; }
+    Rational &operator-=(const Rational &other) { return *this = *this - other; }
+
+    /*
+    * Exact power, the exponent must be an integer of magnitude <= MAX_EXPONENT
+    * Anything else throws std::domain_error so callers can leave the expression symbolic
+    */
+    Rational pow(const Rational &exponent) const;
+    static const std::int64_t MAX_EXPONENT = 1024;
+
+    bool operator==(const Rational &other) const;
+    bool operator!=(const Rational &other) const { return !(*this == other); }
+    bool operator<(const Rational &other) const;
+    bool operator>(const Rational &other) const { return other < *this; }
+};
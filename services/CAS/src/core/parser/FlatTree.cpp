@@ -0,0 +1,409 @@
+#include "FlatTree.h"
+#include <array>
+#include <charconv>
+#include <functional>
+#include <stdexcept>
+
+namespace {
+    const ASTNode *leftOf(const ASTNode *node) {
+        if (node->getNodeType() == NodeType::UnaryOp) {
+            return static_cast<const UnaryOpNode *>(node)->getOperand();
+        }
+        return static_cast<const BinaryOpNode *>(node)->getLeft();
+    }
+
+    const ASTNode *rightOf(const ASTNode *node) {
+        return static_cast<const BinaryOpNode *>(node)->getRight();
+    }
+
+    // A unary PersistentNode keeps its operand in left
+    const PersistentNode *leftOf(const PersistentNode *node) {
+        return node->getLeft().get();
+    }
+
+    const PersistentNode *rightOf(const PersistentNode *node) {
+        return node->getRight().get();
+    }
+
+    void writeInteger(std::string &out, std::int64_t value) {
+        char buffer[24];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), value).ptr;
+        out.append(buffer, end);
+    }
+
+    /* std::hash of each operator's text, indexed by TokenType */
+    const std::array<std::size_t, POWER + 1> &operatorHashes() {
+        static const std::array<std::size_t, POWER + 1> hashes = []() {
+            std::array<std::size_t, POWER + 1> result{};
+            for (int op = ASSIGN; op <= POWER; op++) {
+                result[op] = std::hash<std::string>()(std::string(1, Token::operationToChr(static_cast<TokenType>(op))));
+            }
+            return result;
+        }();
+        return hashes;
+    }
+
+    Token operatorToken(TokenType op) {
+        return Token(op, std::string(1, Token::operationToChr(op)));
+    }
+
+    struct AstBuilder {
+        std::unique_ptr<ASTNode> integer(std::int64_t value) {
+            return std::make_unique<AtomNode>(Token(NUMBER, std::to_string(value)));
+        }
+        std::unique_ptr<ASTNode> number(const Token &token) {
+            return std::make_unique<AtomNode>(token);
+        }
+        std::unique_ptr<ASTNode> variable(const std::string &name) {
+            return std::make_unique<AtomNode>(Token(VARIABLE, name));
+        }
+        std::unique_ptr<ASTNode> unary(TokenType op, std::unique_ptr<ASTNode> operand) {
+            return std::make_unique<UnaryOpNode>(operatorToken(op), std::move(operand));
+        }
+        std::unique_ptr<ASTNode> binary(TokenType op, std::unique_ptr<ASTNode> left, std::unique_ptr<ASTNode> right) {
+            return std::make_unique<BinaryOpNode>(operatorToken(op), std::move(left), std::move(right));
+        }
+    };
+
+    struct TreeBuilder {
+        PTree integer(std::int64_t value) {
+            return PersistentNode::atom(Token(NUMBER, std::to_string(value)));
+        }
+        PTree number(const Token &token) {
+            return PersistentNode::atom(token);
+        }
+        PTree variable(const std::string &name) {
+            return PersistentNode::atom(Token(VARIABLE, name));
+        }
+        PTree unary(TokenType op, PTree operand) {
+            return PersistentNode::unary(operatorToken(op), std::move(operand));
+        }
+        PTree binary(TokenType op, PTree left, PTree right) {
+            return PersistentNode::binary(operatorToken(op), std::move(left), std::move(right));
+        }
+    };
+}
+
+std::uint32_t FlatTree::push(FlatNode node) {
+    this->nodes.push_back(node);
+    return static_cast<std::uint32_t>(this->nodes.size() - 1);
+}
+
+std::uint32_t FlatTree::symbolId(const std::string &name, std::unordered_map<std::string, std::uint32_t> &symbolIds) {
+    auto [it, inserted] = symbolIds.emplace(name, static_cast<std::uint32_t>(this->symbols.size()));
+    if (inserted) {
+        this->symbols.push_back(name);
+    }
+    return it->second;
+}
+
+std::uint32_t FlatTree::pushAtom(const Token &token, std::unordered_map<std::string, std::uint32_t> &symbolIds) {
+    FlatNode node{};
+    const std::string &text = token.getValue();
+    if (token.getType() == VARIABLE) {
+        node.tag = FlatTag::Variable;
+        node.first = this->symbolId(text, symbolIds);
+    } else if (token.getType() != NUMBER) {
+        throw std::runtime_error("Cannot flatten atom " + text);
+    } else if (text.size() <= 18 && text.find('/') == std::string::npos && Rational::isCanonical(text)) {
+        node.tag = FlatTag::Integer;
+        node.integer = std::stoll(text);
+    } else {
+        node.tag = FlatTag::Number;
+        node.first = static_cast<std::uint32_t>(this->numbers.size());
+        this->numbers.push_back(token);
+    }
+    return this->push(node);
+}
+
+template <typename Node>
+FlatTree FlatTree::build(const Node *root) {
+    FlatTree tree;
+    std::unordered_map<std::string, std::uint32_t> symbolIds;
+    // An operator is popped twice: first to queue its children, then (expanded) to be
+    // emitted once they are, their indices wait on built
+    std::vector<std::pair<const Node *, bool>> stack{{root, false}};
+    std::vector<std::uint32_t> built;
+    while (!stack.empty()) {
+        auto [node, expanded] = stack.back();
+        stack.pop_back();
+        NodeType type = node->getNodeType();
+        if (type == NodeType::Atom) {
+            built.push_back(tree.pushAtom(node->getToken(), symbolIds));
+            continue;
+        }
+        if (!expanded) {
+            stack.push_back({node, true});
+            if (type == NodeType::BinaryOp) {
+                stack.push_back({rightOf(node), false});
+            }
+            stack.push_back({leftOf(node), false});
+            continue;
+        }
+        FlatNode flat{};
+        flat.tag = type == NodeType::BinaryOp ? FlatTag::Binary : FlatTag::Unary;
+        flat.op = static_cast<std::uint8_t>(node->getToken().getType());
+        if (type == NodeType::BinaryOp) {
+            flat.second = built.back();
+            built.pop_back();
+        }
+        flat.first = built.back();
+        built.pop_back();
+        built.push_back(tree.push(flat));
+    }
+    return tree;
+}
+
+FlatTree FlatTree::fromAst(const ASTNode *root) {
+    return FlatTree::build(root);
+}
+
+FlatTree FlatTree::fromTree(const PTree &root) {
+    return FlatTree::build(root.get());
+}
+
+std::unique_ptr<ASTNode> FlatTree::toAst() const {
+    AstBuilder builder;
+    return this->reduce<std::unique_ptr<ASTNode>>(builder);
+}
+
+PTree FlatTree::toTree() const {
+    TreeBuilder builder;
+    return this->reduce<PTree>(builder);
+}
+
+std::string FlatTree::toString() const {
+    std::vector<std::string> numberTexts;
+    numberTexts.reserve(this->numbers.size());
+    for (const Token &token : this->numbers) {
+        // Same as AtomNode::write, non canonical numbers print in canonical form
+        const std::string &value = token.getValue();
+        numberTexts.push_back(Rational::isCanonical(value) ? value : Token::getNumericValue(token).toString());
+    }
+    // Two passes instead of an in-order walk: text length of every subtree (children first),
+    // then each node writes its own characters at its offset (parents first)
+    std::vector<std::uint32_t> length(this->nodes.size());
+    for (std::size_t i = 0; i < this->nodes.size(); i++) {
+        const FlatNode &node = this->nodes[i];
+        switch (node.tag) {
+            case FlatTag::Integer: {
+                char buffer[24];
+                length[i] = static_cast<std::uint32_t>(std::to_chars(buffer, buffer + sizeof(buffer), node.integer).ptr - buffer);
+                break;
+            }
+            case FlatTag::Number:
+                length[i] = static_cast<std::uint32_t>(numberTexts[node.first].size());
+                break;
+            case FlatTag::Variable:
+                length[i] = static_cast<std::uint32_t>(this->symbols[node.first].size());
+                break;
+            case FlatTag::Unary:
+                length[i] = 1 + length[node.first];
+                break;
+            case FlatTag::Binary:
+                // "(" left " op " right ")"
+                length[i] = length[node.first] + length[node.second] + 5;
+                break;
+        }
+    }
+    std::string out(length.back(), ' ');
+    std::vector<std::uint32_t> start(this->nodes.size());
+    for (std::size_t i = this->nodes.size(); i-- > 0;) {
+        const FlatNode &node = this->nodes[i];
+        char *at = &out[start[i]];
+        switch (node.tag) {
+            case FlatTag::Integer:
+                std::to_chars(at, at + length[i], node.integer);
+                break;
+            case FlatTag::Number:
+                numberTexts[node.first].copy(at, length[i]);
+                break;
+            case FlatTag::Variable:
+                this->symbols[node.first].copy(at, length[i]);
+                break;
+            case FlatTag::Unary:
+                at[0] = Token::operationToChr(static_cast<TokenType>(node.op));
+                start[node.first] = start[i] + 1;
+                break;
+            case FlatTag::Binary:
+                at[0] = '(';
+                start[node.first] = start[i] + 1;
+                // The spaces around the operator are already there
+                at[length[node.first] + 2] = Token::operationToChr(static_cast<TokenType>(node.op));
+                start[node.second] = start[node.first] + length[node.first] + 3;
+                at[length[i] - 1] = ')';
+                break;
+        }
+    }
+    return out;
+}
+
+std::size_t FlatTree::hash() const {
+    // ASTNode::hash XORs the hash of every node's text, the order does not matter
+    std::hash<std::string> hasher;
+    std::vector<std::size_t> symbolHashes;
+    symbolHashes.reserve(this->symbols.size());
+    for (const std::string &symbol : this->symbols) {
+        symbolHashes.push_back(hasher(symbol));
+    }
+    std::size_t result = 0;
+    for (const FlatNode &node : this->nodes) {
+        switch (node.tag) {
+            case FlatTag::Integer: {
+                std::string text;
+                writeInteger(text, node.integer);
+                result ^= hasher(text);
+                break;
+            }
+            case FlatTag::Number:
+                result ^= hasher(this->numbers[node.first].getValue());
+                break;
+            case FlatTag::Variable:
+                result ^= symbolHashes[node.first];
+                break;
+            case FlatTag::Unary:
+            case FlatTag::Binary:
+                result ^= operatorHashes()[node.op];
+                break;
+        }
+    }
+    return result;
+}
+
+bool FlatTree::operator==(const FlatTree &other) const {
+    if (this->nodes.size() != other.nodes.size()) {
+        return false;
+    }
+    // Both are post-order, equal trees have the same shape index for index
+    for (std::size_t i = 0; i < this->nodes.size(); i++) {
+        const FlatNode &a = this->nodes[i];
+        const FlatNode &b = other.nodes[i];
+        if (a.tag != b.tag) {
+            return false;
+        }
+        switch (a.tag) {
+            case FlatTag::Integer:
+                if (a.integer != b.integer) {
+                    return false;
+                }
+                break;
+            case FlatTag::Number:
+                if (this->numbers[a.first] != other.numbers[b.first]) {
+                    return false;
+                }
+                break;
+            case FlatTag::Variable:
+                if (this->symbols[a.first] != other.symbols[b.first]) {
+                    return false;
+                }
+                break;
+            case FlatTag::Unary:
+                if (a.op != b.op || a.first != b.first) {
+                    return false;
+                }
+                break;
+            case FlatTag::Binary:
+                if (a.op != b.op || a.first != b.first || a.second != b.second) {
+                    return false;
+                }
+                break;
+        }
+    }
+    return true;
+}
+
+int FlatTree::collectVariables(std::unordered_set<std::string> &vars) const {
+    int occurrences = 0;
+    for (const FlatNode &node : this->nodes) {
+        if (node.tag == FlatTag::Variable) {
+            vars.insert(this->symbols[node.first]);
+            occurrences++;
+        }
+    }
+    return occurrences;
+}
+
+std::uint32_t FlatTree::append(const FlatTree &other, std::unordered_map<std::string, std::uint32_t> &symbolIds) {
+    std::uint32_t offset = static_cast<std::uint32_t>(this->nodes.size());
+    for (FlatNode node : other.nodes) {
+        switch (node.tag) {
+            case FlatTag::Integer:
+                break;
+            case FlatTag::Number:
+                this->numbers.push_back(other.numbers[node.first]);
+                node.first = static_cast<std::uint32_t>(this->numbers.size() - 1);
+                break;
+            case FlatTag::Variable:
+                node.first = this->symbolId(other.symbols[node.first], symbolIds);
+                break;
+            case FlatTag::Binary:
+                node.second += offset;
+                node.first += offset;
+                break;
+            case FlatTag::Unary:
+                node.first += offset;
+                break;
+        }
+        this->push(node);
+    }
+    return static_cast<std::uint32_t>(this->nodes.size() - 1);
+}
+
+FlatTree FlatTree::substitute(const std::string &variable, const FlatTree &replacement) const {
+    std::uint32_t target = 0;
+    while (target < this->symbols.size() && this->symbols[target] != variable) {
+        target++;
+    }
+    if (target == this->symbols.size()) {
+        return *this;
+    }
+
+    FlatTree result;
+    result.nodes.reserve(this->nodes.size());
+    std::unordered_map<std::string, std::uint32_t> symbolIds;
+    // Old index -> new index, children always come before their parent
+    std::vector<std::uint32_t> moved(this->nodes.size());
+    for (std::size_t i = 0; i < this->nodes.size(); i++) {
+        FlatNode node = this->nodes[i];
+        switch (node.tag) {
+            case FlatTag::Integer:
+                break;
+            case FlatTag::Number:
+                result.numbers.push_back(this->numbers[node.first]);
+                node.first = static_cast<std::uint32_t>(result.numbers.size() - 1);
+                break;
+            case FlatTag::Variable:
+                if (node.first == target) {
+                    moved[i] = result.append(replacement, symbolIds);
+                    continue;
+                }
+                node.first = result.symbolId(this->symbols[node.first], symbolIds);
+                break;
+            case FlatTag::Binary:
+                node.second = moved[node.second];
+                node.first = moved[node.first];
+                break;
+            case FlatTag::Unary:
+                node.first = moved[node.first];
+                break;
+        }
+        moved[i] = result.push(node);
+    }
+    return result;
+}
+
+std::size_t FlatTree::bytes() const {
+    // Strings longer than the small string buffer hold a heap block too
+    auto stringBytes = [](const std::string &text) {
+        return text.capacity() > 15 ? text.capacity() + 1 : 0;
+    };
+    std::size_t total = sizeof(FlatTree) + this->nodes.capacity() * sizeof(FlatNode)
+        + this->symbols.capacity() * sizeof(std::string) + this->numbers.capacity() * sizeof(Token);
+    for (const std::string &symbol : this->symbols) {
+        total += stringBytes(symbol);
+    }
+    for (const Token &number : this->numbers) {
+        total += stringBytes(number.getValue());
+    }
+    return total;
+}
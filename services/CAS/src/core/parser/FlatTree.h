@@ -0,0 +1,133 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Nodes.h"
+#include "PersistentNode.h"
+
+enum class FlatTag : std::uint8_t {
+    // Number that fits in 63 bits and prints as itself, the value is stored inline
+    Integer,
+    // Any other number, index into the tree's number table
+    Number,
+    Variable,
+    Unary,
+    Binary,
+};
+
+/*
+* One node of a FlatTree, 16 bytes: no vtable, no Token string, no child pointers
+* Operators are their TokenType, variables an id into the tree's symbol table,
+* children are indices into the same vector
+*/
+struct FlatNode {
+    FlatTag tag;
+    // TokenType of Unary/Binary
+    std::uint8_t op;
+    // Unary: operand, Binary: left, Variable: symbol id, Number: index into the numbers
+    std::uint32_t first;
+    union {
+        // Integer
+        std::int64_t integer;
+        // Binary: right
+        std::uint32_t second;
+    };
+};
+static_assert(sizeof(FlatNode) == 16, "FlatNode is meant to stay at 16 bytes");
+
+/*
+* Expression tree in one contiguous vector, for read-only passes over large expressions
+* e.g. FlatTree::fromAst(parsed).reduce<Rational>(visitor)
+*
+* Nodes are stored in post-order (children before their parent, the root is last), so
+* a bottom-up pass is a single forward loop with a switch on the tag: no recursion, no
+* virtual calls and no pointer chasing. A tree is about 16 bytes per node plus one copy
+* of each distinct variable name, against a heap object with a vtable, a Token (with its
+* std::string) and child unique_ptrs per ASTNode.
+*
+* Immutable: rewrites (simplify, isolate) still run on ASTNode, convert with
+* fromAst/toAst or fromTree/toTree around them.
+*/
+class FlatTree {
+private:
+    std::vector<FlatNode> nodes;
+    std::vector<std::string> symbols;
+    // Number atoms that are not inline integers, kept as tokens so the text round-trips
+    std::vector<Token> numbers;
+
+    /* Iterative post-order copy of an ASTNode or PersistentNode tree */
+    template <typename Node>
+    static FlatTree build(const Node *root);
+    std::uint32_t push(FlatNode node);
+    std::uint32_t pushAtom(const Token &token, std::unordered_map<std::string, std::uint32_t> &symbolIds);
+    std::uint32_t symbolId(const std::string &name, std::unordered_map<std::string, std::uint32_t> &symbolIds);
+    /* Appends every node of other with its ids and indices translated, returns the new index of its root */
+    std::uint32_t append(const FlatTree &other, std::unordered_map<std::string, std::uint32_t> &symbolIds);
+
+public:
+    static FlatTree fromAst(const ASTNode *root);
+    static FlatTree fromTree(const PTree &root);
+    std::unique_ptr<ASTNode> toAst() const;
+    PTree toTree() const;
+
+    /*
+    * Bottom-up pass, one call per node, children first
+    * Visitor has integer(std::int64_t), number(const Token &), variable(const std::string &),
+    * unary(TokenType, Result) and binary(TokenType, Result, Result), each returning Result
+    */
+    template <typename Result, typename Visitor>
+    Result reduce(Visitor &visitor) const;
+
+    /* Same text as ASTNode::toString */
+    std::string toString() const;
+    /* Same value as ASTNode::hash */
+    std::size_t hash() const;
+    /* Structural, symbols compared by name */
+    bool operator==(const FlatTree &other) const;
+    bool operator!=(const FlatTree &other) const { return !(*this == other); }
+
+    /* Adds the variable names to vars, returns the number of occurrences */
+    int collectVariables(std::unordered_set<std::string> &vars) const;
+    /* Every occurrence of variable replaced by a copy of replacement */
+    FlatTree substitute(const std::string &variable, const FlatTree &replacement) const;
+
+    std::size_t size() const { return this->nodes.size(); }
+    std::uint32_t root() const { return static_cast<std::uint32_t>(this->nodes.size() - 1); }
+    const FlatNode &node(std::uint32_t index) const { return this->nodes[index]; }
+    const std::string &symbol(std::uint32_t id) const { return this->symbols[id]; }
+    const Token &number(std::uint32_t index) const { return this->numbers[index]; }
+    /* Heap and inline bytes held by the tree */
+    std::size_t bytes() const;
+};
+
+template <typename Result, typename Visitor>
+Result FlatTree::reduce(Visitor &visitor) const {
+    // In post-order every child's result is ready when its parent comes up
+    std::vector<Result> results(this->nodes.size());
+    for (std::size_t i = 0; i < this->nodes.size(); i++) {
+        const FlatNode &node = this->nodes[i];
+        switch (node.tag) {
+            case FlatTag::Integer:
+                results[i] = visitor.integer(node.integer);
+                break;
+            case FlatTag::Number:
+                results[i] = visitor.number(this->numbers[node.first]);
+                break;
+            case FlatTag::Variable:
+                results[i] = visitor.variable(this->symbols[node.first]);
+                break;
+            case FlatTag::Unary:
+                results[i] = visitor.unary(static_cast<TokenType>(node.op), std::move(results[node.first]));
+                break;
+            case FlatTag::Binary:
+                results[i] = visitor.binary(
+                    static_cast<TokenType>(node.op), std::move(results[node.first]), std::move(results[node.second])
+                );
+                break;
+        }
+    }
+    return std::move(results.back());
+}
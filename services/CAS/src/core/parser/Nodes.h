@@ -4,6 +4,7 @@
 #include <sstream>
 #include <iomanip>
 #include <cmath>
+#include <vector>
 
 enum class NodeType {
     Atom,
@@ -26,13 +27,39 @@ public:
         return this->getToken() == other.getToken() && this->getNodeType() == other.getNodeType();
     }
 
+protected:
+    /*
+    * Whole-tree walks with an explicit stack, the operator nodes forward to these
+    * Trees can be a million nodes deep (a long "x + 1 + 1 + ..."), too deep for recursion
+    */
+    static void writeTree(const ASTNode *root, std::string &out);
+    static std::unique_ptr<ASTNode> cloneTree(const ASTNode *root);
+    static std::size_t hashTree(const ASTNode *root);
+    static bool equalTrees(const ASTNode *a, const ASTNode *b);
+    /* Moves the children out, so destroying this node does not go down the tree */
+    virtual void releaseChildren(std::vector<std::unique_ptr<ASTNode>> &/*pending*/) {}
+    /* Destroys the subtrees one node at a time, each has no children left when it goes */
+    static void destroyTrees(std::vector<std::unique_ptr<ASTNode>> &pending);
+
+public:
+
     Token getToken() const { return token; }
     NodeType getNodeType() const { return type; }
 
     void setToken(const Token& newToken) { token = newToken; }
     void setType(const NodeType& newType) { type = newType; }
 
-    virtual std::string toString() = 0;
+    /* Fully parenthesized form, unique per tree, used as the key for dedupe and caches */
+    virtual std::string toString() {
+        std::string out;
+        if (this->type != NodeType::Atom) {
+            out.reserve(64);
+        }
+        this->write(out);
+        return out;
+    }
+    /* Append toString() to out, one buffer for the whole tree */
+    virtual void write(std::string &out) const = 0;
     virtual std::unique_ptr<ASTNode> clone() const = 0;
     virtual std::size_t hash() const {
         return std::hash<std::string>()(token.getValue()) ^ std::hash<int>()(static_cast<int>(type));
@@ -47,20 +74,16 @@ public:
         return this->getToken() == other.getToken();
     }
 
-    std::string toString() override {
-        if (getToken().getType() == NUMBER) {
-            double value = Token::getNumericValue(getToken());
-            // Check if the value is a whole number
-            if (value == std::floor(value)) {
-                return std::to_string(static_cast<long long>(value));
-            } else {
-                // Format with 3 decimal places
-                std::ostringstream oss;
-                oss << std::fixed << std::setprecision(3) << value;
-                return oss.str();
-            }
+    void write(std::string &out) const override {
+        // getToken() returns a copy, keep it alive while its text is read
+        const Token token = getToken();
+        const std::string &value = token.getValue();
+        // Tokens from the lexer and the simplifier are already canonical
+        if (token.getType() == NUMBER && !Rational::isCanonical(value)) {
+            out += Token::getNumericValue(token).toString();
+            return;
         }
-        return getToken().getValue();
+        out += value;
     }
 
     std::unique_ptr<ASTNode> clone() const override {
@@ -84,12 +107,16 @@ public:
             throw std::runtime_error("BinaryOpNode requires an operation token");
         }
     }
+    ~BinaryOpNode() override {
+        bool leaves = (!left || left->getNodeType() == NodeType::Atom) &&
+                      (!right || right->getNodeType() == NodeType::Atom);
+        if (leaves) return;
+        std::vector<std::unique_ptr<ASTNode>> pending;
+        this->releaseChildren(pending);
+        ASTNode::destroyTrees(pending);
+    }
     bool operator==(const ASTNode &other) const override {
-        if (other.getNodeType() != NodeType::BinaryOp) return false;
-        const BinaryOpNode &o = static_cast<const BinaryOpNode &>(other);
-        return this->getToken() == o.getToken() &&
-               *(this->left) == *(o.left) &&
-               *(this->right) == *(o.right);
+        return ASTNode::equalTrees(this, &other);
     }
 
     ASTNode *getLeft() const { return left.get(); }
@@ -105,23 +132,22 @@ public:
     std::unique_ptr<ASTNode>& getLeftRef() { return left; }
     std::unique_ptr<ASTNode>& getRightRef() { return right; }
 
-    std::string toString() override {
-        return "(" + left->toString() + 
-                " " + getToken().getValue() + " " + 
-                right->toString() + ")";
+    void write(std::string &out) const override {
+        ASTNode::writeTree(this, out);
     }
 
     std::unique_ptr<ASTNode> clone() const override {
-        return std::make_unique<BinaryOpNode>(
-            getToken(), 
-            left->clone(), 
-            right->clone()
-        );
+        return ASTNode::cloneTree(this);
     }
 
     std::size_t hash() const override {
-        return std::hash<std::string>()(getToken().getValue()) ^
-               left->hash() ^ right->hash();
+        return ASTNode::hashTree(this);
+    }
+
+protected:
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>> &pending) override {
+        if (left) pending.push_back(std::move(left));
+        if (right) pending.push_back(std::move(right));
     }
 };
 
@@ -136,11 +162,14 @@ public:
             throw std::runtime_error("UnaryOpNode requires a unary operation token");
         }
     }
+    ~UnaryOpNode() override {
+        if (!operand || operand->getNodeType() == NodeType::Atom) return;
+        std::vector<std::unique_ptr<ASTNode>> pending;
+        this->releaseChildren(pending);
+        ASTNode::destroyTrees(pending);
+    }
     bool operator==(const ASTNode &other) const override {
-        if (other.getNodeType() != NodeType::UnaryOp) return false;
-        const UnaryOpNode &o = static_cast<const UnaryOpNode &>(other);
-        return this->getToken() == o.getToken() &&
-               *(this->operand) == *(o.operand);
+        return ASTNode::equalTrees(this, &other);
     }
 
     ASTNode *getOperand() const { return operand.get(); }
@@ -150,44 +179,180 @@ public:
         operand = std::move(newOperand);
     }
 
-    std::string toString() override {
-        return getToken().getValue() + operand->toString();
+    void write(std::string &out) const override {
+        ASTNode::writeTree(this, out);
     }
 
     std::unique_ptr<ASTNode> clone() const override {
-        return std::make_unique<UnaryOpNode>(
-            getToken(), 
-            operand->clone()
-        );
+        return ASTNode::cloneTree(this);
     }
     
     std::size_t hash() const override {
-        return std::hash<std::string>()(getToken().getValue()) ^
-               operand->hash();
+        return ASTNode::hashTree(this);
+    }
+
+protected:
+    void releaseChildren(std::vector<std::unique_ptr<ASTNode>> &pending) override {
+        if (operand) pending.push_back(std::move(operand));
     }
 };
 
+inline void ASTNode::writeTree(const ASTNode *root, std::string &out) {
+    // Binary nodes still open, with whether their right operand is the one being written
+    std::vector<std::pair<const BinaryOpNode *, bool>> open;
+    const ASTNode *node = root;
+    while (true) {
+        // Down to the leftmost atom, writing what comes before each operand on the way
+        while (node->type != NodeType::Atom) {
+            if (node->type == NodeType::UnaryOp) {
+                out += node->token.getValue();
+                node = static_cast<const UnaryOpNode *>(node)->getOperand();
+            } else {
+                const BinaryOpNode *binary = static_cast<const BinaryOpNode *>(node);
+                out += '(';
+                open.push_back({binary, false});
+                node = binary->getLeft();
+            }
+        }
+        node->write(out);
+
+        while (!open.empty() && open.back().second) {
+            out += ')';
+            open.pop_back();
+        }
+        if (open.empty()) {
+            return;
+        }
+        const BinaryOpNode *binary = open.back().first;
+        open.back().second = true;
+        out += ' ';
+        out += binary->token.getValue();
+        out += ' ';
+        node = binary->getRight();
+    }
+}
+
+inline std::unique_ptr<ASTNode> ASTNode::cloneTree(const ASTNode *root) {
+    // Post-order, a node is copied once the copies of its operands are on built
+    std::vector<std::pair<const ASTNode *, bool>> pending = {{root, false}};
+    std::vector<std::unique_ptr<ASTNode>> built;
+    while (!pending.empty()) {
+        auto [node, expanded] = pending.back();
+        if (node->type == NodeType::Atom) {
+            pending.pop_back();
+            built.push_back(std::make_unique<AtomNode>(node->token));
+            continue;
+        }
+        if (!expanded) {
+            pending.back().second = true;
+            if (node->type == NodeType::BinaryOp) {
+                const BinaryOpNode *binary = static_cast<const BinaryOpNode *>(node);
+                pending.push_back({binary->getRight(), false});
+                pending.push_back({binary->getLeft(), false});
+            } else {
+                pending.push_back({static_cast<const UnaryOpNode *>(node)->getOperand(), false});
+            }
+            continue;
+        }
+        pending.pop_back();
+        std::unique_ptr<ASTNode> last = std::move(built.back());
+        built.pop_back();
+        if (node->type == NodeType::BinaryOp) {
+            std::unique_ptr<ASTNode> left = std::move(built.back());
+            built.pop_back();
+            built.push_back(std::make_unique<BinaryOpNode>(node->token, std::move(left), std::move(last)));
+        } else {
+            built.push_back(std::make_unique<UnaryOpNode>(node->token, std::move(last)));
+        }
+    }
+    return std::move(built.back());
+}
+
+inline std::size_t ASTNode::hashTree(const ASTNode *root) {
+    // XOR of every token's hash, the order of the walk does not matter
+    std::size_t hash = 0;
+    std::vector<const ASTNode *> pending = {root};
+    while (!pending.empty()) {
+        const ASTNode *node = pending.back();
+        pending.pop_back();
+        hash ^= std::hash<std::string>()(node->token.getValue());
+        if (node->type == NodeType::BinaryOp) {
+            const BinaryOpNode *binary = static_cast<const BinaryOpNode *>(node);
+            pending.push_back(binary->getLeft());
+            pending.push_back(binary->getRight());
+        } else if (node->type == NodeType::UnaryOp) {
+            pending.push_back(static_cast<const UnaryOpNode *>(node)->getOperand());
+        }
+    }
+    return hash;
+}
+
+inline bool ASTNode::equalTrees(const ASTNode *a, const ASTNode *b) {
+    std::vector<std::pair<const ASTNode *, const ASTNode *>> pending = {{a, b}};
+    while (!pending.empty()) {
+        auto [x, y] = pending.back();
+        pending.pop_back();
+        if (x->type != y->type || x->token != y->token) {
+            return false;
+        }
+        if (x->type == NodeType::BinaryOp) {
+            const BinaryOpNode *bx = static_cast<const BinaryOpNode *>(x);
+            const BinaryOpNode *by = static_cast<const BinaryOpNode *>(y);
+            pending.push_back({bx->getRight(), by->getRight()});
+            pending.push_back({bx->getLeft(), by->getLeft()});
+        } else if (x->type == NodeType::UnaryOp) {
+            pending.push_back({
+                static_cast<const UnaryOpNode *>(x)->getOperand(),
+                static_cast<const UnaryOpNode *>(y)->getOperand()
+            });
+        }
+    }
+    return true;
+}
+
+inline void ASTNode::destroyTrees(std::vector<std::unique_ptr<ASTNode>> &pending) {
+    while (!pending.empty()) {
+        std::unique_ptr<ASTNode> node = std::move(pending.back());
+        pending.pop_back();
+        node->releaseChildren(pending);
+    }
+}
+
 inline std::ostream &operator<<(std::ostream &os, const ASTNode &node) {
-    switch (node.getNodeType()) {
-    case NodeType::Atom:
-        os << node.getToken().getValue();
-        break;
-    case NodeType::BinaryOp: {
-        const BinaryOpNode &n = static_cast<const BinaryOpNode &>(node);
-        os << "(";
-        os << n.getToken().getValue() << " " << *(n.getLeft()) << " " << *(n.getRight());
-        os << ")";
-        break;
-    }
-
-    case NodeType::UnaryOp: {
-        const UnaryOpNode &n = static_cast<const UnaryOpNode &>(node);
-        os << "(" << n.getToken().getValue() << " " << *n.getOperand() << ")";
-        break;
-    }
-
-    default:
-        throw std::runtime_error("Unknown node type");
+    // Prefix form, e.g. (+ 1 (* 3 2)), either a node still to print or the text after one
+    std::vector<std::pair<const ASTNode *, const char *>> pending = {{&node, nullptr}};
+    while (!pending.empty()) {
+        auto [next, text] = pending.back();
+        pending.pop_back();
+        if (!next) {
+            os << text;
+            continue;
+        }
+        switch (next->getNodeType()) {
+        case NodeType::Atom:
+            os << next->getToken().getValue();
+            break;
+        case NodeType::BinaryOp: {
+            const BinaryOpNode &n = static_cast<const BinaryOpNode &>(*next);
+            os << "(" << n.getToken().getValue() << " ";
+            pending.push_back({nullptr, ")"});
+            pending.push_back({n.getRight(), nullptr});
+            pending.push_back({nullptr, " "});
+            pending.push_back({n.getLeft(), nullptr});
+            break;
+        }
+
+        case NodeType::UnaryOp: {
+            const UnaryOpNode &n = static_cast<const UnaryOpNode &>(*next);
+            os << "(" << n.getToken().getValue() << " ";
+            pending.push_back({nullptr, ")"});
+            pending.push_back({n.getOperand(), nullptr});
+            break;
+        }
+
+        default:
+            throw std::runtime_error("Unknown node type");
+        }
     }
     return os;
 }
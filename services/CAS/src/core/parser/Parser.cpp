@@ -1,60 +1,98 @@
 #include "Parser.h"
+#include <vector>
 
+namespace {
+    /*
+    * An operand the parser is in the middle of: what it was started by and the binding
+    * power to go back to once it is read
+    */
+    struct Pending {
+        enum Kind { Paren, Unary, Binary } kind;
+        float bp;
+        Token op;
+        // Binary: the left operand
+        std::unique_ptr<ASTNode> left;
+    };
+}
+
+/*
+* Pratt parser with its own stack instead of recursion, so the nesting depth is only bounded
+* by memory: "(((...)))", "- - - x" or the right operands of "a ^ b ^ c ^ ..."
+*/
 std::unique_ptr<ASTNode> Parser::parse(float cur_bp) {
-    std::unique_ptr<ASTNode> left;
     Lexer *lexer = this->getLexer();
-    Token token = lexer->getNextToken();
+    std::vector<Pending> pending;
+    std::unique_ptr<ASTNode> left;
 
-    if (Token::isAtom(token.getType())) {
-        left = std::make_unique<AtomNode>(token);
-    } else if (token.getType() == TokenType::LPARAN) {
-        left = Parser::parse(0);
-        token = lexer->getNextToken();
-        if (token.getType() != TokenType::RPARAN) {
-            throw std::runtime_error("Expected ')', got: " + token.getValue());
+    while (true) {
+        // Prefix: an atom ends the operand, a parenthesis or a unary operator opens a new one
+        Token token = lexer->getNextToken();
+        if (Token::isAtom(token.getType())) {
+            left = std::make_unique<AtomNode>(token);
+        } else if (token.getType() == TokenType::LPARAN) {
+            pending.push_back({Pending::Paren, cur_bp, token, nullptr});
+            cur_bp = 0;
+            continue;
+        } else if (Token::isUnaryOperation(token.getType())) {
+            auto [left_bp, right_bp] = Token::getBindingPower(token.getType());
+            pending.push_back({Pending::Unary, cur_bp, token, nullptr});
+            cur_bp = right_bp;
+            continue;
+        } else {
+            throw std::runtime_error("Unexpected token: " + token.getValue());
         }
-    } else if (Token::isUnaryOperation(token.getType())) {
-        auto [left_bp, right_bp] = Token::getBindingPower(token.getType());
-        std::unique_ptr<ASTNode> right = Parser::parse(right_bp);
-        left = std::make_unique<UnaryOpNode>(token, std::move(right));
-    } else {
-        throw std::runtime_error("Unexpected token: " + token.getValue());
-    }
 
-    while (true) {
-        token = lexer->peekNextToken();
-        bool implicitMultiply = false;
-        if (!Token::isOperation(token.getType())) {
-            if (Token::isAtom(token.getType()) ||
-                token.getType() == TokenType::LPARAN
-            ) {
-                token = Token(TokenType::MULTIPLY, "*");
-                implicitMultiply = true;
-            } else {
-                break;
+        // Infix: extend left while the operators bind tighter than cur_bp,
+        // then close the operand it completes and carry on with the enclosing one
+        while (true) {
+            token = lexer->peekNextToken();
+            bool implicitMultiply = false;
+            bool stop = false;
+            if (!Token::isOperation(token.getType())) {
+                if (Token::isAtom(token.getType()) ||
+                    token.getType() == TokenType::LPARAN
+                ) {
+                    token = Token(TokenType::MULTIPLY, "*");
+                    implicitMultiply = true;
+                } else {
+                    stop = true;
+                }
+            }
+            if (token.getType() == TokenType::END || token.getType() == TokenType::RPARAN) {
+                stop = true;
             }
-        }
-        if (token.getType() == TokenType::END) {
-            break;
-        }
-        if (token.getType() == TokenType::RPARAN) {
-            break;
-        }
 
-        auto [left_bp, right_bp] = Token::getBindingPower(token.getType());
-        if (left_bp < cur_bp) {
-            break;
-        }
-        if (implicitMultiply) {
-            // Do not consume the token, as it's not actually there
-        } else {
-            lexer->getNextToken(); // consume the operator
-        }
+            if (!stop) {
+                auto [left_bp, right_bp] = Token::getBindingPower(token.getType());
+                if (left_bp >= cur_bp) {
+                    if (implicitMultiply) {
+                        // Do not consume the token, as it's not actually there
+                    } else {
+                        lexer->getNextToken(); // consume the operator
+                    }
+                    // Read the right operand, the node is built when it is complete
+                    pending.push_back({Pending::Binary, cur_bp, token, std::move(left)});
+                    cur_bp = right_bp;
+                    break;
+                }
+            }
 
-        std::unique_ptr<ASTNode> right = Parser::parse(right_bp);
-        left = std::make_unique<BinaryOpNode>(token, std::move(left), std::move(right));
+            if (pending.empty()) {
+                return left;
+            }
+            Pending done = std::move(pending.back());
+            pending.pop_back();
+            cur_bp = done.bp;
+            if (done.kind == Pending::Paren) {
+                token = lexer->getNextToken();
+                if (token.getType() != TokenType::RPARAN) {
+                    throw std::runtime_error("Expected ')', got: " + token.getValue());
+                }
+            } else if (done.kind == Pending::Unary) {
+                left = std::make_unique<UnaryOpNode>(done.op, std::move(left));
+            } else {
+                left = std::make_unique<BinaryOpNode>(done.op, std::move(done.left), std::move(left));
+            }
+        }
     }
-
-    return left;
 }
-
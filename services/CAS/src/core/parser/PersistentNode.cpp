@@ -0,0 +1,293 @@
+#include "PersistentNode.h"
+#include <functional>
+
+PersistentNode::PersistentNode(Token token, NodeType type, PTree left, PTree right)
+    : token(std::move(token)), type(type), left(std::move(left)), right(std::move(right)) {
+    if (this->type == NodeType::Atom && this->token.getType() == TokenType::VARIABLE) {
+        this->variableMask = PersistentNode::variableBit(this->token.getValue());
+    }
+    if (this->left) {
+        this->variableMask |= this->left->variableMask;
+        this->nodeCount += this->left->nodeCount;
+    }
+    if (this->right) {
+        this->variableMask |= this->right->variableMask;
+        this->nodeCount += this->right->nodeCount;
+    }
+}
+
+thread_local std::vector<PTree> *PersistentNode::releasing = nullptr;
+
+PersistentNode::~PersistentNode() {
+    if (PersistentNode::releasing) {
+        if (this->left) {
+            PersistentNode::releasing->push_back(std::move(this->left));
+        }
+        if (this->right) {
+            PersistentNode::releasing->push_back(std::move(this->right));
+        }
+        return;
+    }
+    std::vector<PTree> pending;
+    PersistentNode::releasing = &pending;
+    if (this->left) {
+        pending.push_back(std::move(this->left));
+    }
+    if (this->right) {
+        pending.push_back(std::move(this->right));
+    }
+    while (!pending.empty()) {
+        PTree node = std::move(pending.back());
+        pending.pop_back();
+        // The last reference destroys the node here, which hands its children over
+        node.reset();
+    }
+    PersistentNode::releasing = nullptr;
+}
+
+std::uint64_t PersistentNode::variableBit(const std::string &variable) {
+    return std::uint64_t(1) << (std::hash<std::string>()(variable) % 64);
+}
+
+PTree PersistentNode::atom(Token token) {
+    return std::make_shared<const PersistentNode>(std::move(token), NodeType::Atom);
+}
+
+PTree PersistentNode::unary(Token op, PTree operand) {
+    return std::make_shared<const PersistentNode>(std::move(op), NodeType::UnaryOp, std::move(operand));
+}
+
+PTree PersistentNode::binary(Token op, PTree left, PTree right) {
+    return std::make_shared<const PersistentNode>(std::move(op), NodeType::BinaryOp, std::move(left), std::move(right));
+}
+
+PTree PersistentNode::freeze(const ASTNode *node) {
+    // Post-order, a node is built once its operands are on built
+    std::vector<std::pair<const ASTNode *, bool>> pending = {{node, false}};
+    std::vector<PTree> built;
+    while (!pending.empty()) {
+        auto [current, expanded] = pending.back();
+        if (current->getNodeType() == NodeType::Atom) {
+            pending.pop_back();
+            built.push_back(PersistentNode::atom(current->getToken()));
+            continue;
+        }
+        if (!expanded) {
+            pending.back().second = true;
+            if (current->getNodeType() == NodeType::BinaryOp) {
+                const BinaryOpNode *binaryNode = static_cast<const BinaryOpNode *>(current);
+                pending.push_back({binaryNode->getRight(), false});
+                pending.push_back({binaryNode->getLeft(), false});
+            } else {
+                pending.push_back({static_cast<const UnaryOpNode *>(current)->getOperand(), false});
+            }
+            continue;
+        }
+        pending.pop_back();
+        PTree last = std::move(built.back());
+        built.pop_back();
+        if (current->getNodeType() == NodeType::BinaryOp) {
+            PTree left = std::move(built.back());
+            built.pop_back();
+            built.push_back(PersistentNode::binary(current->getToken(), std::move(left), std::move(last)));
+        } else {
+            built.push_back(PersistentNode::unary(current->getToken(), std::move(last)));
+        }
+    }
+    return std::move(built.back());
+}
+
+std::unique_ptr<ASTNode> PersistentNode::thaw() const {
+    // Same as freeze the other way around
+    std::vector<std::pair<const PersistentNode *, bool>> pending = {{this, false}};
+    std::vector<std::unique_ptr<ASTNode>> built;
+    while (!pending.empty()) {
+        auto [current, expanded] = pending.back();
+        if (current->type == NodeType::Atom) {
+            pending.pop_back();
+            built.push_back(std::make_unique<AtomNode>(current->token));
+            continue;
+        }
+        if (!expanded) {
+            pending.back().second = true;
+            if (current->right) {
+                pending.push_back({current->right.get(), false});
+            }
+            pending.push_back({current->left.get(), false});
+            continue;
+        }
+        pending.pop_back();
+        std::unique_ptr<ASTNode> last = std::move(built.back());
+        built.pop_back();
+        if (current->type == NodeType::BinaryOp) {
+            std::unique_ptr<ASTNode> left = std::move(built.back());
+            built.pop_back();
+            built.push_back(std::make_unique<BinaryOpNode>(current->token, std::move(left), std::move(last)));
+        } else {
+            built.push_back(std::make_unique<UnaryOpNode>(current->token, std::move(last)));
+        }
+    }
+    return std::move(built.back());
+}
+
+template <typename Lookup>
+PTree PersistentNode::substituteImpl(const PTree &node, std::uint64_t mask, const Lookup &lookup) {
+    // Post-order, the new operands of a node are on built when it is rebuilt
+    std::vector<std::pair<const PTree *, bool>> pending = {{&node, false}};
+    std::vector<PTree> built;
+    while (!pending.empty()) {
+        auto [slot, expanded] = pending.back();
+        const PTree &current = *slot;
+        // Nothing to replace below, share the whole subtree
+        if ((current->variableMask & mask) == 0) {
+            pending.pop_back();
+            built.push_back(current);
+            continue;
+        }
+        if (current->type == NodeType::Atom) {
+            pending.pop_back();
+            const PTree *replacement = lookup(current->token.getValue());
+            built.push_back(replacement ? *replacement : current);
+            continue;
+        }
+        if (!expanded) {
+            pending.back().second = true;
+            if (current->right) {
+                pending.push_back({&current->right, false});
+            }
+            pending.push_back({&current->left, false});
+            continue;
+        }
+        pending.pop_back();
+        if (current->type == NodeType::UnaryOp) {
+            PTree operand = std::move(built.back());
+            built.pop_back();
+            built.push_back(operand == current->left ? current : PersistentNode::unary(current->token, std::move(operand)));
+            continue;
+        }
+        PTree right = std::move(built.back());
+        built.pop_back();
+        PTree left = std::move(built.back());
+        built.pop_back();
+        if (left == current->left && right == current->right) {
+            // Bloom false positive
+            built.push_back(current);
+        } else {
+            built.push_back(PersistentNode::binary(current->token, std::move(left), std::move(right)));
+        }
+    }
+    return std::move(built.back());
+}
+
+PTree PersistentNode::substitute(const PTree &root, const std::string &variable, const PTree &replacement) {
+    return PersistentNode::substituteImpl(root, PersistentNode::variableBit(variable), [&](const std::string &name) {
+        return name == variable ? &replacement : nullptr;
+    });
+}
+
+PTree PersistentNode::substitute(const PTree &root, const std::unordered_map<std::string, PTree> &bindings) {
+    std::uint64_t mask = 0;
+    for (const auto &[variable, replacement] : bindings) {
+        mask |= PersistentNode::variableBit(variable);
+    }
+    return PersistentNode::substituteImpl(root, mask, [&](const std::string &name) -> const PTree * {
+        auto it = bindings.find(name);
+        return it == bindings.end() ? nullptr : &it->second;
+    });
+}
+
+int PersistentNode::collectVariables(std::unordered_set<std::string> &vars) const {
+    if (this->variableMask == 0) {
+        return 0;
+    }
+    if (this->type == NodeType::Atom) {
+        vars.insert(this->token.getValue());
+        return 1;
+    }
+    // Post-order with a set per unfinished node, merged into its parent's when it is done,
+    // the root's children straight into vars
+    struct Frame {
+        const PersistentNode *node;
+        int stage;
+        std::unordered_set<std::string> vars;
+    };
+    std::vector<Frame> frames;
+    frames.push_back({this, 0, {}});
+    int occurrences = 0;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const PersistentNode *node = frame.node;
+        const PersistentNode *next = nullptr;
+        if (node->type == NodeType::Atom) {
+            frame.vars.insert(node->token.getValue());
+            occurrences++;
+        } else if (frame.stage == 0) {
+            next = node->left.get();
+        } else if (frame.stage == 1 && node->right) {
+            next = node->right.get();
+        }
+
+        if (next) {
+            frame.stage++;
+            // A subtree without variables adds nothing
+            if (next->variableMask != 0) {
+                frames.push_back({next, 0, {}});
+            }
+            continue;
+        }
+        std::unordered_set<std::string> done = std::move(frame.vars);
+        frames.pop_back();
+        if (frames.size() == 1) {
+            vars.merge(done);
+        } else if (!frames.empty()) {
+            frames.back().vars.merge(done);
+        }
+    }
+    return occurrences;
+}
+
+void PersistentNode::write(std::string &out) const {
+    // Like ASTNode::writeTree, binary nodes still open with whether their right operand is the one being written
+    std::vector<std::pair<const PersistentNode *, bool>> open;
+    const PersistentNode *node = this;
+    while (true) {
+        while (node->type != NodeType::Atom) {
+            if (node->type == NodeType::UnaryOp) {
+                out += node->token.getValue();
+            } else {
+                out += '(';
+                open.push_back({node, false});
+            }
+            node = node->left.get();
+        }
+        const std::string &value = node->token.getValue();
+        if (node->token.getType() == NUMBER && !Rational::isCanonical(value)) {
+            out += Token::getNumericValue(node->token).toString();
+        } else {
+            out += value;
+        }
+
+        while (!open.empty() && open.back().second) {
+            out += ')';
+            open.pop_back();
+        }
+        if (open.empty()) {
+            return;
+        }
+        const PersistentNode *binary = open.back().first;
+        open.back().second = true;
+        out += ' ';
+        out += binary->token.getValue();
+        out += ' ';
+        node = binary->right.get();
+    }
+}
+
+std::string PersistentNode::toString() const {
+    std::string out;
+    if (this->type != NodeType::Atom) {
+        out.reserve(64);
+    }
+    this->write(out);
+    return out;
+}
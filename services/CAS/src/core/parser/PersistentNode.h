@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "Nodes.h"
+
+class PersistentNode;
+using PTree = std::shared_ptr<const PersistentNode>;
+
+/*
+* Immutable, reference counted expression tree
+* Subtrees are shared freely between trees: an "edit" builds new nodes only on the
+* path from the root to the change (path copying) and points at the old subtrees
+* everywhere else. The solver keeps its states in this form and thaws a mutable
+* ASTNode copy only where the in-place simplifier/isolator have to run.
+*
+* Each node keeps a 64-bit bloom mask of the variables below it, so a subtree
+* that cannot contain a variable is skipped (and shared) without being walked.
+*/
+class PersistentNode {
+private:
+    Token token;
+    NodeType type;
+    // BinaryOp: left/right, UnaryOp: operand in left
+    PTree left;
+    PTree right;
+    std::uint64_t variableMask = 0;
+    std::size_t nodeCount = 1;
+
+    /*
+    * The children still to drop while a tree is being destroyed, null otherwise
+    * A node destroyed meanwhile leaves its children here instead of dropping them itself,
+    * so a deep tree goes one node at a time instead of one destructor inside the next
+    */
+    static thread_local std::vector<PTree> *releasing;
+
+    /* lookup(name) gives the replacement for a variable atom, or nullptr to keep it */
+    template <typename Lookup>
+    static PTree substituteImpl(const PTree &node, std::uint64_t mask, const Lookup &lookup);
+
+public:
+    PersistentNode(Token token, NodeType type, PTree left = nullptr, PTree right = nullptr);
+    ~PersistentNode();
+
+    static PTree atom(Token token);
+    static PTree unary(Token op, PTree operand);
+    static PTree binary(Token op, PTree left, PTree right);
+
+    /* Deep copy of a mutable tree */
+    static PTree freeze(const ASTNode *node);
+    /* Deep copy into a mutable tree, for the simplifier/isolator */
+    std::unique_ptr<ASTNode> thaw() const;
+
+    /*
+    * Replace every occurrence of variable, the tree itself is not modified
+    * Untouched subtrees are shared with the input, all occurrences share replacement,
+    * and the input is returned as is when the variable does not occur
+    */
+    static PTree substitute(const PTree &root, const std::string &variable, const PTree &replacement);
+    /*
+    * Every binding at once, in one traversal, e.g. {a: 2, b: c + 1}
+    * Replacements are inserted as given, a variable inside a replacement is not substituted again
+    */
+    static PTree substitute(const PTree &root, const std::unordered_map<std::string, PTree> &bindings);
+
+    static std::uint64_t variableBit(const std::string &variable);
+    /* False means the variable is definitely not in this subtree */
+    bool mayContain(const std::string &variable) const { return (variableMask & variableBit(variable)) != 0; }
+    /* Same for any of the variables OR-ed into mask */
+    bool mayContainAny(std::uint64_t mask) const { return (variableMask & mask) != 0; }
+    /* Exact, a tree without variables has an empty mask */
+    bool hasVariables() const { return variableMask != 0; }
+
+    const Token &getToken() const { return token; }
+    NodeType getNodeType() const { return type; }
+    const PTree &getLeft() const { return left; }
+    const PTree &getRight() const { return right; }
+    const PTree &getOperand() const { return left; }
+    /*
+    * Adds the variable names to vars, returns the number of occurrences
+    * Built like EquationSolver::extractVariables so the set iterates in the same order
+    */
+    int collectVariables(std::unordered_set<std::string> &vars) const;
+    /* Nodes reachable from here, shared subtrees counted once per reference */
+    std::size_t size() const { return nodeCount; }
+
+    /* Same text as ASTNode::toString, so keys match between the two forms */
+    void write(std::string &out) const;
+    std::string toString() const;
+};
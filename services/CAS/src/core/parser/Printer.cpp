@@ -0,0 +1,129 @@
+#include "Printer.h"
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+bool Printer::isFraction(const ASTNode *node) {
+    return node->getNodeType() == NodeType::Atom &&
+        node->getToken().getType() == TokenType::NUMBER &&
+        node->getToken().getValue().find('/') != std::string::npos;
+}
+
+bool Printer::bindingPower(const ASTNode *node, float &left, float &right) {
+    switch (node->getNodeType()) {
+        case NodeType::BinaryOp:
+            std::tie(left, right) = Token::getBindingPower(node->getToken().getType());
+            return true;
+        case NodeType::UnaryOp:
+            // Prefix, nothing binds from the left
+            left = std::numeric_limits<float>::infinity();
+            right = std::get<1>(Token::getBindingPower(node->getToken().getType()));
+            return true;
+        case NodeType::Atom:
+            if (Printer::isFraction(node)) {
+                std::tie(left, right) = Token::getBindingPower(TokenType::DIVIDE);
+                return true;
+            }
+            return false;
+    }
+    return false;
+}
+
+bool Printer::wrapRight(const ASTNode *parent, const ASTNode *child) {
+    float parentLeft, parentRight, childLeft, childRight;
+    if (!Printer::bindingPower(parent, parentLeft, parentRight) || !Printer::bindingPower(child, childLeft, childRight)) {
+        return false;
+    }
+    // The parser reads the operand with parentRight and stops at anything weaker
+    return childLeft < parentRight;
+}
+
+float Printer::rightEdge(const ASTNode *node) {
+    float edge = std::numeric_limits<float>::infinity();
+    while (node) {
+        float left, right;
+        if (!Printer::bindingPower(node, left, right)) {
+            break;
+        }
+        edge = std::min(edge, right);
+
+        const ASTNode *next = nullptr;
+        if (node->getNodeType() == NodeType::BinaryOp) {
+            next = static_cast<const BinaryOpNode *>(node)->getRight();
+        } else if (node->getNodeType() == NodeType::UnaryOp) {
+            next = static_cast<const UnaryOpNode *>(node)->getOperand();
+        }
+        // A parenthesized operand closes the edge
+        if (next && Printer::wrapRight(node, next)) {
+            break;
+        }
+        node = next;
+    }
+    return edge;
+}
+
+void Printer::write(const ASTNode *node, std::string &out) {
+    // Explicit stack, an operand's parenthesis is opened when it is started and closed when it is done
+    struct Frame {
+        const ASTNode *node;
+        int stage;
+        bool wrap;
+    };
+    std::vector<Frame> frames = {{node, 0, false}};
+    auto start = [&](const ASTNode *operand, bool wrap) {
+        if (wrap) out += '(';
+        frames.push_back({operand, 0, wrap});
+    };
+
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const ASTNode *current = frame.node;
+        if (current->getNodeType() == NodeType::Atom) {
+            current->write(out);
+        } else if (current->getNodeType() == NodeType::UnaryOp) {
+            if (frame.stage == 0) {
+                frame.stage = 1;
+                const ASTNode *operand = static_cast<const UnaryOpNode *>(current)->getOperand();
+                out += current->getToken().getValue();
+                start(operand, Printer::wrapRight(current, operand));
+                continue;
+            }
+        } else if (current->getNodeType() == NodeType::BinaryOp) {
+            const BinaryOpNode *binary = static_cast<const BinaryOpNode *>(current);
+            if (frame.stage == 0) {
+                frame.stage = 1;
+                float left, right;
+                Printer::bindingPower(current, left, right);
+
+                // The left operand would swallow this operator if its right edge binds looser
+                const ASTNode *lhs = binary->getLeft();
+                start(lhs, !(left < Printer::rightEdge(lhs)));
+                continue;
+            }
+            if (frame.stage == 1) {
+                frame.stage = 2;
+                out += ' ';
+                out += current->getToken().getValue();
+                out += ' ';
+
+                const ASTNode *rhs = binary->getRight();
+                start(rhs, Printer::wrapRight(current, rhs));
+                continue;
+            }
+        }
+
+        if (frame.wrap) out += ')';
+        frames.pop_back();
+    }
+}
+
+std::string Printer::print(const ASTNode *node) {
+    std::string out;
+    out.reserve(64);
+    Printer::write(node, out);
+    return out;
+}
+
+void Printer::print(const ASTNode *node, std::string &out) {
+    Printer::write(node, out);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include "Nodes.h"
+
+/*
+* Human readable output with only the parentheses the parser needs
+* Precedence and associativity come from Token::getBindingPower, so printing
+* and parsing the result gives back the same tree:
+*   ((x + (2 * (y - 1))) = 0) -> x + 2 * (y - 1) = 0
+*   (-(a + b))                -> -(a + b)
+*   ((-a) ^ 2)                -> (-a) ^ 2
+* Fractions print as p/q and are parenthesized like a division
+* toString() stays the fully parenthesized form, it is the dedupe/cache key
+*/
+class Printer {
+private:
+    /* How tightly the operator at node binds on each side, false for plain atoms */
+    static bool bindingPower(const ASTNode *node, float &left, float &right);
+    static bool isFraction(const ASTNode *node);
+
+    /* Parentheses needed around child when it is the right operand (or the unary operand) of parent */
+    static bool wrapRight(const ASTNode *parent, const ASTNode *child);
+    /*
+    * Lowest binding power on the printed right edge of node
+    * An operator after node is absorbed by it unless it binds weaker than this
+    */
+    static float rightEdge(const ASTNode *node);
+
+    static void write(const ASTNode *node, std::string &out);
+
+public:
+    static std::string print(const ASTNode *node);
+    /* Append to out instead of allocating a new string */
+    static void print(const ASTNode *node, std::string &out);
+};
@@ -0,0 +1,230 @@
+#include "CompiledEvaluator.h"
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+    // Registers are numbered per kind while compiling, constants are only all known at the end
+    enum class Kind : std::uint8_t { Variable, Constant, Temporary };
+
+    struct Operand {
+        Kind kind;
+        std::uint32_t index;
+    };
+
+    // Exponents up to this size are done by repeated squaring instead of std::pow
+    const double MAX_INTEGER_EXPONENT = 64;
+}
+
+double CompiledEvaluator::integerPower(double base, std::int64_t exponent) {
+    bool invert = exponent < 0;
+    std::uint64_t remaining = invert ? -exponent : exponent;
+    double result = 1;
+    while (remaining > 0) {
+        if (remaining & 1) {
+            result *= base;
+        }
+        base *= base;
+        remaining >>= 1;
+    }
+    return invert ? 1 / result : result;
+}
+
+CompiledEvaluator CompiledEvaluator::compile(const std::vector<PTree> &roots, const std::vector<std::string> &variables) {
+    CompiledEvaluator compiled;
+    compiled.numVariables = variables.size();
+
+    std::unordered_map<std::string, std::uint32_t> variableIndex;
+    for (std::size_t i = 0; i < variables.size(); i++) {
+        variableIndex.emplace(variables[i], static_cast<std::uint32_t>(i));
+    }
+    std::unordered_map<double, std::uint32_t> constantIndex;
+    std::unordered_map<const PersistentNode *, Operand> memo;
+    // Operands of program[i], resolved to registers once the constants are counted
+    std::vector<std::pair<Operand, Operand>> operands;
+
+    auto constant = [&](double value) {
+        auto it = constantIndex.find(value);
+        if (it != constantIndex.end()) {
+            return Operand{Kind::Constant, it->second};
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(compiled.constants.size());
+        compiled.constants.push_back(value);
+        constantIndex.emplace(value, index);
+        return Operand{Kind::Constant, index};
+    };
+
+    auto apply = [](Op op, double left, double right) {
+        switch (op) {
+            case Op::Add: return left + right;
+            case Op::Subtract: return left - right;
+            case Op::Multiply: return left * right;
+            case Op::Divide: return left / right;
+            case Op::Power: return std::pow(left, right);
+            case Op::IntegerPower: return CompiledEvaluator::integerPower(left, static_cast<std::int64_t>(right));
+            case Op::Negate: return -left;
+        }
+        return 0.0;
+    };
+
+    auto emit = [&](Op op, Operand left, Operand right) {
+        // Both sides known now, the result is one more constant
+        if (left.kind == Kind::Constant && (op == Op::Negate || right.kind == Kind::Constant)) {
+            double rightValue = op == Op::Negate ? 0 : compiled.constants[right.index];
+            return constant(apply(op, compiled.constants[left.index], rightValue));
+        }
+        if (op == Op::Power && right.kind == Kind::Constant) {
+            double exponent = compiled.constants[right.index];
+            if (exponent == std::floor(exponent) && std::fabs(exponent) <= MAX_INTEGER_EXPONENT) {
+                op = Op::IntegerPower;
+                right = Operand{Kind::Constant, static_cast<std::uint32_t>(static_cast<std::int32_t>(exponent))};
+            }
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(compiled.program.size());
+        compiled.program.push_back(Instruction{op, 0, 0});
+        operands.emplace_back(left, right);
+        return Operand{Kind::Temporary, index};
+    };
+
+    auto binaryOp = [](const Token &token) {
+        switch (token.getType()) {
+            case TokenType::PLUS: return Op::Add;
+            case TokenType::MINUS: return Op::Subtract;
+            case TokenType::MULTIPLY: return Op::Multiply;
+            case TokenType::DIVIDE: return Op::Divide;
+            case TokenType::POWER: return Op::Power;
+            default:
+                throw std::runtime_error("Unsupported operator in compiled expression: " + token.getValue());
+        }
+    };
+
+    // Post-order with an explicit stack, operands are emitted before the node that uses them
+    struct Frame {
+        const PTree *node;
+        int stage;
+    };
+    std::vector<Frame> frames;
+    auto visit = [&](const PTree &root) -> Operand {
+        if (memo.count(root.get()) == 0) {
+            frames.push_back({&root, 0});
+        }
+        while (!frames.empty()) {
+            Frame &frame = frames.back();
+            const PTree &node = *frame.node;
+            const PTree *next = nullptr;
+            if (frame.stage == 0 && node->getNodeType() != NodeType::Atom) {
+                if (node->getNodeType() == NodeType::BinaryOp) {
+                    binaryOp(node->getToken());
+                }
+                next = &node->getLeft();
+            } else if (frame.stage == 1 && node->getNodeType() == NodeType::BinaryOp) {
+                next = &node->getRight();
+            }
+            if (next) {
+                frame.stage++;
+                if (memo.count(next->get()) == 0) {
+                    frames.push_back({next, 0});
+                }
+                continue;
+            }
+            frames.pop_back();
+
+            Operand result;
+            const Token &token = node->getToken();
+            switch (node->getNodeType()) {
+                case NodeType::Atom: {
+                    if (token.getType() == TokenType::NUMBER) {
+                        result = constant(Token::getNumericValue(token).toDouble());
+                    } else {
+                        auto found = variableIndex.find(token.getValue());
+                        if (found == variableIndex.end()) {
+                            throw std::runtime_error("Unknown variable in compiled expression: " + token.getValue());
+                        }
+                        result = Operand{Kind::Variable, found->second};
+                    }
+                    break;
+                }
+                case NodeType::UnaryOp: {
+                    Operand operand = memo.at(node->getOperand().get());
+                    result = token.getType() == TokenType::MINUS ? emit(Op::Negate, operand, operand) : operand;
+                    break;
+                }
+                case NodeType::BinaryOp:
+                    result = emit(binaryOp(token), memo.at(node->getLeft().get()), memo.at(node->getRight().get()));
+                    break;
+            }
+            memo.emplace(node.get(), result);
+        }
+        return memo.at(root.get());
+    };
+
+    std::vector<Operand> outputs;
+    outputs.reserve(roots.size());
+    for (const PTree &root : roots) {
+        outputs.push_back(visit(root));
+    }
+
+    std::uint32_t constantBase = static_cast<std::uint32_t>(compiled.numVariables);
+    std::uint32_t temporaryBase = constantBase + static_cast<std::uint32_t>(compiled.constants.size());
+    auto registerOf = [&](Operand operand) {
+        switch (operand.kind) {
+            case Kind::Variable: return operand.index;
+            case Kind::Constant: return constantBase + operand.index;
+            case Kind::Temporary: return temporaryBase + operand.index;
+        }
+        return operand.index;
+    };
+    for (std::size_t i = 0; i < compiled.program.size(); i++) {
+        Instruction &instruction = compiled.program[i];
+        instruction.left = registerOf(operands[i].first);
+        instruction.right = instruction.op == Op::IntegerPower ? operands[i].second.index : registerOf(operands[i].second);
+    }
+    for (Operand output : outputs) {
+        compiled.outputs.push_back(registerOf(output));
+    }
+    return compiled;
+}
+
+void CompiledEvaluator::evaluate(const double *point, double *out, std::vector<double> &registers) const {
+    std::size_t constantBase = this->numVariables;
+    std::size_t temporaryBase = constantBase + this->constants.size();
+    registers.resize(temporaryBase + this->program.size());
+    double *r = registers.data();
+    for (std::size_t i = 0; i < this->numVariables; i++) {
+        r[i] = point[i];
+    }
+    for (std::size_t i = 0; i < this->constants.size(); i++) {
+        r[constantBase + i] = this->constants[i];
+    }
+
+    double *target = r + temporaryBase;
+    for (const Instruction &instruction : this->program) {
+        double left = r[instruction.left];
+        switch (instruction.op) {
+            case Op::Add: *target = left + r[instruction.right]; break;
+            case Op::Subtract: *target = left - r[instruction.right]; break;
+            case Op::Multiply: *target = left * r[instruction.right]; break;
+            case Op::Divide: *target = left / r[instruction.right]; break;
+            case Op::Power: *target = std::pow(left, r[instruction.right]); break;
+            case Op::IntegerPower:
+                *target = CompiledEvaluator::integerPower(left, static_cast<std::int32_t>(instruction.right));
+                break;
+            case Op::Negate: *target = -left; break;
+        }
+        target++;
+    }
+
+    for (std::size_t i = 0; i < this->outputs.size(); i++) {
+        out[i] = r[this->outputs[i]];
+    }
+}
+
+std::vector<double> CompiledEvaluator::evaluate(const std::vector<double> &point) const {
+    if (point.size() != this->numVariables) {
+        throw std::runtime_error("Expected " + std::to_string(this->numVariables) + " values, got " + std::to_string(point.size()));
+    }
+    std::vector<double> out(this->outputs.size());
+    std::vector<double> registers;
+    this->evaluate(point.data(), out.data(), registers);
+    return out;
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../parser/PersistentNode.h"
+
+/*
+* Expressions flattened into one straight-line program over doubles, for evaluating
+* the same expressions at many numeric points (e.g. a Jacobian inside Newton's method)
+*
+* Registers hold the variables (in the order given to compile), then the constants,
+* then one result per instruction. A subtree reachable from several roots through the
+* same pointer is computed once, so roots interned through one ExpressionDag share all
+* their common subexpressions. Nothing is parsed, hashed or allocated per evaluation.
+*
+* e.g. CompiledEvaluator f = CompiledEvaluator::compile({xy, x2}, {"x", "y"});
+*      std::vector<double> out = f.evaluate({3, 4});  // {x * y, x ^ 2} at x = 3, y = 4
+*/
+class CompiledEvaluator {
+private:
+    enum class Op : std::uint8_t {
+        Add,
+        Subtract,
+        Multiply,
+        Divide,
+        Power,
+        // right holds the exponent itself, not a register
+        IntegerPower,
+        Negate,
+    };
+
+    struct Instruction {
+        Op op;
+        std::uint32_t left;
+        std::uint32_t right;
+    };
+
+    std::size_t numVariables = 0;
+    std::vector<double> constants;
+    // Instruction i writes register numVariables + constants.size() + i
+    std::vector<Instruction> program;
+    std::vector<std::uint32_t> outputs;
+
+    static double integerPower(double base, std::int64_t exponent);
+
+public:
+    /* Throws when a root uses a variable that is not in variables, or % */
+    static CompiledEvaluator compile(const std::vector<PTree> &roots, const std::vector<std::string> &variables);
+
+    /*
+    * point has one value per variable, out one slot per root
+    * registers is scratch space, reused across calls to avoid allocating
+    */
+    void evaluate(const double *point, double *out, std::vector<double> &registers) const;
+    std::vector<double> evaluate(const std::vector<double> &point) const;
+
+    std::size_t variables() const { return numVariables; }
+    std::size_t size() const { return outputs.size(); }
+    std::size_t instructions() const { return program.size(); }
+};
@@ -0,0 +1,294 @@
+#include "Differentiator.h"
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_set>
+#include "ExpressionDag.h"
+#include "Simplifier.h"
+
+namespace {
+    bool isNumber(const PTree &node, const char *value) {
+        return node->getNodeType() == NodeType::Atom && node->getToken().getType() == NUMBER
+            && node->getToken().getValue() == value;
+    }
+
+    /* Value of a number or a negated number, e.g. 3 or -1/2 */
+    bool constantValue(const PTree &node, Rational &out) {
+        if (node->getNodeType() == NodeType::Atom) {
+            if (node->getToken().getType() != NUMBER) {
+                return false;
+            }
+            out = Token::getNumericValue(node->getToken());
+            return true;
+        }
+        if (node->getNodeType() == NodeType::UnaryOp && constantValue(node->getOperand(), out)) {
+            if (node->getToken().getType() == MINUS) {
+                out = -out;
+            }
+            return true;
+        }
+        return false;
+    }
+}
+
+PTree Differentiator::number(const Rational &value) {
+    PTree magnitude = PersistentNode::atom(Token::fromNumber(value));
+    return value.isNegative() ? PersistentNode::unary(Token(MINUS, "-"), magnitude) : magnitude;
+}
+
+PTree Differentiator::negate(const PTree &node) {
+    if (isNumber(node, "0")) {
+        return node;
+    }
+    if (node->getNodeType() == NodeType::UnaryOp && node->getToken().getType() == MINUS) {
+        return node->getOperand();
+    }
+    return PersistentNode::unary(Token(MINUS, "-"), node);
+}
+
+PTree Differentiator::add(const PTree &left, const PTree &right) {
+    if (isNumber(left, "0")) {
+        return right;
+    }
+    if (isNumber(right, "0")) {
+        return left;
+    }
+    return PersistentNode::binary(Token(PLUS, "+"), left, right);
+}
+
+PTree Differentiator::subtract(const PTree &left, const PTree &right) {
+    if (isNumber(right, "0")) {
+        return left;
+    }
+    if (isNumber(left, "0")) {
+        return Differentiator::negate(right);
+    }
+    return PersistentNode::binary(Token(MINUS, "-"), left, right);
+}
+
+PTree Differentiator::multiply(const PTree &left, const PTree &right) {
+    if (isNumber(left, "0") || isNumber(right, "1")) {
+        return left;
+    }
+    if (isNumber(right, "0") || isNumber(left, "1")) {
+        return right;
+    }
+    // Coefficients are multiplied out here, the simplifier leaves 2 * (3 * x) nested
+    Rational leftValue, rightValue;
+    bool leftConstant = constantValue(left, leftValue);
+    if (constantValue(right, rightValue)) {
+        return leftConstant ? Differentiator::number(leftValue * rightValue) : Differentiator::multiply(right, left);
+    }
+    if (leftConstant && right->getNodeType() == NodeType::BinaryOp && right->getToken().getType() == MULTIPLY
+        && constantValue(right->getLeft(), rightValue)) {
+        return Differentiator::multiply(Differentiator::number(leftValue * rightValue), right->getRight());
+    }
+    return PersistentNode::binary(Token(MULTIPLY, "*"), left, right);
+}
+
+PTree Differentiator::divide(const PTree &left, const PTree &right) {
+    if (isNumber(left, "0") || isNumber(right, "1")) {
+        return left;
+    }
+    return PersistentNode::binary(Token(DIVIDE, "/"), left, right);
+}
+
+PTree Differentiator::rule(const PTree &node, const std::string &variable, const PTree &dLeft, const PTree &dRight) {
+    PTree result;
+    const Token &token = node->getToken();
+    switch (node->getNodeType()) {
+        case NodeType::Atom:
+            result = Differentiator::number(Rational(token.getValue() == variable ? 1 : 0));
+            break;
+        case NodeType::UnaryOp:
+            result = token.getType() == MINUS ? Differentiator::negate(dLeft) : dLeft;
+            break;
+        case NodeType::BinaryOp: {
+            const PTree &left = node->getLeft();
+            const PTree &right = node->getRight();
+            switch (token.getType()) {
+                case PLUS:
+                    result = Differentiator::add(dLeft, dRight);
+                    break;
+                case MINUS:
+                    result = Differentiator::subtract(dLeft, dRight);
+                    break;
+                case MULTIPLY:
+                    // (f * g)' = f' * g + f * g'
+                    result = Differentiator::add(
+                        Differentiator::multiply(dLeft, right),
+                        Differentiator::multiply(left, dRight)
+                    );
+                    break;
+                case DIVIDE:
+                    if (isNumber(dRight, "0")) {
+                        result = Differentiator::divide(dLeft, right);
+                    } else {
+                        // (f / g)' = (f' * g - f * g') / g ^ 2
+                        result = Differentiator::divide(
+                            Differentiator::subtract(
+                                Differentiator::multiply(dLeft, right),
+                                Differentiator::multiply(left, dRight)
+                            ),
+                            PersistentNode::binary(Token(POWER, "^"), right, Differentiator::number(Rational(2)))
+                        );
+                    }
+                    break;
+                case POWER: {
+                    if (!isNumber(dRight, "0")) {
+                        // Would need ln f, which the grammar cannot write
+                        return nullptr;
+                    }
+                    // (f ^ n)' = n * f ^ (n - 1) * f'
+                    Rational exponent;
+                    PTree lowered;
+                    if (constantValue(right, exponent)) {
+                        Rational next = exponent - Rational(1);
+                        lowered = next.isOne() ? left : next.isZero() ? Differentiator::number(Rational(1))
+                            : PersistentNode::binary(Token(POWER, "^"), left, Differentiator::number(next));
+                    } else {
+                        lowered = PersistentNode::binary(
+                            Token(POWER, "^"), left, Differentiator::subtract(right, Differentiator::number(Rational(1)))
+                        );
+                    }
+                    result = Differentiator::multiply(Differentiator::multiply(right, dLeft), lowered);
+                    break;
+                }
+                default:
+                    throw std::runtime_error("Cannot differentiate operator " + token.getValue());
+            }
+            break;
+        }
+    }
+    return result;
+}
+
+PTree Differentiator::derive(const PTree &root, const std::string &variable, Memo &memo) {
+    // Post-order with an explicit stack, every finished node that has the variable goes
+    // into memo and its parent reads the operands' derivatives from there
+    PTree zero = Differentiator::number(Rational(0));
+    auto derived = [&](const PTree &node) -> const PTree & {
+        return node->mayContain(variable) ? memo.at(node.get()) : zero;
+    };
+    auto pending = [&](const PTree &node) {
+        return node->mayContain(variable) && memo.count(node.get()) == 0;
+    };
+    struct Frame {
+        const PTree *node;
+        int stage;
+    };
+    std::vector<Frame> frames;
+    if (pending(root)) {
+        frames.push_back({&root, 0});
+    }
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const PTree &node = *frame.node;
+        const PTree *next = nullptr;
+        if (frame.stage == 0 && node->getNodeType() != NodeType::Atom) {
+            next = &node->getLeft();
+        } else if (frame.stage == 1 && node->getNodeType() == NodeType::BinaryOp) {
+            next = &node->getRight();
+        }
+        if (next) {
+            frame.stage++;
+            if (pending(*next)) {
+                frames.push_back({next, 0});
+            }
+            continue;
+        }
+        frames.pop_back();
+        const PTree &dLeft = node->getNodeType() == NodeType::Atom ? zero : derived(node->getLeft());
+        const PTree &dRight = node->getNodeType() == NodeType::BinaryOp ? derived(node->getRight()) : zero;
+        // Nothing above a missing derivative has one either
+        memo.emplace(node.get(), dLeft && dRight ? Differentiator::rule(node, variable, dLeft, dRight) : nullptr);
+    }
+    return derived(root);
+}
+
+PTree Differentiator::simplified(const PTree &node) {
+    if (node->getNodeType() == NodeType::Atom) {
+        return node;
+    }
+    std::unique_ptr<ASTNode> mutableCopy = node->thaw();
+    Simplifier::simplify(mutableCopy);
+    return PersistentNode::freeze(mutableCopy.get());
+}
+
+PTree Differentiator::derivative(const PTree &node, const std::string &variable) {
+    Memo memo;
+    PTree derivative = Differentiator::derive(node, variable, memo);
+    if (!derivative) {
+        throw std::runtime_error("Cannot differentiate " + node->toString() + ": " + variable + " is in an exponent");
+    }
+    return Differentiator::simplified(derivative);
+}
+
+std::unique_ptr<ASTNode> Differentiator::derivative(const ASTNode *node, const std::string &variable) {
+    return Differentiator::derivative(PersistentNode::freeze(node), variable)->thaw();
+}
+
+PTree Differentiator::residual(const PTree &equation) {
+    if (equation->getNodeType() == NodeType::BinaryOp && equation->getToken().getType() == ASSIGN) {
+        return Differentiator::subtract(equation->getLeft(), equation->getRight());
+    }
+    return equation;
+}
+
+SparseJacobian Differentiator::jacobian(
+    const std::vector<PTree> &equations,
+    std::vector<std::string> variables,
+    bool allowNumeric
+) {
+    // One dag for everything: subtrees shared between equations are derived once per
+    // variable, and common subexpressions of all entries are compiled once
+    ExpressionDag dag;
+    SparseJacobian jacobian;
+    std::vector<std::unordered_set<std::string>> rowVariables(equations.size());
+    std::unordered_set<std::string> allVariables;
+    for (std::size_t row = 0; row < equations.size(); row++) {
+        jacobian.residuals.push_back(dag.intern(Differentiator::residual(equations[row])));
+        jacobian.residuals.back()->collectVariables(rowVariables[row]);
+        allVariables.insert(rowVariables[row].begin(), rowVariables[row].end());
+    }
+    if (variables.empty()) {
+        variables.assign(allVariables.begin(), allVariables.end());
+        std::sort(variables.begin(), variables.end());
+    }
+
+    std::unordered_map<std::string, Memo> memos;
+    jacobian.rowStart.push_back(0);
+    for (std::size_t row = 0; row < equations.size(); row++) {
+        for (std::size_t column = 0; column < variables.size(); column++) {
+            const std::string &variable = variables[column];
+            if (rowVariables[row].count(variable) == 0) {
+                continue;
+            }
+            PTree derivative = Differentiator::derive(jacobian.residuals[row], variable, memos[variable]);
+            if (!derivative) {
+                if (!allowNumeric) {
+                    throw std::runtime_error(
+                        "Cannot differentiate " + jacobian.residuals[row]->toString() + ": " + variable + " is in an exponent"
+                    );
+                }
+                jacobian.numericEntries.push_back(static_cast<int>(jacobian.columns.size()));
+                jacobian.columns.push_back(static_cast<int>(column));
+                jacobian.derivatives.push_back(Differentiator::number(Rational(0)));
+                continue;
+            }
+            derivative = dag.intern(Differentiator::simplified(derivative));
+            // A term that cancels out, e.g. x - x, is structurally but not actually present
+            if (isNumber(derivative, "0")) {
+                continue;
+            }
+            jacobian.columns.push_back(static_cast<int>(column));
+            jacobian.derivatives.push_back(std::move(derivative));
+        }
+        jacobian.rowStart.push_back(static_cast<int>(jacobian.columns.size()));
+    }
+
+    std::vector<PTree> outputs = jacobian.residuals;
+    outputs.insert(outputs.end(), jacobian.derivatives.begin(), jacobian.derivatives.end());
+    jacobian.compiled = CompiledEvaluator::compile(outputs, variables);
+    jacobian.variables = std::move(variables);
+    return jacobian;
+}
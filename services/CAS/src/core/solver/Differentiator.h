@@ -0,0 +1,74 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../parser/PersistentNode.h"
+#include "CompiledEvaluator.h"
+
+/*
+* Jacobian of the residuals lhs - rhs of a system, d residual[row] / d variables[column]
+* Only the non-zero entries are kept, in compressed rows: the entries of row i are
+* rowStart[i] .. rowStart[i + 1] - 1, with their columns and derivatives at the same positions
+*/
+struct SparseJacobian {
+    std::vector<std::string> variables;
+    std::vector<PTree> residuals;
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+    std::vector<PTree> derivatives;
+    /*
+    * Entries with no symbolic derivative (a variable in an exponent), only with allowNumeric
+    * Their derivative is 0, the value has to come from finite differences of the residual
+    */
+    std::vector<int> numericEntries;
+    /* Outputs: one residual per row, then the derivatives in entry order */
+    CompiledEvaluator compiled;
+
+    std::size_t rows() const { return residuals.size(); }
+    std::size_t entries() const { return derivatives.size(); }
+};
+
+/*
+* Symbolic derivatives, e.g. d/dx (x ^ 3 + 2 * x * y) -> 3 * x ^ 2 + 2 * y
+* Sum, product, quotient, chain and power rules. The grammar has no functions, so there is
+* no logarithm for a power whose exponent depends on the variable: derivative() throws for
+* it, like for %, and jacobian() can leave those entries to finite differences.
+*/
+class Differentiator {
+private:
+    using Memo = std::unordered_map<const PersistentNode *, PTree>;
+
+    /*
+    * Unsimplified derivative, memo is per variable and shares the work on shared subtrees
+    * nullptr when a power on the way has the variable in its exponent
+    */
+    static PTree derive(const PTree &root, const std::string &variable, Memo &memo);
+    /* One node's derivative from its operands' (dRight only for binary nodes) */
+    static PTree rule(const PTree &node, const std::string &variable, const PTree &dLeft, const PTree &dRight);
+    /* Builders that fold 0 and 1 away, so untouched branches do not leave 0 * x behind */
+    static PTree add(const PTree &left, const PTree &right);
+    static PTree subtract(const PTree &left, const PTree &right);
+    static PTree multiply(const PTree &left, const PTree &right);
+    static PTree divide(const PTree &left, const PTree &right);
+    static PTree negate(const PTree &node);
+    static PTree number(const Rational &value);
+    static PTree simplified(const PTree &node);
+
+public:
+    static std::unique_ptr<ASTNode> derivative(const ASTNode *node, const std::string &variable);
+    static PTree derivative(const PTree &node, const std::string &variable);
+
+    /* lhs - rhs for lhs = rhs, anything else is already a residual */
+    static PTree residual(const PTree &equation);
+    /*
+    * Every non-zero d residual / d variable of the system, compiled for repeated evaluation
+    * variables fixes the column order, empty means every variable of the system, sorted
+    * allowNumeric lists the entries with no symbolic derivative in numericEntries instead of throwing
+    */
+    static SparseJacobian jacobian(
+        const std::vector<PTree> &equations,
+        std::vector<std::string> variables = {},
+        bool allowNumeric = false
+    );
+};
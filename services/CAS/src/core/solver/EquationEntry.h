@@ -0,0 +1,58 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "../parser/PersistentNode.h"
+#include "StepTrace.h"
+
+/*
+* One search state, trees are persistent and shared with the states it was derived from
+* Copying an entry never copies a tree
+*/
+struct EquationEntry {
+    PTree equation;
+    std::unordered_set<std::string> vars;
+    int numVariables;
+    int distinctVariables;
+
+    // Mapping from variable to isolated equation
+    std::unordered_map<std::string, PTree> varToIsolatedEquation;
+
+    // Steps taken to reach this equation, shared with the entries it was cloned from
+    StepTrace steps;
+    // Substitutions taken to reach this equation
+    int depth = 0;
+
+    EquationEntry(
+        PTree eq,
+        std::unordered_set<std::string> vars,
+        int numVars,
+        int distinctVars,
+        std::unordered_map<std::string, PTree> varToIsolatedEquation = {},
+        StepTrace steps = StepTrace(),
+        int depth = 0
+    ) : equation(std::move(eq)), vars(vars), numVariables(numVars), distinctVariables(distinctVars), varToIsolatedEquation(std::move(varToIsolatedEquation)), steps(steps), depth(depth) {}
+
+    bool operator==(const EquationEntry &other) const {
+        return this->equation == other.equation || this->equation->toString() == other.equation->toString();
+    }
+
+    bool operator!=(const EquationEntry &other) const {
+        return !(*this == other);
+    }
+    
+    // Less variables -> higher priority
+    // Distinct variables take precedence
+    bool operator<(const EquationEntry &other) const {
+        if (this->distinctVariables == other.distinctVariables) {
+            return this->numVariables > other.numVariables;
+        }
+        return this->distinctVariables > other.distinctVariables;
+    }
+    
+    EquationEntry clone() const {
+        return *this;
+    }
+};
@@ -1,79 +1,118 @@
 #include "EquationSolver.h"
 #include <iostream>
-#include <queue>
 #include <climits>
+#include <chrono>
+#include <algorithm>
 #include "../../utils/ASTUtils.h"
 #include "../../utils/Debug.h"
 #include "../../utils/Config.h"
+#include "../parser/Printer.h"
+#include "ExpressionDag.h"
+#include "NewtonSolver.h"
+#include "PolynomialSolver.h"
+
+namespace {
+    /*
+    * The variables of a tree that keep accepts. Post-order with a set per unfinished node that its
+    * children are merged into when they are done, in the order the sets used to be merged in
+    * when this recursed, so the result iterates in the same order
+    */
+    template <typename Keep>
+    std::unordered_set<std::string> collectVariables(ASTNode *root, Keep keep) {
+        struct Frame {
+            ASTNode *node;
+            int stage;
+            std::unordered_set<std::string> vars;
+        };
+        std::vector<Frame> frames;
+        frames.push_back({root, 0, {}});
+        while (true) {
+            Frame &frame = frames.back();
+            ASTNode *node = frame.node;
+            ASTNode *next = nullptr;
+            if (node->getNodeType() == NodeType::Atom) {
+                if (node->getToken() == TokenType::VARIABLE && keep(node->getToken().getValue())) {
+                    frame.vars.insert(node->getToken().getValue());
+                }
+            } else if (node->getNodeType() == NodeType::BinaryOp) {
+                BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node);
+                if (frame.stage < 2) {
+                    next = frame.stage == 0 ? binaryNode->getLeft() : binaryNode->getRight();
+                }
+            } else if (node->getNodeType() == NodeType::UnaryOp) {
+                if (frame.stage == 0) {
+                    next = static_cast<UnaryOpNode *>(node)->getOperand();
+                }
+            }
 
-void EquationSolver::subsituteVariable(
-    std::unique_ptr<ASTNode>& equation,
-    const std::string &variable,
-    std::unique_ptr<ASTNode> substitution
-) {
-    if (equation->getNodeType() == NodeType::Atom) {
-        if (equation->getToken() == TokenType::VARIABLE &&
-            equation->getToken().getValue() == variable) {
-            equation = substitution->clone();
+            if (next) {
+                frame.stage++;
+                frames.push_back({next, 0, {}});
+                continue;
+            }
+            if (frames.size() == 1) {
+                return std::move(frame.vars);
+            }
+            std::unordered_set<std::string> vars = std::move(frame.vars);
+            frames.pop_back();
+            frames.back().vars.merge(vars);
         }
-    } else if (equation->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(equation.get());
-        EquationSolver::subsituteVariable(binaryNode->getLeftRef(), variable, substitution->clone());
-        EquationSolver::subsituteVariable(binaryNode->getRightRef(), variable, std::move(substitution));
-    } else if (equation->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(equation.get());
-        EquationSolver::subsituteVariable(unaryNode->getOperandRef(), variable, std::move(substitution));
     }
 }
 
-std::unordered_set<std::string> EquationSolver::extractVariables(std::unique_ptr<ASTNode>& node) {
-    std::unordered_set<std::string> vars;
-    if (node->getNodeType() == NodeType::Atom) {
-        if (node->getToken() == TokenType::VARIABLE) {
-            vars.insert(node->getToken().getValue());
+namespace {
+    /* "variable = value" for an answer only known numerically, the exact fraction of its 15 printed digits */
+    std::unique_ptr<ASTNode> numericResult(const std::string &variable, double approximate) {
+        Rational value = Rational::parse(NewtonSolver::formatValue(approximate));
+        std::unique_ptr<ASTNode> number = std::make_unique<AtomNode>(Token::fromNumber(value));
+        if (value.isNegative()) {
+            number = std::make_unique<UnaryOpNode>(Token(TokenType::MINUS, "-"), std::move(number));
         }
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        std::unordered_set<std::string> leftVars = EquationSolver::extractVariables(binaryNode->getLeftRef());
-        std::unordered_set<std::string> rightVars = EquationSolver::extractVariables(binaryNode->getRightRef());
-        vars.merge(leftVars);
-        vars.merge(rightVars);
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        std::unordered_set<std::string> operandVars = EquationSolver::extractVariables(unaryNode->getOperandRef());
-        vars.merge(operandVars);
+        return std::make_unique<BinaryOpNode>(
+            Token(TokenType::ASSIGN, "="),
+            std::make_unique<AtomNode>(Token(TokenType::VARIABLE, variable)),
+            std::move(number)
+        );
     }
+}
 
-    return vars;
+std::unordered_set<std::string> EquationSolver::extractVariables(std::unique_ptr<ASTNode>& node) {
+    return collectVariables(node.get(), [](const std::string &) { return true; });
 }
 
 void EquationSolver::reorderConstants(std::unique_ptr<ASTNode>& node) {
-    if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        TokenType opType = binaryNode->getToken().getType();
-
-        if (opType == TokenType::MULTIPLY) {
-            ASTNode *left = binaryNode->getLeft();
-            ASTNode *right = binaryNode->getRight();
-            if (!left || !right) {
-                std::cerr << "Corrupted child detected!" << std::endl;
-                return;
-            }
+    // Every multiplication is looked at once, the order does not matter
+    std::vector<ASTNode *> pending = {node.get()};
+    while (!pending.empty()) {
+        ASTNode *current = pending.back();
+        pending.pop_back();
+        if (current->getNodeType() == NodeType::BinaryOp) {
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current);
+            TokenType opType = binaryNode->getToken().getType();
+
+            if (opType == TokenType::MULTIPLY) {
+                ASTNode *left = binaryNode->getLeft();
+                ASTNode *right = binaryNode->getRight();
+                if (!left || !right) {
+                    std::cerr << "Corrupted child detected!" << std::endl;
+                    continue;
+                }
 
-            bool leftIsConst = left->getNodeType() == NodeType::Atom && 
-                static_cast<AtomNode *>(left)->getToken().getType() == TokenType::NUMBER;
-            bool rightIsConst = right->getNodeType() == NodeType::Atom && 
-                static_cast<AtomNode *>(right)->getToken().getType() == TokenType::NUMBER;
+                bool leftIsConst = left->getNodeType() == NodeType::Atom && 
+                    static_cast<AtomNode *>(left)->getToken().getType() == TokenType::NUMBER;
+                bool rightIsConst = right->getNodeType() == NodeType::Atom && 
+                    static_cast<AtomNode *>(right)->getToken().getType() == TokenType::NUMBER;
 
-            if (!leftIsConst && rightIsConst) {
-                std::swap(binaryNode->getLeftRef(), binaryNode->getRightRef());
+                if (!leftIsConst && rightIsConst) {
+                    std::swap(binaryNode->getLeftRef(), binaryNode->getRightRef());
+                }
             }
+            pending.push_back(binaryNode->getRight());
+            pending.push_back(binaryNode->getLeft());
+        } else if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current);
+            pending.push_back(unaryNode->getOperand());
         }
-        reorderConstants(binaryNode->getLeftRef());
-        reorderConstants(binaryNode->getRightRef());
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        reorderConstants(unaryNode->getOperandRef());
     }
 }
 
@@ -103,71 +142,242 @@ std::unique_ptr<ASTNode> EquationSolver::normalizeEquation(std::unique_ptr<ASTNo
 }
 
 std::unordered_set<std::string> EquationSolver::dependencies(const std::string &variable, std::unique_ptr<ASTNode>& equation) {
-    std::unordered_set<std::string> deps;
-    if (equation->getNodeType() == NodeType::Atom) {
-        if (equation->getToken() == TokenType::VARIABLE &&
-            equation->getToken().getValue() != variable) {
-            deps.insert(equation->getToken().getValue());
-        }
-    } else if (equation->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(equation.get());
-        std::unordered_set<std::string> leftDeps = EquationSolver::dependencies(
-            variable, 
-            binaryNode->getLeftRef()
-        );
-        std::unordered_set<std::string> rightDeps = EquationSolver::dependencies(
-            variable, 
-            binaryNode->getRightRef()
-        );
-        deps.merge(leftDeps);
-        deps.merge(rightDeps);
-    } else if (equation->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(equation.get());
-        std::unordered_set<std::string> operandDeps = EquationSolver::dependencies(
-            variable, 
-            unaryNode->getOperandRef()
-        );
-        deps.merge(operandDeps);
+    return collectVariables(equation.get(), [&](const std::string &name) { return name != variable; });
+}
+
+
+TerminationReason EquationSolver::terminationFor(BudgetStatus status) {
+    switch (status) {
+        case BudgetStatus::Cancelled: return TerminationReason::Cancelled;
+        case BudgetStatus::DeadlineExceeded: return TerminationReason::DeadlineExceeded;
+        case BudgetStatus::NodeLimitExceeded: return TerminationReason::NodeLimitExceeded;
+        case BudgetStatus::QueueLimitExceeded: return TerminationReason::QueueLimitExceeded;
+        case BudgetStatus::MemoryLimitExceeded: return TerminationReason::MemoryLimitExceeded;
+        default: return TerminationReason::QueueExhausted;
     }
+}
 
-    return deps;
+std::string SolveResult::answer() const {
+    if (!this->metrics.polynomial.answer.empty()) {
+        return this->metrics.polynomial.answer;
+    }
+    // The result holds the exact rational of the printed digits, the report prints them as they are
+    if (this->metrics.termination == TerminationReason::SolvedNumerically) {
+        return this->metrics.numeric.answer;
+    }
+    return this->result ? Printer::print(this->result.get()) : "";
 }
 
+PTree EquationSolver::prepareEquation(std::unique_ptr<ASTNode> equation) {
+    std::unique_ptr<ASTNode> normalized = EquationSolver::normalizeEquation(std::move(equation));
+    Simplifier::simplify(normalized);
+    return PersistentNode::freeze(normalized.get());
+}
 
-// TODO: This current approach is brute forcing with heuristic paths
-// We will implement further optimizations like Gauss elimination later
 SolveResult EquationSolver::solve(
     std::vector<std::unique_ptr<ASTNode>>& equations,
-    const std::string &variable
+    const std::string &variable,
+    const SolverOptions &options,
+    SolveBudget *budget,
+    const SolveObserver &observer
 ) {
+    std::vector<PTree> frozen;
+    frozen.reserve(equations.size());
+    for (std::unique_ptr<ASTNode> &eq : equations) {
+        frozen.push_back(PersistentNode::freeze(eq.get()));
+    }
+    return this->search(frozen, true, variable, options, budget, observer);
+}
+
+SolveResult EquationSolver::solvePrepared(
+    const std::vector<PTree> &equations,
+    const std::string &variable,
+    const SolverOptions &options,
+    SolveBudget *budget,
+    const SolveObserver &observer
+) {
+    return this->search(equations, false, variable, options, budget, observer);
+}
+
+// TODO: This current approach is brute forcing with heuristic paths
+// We will implement further optimizations like Gauss elimination later
+SolveResult EquationSolver::search(
+    const std::vector<PTree> &equations,
+    bool prepare,
+    const std::string &variable,
+    const SolverOptions &options,
+    SolveBudget *budget,
+    const SolveObserver &observer
+) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsedNs = [](Clock::time_point start) -> std::uint64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    };
+    auto solveStart = Clock::now();
+    SolveMetrics metrics;
+
+    // Simplifier and Isolator pick the budget up from the scope
+    if (budget) {
+        budget->start();
+    }
+    BudgetScope budgetScope(budget);
+
+    // Rough footprint of the stored states, only tracked with a memory limit
+    std::size_t storedBytes = 0;
+    auto entryBytes = [&](EquationEntry &entry) -> std::size_t {
+        if (!budget || budget->maxMemoryBytes == 0) {
+            return 0;
+        }
+        // Shared subtrees are counted for every state using them, an upper bound
+        return entry.equation->size() * sizeof(PersistentNode) + sizeof(EquationEntry);
+    };
+    auto overBudget = [&]() {
+        return budget && (budget->interrupted() || budget->checkMemory(storedBytes));
+    };
+
+    SearchFrontier queue(options);
+    // Only used with options.shareSubexpressions
+    ExpressionDag dag;
+
+    // Every simplify/isolate/clone of the search goes through these so it is counted
+    auto simplify = [&](std::unique_ptr<ASTNode> &node) {
+        auto start = Clock::now();
+        this->simplifier.simplify(node);
+        metrics.simplifyCalls++;
+        metrics.simplifyNs += elapsedNs(start);
+    };
+    auto isolate = [&](std::unique_ptr<ASTNode> &node, const std::string &var) {
+        auto start = Clock::now();
+        this->isolator.isolateVariable(node, var);
+        metrics.isolations++;
+        metrics.isolateNs += elapsedNs(start);
+    };
+    // Persistent copies of the states, hash-consed when sharing so equal trees are one pointer
+    auto freeze = [&](const ASTNode *node) {
+        return options.shareSubexpressions ? dag.intern(node) : PersistentNode::freeze(node);
+    };
+    auto substitute = [&](const PTree &tree, const std::string &var, const PTree &value) {
+        metrics.substitutions++;
+        return options.shareSubexpressions ? dag.substitute(tree, var, value) : PersistentNode::substitute(tree, var, value);
+    };
+    // Simplified / isolated copies, a tree the dag has seen before is not worked on again
+    auto simplifiedCopy = [&](const PTree &tree) {
+        if (options.shareSubexpressions) {
+            return dag.rewrite(tree, "simplify", simplify);
+        }
+        std::unique_ptr<ASTNode> work = tree->thaw();
+        simplify(work);
+        return PersistentNode::freeze(work.get());
+    };
+    auto isolatedCopy = [&](const PTree &tree, const std::string &var) {
+        auto rewrite = [&](std::unique_ptr<ASTNode> &node) {
+            isolate(node, var);
+            simplify(node);
+        };
+        if (options.shareSubexpressions) {
+            return dag.rewrite(tree, "isolate:" + var, rewrite);
+        }
+        std::unique_ptr<ASTNode> work = tree->thaw();
+        rewrite(work);
+        return PersistentNode::freeze(work.get());
+    };
+    auto sameEquation = [&](const EquationEntry &a, const EquationEntry &b) {
+        return options.shareSubexpressions ? a.equation == b.equation : a == b;
+    };
+    auto cloneEntry = [&](const EquationEntry &entry) {
+        metrics.clones++;
+        return entry.clone();
+    };
+    // Normalized and simplified, what the search starts from
+    std::vector<PTree> preparedEquations;
+    auto finish = [&](TerminationReason reason, std::unique_ptr<ASTNode> result, StepTrace steps) {
+        bool searchFailed = reason == TerminationReason::QueueExhausted || reason == TerminationReason::MaxIterations
+            || reason == TerminationReason::NoImprovement;
+        if (!result && searchFailed && options.numericFallback) {
+            // The prepared forms are usually far smaller than the input, so cheaper to differentiate
+            metrics.numeric = NewtonSolver::solveFor(preparedEquations, variable, options.newton, budget);
+            if (metrics.numeric.converged) {
+                reason = TerminationReason::SolvedNumerically;
+                result = numericResult(variable, metrics.numeric.values.at(variable));
+            }
+        }
+        metrics.termination = reason;
+        metrics.bestDistinctVariables = metrics.bestDistinctVariables == INT_MAX ? 0 : metrics.bestDistinctVariables;
+        metrics.totalNs = elapsedNs(solveStart);
+        metrics.searchNs = metrics.totalNs - metrics.normalizeNs;
+        metrics.statesPruned = queue.pruned();
+        metrics.sharedRewrites = static_cast<int>(dag.hits());
+        if (observer) {
+            std::string answer = !metrics.polynomial.answer.empty() ? metrics.polynomial.answer
+                : reason == TerminationReason::SolvedNumerically ? metrics.numeric.answer
+                : result ? Printer::print(result.get()) : "";
+            SolveEvent event{SolveEventKind::Finished, answer};
+            event.iteration = metrics.iterations;
+            event.queueSize = queue.size();
+            event.bestDistinctVariables = metrics.bestDistinctVariables;
+            event.steps = steps.render();
+            event.termination = reason;
+            observer(event);
+        }
+        return SolveResult{std::move(result), std::move(steps), metrics};
+    };
+    auto emit = [&](SolveEventKind kind, EquationEntry &entry) {
+        SolveEvent event{kind, options.recordSteps ? entry.steps.latest() : Printer::print(entry.equation->thaw().get())};
+        event.iteration = metrics.iterations;
+        event.queueSize = queue.size();
+        event.bestDistinctVariables = metrics.bestDistinctVariables == INT_MAX ? 0 : metrics.bestDistinctVariables;
+        observer(event);
+    };
+    auto finishOverBudget = [&]() {
+        return finish(EquationSolver::terminationFor(budget->getStatus()), nullptr, {});
+    };
+
     // Normalize and simplify equations
-    std::priority_queue<EquationEntry> queue;
     std::unordered_map<std::string, std::vector<EquationEntry>> varToEquation;
     int i = 0;
-    for (auto &eq : equations) {
-        std::unique_ptr<ASTNode> normalized = EquationSolver::normalizeEquation(std::move(eq));
-        this->simplifier.simplify(normalized);
+    for (const PTree &eq : equations) {
+        PTree prepared;
+        if (prepare) {
+            std::unique_ptr<ASTNode> normalized = EquationSolver::normalizeEquation(eq->thaw());
+            simplify(normalized);
+            prepared = freeze(normalized.get());
+        } else {
+            prepared = options.shareSubexpressions ? dag.intern(eq) : eq;
+        }
+        preparedEquations.push_back(prepared);
         
-        std::unordered_set<std::string> vars = EquationSolver::extractVariables(normalized);
-        int numVars = ASTUtils::countVariableOccurrences(normalized);
-        int distinctVars = ASTUtils::countDistinctVariables(normalized);
-
-        bool containsVar = ASTUtils::containsVariable(normalized, variable);
-        EquationEntry entry(std::move(normalized), vars, numVars, distinctVars);
-        entry.steps.push_back("Start: " + entry.equation->toString());
+        std::unordered_set<std::string> vars;
+        int numVars = prepared->collectVariables(vars);
+        int distinctVars = static_cast<int>(vars.size());
+
+        bool containsVar = vars.count(variable) > 0;
+        EquationEntry entry(prepared, vars, numVars, distinctVars);
+        if (options.recordSteps) {
+            entry.steps.record(StepKind::Start, "", entry.equation);
+        }
 
         // Build graph connections
         // Eq 1: a = b + c (variables: a,b,c)
         // Eq 2: b = 2 * d (variables: b,d)
         // Eq 1 and 2 are connected because they share variable b
         for (const std::string &var : vars) {
-            varToEquation[var].push_back(entry.clone());
+            varToEquation[var].push_back(cloneEntry(entry));
+            storedBytes += entryBytes(entry);
         }
         if (containsVar) {
+            if (observer) {
+                emit(SolveEventKind::Started, entry);
+            }
+            storedBytes += entryBytes(entry);
             queue.push(std::move(entry));
         }
         i++;
+        if (overBudget()) {
+            return finishOverBudget();
+        }
     }
+    metrics.normalizeNs = elapsedNs(solveStart);
+    metrics.peakQueueSize = queue.size();
 
     // for (const auto& [var, eqs] : varToEquation) {
     //     dbg(var, eqs);
@@ -185,24 +395,34 @@ SolveResult EquationSolver::solve(
 
     int iterations = 0;
     std::unordered_set<std::string> visited;
-    int bestDistinctVars = INT_MAX;
+    std::unordered_set<const PersistentNode *> visitedShared;
+    // Constant values found by the 1-variable branch, applied together on every substitution
+    std::unordered_map<std::string, PTree> knownValues;
+    int &bestDistinctVars = metrics.bestDistinctVariables;
+    bestDistinctVars = INT_MAX;
     int iterationsSinceImprovement = 0;
     
     while (!queue.empty()){
         iterations++;
-        if (iterations > Config::MAX_ITERATIONS_CONVERGE_SOLVE) {
-            std::cerr << "Max iterations reached in EquationSolver::solve" << std::endl;
-            return {nullptr, {}};
+        metrics.iterations = iterations;
+        if (iterations > options.maxIterations) {
+            return finish(TerminationReason::MaxIterations, nullptr, {});
+        }
+        if (overBudget() || (budget && budget->checkQueue(queue.size()))) {
+            return finishOverBudget();
         }
-        EquationEntry entry = queue.top().clone();
-        queue.pop();
+        EquationEntry entry = queue.pop();
+        storedBytes -= std::min(storedBytes, entryBytes(entry));
 
         // Already did this one
-        std::string eqStr = entry.equation->toString();
-        if (visited.count(eqStr) > 0) {
+        bool seen = options.shareSubexpressions
+            ? !visitedShared.insert(entry.equation.get()).second
+            : !visited.insert(entry.equation->toString()).second;
+        if (seen) {
+            metrics.duplicatesSkipped++;
             continue;
         }
-        visited.insert(eqStr);
+        metrics.statesExpanded++;
 
         // dbg(entry.equation->toString(), entry.vars, entry.numVariables, entry.distinctVariables);
 
@@ -215,24 +435,84 @@ SolveResult EquationSolver::solve(
             // that contains the target variable, these are promising
             if (!(entry.distinctVariables == 2 && entry.vars.count(variable) > 0)) {
                 iterationsSinceImprovement++;
-                if (iterationsSinceImprovement > Config::MAX_ITERATIONS_WITHOUT_IMPROVEMENT) {
-                    std::cerr << "Stuck at " << bestDistinctVars << " variables after " 
-                              << Config::MAX_ITERATIONS_WITHOUT_IMPROVEMENT << " iterations without improvement" << std::endl;
-                    return {nullptr, {}};
+                if (iterationsSinceImprovement > options.maxIterationsWithoutImprovement) {
+                    return finish(TerminationReason::NoImprovement, nullptr, {});
+                }
+            }
+        }
+        if (observer) {
+            emit(SolveEventKind::Expanded, entry);
+        }
+
+        // Only the target left, e.g. x ^ 2 + 3 * x = 10: when it is a polynomial of degree 2
+        // or more, which isolation cannot undo, every real root is taken at once
+        std::vector<Rational> coefficients;
+        if (options.polynomialRoots && entry.distinctVariables == 1
+            && entry.vars.count(variable) == 1 && PolynomialSolver::coefficients(entry.equation, variable, coefficients)
+            && coefficients.size() > 2) {
+            auto start = Clock::now();
+            std::vector<PolynomialRoot> roots = PolynomialSolver::realRoots(coefficients);
+            PolynomialReport &report = metrics.polynomial;
+            report.attempted = true;
+            report.degree = static_cast<int>(coefficients.size()) - 1;
+            report.roots.clear();
+            report.answer.clear();
+            for (const PolynomialRoot &root : roots) {
+                report.roots.push_back(root.text);
+                report.answer += (report.answer.empty() ? "" : " or ") + variable + " = " + root.text;
+            }
+            report.totalNs = elapsedNs(start);
+            if (roots.empty()) {
+                // No real root, no rewrite of this equation will find one either
+                continue;
+            }
+            // The result tree holds the smallest root with an exact form, the report all of them
+            std::unique_ptr<ASTNode> solved;
+            for (const PolynomialRoot &root : roots) {
+                if (root.exact) {
+                    solved = PersistentNode::binary(
+                        Token(ASSIGN, "="), PersistentNode::atom(Token(VARIABLE, variable)), root.exact
+                    )->thaw();
+                    break;
                 }
             }
+            if (!solved) {
+                // Only numeric roots, the smallest one as a fraction of its printed digits
+                solved = numericResult(variable, roots.front().value);
+            }
+            if (options.recordSteps) {
+                // Every root, as the answer shows them
+                entry.steps.record(StepKind::Solved, variable, report.answer);
+            }
+            return finish(TerminationReason::Solved, std::move(solved), entry.steps);
         }
 
         // No more dependencies, final result - but only if it's the variable we're solving for!
         if (entry.numVariables == 1 && entry.vars.count(variable) == 1) {
-            std::unique_ptr<ASTNode> isolated = entry.equation->clone();
+            std::unique_ptr<ASTNode> isolated = entry.equation->thaw();
             // dbg("Initial", isolated->toString());
-            this->isolator.isolateVariable(isolated, variable);
+            isolate(isolated, variable);
             // dbg("Isolated", isolated->toString());
-            this->simplifier.simplify(isolated);
+            simplify(isolated);
             // dbg("Simplify", isolated->toString());
-            entry.steps.push_back("Solved: " + isolated->toString());
-            return {std::move(isolated), entry.steps};
+            if (overBudget()) {
+                return finishOverBudget();
+            }
+            // Only "variable = expression without it" is an answer, e.g. 2 ^ x = 8 stays as it is
+            // and is left to the numeric fallback once the search runs out
+            PTree result = PersistentNode::freeze(isolated.get());
+            bool isolatedTarget = result->getNodeType() == NodeType::BinaryOp && result->getLeft()->toString() == variable;
+            std::unordered_set<std::string> rightVars;
+            if (isolatedTarget) {
+                result->getRight()->collectVariables(rightVars);
+            }
+            if (!isolatedTarget || rightVars.count(variable) > 0) {
+                continue;
+            }
+            if (options.recordSteps) {
+                entry.steps.record(StepKind::Solved, variable, result);
+            }
+            return finish(TerminationReason::Solved, std::move(isolated), entry.steps);
         }
         
         // If we have a 1-variable equation but it's not our target:
@@ -242,21 +522,26 @@ SolveResult EquationSolver::solve(
             std::string solvedVar = *entry.vars.begin();
             
             // Isolate this variable to get its value
-            std::unique_ptr<ASTNode> isolated = entry.equation->clone();
-            this->isolator.isolateVariable(isolated, solvedVar);
-            this->simplifier.simplify(isolated);
+            PTree solved = isolatedCopy(entry.equation, solvedVar);
             
-            // Extract the value (right side of assignment)
-            if (isolated->getNodeType() == NodeType::BinaryOp) {
-                BinaryOpNode* assignNode = static_cast<BinaryOpNode*>(isolated.get());
-                std::unique_ptr<ASTNode> solvedValue = assignNode->getRightRef()->clone();
+            // Extract the value (right side of assignment), only when isolation got "solvedVar = ..."
+            // Anything else is not its value and must not be stored or substituted
+            if (
+                solved->getNodeType() == NodeType::BinaryOp &&
+                solved->getLeft()->toString() == solvedVar
+            ) {
+                // One copy, shared by every equation it is substituted into
+                PTree solvedValue = solved->getRight();
+                if (!solvedValue->hasVariables()) {
+                    knownValues[solvedVar] = solvedValue;
+                }
                 
                 // Now substitute this into ALL related equations that contain this variable
                 if (varToEquation.find(solvedVar) != varToEquation.end()) {
                     std::vector<EquationEntry>& relatedEqs = varToEquation.at(solvedVar);
                     for (EquationEntry& relatedEq : relatedEqs) {
                         // Skip if it's the same equation or if it doesn't help us get to target
-                        if (relatedEq.equation->toString() == entry.equation->toString()) {
+                        if (sameEquation(relatedEq, entry)) {
                             continue;
                         }
                         if (relatedEq.vars.count(variable) == 0) {
@@ -265,25 +550,62 @@ SolveResult EquationSolver::solve(
                         }
                         
                         // Create new entry with substitution
-                        EquationEntry newEntry = relatedEq.clone();
-                        EquationSolver::subsituteVariable(newEntry.equation, solvedVar, solvedValue->clone());
-                        this->simplifier.simplify(newEntry.equation);
+                        EquationEntry newEntry = cloneEntry(relatedEq);
+                        // Every known value in one pass and one simplify, instead of one round per variable
+                        PTree substituted;
+                        if (knownValues.count(solvedVar) == 0) {
+                            substituted = substitute(relatedEq.equation, solvedVar, solvedValue);
+                        } else if (options.shareSubexpressions) {
+                            metrics.substitutions++;
+                            substituted = dag.substitute(relatedEq.equation, knownValues);
+                        } else {
+                            metrics.substitutions++;
+                            substituted = PersistentNode::substitute(relatedEq.equation, knownValues);
+                        }
+                        PTree work = simplifiedCopy(substituted);
+                        if (overBudget()) {
+                            return finishOverBudget();
+                        }
                         
-                        int newNumVars = ASTUtils::countVariableOccurrences(newEntry.equation);
-                        int newDistinctVars = ASTUtils::countDistinctVariables(newEntry.equation);
+                        std::unordered_set<std::string> newVars;
+                        int newNumVars = work->collectVariables(newVars);
+                        int newDistinctVars = static_cast<int>(newVars.size());
                         
                         // Only add if it reduces complexity
                         if (newDistinctVars < relatedEq.distinctVariables) {
                             newEntry.numVariables = newNumVars;
                             newEntry.distinctVariables = newDistinctVars;
-                            newEntry.vars = EquationSolver::extractVariables(newEntry.equation);
+                            newEntry.vars = std::move(newVars);
+                            newEntry.equation = work;
+                            newEntry.depth++;
+                            if (options.recordSteps) {
+                                // "a, b" when several known values went in together
+                                std::string names = solvedVar;
+                                if (knownValues.count(solvedVar) > 0) {
+                                    std::vector<std::string> known;
+                                    for (const std::string &v : relatedEq.vars) {
+                                        if (knownValues.count(v) > 0) {
+                                            known.push_back(v);
+                                        }
+                                    }
+                                    std::sort(known.begin(), known.end());
+                                    names.clear();
+                                    for (const std::string &name : known) {
+                                        names += (names.empty() ? "" : ", ") + name;
+                                    }
+                                }
+                                newEntry.steps.record(StepKind::Substitute, names, newEntry.equation);
+                            }
                             
                             // Add to varToEquation map
                             for (const std::string &v : newEntry.vars) {
-                                varToEquation[v].push_back(newEntry.clone());
+                                varToEquation[v].push_back(cloneEntry(newEntry));
+                                storedBytes += entryBytes(newEntry);
                             }
                             
+                            storedBytes += entryBytes(newEntry);
                             queue.push(std::move(newEntry));
+                            metrics.peakQueueSize = std::max(metrics.peakQueueSize, queue.size());
                         }
                     }
                 }
@@ -304,14 +626,20 @@ SolveResult EquationSolver::solve(
             // Already use this variable
             if (entry.varToIsolatedEquation.find(var) != entry.varToIsolatedEquation.end()) {
                 // Replace this var with the already isolated equation
-                std::unique_ptr<ASTNode> substitution = entry.varToIsolatedEquation.at(var)->clone();
-                EquationSolver::subsituteVariable(entry.equation, var, std::move(substitution));
-                this->simplifier.simplify(entry.equation);
-                entry.steps.push_back("Substitute " + var + ": " + entry.equation->toString());
-                entry.numVariables = ASTUtils::countVariableOccurrences(entry.equation);
-                entry.distinctVariables = ASTUtils::countDistinctVariables(entry.equation);
-                entry.vars = EquationSolver::extractVariables(entry.equation);
+                entry.equation = simplifiedCopy(substitute(entry.equation, var, entry.varToIsolatedEquation.at(var)));
+                if (overBudget()) {
+                    return finishOverBudget();
+                }
+                entry.depth++;
+                if (options.recordSteps) {
+                    entry.steps.record(StepKind::Substitute, var, entry.equation);
+                }
+                entry.vars.clear();
+                entry.numVariables = entry.equation->collectVariables(entry.vars);
+                entry.distinctVariables = static_cast<int>(entry.vars.size());
+                storedBytes += entryBytes(entry);
                 queue.push(std::move(entry));
+                metrics.peakQueueSize = std::max(metrics.peakQueueSize, queue.size());
                 break;
             }
             // No equation to derive this variable
@@ -321,63 +649,69 @@ SolveResult EquationSolver::solve(
             std::vector<EquationEntry>& relatedEqs = varToEquation.at(var);
             for (EquationEntry &relatedEq : relatedEqs) {
                 // Do not use the same equation to substitute
-                if (relatedEq.equation->toString() == entry.equation->toString()) {
+                if (sameEquation(relatedEq, entry)) {
                     // dbg("Skipping same equation");
                     continue;
                 }
                 // dbg(var, relatedEq.equation->toString());
                 
-                EquationEntry newEntry = entry.clone();
+                EquationEntry newEntry = cloneEntry(entry);
 
-                std::unique_ptr<ASTNode> isolated = relatedEq.equation->clone();
-                // dbg("Isolating", var, "from", isolated->toString());
-                this->isolator.isolateVariable(isolated, var);
-                // dbg("Isolated:", isolated->toString());
-                this->simplifier.simplify(isolated);
-                // dbg("Simplified:", isolated->toString());
+                // dbg("Isolating", var, "from", relatedEq.equation->toString());
+                PTree isolatedTree = isolatedCopy(relatedEq.equation, var);
+                // dbg("Isolated:", isolatedTree->toString());
 
-                if (isolated->getNodeType() != NodeType::BinaryOp) {
+                if (isolatedTree->getNodeType() != NodeType::BinaryOp) {
                     throw std::runtime_error("Isolated equation is not a binary operation");
                 }
-                if (static_cast<BinaryOpNode *>(isolated.get())->getLeft()->toString() != var) {
-                    // dbg(isolated->toString());
+                if (isolatedTree->getLeft()->toString() != var) {
+                    // dbg(isolatedTree->toString());
                     // throw std::runtime_error("Isolated equation left side is not the variable");
                     continue;
                 }
-                BinaryOpNode* assignNode = static_cast<BinaryOpNode *>(isolated.get());
 
-                EquationSolver::subsituteVariable(newEntry.equation, var, assignNode->getRightRef()->clone());
-                // dbg("After substitution:", newEntry.equation->toString());
-                this->simplifier.simplify(newEntry.equation);
-                newEntry.steps.push_back("Substitute " + var + ": " + newEntry.equation->toString());
-                // dbg("After simplification:", newEntry.equation->toString());
+                // Path copy of the state, then one mutable copy for the simplifier
+                PTree work = simplifiedCopy(substitute(newEntry.equation, var, isolatedTree->getRight()));
+                if (overBudget()) {
+                    return finishOverBudget();
+                }
+                // dbg("After simplification:", work->toString());
 
-                int newNumVariables = ASTUtils::countVariableOccurrences(newEntry.equation);
-                int newDistinctVariables = ASTUtils::countDistinctVariables(newEntry.equation);
+                std::unordered_set<std::string> newVars;
+                int newNumVariables = work->collectVariables(newVars);
+                int newDistinctVariables = static_cast<int>(newVars.size());
 
-                if (((float)newDistinctVariables / entry.distinctVariables) > Config::LIMIT_RATIO_NEW_DISTINCT_VARS) {
+                if (((float)newDistinctVariables / entry.distinctVariables) > options.expansionRatio) {
                     // dbg("Skipping, more variables");
                     continue;
                 }
 
+                newEntry.equation = work;
+                newEntry.depth++;
+                if (options.recordSteps) {
+                    newEntry.steps.record(StepKind::Substitute, var, newEntry.equation);
+                }
                 newEntry.numVariables = newNumVariables;
                 newEntry.distinctVariables = newDistinctVariables;
-                newEntry.vars = EquationSolver::extractVariables(newEntry.equation);
+                newEntry.vars = std::move(newVars);
 
                 // Add this derived equation to varToEquation so it can be used in future substitutions
                 for (const std::string &v : newEntry.vars) {
-                    varToEquation[v].push_back(newEntry.clone());
+                    varToEquation[v].push_back(cloneEntry(newEntry));
+                    storedBytes += entryBytes(newEntry);
                 }
                 
-                newEntry.varToIsolatedEquation[var] = isolated->clone();
+                newEntry.varToIsolatedEquation[var] = isolatedTree;
+                storedBytes += entryBytes(newEntry);
                 
                 // dbg(newEntry.equation->toString(), newEntry.numVariables);
                 // dbg("-----------------------------------------------");
                 queue.push(std::move(newEntry));
+                metrics.peakQueueSize = std::max(metrics.peakQueueSize, queue.size());
             }
         }
 
     }
 
-    return {nullptr, {}};
+    return finish(TerminationReason::QueueExhausted, nullptr, {});
 }
@@ -2,60 +2,28 @@
 #include <unordered_set>
 #include "Simplifier.h"
 #include "Isolator.h"
+#include "EquationEntry.h"
+#include "SearchFrontier.h"
+#include "SolveMetrics.h"
+#include "SolveBudget.h"
+#include "SolverOptions.h"
+#include "SolveObserver.h"
 #include <cassert>
 #include <cmath>
 #include <memory>
 
-struct EquationEntry {
-    std::unique_ptr<ASTNode> equation;
-    std::unordered_set<std::string> vars;
-    int numVariables;
-    int distinctVariables;
-
-    // Mapping from variable to isolated equation
-    std::unordered_map<std::string, std::unique_ptr<ASTNode>> varToIsolatedEquation;
-
-    // Steps taken to reach this equation
-    std::vector<std::string> steps;
-
-    EquationEntry(
-        std::unique_ptr<ASTNode> eq,
-        std::unordered_set<std::string> vars,
-        int numVars,
-        int distinctVars,
-        std::unordered_map<std::string, std::unique_ptr<ASTNode>> varToIsolatedEquation = {},
-        std::vector<std::string> steps = {}
-    ) : equation(std::move(eq)), vars(vars), numVariables(numVars), distinctVariables(distinctVars), varToIsolatedEquation(std::move(varToIsolatedEquation)), steps(steps) {}
-
-    bool operator==(const EquationEntry &other) const {
-        return this->equation->toString() == other.equation->toString();
-    }
-
-    bool operator!=(const EquationEntry &other) const {
-        return !(*this == other);
-    }
-    
-    // Less variables -> higher priority
-    // Distinct variables take precedence
-    bool operator<(const EquationEntry &other) const {
-        if (this->distinctVariables == other.distinctVariables) {
-            return this->numVariables > other.numVariables;
-        }
-        return this->distinctVariables > other.distinctVariables;
-    }
-    
-    EquationEntry clone() const {
-        std::unordered_map<std::string, std::unique_ptr<ASTNode>> clonedMap;
-        for (const auto& [var, eq] : this->varToIsolatedEquation) {
-            clonedMap[var] = eq->clone();
-        }
-        return EquationEntry(this->equation->clone(), this->vars, this->numVariables, this->distinctVariables, std::move(clonedMap), this->steps);
-    }
-};
-
 struct SolveResult {
+    // "variable = value", null when not solved
+    // Solved numerically or by a numeric-only polynomial root, the value is the exact fraction of its 15 printed digits
     std::unique_ptr<ASTNode> result;
-    std::vector<std::string> steps;
+    // Structural steps of the winning path, empty when not solved or not recorded
+    StepTrace trace;
+    SolveMetrics metrics;
+
+    /* Steps as text, rendered on each call */
+    std::vector<std::string> steps() const { return trace.render(); }
+    /* Printed result, the numeric or polynomial answer when one of those found it, or "" */
+    std::string answer() const;
 };
 
 class EquationSolver {
@@ -67,14 +35,18 @@ protected:
 
     static std::unordered_set<std::string> extractVariables(std::unique_ptr<ASTNode>& node);
 
-    static void subsituteVariable(
-        std::unique_ptr<ASTNode>& equation,
-        const std::string &variable,
-        std::unique_ptr<ASTNode> substitution
-    );
-
     Simplifier simplifier;
     Isolator isolator;
+
+    /* The search behind both solve() forms, prepare runs prepareEquation on each equation first */
+    SolveResult search(
+        const std::vector<PTree> &equations,
+        bool prepare,
+        const std::string &variable,
+        const SolverOptions &options,
+        SolveBudget *budget,
+        const SolveObserver &observer
+    );
 public:
     EquationSolver() : simplifier(), isolator() {}
     
@@ -95,6 +67,9 @@ public:
     */
     static std::unique_ptr<ASTNode> standardizeEquation(std::unique_ptr<ASTNode> equation);
 
+    /* normalizeEquation + simplify, the form the search starts from */
+    static PTree prepareEquation(std::unique_ptr<ASTNode> equation);
+
 
     /*
     * Solve for the variable using the equations provided
@@ -104,9 +79,27 @@ public:
     *   c = 3
     *   b = 4
     *   solve(x) -> 12
+    * Options pick the search strategy, priority and limits (see SolverOptions)
+    * A budget, when given, bounds the search. Tripping it returns an empty result
+    * with the matching TerminationReason (see SolveBudget)
+    * An observer, when given, sees the search as it runs (see SolveObserver)
     */
     SolveResult solve(
         std::vector<std::unique_ptr<ASTNode>>& equations,
-        const std::string &variable
+        const std::string &variable,
+        const SolverOptions &options = SolverOptions(),
+        SolveBudget *budget = nullptr,
+        const SolveObserver &observer = nullptr
     );
+
+    /* Same search on equations that already went through prepareEquation, e.g. kept by a SolverSession */
+    SolveResult solvePrepared(
+        const std::vector<PTree> &equations,
+        const std::string &variable,
+        const SolverOptions &options = SolverOptions(),
+        SolveBudget *budget = nullptr,
+        const SolveObserver &observer = nullptr
+    );
+
+    static TerminationReason terminationFor(BudgetStatus status);
 };
@@ -7,55 +7,104 @@ void Evaluation::reset() {
     Evaluation::variables.clear();
 }
 
-double Evaluation::evaluate(const ASTNode* node) {
+namespace {
+    struct FlatEvaluator {
+        const std::unordered_map<std::string, Rational> &variables;
+
+        Rational integer(std::int64_t value) { return Rational(value); }
+        Rational number(const Token &token) { return Token::getNumericValue(token); }
+        Rational variable(const std::string &name) {
+            auto it = this->variables.find(name);
+            if (it == this->variables.end()) {
+                throw std::runtime_error("Undefined variable: " + name);
+            }
+            return it->second;
+        }
+        Rational unary(TokenType op, Rational operand) { return op == TokenType::MINUS ? -operand : operand; }
+        Rational binary(TokenType op, Rational left, Rational right) {
+            return Evaluation::evaluateExpression(left, op, right);
+        }
+    };
+}
+
+Rational Evaluation::evaluate(const FlatTree &tree) {
+    FlatEvaluator evaluator{Evaluation::variables};
+    return tree.reduce<Rational>(evaluator);
+}
+
+Rational Evaluation::evaluate(const ASTNode* node) {
     if (node == nullptr) {
         throw std::runtime_error("Null node in evaluation");
     }
-    switch(node->getNodeType()) {
-        case NodeType::Atom: {
-            Token token = node->getToken();
-            if (token.getType() == TokenType::NUMBER) {
-                return std::stod(token.getValue());
-            } else if (token.getType() == TokenType::VARIABLE) {
-                auto it = Evaluation::variables.find(token.getValue());
-                if (it != variables.end()) {
-                    return it->second;
+    // Post-order with an explicit stack: an operator is applied once the values of its
+    // operands, left then right, are on values. A null node is the marker to negate the
+    // value below it, left by a chain of signs
+    std::vector<std::pair<const ASTNode *, bool>> pending = {{node, false}};
+    std::vector<Rational> values;
+    while (!pending.empty()) {
+        auto [current, expanded] = pending.back();
+        if (current == nullptr) {
+            pending.pop_back();
+            values.back() = -values.back();
+            continue;
+        }
+        switch(current->getNodeType()) {
+            case NodeType::Atom: {
+                Stats::visit();
+                pending.pop_back();
+                Token token = current->getToken();
+                if (token.getType() == TokenType::NUMBER) {
+                    values.push_back(Token::getNumericValue(token));
+                } else if (token.getType() == TokenType::VARIABLE) {
+                    auto it = Evaluation::variables.find(token.getValue());
+                    if (it != variables.end()) {
+                        values.push_back(it->second);
+                    } else {
+                        throw std::runtime_error("Undefined variable: " + token.getValue());
+                    }
                 } else {
-                    throw std::runtime_error("Undefined variable: " + token.getValue());
+                    throw std::runtime_error("Invalid atom token");
                 }
-            } else {
-                throw std::runtime_error("Invalid atom token");
+                break;
             }
-        }
-        case NodeType::BinaryOp: {
-            const BinaryOpNode* binNode = dynamic_cast<const BinaryOpNode*>(node);
-            if (!binNode) {
-                throw std::runtime_error("Invalid binary operation node");
+            case NodeType::BinaryOp: {
+                const BinaryOpNode* binNode = static_cast<const BinaryOpNode*>(current);
+                if (!expanded) {
+                    Stats::visit();
+                    pending.back().second = true;
+                    pending.push_back({binNode->getRight(), false});
+                    pending.push_back({binNode->getLeft(), false});
+                    break;
+                }
+                pending.pop_back();
+                Rational rightVal = std::move(values.back());
+                values.pop_back();
+                values.back() = Evaluation::evaluateExpression(values.back(), binNode->getToken(), rightVal);
+                break;
             }
-            double leftVal = Evaluation::evaluate(binNode->getLeft());
-            double rightVal = Evaluation::evaluate(binNode->getRight());
-            Token opToken = binNode->getToken();
-            return Evaluation::evaluateExpression(leftVal, opToken, rightVal);
-        }
-        case NodeType::UnaryOp: {
-            bool isPositive = true;
-            while(node->getNodeType() == NodeType::UnaryOp) {
-                const UnaryOpNode* unNode = dynamic_cast<const UnaryOpNode*>(node);
-                if (!unNode) {
-                    throw std::runtime_error("Invalid unary operation node");
+            case NodeType::UnaryOp: {
+                Stats::visit();
+                // Only the parity of a chain of signs matters
+                bool isPositive = true;
+                while(current->getNodeType() == NodeType::UnaryOp) {
+                    const UnaryOpNode* unNode = static_cast<const UnaryOpNode*>(current);
+                    if (unNode->getToken().getType() == TokenType::MINUS) {
+                        isPositive = !isPositive;
+                    }
+                    current = unNode->getOperand();
                 }
-                if (unNode->getToken().getType() == TokenType::MINUS) {
-                    isPositive = !isPositive;
+                pending.pop_back();
+                if (!isPositive) {
+                    pending.push_back({nullptr, false});
                 }
-                node = unNode->getOperand();
+                pending.push_back({current, false});
+                break;
             }
-            
-            double operandVal = Evaluation::evaluate(node);
-            return isPositive ? operandVal : -operandVal;
+            default:
+                throw std::runtime_error("Unknown node type");
         }
-        default:
-            throw std::runtime_error("Unknown node type");
     }
+    return std::move(values.back());
 }
 
 
@@ -79,7 +128,7 @@ void Evaluation::assignment(const ASTNode* node) {
     }
 
     std::string varName = leftNode->getToken().getValue();
-    double value = Evaluation::evaluate(rightNode);
+    Rational value = Evaluation::evaluate(rightNode);
     Evaluation::variables[varName] = value;
 }
 
@@ -87,8 +136,12 @@ void Evaluation::unassignment(const std::string& variable) {
     Evaluation::variables.erase(variable);
 }
 
-double Evaluation::evaluateExpression(double left, Token op, double right){
-    switch(op.getType()){
+Rational Evaluation::evaluateExpression(const Rational &left, Token op, const Rational &right){
+    return Evaluation::evaluateExpression(left, op.getType(), right);
+}
+
+Rational Evaluation::evaluateExpression(const Rational &left, TokenType op, const Rational &right){
+    switch(op){
         case TokenType::PLUS:
             return left + right;
         case TokenType::MINUS:
@@ -96,17 +149,17 @@ double Evaluation::evaluateExpression(double left, Token op, double right){
         case TokenType::MULTIPLY:
             return left * right;
         case TokenType::DIVIDE:
-            if (right == 0) {
+            if (right.isZero()) {
                 throw std::runtime_error("Division by zero from evaluation expression");
             }
             return left / right;
         case TokenType::POWER:
-            return std::pow(left, right);
+            return left.pow(right);
         default:
             throw std::runtime_error("Unsupported operator in expression evaluation");
     }
 }
 
-double Evaluation::evaluateExpression(Token left, Token op, Token right){
-    return Evaluation::evaluateExpression(std::stod(left.getValue()), op, std::stod(right.getValue()));
+Rational Evaluation::evaluateExpression(Token left, Token op, Token right){
+    return Evaluation::evaluateExpression(Token::getNumericValue(left), op, Token::getNumericValue(right));
 }
@@ -1,21 +1,27 @@
 #pragma once
 #include <unordered_map>
 #include "../parser/Parser.h"
+#include "../parser/FlatTree.h"
+#include "../number/Rational.h"
 
 class Evaluation {
 private:
-    std::unordered_map<std::string, double> variables;
+    std::unordered_map<std::string, Rational> variables;
 public:
     Evaluation(): variables(
-        std::unordered_map<std::string, double>()
+        std::unordered_map<std::string, Rational>()
     ) {};
 
     void reset();
 
-    double evaluate(const ASTNode* node);
+    /* Exact, throws when a variable is unbound or a power has no exact value */
+    Rational evaluate(const ASTNode* node);
+    /* Same, as one loop over the nodes */
+    Rational evaluate(const FlatTree &tree);
     void assignment(const ASTNode* node);
     void unassignment(const std::string& variable);
     
-    static double evaluateExpression(Token left, Token op, Token right);
-    static double evaluateExpression(double left, Token op, double right);
+    static Rational evaluateExpression(Token left, Token op, Token right);
+    static Rational evaluateExpression(const Rational &left, Token op, const Rational &right);
+    static Rational evaluateExpression(const Rational &left, TokenType op, const Rational &right);
 };
@@ -0,0 +1,252 @@
+#include "ExpressionDag.h"
+#include "Evaluation.h"
+#include "SolveBudget.h"
+#include <stdexcept>
+
+std::size_t ExpressionDag::NodeKeyHash::operator()(const NodeKey &key) const {
+    std::size_t hash = std::hash<std::string>()(key.value);
+    hash ^= std::hash<const void *>()(key.left) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<const void *>()(key.right) + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    hash ^= (static_cast<std::size_t>(key.type) << 8) | static_cast<std::size_t>(key.tokenType);
+    return hash;
+}
+
+PTree ExpressionDag::make(Token token, NodeType type, PTree left, PTree right) {
+    NodeKey key{type, token.getType(), token.getValue(), left.get(), right.get()};
+    auto it = this->nodes.find(key);
+    if (it != this->nodes.end()) {
+        return it->second;
+    }
+    PTree node = std::make_shared<const PersistentNode>(std::move(token), type, std::move(left), std::move(right));
+    this->canonical.insert(node.get());
+    this->nodes.emplace(std::move(key), node);
+    return node;
+}
+
+PTree ExpressionDag::atom(Token token) {
+    return this->make(std::move(token), NodeType::Atom, nullptr, nullptr);
+}
+
+PTree ExpressionDag::unary(Token op, PTree operand) {
+    return this->make(std::move(op), NodeType::UnaryOp, this->intern(operand), nullptr);
+}
+
+PTree ExpressionDag::binary(Token op, PTree left, PTree right) {
+    return this->make(std::move(op), NodeType::BinaryOp, this->intern(left), this->intern(right));
+}
+
+PTree ExpressionDag::intern(const ASTNode *root) {
+    // Post-order with an explicit stack, each finished node leaves its canonical tree on built
+    struct Frame {
+        const ASTNode *node;
+        int stage;
+    };
+    std::vector<Frame> frames = {{root, 0}};
+    std::vector<PTree> built;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const ASTNode *node = frame.node;
+        const ASTNode *next = nullptr;
+        if (node->getNodeType() == NodeType::UnaryOp && frame.stage == 0) {
+            next = static_cast<const UnaryOpNode *>(node)->getOperand();
+        } else if (node->getNodeType() == NodeType::BinaryOp && frame.stage < 2) {
+            const BinaryOpNode *binaryNode = static_cast<const BinaryOpNode *>(node);
+            next = frame.stage == 0 ? binaryNode->getLeft() : binaryNode->getRight();
+        }
+        if (next) {
+            frame.stage++;
+            frames.push_back({next, 0});
+            continue;
+        }
+        frames.pop_back();
+        switch (node->getNodeType()) {
+            case NodeType::Atom:
+                built.push_back(this->atom(node->getToken()));
+                break;
+            case NodeType::UnaryOp:
+                built.back() = this->make(node->getToken(), NodeType::UnaryOp, std::move(built.back()), nullptr);
+                break;
+            case NodeType::BinaryOp: {
+                PTree right = std::move(built.back());
+                built.pop_back();
+                built.back() = this->make(node->getToken(), NodeType::BinaryOp, std::move(built.back()), std::move(right));
+                break;
+            }
+        }
+    }
+    return built.back();
+}
+
+PTree ExpressionDag::intern(const PTree &root) {
+    // Path copies of canonical trees stop at the first shared subtree
+    if (this->contains(root)) {
+        return root;
+    }
+    struct Frame {
+        const PTree *node;
+        int stage;
+    };
+    std::vector<Frame> frames = {{&root, 0}};
+    std::vector<PTree> built;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const PTree &node = *frame.node;
+        const PTree *next = nullptr;
+        if (frame.stage == 0 && node->getNodeType() != NodeType::Atom) {
+            next = &node->getLeft();
+        } else if (frame.stage == 1 && node->getNodeType() == NodeType::BinaryOp) {
+            next = &node->getRight();
+        }
+        if (next) {
+            frame.stage++;
+            if (this->contains(*next)) {
+                built.push_back(*next);
+            } else {
+                frames.push_back({next, 0});
+            }
+            continue;
+        }
+        frames.pop_back();
+        switch (node->getNodeType()) {
+            case NodeType::Atom:
+                built.push_back(this->atom(node->getToken()));
+                break;
+            case NodeType::UnaryOp:
+                built.back() = this->make(node->getToken(), NodeType::UnaryOp, std::move(built.back()), nullptr);
+                break;
+            case NodeType::BinaryOp: {
+                PTree right = std::move(built.back());
+                built.pop_back();
+                built.back() = this->make(node->getToken(), NodeType::BinaryOp, std::move(built.back()), std::move(right));
+                break;
+            }
+        }
+    }
+    return built.back();
+}
+
+PTree ExpressionDag::rewrite(const PTree &root, const std::string &tag, const Rewrite &rewrite) {
+    PTree input = this->intern(root);
+    std::unordered_map<const PersistentNode *, PTree> &memo = this->rewrites[tag];
+    auto it = memo.find(input.get());
+    if (it != memo.end()) {
+        this->rewriteHits++;
+        return it->second;
+    }
+    std::unique_ptr<ASTNode> work = input->thaw();
+    rewrite(work);
+    PTree result = this->intern(work.get());
+    // A rewrite cut short by the budget is not the real answer
+    SolveBudget *budget = SolveBudget::current();
+    if (!budget || !budget->exceeded()) {
+        memo.emplace(input.get(), result);
+    }
+    return result;
+}
+
+PTree ExpressionDag::substitute(const PTree &root, const std::unordered_map<std::string, PTree> &bindings) {
+    std::uint64_t mask = 0;
+    std::unordered_map<std::string, PTree> replacements;
+    for (const auto &[variable, replacement] : bindings) {
+        mask |= PersistentNode::variableBit(variable);
+        replacements.emplace(variable, this->intern(replacement));
+    }
+
+    // A shared subexpression is substituted once, every parent reuses the result
+    std::unordered_map<const PersistentNode *, PTree> done;
+    std::function<PTree(const PTree &)> visit = [&](const PTree &node) -> PTree {
+        if (!node->mayContainAny(mask)) {
+            return node;
+        }
+        auto it = done.find(node.get());
+        if (it != done.end()) {
+            return it->second;
+        }
+        PTree result = node;
+        switch (node->getNodeType()) {
+            case NodeType::Atom: {
+                auto replacement = replacements.find(node->getToken().getValue());
+                if (replacement != replacements.end()) {
+                    result = replacement->second;
+                }
+                break;
+            }
+            case NodeType::UnaryOp: {
+                PTree operand = visit(node->getOperand());
+                if (operand != node->getOperand()) {
+                    result = this->make(node->getToken(), NodeType::UnaryOp, std::move(operand), nullptr);
+                }
+                break;
+            }
+            case NodeType::BinaryOp: {
+                PTree left = visit(node->getLeft());
+                PTree right = visit(node->getRight());
+                if (left != node->getLeft() || right != node->getRight()) {
+                    result = this->make(node->getToken(), NodeType::BinaryOp, std::move(left), std::move(right));
+                }
+                break;
+            }
+        }
+        done.emplace(node.get(), result);
+        return result;
+    };
+    return visit(this->intern(root));
+}
+
+PTree ExpressionDag::substitute(const PTree &root, const std::string &variable, const PTree &replacement) {
+    return this->substitute(root, std::unordered_map<std::string, PTree>{{variable, replacement}});
+}
+
+Rational ExpressionDag::evaluate(const PTree &root, const std::unordered_map<std::string, Rational> &values) const {
+    std::unordered_map<const PersistentNode *, Rational> done;
+    std::function<Rational(const PTree &)> visit = [&](const PTree &node) -> Rational {
+        auto it = done.find(node.get());
+        if (it != done.end()) {
+            return it->second;
+        }
+        Rational result;
+        const Token &token = node->getToken();
+        switch (node->getNodeType()) {
+            case NodeType::Atom:
+                if (token.getType() == TokenType::NUMBER) {
+                    result = Token::getNumericValue(token);
+                } else {
+                    auto value = values.find(token.getValue());
+                    if (value == values.end()) {
+                        throw std::runtime_error("Undefined variable: " + token.getValue());
+                    }
+                    result = value->second;
+                }
+                break;
+            case NodeType::UnaryOp:
+                result = visit(node->getOperand());
+                if (token.getType() == TokenType::MINUS) {
+                    result = -result;
+                }
+                break;
+            case NodeType::BinaryOp:
+                result = Evaluation::evaluateExpression(visit(node->getLeft()), token, visit(node->getRight()));
+                break;
+        }
+        done.emplace(node.get(), result);
+        return result;
+    };
+    return visit(root);
+}
+
+std::size_t ExpressionDag::uniqueNodes(const PTree &root) {
+    std::unordered_set<const PersistentNode *> seen;
+    std::function<void(const PTree &)> visit = [&](const PTree &node) {
+        if (!seen.insert(node.get()).second) {
+            return;
+        }
+        if (node->getLeft()) {
+            visit(node->getLeft());
+        }
+        if (node->getRight()) {
+            visit(node->getRight());
+        }
+    };
+    visit(root);
+    return seen.size();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "../parser/PersistentNode.h"
+#include "../number/Rational.h"
+
+/*
+* Hash-consed PersistentNode trees: structurally identical subtrees are one shared node,
+* so every expression built through the same dag is a DAG of unique subexpressions.
+*
+* Within one dag two trees are equal exactly when their root pointers are equal.
+* substitute and evaluate visit each unique node once, however often it is repeated in
+* the expanded tree, and rewrite results are remembered per tree. Nodes live as long as the dag.
+*
+* e.g. ExpressionDag dag;
+*      PTree a = dag.intern(parsed.get());
+*      PTree b = dag.rewrite(a, "simplify", [](auto &node) { Simplifier::simplify(node); });
+*      // later rewrites of a with "simplify" return b without simplifying
+*/
+class ExpressionDag {
+public:
+    /* In-place transformation of a mutable copy, e.g. Simplifier::simplify */
+    using Rewrite = std::function<void(std::unique_ptr<ASTNode> &)>;
+
+private:
+    struct NodeKey {
+        NodeType type;
+        TokenType tokenType;
+        std::string value;
+        const PersistentNode *left;
+        const PersistentNode *right;
+
+        bool operator==(const NodeKey &other) const {
+            return type == other.type && tokenType == other.tokenType && left == other.left
+                && right == other.right && value == other.value;
+        }
+    };
+    struct NodeKeyHash {
+        std::size_t operator()(const NodeKey &key) const;
+    };
+
+    std::unordered_map<NodeKey, PTree, NodeKeyHash> nodes;
+    // Canonical nodes only, they are kept alive by nodes so the pointers stay valid
+    std::unordered_set<const PersistentNode *> canonical;
+    // tag -> input -> result
+    std::unordered_map<std::string, std::unordered_map<const PersistentNode *, PTree>> rewrites;
+    std::size_t rewriteHits = 0;
+
+    PTree make(Token token, NodeType type, PTree left, PTree right);
+
+public:
+    PTree atom(Token token);
+    PTree unary(Token op, PTree operand);
+    PTree binary(Token op, PTree left, PTree right);
+
+    /* Canonical copy of a mutable tree */
+    PTree intern(const ASTNode *node);
+    /* Canonical copy of any persistent tree, subtrees already in this dag are reused as is */
+    PTree intern(const PTree &node);
+    bool contains(const PTree &node) const { return canonical.count(node.get()) > 0; }
+
+    /*
+    * rewrite(thawed root), interned, remembered per (root, tag)
+    * The tag names the transformation, e.g. "simplify" or "isolate:x"
+    * A result produced while the current SolveBudget is exceeded is not remembered
+    */
+    PTree rewrite(const PTree &root, const std::string &tag, const Rewrite &rewrite);
+
+    /* PersistentNode::substitute over unique nodes, the result is canonical */
+    PTree substitute(const PTree &root, const std::unordered_map<std::string, PTree> &bindings);
+    PTree substitute(const PTree &root, const std::string &variable, const PTree &replacement);
+
+    /* Exact value, each unique subexpression evaluated once, throws like Evaluation::evaluate */
+    Rational evaluate(const PTree &root, const std::unordered_map<std::string, Rational> &values) const;
+
+    /* Unique nodes in the dag */
+    std::size_t size() const { return nodes.size(); }
+    /* Rewrites answered from memory */
+    std::size_t hits() const { return rewriteHits; }
+    /* Unique nodes reachable from root, compare with root->size() for the expanded tree */
+    static std::size_t uniqueNodes(const PTree &root);
+};
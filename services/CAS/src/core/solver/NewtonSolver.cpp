@@ -0,0 +1,393 @@
+#include "NewtonSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+    // Armijo constant, a step must remove at least this fraction of the predicted decrease
+    const double SUFFICIENT_DECREASE = 1e-4;
+    const double MIN_STEP_FRACTION = 1e-10;
+    // Central difference step relative to the value, about cbrt(epsilon)
+    const double DIFFERENCE_STEP = 6e-6;
+    const int MAX_TRUST_REGION_TRIES = 30;
+    const unsigned RANDOM_START_SEED = 0x5eed;
+
+    double maxAbs(const double *values, std::size_t count) {
+        double result = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            // NaN compares false, keep it visible
+            if (!(std::fabs(values[i]) <= result)) {
+                result = std::fabs(values[i]);
+            }
+        }
+        return result;
+    }
+
+    /* 1/2 * sum of squared residuals, the quantity every accepted step lowers */
+    double halfSquares(const std::vector<double> &values, std::size_t rows) {
+        double sum = 0;
+        for (std::size_t i = 0; i < rows; i++) {
+            sum += values[i] * values[i];
+        }
+        return sum / 2;
+    }
+}
+
+std::string NewtonSolver::formatValue(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value == 0 ? 0.0 : value);
+    return buffer;
+}
+
+bool NewtonSolver::solveDense(std::vector<double> &a, std::vector<double> &b, std::size_t n) {
+    double scale = maxAbs(a.data(), a.size());
+    if (scale == 0 || !std::isfinite(scale)) {
+        return false;
+    }
+    for (std::size_t column = 0; column < n; column++) {
+        std::size_t pivot = column;
+        for (std::size_t row = column + 1; row < n; row++) {
+            if (std::fabs(a[row * n + column]) > std::fabs(a[pivot * n + column])) {
+                pivot = row;
+            }
+        }
+        if (std::fabs(a[pivot * n + column]) <= 1e-13 * scale) {
+            return false;
+        }
+        if (pivot != column) {
+            std::swap_ranges(a.begin() + pivot * n, a.begin() + (pivot + 1) * n, a.begin() + column * n);
+            std::swap(b[pivot], b[column]);
+        }
+        for (std::size_t row = column + 1; row < n; row++) {
+            double factor = a[row * n + column] / a[column * n + column];
+            if (factor == 0) {
+                continue;
+            }
+            for (std::size_t k = column; k < n; k++) {
+                a[row * n + k] -= factor * a[column * n + k];
+            }
+            b[row] -= factor * b[column];
+        }
+    }
+    for (std::size_t row = n; row-- > 0;) {
+        double sum = b[row];
+        for (std::size_t k = row + 1; k < n; k++) {
+            sum -= a[row * n + k] * b[k];
+        }
+        b[row] = sum / a[row * n + row];
+    }
+    return true;
+}
+
+NumericReport NewtonSolver::solve(const SparseJacobian &jacobian, const NewtonOptions &options, SolveBudget *budget) {
+    auto start = std::chrono::steady_clock::now();
+    NumericReport report;
+    report.attempted = true;
+    const std::size_t rows = jacobian.rows();
+    const std::size_t n = jacobian.variables.size();
+    if (rows < n || n == 0) {
+        report.reason = "underdetermined";
+        return report;
+    }
+
+    std::vector<std::vector<double>> starts;
+    for (const auto &point : options.startingPoints) {
+        std::vector<double> values(n, 1.0);
+        for (std::size_t i = 0; i < n; i++) {
+            auto it = point.find(jacobian.variables[i]);
+            if (it != point.end()) {
+                values[i] = it->second;
+            }
+        }
+        starts.push_back(std::move(values));
+    }
+    if (starts.empty()) {
+        starts.emplace_back(n, 1.0);
+    }
+    std::mt19937 random(RANDOM_START_SEED);
+    std::uniform_real_distribution<double> uniform(-10.0, 10.0);
+    for (int i = 0; i < options.randomStarts; i++) {
+        std::vector<double> values(n);
+        for (double &value : values) {
+            value = uniform(random);
+        }
+        starts.push_back(std::move(values));
+    }
+
+    // values: residuals then Jacobian entries, as compiled
+    std::vector<double> values(jacobian.compiled.size());
+    std::vector<double> trial(jacobian.compiled.size());
+    std::vector<double> registers;
+    auto evaluate = [&](const std::vector<double> &point, std::vector<double> &out) {
+        report.residualEvaluations++;
+        jacobian.compiled.evaluate(point.data(), out.data(), registers);
+        return halfSquares(out, rows);
+    };
+
+    // Entries with no symbolic derivative, by column: one central difference of the
+    // residuals per column fills the entries of every row
+    std::vector<std::vector<std::pair<int, std::size_t>>> numericColumns(n);
+    for (int entry : jacobian.numericEntries) {
+        std::size_t row = std::upper_bound(jacobian.rowStart.begin(), jacobian.rowStart.end(), entry) - jacobian.rowStart.begin() - 1;
+        numericColumns[jacobian.columns[entry]].emplace_back(entry, row);
+    }
+    std::vector<double> shifted;
+    std::vector<double> above(jacobian.compiled.size());
+    std::vector<double> below(jacobian.compiled.size());
+    auto differences = [&](const std::vector<double> &point, std::vector<double> &out) {
+        for (std::size_t column = 0; column < n; column++) {
+            if (numericColumns[column].empty()) {
+                continue;
+            }
+            double h = DIFFERENCE_STEP * std::max(1.0, std::fabs(point[column]));
+            shifted = point;
+            shifted[column] = point[column] + h;
+            evaluate(shifted, above);
+            double width = shifted[column];
+            shifted[column] = point[column] - h;
+            evaluate(shifted, below);
+            // The step actually taken, point +- h is rounded
+            width -= shifted[column];
+            for (const auto &[entry, row] : numericColumns[column]) {
+                out[rows + entry] = (above[row] - below[row]) / width;
+            }
+        }
+    };
+
+    std::vector<double> dense(rows * n);
+    std::vector<double> normal(n * n);
+    std::vector<double> gradient(n);
+    std::vector<double> system;
+    std::vector<double> direction;
+    std::vector<double> next(n);
+
+    for (std::vector<double> &x : starts) {
+        report.starts++;
+        double f = evaluate(x, values);
+        double lambda = -1;
+        bool polished = false;
+        for (int iteration = 0; ; iteration++) {
+            report.residualNorm = maxAbs(values.data(), rows);
+            if (!std::isfinite(report.residualNorm)) {
+                report.reason = "not_finite";
+                break;
+            }
+            if (report.residualNorm <= options.tolerance) {
+                report.reason = "converged";
+                report.converged = true;
+                // One more step while it still helps, each Newton step about doubles the correct digits
+                if (polished || iteration == options.maxIterations) {
+                    break;
+                }
+                polished = true;
+            } else if (iteration == options.maxIterations) {
+                report.reason = "max_iterations";
+                break;
+            }
+            if (budget && budget->interrupted()) {
+                if (!report.converged) {
+                    report.reason = "budget";
+                }
+                break;
+            }
+
+            // J (dense), gradient J^T r and J^T J from the compressed rows
+            differences(x, values);
+            std::fill(dense.begin(), dense.end(), 0.0);
+            for (std::size_t row = 0; row < rows; row++) {
+                for (int entry = jacobian.rowStart[row]; entry < jacobian.rowStart[row + 1]; entry++) {
+                    dense[row * n + jacobian.columns[entry]] = values[rows + entry];
+                }
+            }
+            std::fill(gradient.begin(), gradient.end(), 0.0);
+            std::fill(normal.begin(), normal.end(), 0.0);
+            for (std::size_t row = 0; row < rows; row++) {
+                for (int a = jacobian.rowStart[row]; a < jacobian.rowStart[row + 1]; a++) {
+                    double ja = values[rows + a];
+                    gradient[jacobian.columns[a]] += ja * values[row];
+                    for (int b = jacobian.rowStart[row]; b < jacobian.rowStart[row + 1]; b++) {
+                        normal[jacobian.columns[a] * n + jacobian.columns[b]] += ja * values[rows + b];
+                    }
+                }
+            }
+            double diagonal = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                diagonal = std::max(diagonal, normal[i * n + i]);
+            }
+            // (J^T J + mu * D) d = -J^T r
+            auto regularized = [&](double mu, bool scaled) {
+                system = normal;
+                direction.resize(n);
+                for (std::size_t i = 0; i < n; i++) {
+                    system[i * n + i] += mu * (scaled ? std::max(normal[i * n + i], 1e-12) : 1.0);
+                    direction[i] = -gradient[i];
+                }
+                return NewtonSolver::solveDense(system, direction, n);
+            };
+
+            bool accepted = false;
+            double fraction = 1;
+            if (options.method == NewtonMethod::LineSearch) {
+                bool solved;
+                if (rows == n) {
+                    // Square: the Newton step itself, J d = -r
+                    system = dense;
+                    direction.assign(values.begin(), values.begin() + rows);
+                    for (double &value : direction) {
+                        value = -value;
+                    }
+                    solved = NewtonSolver::solveDense(system, direction, n);
+                } else {
+                    solved = regularized(0, false);
+                }
+                if (!solved && !regularized(1e-6 * (1 + diagonal), false)) {
+                    if (!report.converged) {
+                        report.reason = "singular";
+                    }
+                    break;
+                }
+                double slope = 0;
+                for (std::size_t i = 0; i < n; i++) {
+                    slope += gradient[i] * direction[i];
+                }
+                if (!(slope < 0)) {
+                    // Not a descent direction, fall back to steepest descent
+                    slope = 0;
+                    for (std::size_t i = 0; i < n; i++) {
+                        direction[i] = -gradient[i];
+                        slope -= gradient[i] * gradient[i];
+                    }
+                }
+                for (; fraction >= MIN_STEP_FRACTION; fraction /= 2) {
+                    for (std::size_t i = 0; i < n; i++) {
+                        next[i] = x[i] + fraction * direction[i];
+                    }
+                    double trialF = evaluate(next, trial);
+                    if (std::isfinite(trialF) && trialF <= f + SUFFICIENT_DECREASE * fraction * slope) {
+                        f = trialF;
+                        accepted = true;
+                        break;
+                    }
+                }
+            } else {
+                if (lambda < 0) {
+                    lambda = 1e-3;
+                }
+                for (int attempt = 0; attempt < MAX_TRUST_REGION_TRIES; attempt++, lambda *= 4) {
+                    if (!regularized(lambda, true)) {
+                        continue;
+                    }
+                    for (std::size_t i = 0; i < n; i++) {
+                        next[i] = x[i] + direction[i];
+                    }
+                    double trialF = evaluate(next, trial);
+                    if (std::isfinite(trialF) && trialF < f) {
+                        f = trialF;
+                        lambda = std::max(lambda / 3, 1e-15);
+                        accepted = true;
+                        break;
+                    }
+                }
+            }
+            if (!accepted) {
+                if (!report.converged) {
+                    report.reason = "stalled";
+                }
+                break;
+            }
+
+            report.lastStep = 0;
+            for (std::size_t i = 0; i < n; i++) {
+                report.lastStep = std::max(report.lastStep, std::fabs(next[i] - x[i]));
+            }
+            x.swap(next);
+            values.swap(trial);
+            report.iterations++;
+        }
+
+        report.values.clear();
+        for (std::size_t i = 0; i < n; i++) {
+            report.values[jacobian.variables[i]] = x[i];
+        }
+        if (report.converged || report.reason == "budget") {
+            break;
+        }
+    }
+    report.totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return report;
+}
+
+NumericReport NewtonSolver::solveFor(
+    const std::vector<PTree> &equations,
+    const std::string &variable,
+    const NewtonOptions &options,
+    SolveBudget *budget
+) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unordered_set<std::string>> vars(equations.size());
+    for (std::size_t i = 0; i < equations.size(); i++) {
+        equations[i]->collectVariables(vars[i]);
+    }
+
+    // Grow the component from the target until no equation adds a variable
+    std::unordered_set<std::string> reached{variable};
+    std::vector<bool> used(equations.size(), false);
+    std::vector<PTree> component;
+    for (bool grew = true; grew;) {
+        grew = false;
+        for (std::size_t i = 0; i < equations.size(); i++) {
+            if (used[i]) {
+                continue;
+            }
+            bool connected = std::any_of(vars[i].begin(), vars[i].end(), [&](const std::string &var) {
+                return reached.count(var) > 0;
+            });
+            if (connected) {
+                used[i] = true;
+                grew = true;
+                component.push_back(equations[i]);
+                reached.insert(vars[i].begin(), vars[i].end());
+            }
+        }
+    }
+
+    NumericReport report;
+    if (component.empty()) {
+        report.attempted = true;
+        report.reason = "underdetermined";
+        return report;
+    }
+    // The derivatives grow with the equations, past the limit it is not worth it
+    std::size_t nodes = 0;
+    for (const PTree &equation : component) {
+        nodes += equation->size();
+    }
+    if (options.maxNodes > 0 && nodes > options.maxNodes) {
+        report.attempted = true;
+        report.reason = "too_large";
+        return report;
+    }
+    SparseJacobian jacobian;
+    try {
+        // A variable in an exponent, e.g. 2 ^ x = 8, is left to finite differences
+        jacobian = Differentiator::jacobian(component, {}, true);
+    } catch (const std::runtime_error &) {
+        report.attempted = true;
+        report.reason = "not_differentiable";
+        return report;
+    }
+    report = NewtonSolver::solve(jacobian, options, budget);
+    if (report.converged) {
+        report.answer = variable + " = " + NewtonSolver::formatValue(report.values.at(variable));
+    }
+    report.totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start
+    ).count();
+    return report;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "../parser/PersistentNode.h"
+#include "Differentiator.h"
+#include "SolveBudget.h"
+#include "SolveMetrics.h"
+#include "SolverOptions.h"
+
+/*
+* Numeric answers for systems the search cannot isolate, e.g. x * x + y = 3, x * y = 2
+*
+* The residuals lhs - rhs and their Jacobian are derived and compiled once
+* (Differentiator::jacobian), after which every iteration is two straight-line
+* evaluations and one dense n x n solve. Entries with no symbolic derivative (a
+* variable in an exponent) are central differences, two more evaluations per column.
+* With more equations than unknowns the step is the least squares (Gauss-Newton)
+* one. Each starting point runs until
+* every residual is within NewtonOptions::tolerance; a start that stalls or hits
+* the iteration limit moves on to the next one.
+*
+* Nonlinear systems can have several answers, the report says which start gave this one.
+*/
+class NewtonSolver {
+private:
+    /* a x = b for an n x n row major a, by LU with partial pivoting; x replaces b, false when singular */
+    static bool solveDense(std::vector<double> &a, std::vector<double> &b, std::size_t n);
+
+public:
+    /* Drives every residual of jacobian to 0, report.answer is left empty */
+    static NumericReport solve(const SparseJacobian &jacobian, const NewtonOptions &options, SolveBudget *budget = nullptr);
+    /* 15 significant digits, how values appear in report.answer */
+    static std::string formatValue(double value);
+    /* The equations sharing variables with variable (directly or through others), solved for all of them */
+    static NumericReport solveFor(
+        const std::vector<PTree> &equations,
+        const std::string &variable,
+        const NewtonOptions &options,
+        SolveBudget *budget = nullptr
+    );
+};
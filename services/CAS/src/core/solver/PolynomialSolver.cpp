@@ -0,0 +1,586 @@
+#include "PolynomialSolver.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <numeric>
+#include "../parser/Printer.h"
+
+namespace {
+    const int ABERTH_MAX_ITERATIONS = 500;
+    const int POLISH_STEPS = 6;
+    // A numeric root is kept when |p(x)| is this small next to sum |c_i * x ^ i|
+    const double ROOT_TOLERANCE = 1e-8;
+    const std::int64_t MAX_SCALE = 1000000000;
+
+    void trim(std::vector<Rational> &coefficients) {
+        while (coefficients.size() > 1 && coefficients.back().isZero()) {
+            coefficients.pop_back();
+        }
+    }
+
+    std::vector<Rational> multiply(const std::vector<Rational> &left, const std::vector<Rational> &right) {
+        std::vector<Rational> result(left.size() + right.size() - 1);
+        for (std::size_t i = 0; i < left.size(); i++) {
+            if (left[i].isZero()) {
+                continue;
+            }
+            for (std::size_t j = 0; j < right.size(); j++) {
+                result[i + j] += left[i] * right[j];
+            }
+        }
+        trim(result);
+        return result;
+    }
+
+    Rational evaluate(const std::vector<Rational> &coefficients, const Rational &x) {
+        Rational result;
+        for (std::size_t i = coefficients.size(); i-- > 0;) {
+            result = result * x + coefficients[i];
+        }
+        return result;
+    }
+
+    /* p / (x - root) for an exact root, by synthetic division */
+    std::vector<Rational> deflate(const std::vector<Rational> &coefficients, const Rational &root) {
+        std::vector<Rational> quotient(coefficients.size() - 1);
+        Rational carry;
+        for (std::size_t i = coefficients.size() - 1; i-- > 0;) {
+            carry = carry * root + coefficients[i + 1];
+            quotient[i] = carry;
+        }
+        return quotient;
+    }
+
+    /* Quotient of a / b, remainder left in a */
+    std::vector<Rational> divide(std::vector<Rational> &a, const std::vector<Rational> &b) {
+        if (a.size() < b.size()) {
+            return {Rational(0)};
+        }
+        std::vector<Rational> quotient(a.size() - b.size() + 1);
+        for (std::size_t i = quotient.size(); i-- > 0;) {
+            Rational factor = a[i + b.size() - 1] / b.back();
+            quotient[i] = factor;
+            if (factor.isZero()) {
+                continue;
+            }
+            for (std::size_t j = 0; j < b.size(); j++) {
+                a[i + j] -= factor * b[j];
+            }
+        }
+        a.resize(b.size() - 1);
+        if (a.empty()) {
+            a.push_back(Rational(0));
+        }
+        trim(a);
+        return quotient;
+    }
+
+    /* Same roots, each once: p / gcd(p, p'), so repeated roots are simple for the numeric part */
+    std::vector<Rational> squareFree(const std::vector<Rational> &coefficients) {
+        std::vector<Rational> a = coefficients, b(coefficients.size() - 1);
+        for (std::size_t i = 1; i < coefficients.size(); i++) {
+            b[i - 1] = coefficients[i] * Rational(static_cast<std::int64_t>(i));
+        }
+        // Euclid, remainders kept monic so the coefficients stay small
+        while (b.size() > 1 || !b[0].isZero()) {
+            divide(a, b);
+            std::swap(a, b);
+            if (b.size() > 1 || !b[0].isZero()) {
+                Rational lead = b.back();
+                for (Rational &coefficient : b) {
+                    coefficient = coefficient / lead;
+                }
+            }
+        }
+        if (a.size() == 1) {
+            return coefficients;
+        }
+        std::vector<Rational> p = coefficients;
+        return divide(p, a);
+    }
+
+    PTree numberTree(const Rational &value) {
+        PTree magnitude = PersistentNode::atom(Token::fromNumber(value));
+        return value.isNegative() ? PersistentNode::unary(Token(MINUS, "-"), magnitude) : magnitude;
+    }
+
+    std::string formatValue(double value) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.15g", value == 0 ? 0.0 : value);
+        return buffer;
+    }
+
+    PolynomialRoot exactRoot(const PTree &tree, double value) {
+        return PolynomialRoot{value, tree, Printer::print(tree->thaw().get())};
+    }
+
+    /* Numerator and denominator of a value that fits the int64 fast path */
+    bool split(const Rational &value, std::int64_t &num, std::int64_t &den) {
+        if (!value.isSmall()) {
+            return false;
+        }
+        num = value.numerator().toInt64();
+        den = value.denominator().toInt64();
+        return true;
+    }
+
+    /*
+    * Rational root theorem: p / q in lowest terms is only a root when q divides the leading
+    * and p the constant coefficient of the polynomial scaled to integers. Rejects most near
+    * misses of reconstruct before an exact evaluation, which can be slow with large q
+    */
+    bool possibleRoot(const std::vector<Rational> &coefficients, const Rational &candidate) {
+        std::int64_t num, den, p, q;
+        if (candidate.isZero() || !split(candidate, p, q)) {
+            return true;
+        }
+        std::int64_t scale = 1;
+        for (const Rational &coefficient : coefficients) {
+            if (!split(coefficient, num, den) || scale > MAX_SCALE) {
+                return true;
+            }
+            scale = std::lcm(scale, den);
+        }
+        Rational lead = coefficients.back() * Rational(scale);
+        Rational constant = coefficients.front() * Rational(scale);
+        return (lead / Rational(q)).isInteger() && (constant / Rational(p)).isInteger();
+    }
+
+    /* Roots of a x^2 + b x + c with exact coefficients and an irrational discriminant */
+    void surdRoots(const Rational &a, const Rational &b, const Rational &c, std::vector<PolynomialRoot> &out) {
+        Rational discriminant = b * b - Rational(4) * a * c;
+        if (discriminant.isNegative()) {
+            return;
+        }
+        Rational center = -b / (Rational(2) * a);
+        Rational scale = (Rational(1) / (Rational(2) * a)).abs();
+
+        // sqrt(n / d) = sqrt(n * d) / d, then square factors of n * d move out
+        PTree radicand = numberTree(discriminant);
+        double radicandValue = discriminant.toDouble();
+        std::int64_t num, den;
+        if (split(discriminant, num, den) && num <= (INT64_MAX / den)) {
+            std::int64_t square = num * den;
+            scale = scale / Rational(den);
+            for (std::int64_t k = 2; k * k <= square && k <= 100000; k++) {
+                while (square % (k * k) == 0) {
+                    square /= k * k;
+                    scale = scale * Rational(k);
+                }
+            }
+            radicand = numberTree(Rational(square));
+            radicandValue = static_cast<double>(square);
+        }
+        PTree root = PersistentNode::binary(Token(POWER, "^"), radicand, numberTree(Rational(1, 2)));
+        PTree term = scale.isOne() ? root : PersistentNode::binary(Token(MULTIPLY, "*"), numberTree(scale), root);
+        double offset = scale.toDouble() * std::sqrt(radicandValue);
+
+        if (center.isZero()) {
+            out.push_back(exactRoot(PersistentNode::unary(Token(MINUS, "-"), term), -offset));
+            out.push_back(exactRoot(term, offset));
+            return;
+        }
+        PTree centerTree = numberTree(center);
+        out.push_back(exactRoot(PersistentNode::binary(Token(MINUS, "-"), centerTree, term), center.toDouble() - offset));
+        out.push_back(exactRoot(PersistentNode::binary(Token(PLUS, "+"), centerTree, term), center.toDouble() + offset));
+    }
+
+    void quadraticRoots(double a, double b, double c, std::vector<double> &out) {
+        double discriminant = b * b - 4 * a * c;
+        if (discriminant < 0) {
+            return;
+        }
+        // No cancellation between -b and the square root
+        double q = -(b + std::copysign(std::sqrt(discriminant), b)) / 2;
+        if (q == 0) {
+            out.push_back(0);
+            return;
+        }
+        out.push_back(q / a);
+        out.push_back(c / q);
+    }
+}
+
+bool PolynomialSolver::combine(const Token &token, std::vector<Rational> &left, std::vector<Rational> &right, std::vector<Rational> &out) {
+    switch (token.getType()) {
+        case ASSIGN:
+        case MINUS:
+        case PLUS: {
+            out = std::move(left);
+            out.resize(std::max(out.size(), right.size()));
+            for (std::size_t i = 0; i < right.size(); i++) {
+                out[i] = token.getType() == PLUS ? out[i] + right[i] : out[i] - right[i];
+            }
+            trim(out);
+            return true;
+        }
+        case MULTIPLY:
+            if (left.size() + right.size() - 2 > MAX_DEGREE) {
+                return false;
+            }
+            out = multiply(left, right);
+            return true;
+        case DIVIDE:
+            if (right.size() != 1 || right[0].isZero()) {
+                return false;
+            }
+            out = std::move(left);
+            for (Rational &coefficient : out) {
+                coefficient = coefficient / right[0];
+            }
+            return true;
+        case POWER: {
+            if (right.size() != 1 || !right[0].isInteger() || right[0].isNegative() || right[0] > Rational(MAX_DEGREE)) {
+                return false;
+            }
+            int exponent = static_cast<int>(right[0].toDouble());
+            if ((left.size() - 1) * exponent > MAX_DEGREE) {
+                return false;
+            }
+            out = {Rational(1)};
+            for (int i = 0; i < exponent; i++) {
+                out = multiply(out, left);
+            }
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+bool PolynomialSolver::collect(const PTree &root, const std::string &variable, std::vector<Rational> &out) {
+    // Post-order with an explicit stack, each finished node leaves its coefficients on built
+    struct Frame {
+        const PersistentNode *node;
+        int stage;
+    };
+    std::vector<Frame> frames = {{root.get(), 0}};
+    std::vector<std::vector<Rational>> built;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        const PersistentNode *node = frame.node;
+        const PersistentNode *next = nullptr;
+        if (frame.stage == 0 && node->getNodeType() != NodeType::Atom) {
+            next = node->getLeft().get();
+        } else if (frame.stage == 1 && node->getNodeType() == NodeType::BinaryOp) {
+            next = node->getRight().get();
+        }
+        if (next) {
+            frame.stage++;
+            frames.push_back({next, 0});
+            continue;
+        }
+        frames.pop_back();
+
+        const Token &token = node->getToken();
+        std::vector<Rational> result;
+        switch (node->getNodeType()) {
+            case NodeType::Atom:
+                if (token.getType() == NUMBER) {
+                    result = {Token::getNumericValue(token)};
+                } else if (token.getValue() == variable) {
+                    result = {Rational(0), Rational(1)};
+                } else {
+                    return false;
+                }
+                break;
+            case NodeType::UnaryOp:
+                result = std::move(built.back());
+                built.pop_back();
+                if (token.getType() == MINUS) {
+                    for (Rational &coefficient : result) {
+                        coefficient = -coefficient;
+                    }
+                }
+                break;
+            case NodeType::BinaryOp: {
+                std::vector<Rational> right = std::move(built.back());
+                built.pop_back();
+                std::vector<Rational> left = std::move(built.back());
+                built.pop_back();
+                if (!PolynomialSolver::combine(token, left, right, result)) {
+                    return false;
+                }
+                break;
+            }
+        }
+        built.push_back(std::move(result));
+    }
+    out = std::move(built.back());
+    return true;
+}
+
+bool PolynomialSolver::coefficients(const PTree &equation, const std::string &variable, std::vector<Rational> &out) {
+    if (!PolynomialSolver::collect(equation, variable, out)) {
+        return false;
+    }
+    trim(out);
+    return out.size() > 1;
+}
+
+std::vector<double> PolynomialSolver::cubicRoots(double a, double b, double c) {
+    // x^3 + a x^2 + b x + c
+    const double pi = std::acos(-1.0);
+    double q = (a * a - 3 * b) / 9;
+    double r = (2 * a * a * a - 9 * a * b + 27 * c) / 54;
+    double q3 = q * q * q;
+    if (r * r < q3) {
+        // Three real roots, trigonometric form
+        double theta = std::acos(std::max(-1.0, std::min(1.0, r / std::sqrt(q3))));
+        double scale = -2 * std::sqrt(q);
+        return {
+            scale * std::cos(theta / 3) - a / 3,
+            scale * std::cos((theta + 2 * pi) / 3) - a / 3,
+            scale * std::cos((theta - 2 * pi) / 3) - a / 3,
+        };
+    }
+    double big = -std::copysign(std::cbrt(std::fabs(r) + std::sqrt(r * r - q3)), r);
+    double small = big == 0 ? 0 : q / big;
+    std::vector<double> roots{big + small - a / 3};
+    // On the boundary the other two meet in a double root
+    if (std::fabs(big - small) <= 1e-7 * (std::fabs(big) + std::fabs(small) + 1)) {
+        roots.push_back(-(big + small) / 2 - a / 3);
+    }
+    return roots;
+}
+
+std::vector<double> PolynomialSolver::quarticRoots(double a, double b, double c, double d) {
+    // x^4 + a x^3 + b x^2 + c x + d, with x = y - a / 4: y^4 + p y^2 + q y + r
+    double p = b - 3 * a * a / 8;
+    double q = c - a * b / 2 + a * a * a / 8;
+    double r = d - a * c / 4 + a * a * b / 16 - 3 * a * a * a * a / 256;
+    std::vector<double> ys;
+    if (std::fabs(q) <= 1e-12 * (1 + std::fabs(p) + std::fabs(r))) {
+        // Biquadratic, y^2 = z
+        std::vector<double> zs;
+        quadraticRoots(1, p, r, zs);
+        for (double z : zs) {
+            if (z >= 0) {
+                ys.push_back(std::sqrt(z));
+                ys.push_back(-std::sqrt(z));
+            }
+        }
+    } else {
+        // Ferrari: (y^2 + p/2 + m)^2 = 2m (y - q / 4m)^2 for a root m > 0 of the resolvent cubic
+        std::vector<double> ms = PolynomialSolver::cubicRoots(p, p * p / 4 - r, -q * q / 8);
+        double m = *std::max_element(ms.begin(), ms.end());
+        if (m <= 0) {
+            return {};
+        }
+        double s = std::sqrt(2 * m);
+        quadraticRoots(1, -s, p / 2 + m + q / (2 * s), ys);
+        quadraticRoots(1, s, p / 2 + m - q / (2 * s), ys);
+    }
+    for (double &y : ys) {
+        y -= a / 4;
+    }
+    return ys;
+}
+
+std::vector<std::complex<double>> PolynomialSolver::aberth(const std::vector<double> &coefficients) {
+    using Complex = std::complex<double>;
+    const std::size_t n = coefficients.size() - 1;
+    std::vector<double> monic(coefficients.size());
+    for (std::size_t i = 0; i <= n; i++) {
+        monic[i] = coefficients[i] / coefficients[n];
+    }
+    // Fujiwara bound on the root magnitudes, the start circle sits inside it
+    double radius = 0;
+    for (std::size_t i = 1; i <= n; i++) {
+        radius = std::max(radius, std::pow(std::fabs(monic[n - i]), 1.0 / i));
+    }
+    radius = std::max(radius, 1e-3);
+    std::vector<Complex> z(n);
+    const double pi = std::acos(-1.0);
+    for (std::size_t k = 0; k < n; k++) {
+        z[k] = std::polar(radius, 2 * pi * k / n + 0.4);
+    }
+
+    for (int iteration = 0; iteration < ABERTH_MAX_ITERATIONS; iteration++) {
+        double largest = 0;
+        for (std::size_t k = 0; k < n; k++) {
+            Complex value = 1, derivative = 0;
+            for (std::size_t i = n; i-- > 0;) {
+                derivative = derivative * z[k] + value;
+                value = value * z[k] + monic[i];
+            }
+            if (value == Complex(0)) {
+                continue;
+            }
+            Complex ratio = value / derivative;
+            Complex repulsion = 0;
+            for (std::size_t j = 0; j < n; j++) {
+                if (j != k) {
+                    repulsion += 1.0 / (z[k] - z[j]);
+                }
+            }
+            Complex correction = ratio / (1.0 - ratio * repulsion);
+            z[k] -= correction;
+            largest = std::max(largest, std::abs(correction) / (1 + std::abs(z[k])));
+        }
+        if (largest < 1e-12) {
+            break;
+        }
+    }
+    return z;
+}
+
+double PolynomialSolver::polish(const std::vector<double> &coefficients, double root) {
+    for (int step = 0; step < POLISH_STEPS; step++) {
+        double value = 0, derivative = 0;
+        for (std::size_t i = coefficients.size(); i-- > 0;) {
+            derivative = derivative * root + value;
+            value = value * root + coefficients[i];
+        }
+        if (value == 0 || derivative == 0) {
+            break;
+        }
+        double next = root - value / derivative;
+        if (!std::isfinite(next) || next == root) {
+            break;
+        }
+        root = next;
+    }
+    return root;
+}
+
+std::vector<double> PolynomialSolver::numericRoots(const std::vector<double> &c) {
+    const std::size_t n = c.size() - 1;
+    std::vector<double> candidates;
+    switch (n) {
+        case 1:
+            candidates.push_back(-c[0] / c[1]);
+            break;
+        case 2:
+            quadraticRoots(c[2], c[1], c[0], candidates);
+            break;
+        case 3:
+            candidates = PolynomialSolver::cubicRoots(c[2] / c[3], c[1] / c[3], c[0] / c[3]);
+            break;
+        case 4:
+            candidates = PolynomialSolver::quarticRoots(c[3] / c[4], c[2] / c[4], c[1] / c[4], c[0] / c[4]);
+            break;
+        default:
+            for (const std::complex<double> &z : PolynomialSolver::aberth(c)) {
+                if (std::fabs(z.imag()) <= 1e-7 * (1 + std::abs(z))) {
+                    candidates.push_back(z.real());
+                }
+            }
+    }
+
+    std::vector<double> roots;
+    for (double candidate : candidates) {
+        double root = PolynomialSolver::polish(c, candidate);
+        double value = 0, magnitude = 0;
+        for (std::size_t i = c.size(); i-- > 0;) {
+            value = value * root + c[i];
+            magnitude = magnitude * std::fabs(root) + std::fabs(c[i]);
+        }
+        if (std::isfinite(root) && std::fabs(value) <= ROOT_TOLERANCE * magnitude) {
+            roots.push_back(root);
+        }
+    }
+    return roots;
+}
+
+bool PolynomialSolver::reconstruct(double value, Rational &out) {
+    if (!std::isfinite(value) || std::fabs(value) > 1e15) {
+        return false;
+    }
+    // Continued fraction convergents h / k of value
+    __int128 h0 = 0, h1 = 1, k0 = 1, k1 = 0;
+    double rest = value;
+    for (int i = 0; i < 64; i++) {
+        double whole = std::floor(rest);
+        __int128 h2 = static_cast<__int128>(whole) * h1 + h0;
+        __int128 k2 = static_cast<__int128>(whole) * k1 + k0;
+        if (k2 > MAX_DENOMINATOR || h2 > INT64_MAX || h2 < -INT64_MAX) {
+            return false;
+        }
+        h0 = h1, h1 = h2, k0 = k1, k1 = k2;
+        double approximation = static_cast<double>(h1) / static_cast<double>(k1);
+        if (std::fabs(value - approximation) <= 1e-9 * std::max(1.0, std::fabs(value))) {
+            out = Rational(static_cast<std::int64_t>(h1), static_cast<std::int64_t>(k1));
+            return true;
+        }
+        double fraction = rest - whole;
+        if (fraction <= 0) {
+            return false;
+        }
+        rest = 1 / fraction;
+    }
+    return false;
+}
+
+std::vector<PolynomialRoot> PolynomialSolver::realRoots(const std::vector<Rational> &coefficients) {
+    std::vector<Rational> exact = coefficients;
+    trim(exact);
+    std::vector<PolynomialRoot> roots;
+    if (exact.size() > 1 && exact[0].isZero()) {
+        roots.push_back(exactRoot(numberTree(Rational(0)), 0));
+        std::size_t zeros = 0;
+        while (exact[zeros].isZero()) {
+            zeros++;
+        }
+        exact.erase(exact.begin(), exact.begin() + zeros);
+    }
+    if (exact.size() > 2) {
+        exact = squareFree(exact);
+    }
+
+    while (exact.size() > 1) {
+        if (exact.size() == 2) {
+            Rational root = -exact[0] / exact[1];
+            roots.push_back(exactRoot(numberTree(root), root.toDouble()));
+            break;
+        }
+        std::vector<double> approximate;
+        for (const Rational &coefficient : exact) {
+            approximate.push_back(coefficient.toDouble());
+        }
+        std::vector<double> numeric = PolynomialSolver::numericRoots(approximate);
+
+        // Divide out the rational roots (with their multiplicity), what is left is looked at again
+        bool divided = false;
+        for (double value : numeric) {
+            Rational candidate;
+            if (exact.size() < 2 || !PolynomialSolver::reconstruct(value, candidate)
+                || !possibleRoot(exact, candidate) || !evaluate(exact, candidate).isZero()) {
+                continue;
+            }
+            roots.push_back(exactRoot(numberTree(candidate), candidate.toDouble()));
+            while (exact.size() > 1 && evaluate(exact, candidate).isZero()) {
+                exact = deflate(exact, candidate);
+            }
+            divided = true;
+        }
+        if (divided) {
+            continue;
+        }
+
+        if (exact.size() == 3) {
+            surdRoots(exact[2], exact[1], exact[0], roots);
+        } else {
+            for (double value : numeric) {
+                roots.push_back(PolynomialRoot{value, nullptr, formatValue(value)});
+            }
+        }
+        break;
+    }
+
+    std::sort(roots.begin(), roots.end(), [](const PolynomialRoot &a, const PolynomialRoot &b) {
+        return a.value < b.value;
+    });
+    // Numeric copies of a repeated irrational root
+    std::vector<PolynomialRoot> distinct;
+    for (PolynomialRoot &root : roots) {
+        if (!distinct.empty() && std::fabs(distinct.back().value - root.value) <= 1e-7 * (1 + std::fabs(root.value))) {
+            if (!distinct.back().exact && root.exact) {
+                distinct.back() = std::move(root);
+            }
+            continue;
+        }
+        distinct.push_back(std::move(root));
+    }
+    return distinct;
+}
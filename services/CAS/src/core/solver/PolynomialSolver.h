@@ -0,0 +1,54 @@
+#pragma once
+#include <complex>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../parser/PersistentNode.h"
+#include "../number/Rational.h"
+
+struct PolynomialRoot {
+    double value = 0;
+    // Exact form when there is one: a rational, or a + b * d ^ (1/2) from a quadratic factor
+    PTree exact;
+    // Printed exact form, or the value to 15 significant digits
+    std::string text;
+};
+
+/*
+* Real roots of a polynomial equation in one variable, for what Isolator cannot undo
+* e.g. x ^ 2 + 3 * x = 10 -> x = -5, x = 2
+*
+* Coefficients are collected exactly and repeated factors divided out (p / gcd(p, p')). Rational roots are found from the numeric ones
+* (rational reconstruction, then an exact check) and divided out exactly; an irreducible
+* quadratic that is left gives exact surds. The remaining roots are numeric: closed
+* forms up to degree 4 (quadratic formula, trigonometric/Cardano cubic, Ferrari quartic)
+* and the Aberth-Ehrlich iteration above, each polished with Newton steps.
+*/
+class PolynomialSolver {
+private:
+    /* coefficients[i] multiplies variable ^ i */
+    static bool collect(const PTree &root, const std::string &variable, std::vector<Rational> &out);
+    /* Coefficients of left op right from those of its operands, false when not a polynomial */
+    static bool combine(const Token &token, std::vector<Rational> &left, std::vector<Rational> &right, std::vector<Rational> &out);
+    /* Real roots, possibly repeated, of a polynomial with double coefficients */
+    static std::vector<double> numericRoots(const std::vector<double> &coefficients);
+    static std::vector<double> cubicRoots(double a, double b, double c);
+    static std::vector<double> quarticRoots(double a, double b, double c, double d);
+    static std::vector<std::complex<double>> aberth(const std::vector<double> &coefficients);
+    static double polish(const std::vector<double> &coefficients, double root);
+    /* Closest p / q with q <= MAX_DENOMINATOR, false when value is not close to one */
+    static bool reconstruct(double value, Rational &out);
+
+public:
+    static const int MAX_DEGREE = 64;
+    static const std::int64_t MAX_DENOMINATOR = 1000000;
+
+    /*
+    * Coefficients of lhs - rhs as a polynomial in variable, lowest power first
+    * False when the equation is not one (another variable, division by the variable,
+    * a non-integer power, degree above MAX_DEGREE) or has degree 0
+    */
+    static bool coefficients(const PTree &equation, const std::string &variable, std::vector<Rational> &out);
+    /* Distinct real roots, ascending */
+    static std::vector<PolynomialRoot> realRoots(const std::vector<Rational> &coefficients);
+};
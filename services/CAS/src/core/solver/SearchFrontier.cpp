@@ -0,0 +1,86 @@
+#include "SearchFrontier.h"
+#include <algorithm>
+
+bool SearchFrontier::lowerPriority(const EquationEntry &a, const EquationEntry &b, const SolverOptions &options) {
+    switch (options.priority) {
+        case PriorityFunction::Occurrences:
+            if (a.numVariables == b.numVariables) {
+                return a.distinctVariables > b.distinctVariables;
+            }
+            return a.numVariables > b.numVariables;
+        case PriorityFunction::Weighted: {
+            auto score = [&](const EquationEntry &e) {
+                return options.distinctWeight * e.distinctVariables +
+                       options.occurrenceWeight * e.numVariables +
+                       options.depthWeight * e.depth;
+            };
+            return score(a) > score(b);
+        }
+        case PriorityFunction::DistinctVariables:
+        default:
+            return a < b;
+    }
+}
+
+void SearchFrontier::push(EquationEntry entry) {
+    if (this->options.strategy == SearchStrategy::BreadthFirst) {
+        this->fifo.push_back(std::move(entry));
+        return;
+    }
+
+    auto cmp = [this](const EquationEntry &a, const EquationEntry &b) {
+        return SearchFrontier::lowerPriority(a, b, this->options);
+    };
+    this->heap.push_back(std::move(entry));
+    std::push_heap(this->heap.begin(), this->heap.end(), cmp);
+
+    if (this->options.strategy == SearchStrategy::Beam &&
+        this->options.beamWidth > 0 &&
+        this->heap.size() > static_cast<std::size_t>(this->options.beamWidth)) {
+        this->dropWorst();
+    }
+}
+
+void SearchFrontier::dropWorst() {
+    auto cmp = [this](const EquationEntry &a, const EquationEntry &b) {
+        return SearchFrontier::lowerPriority(a, b, this->options);
+    };
+    // The worst state of a max-heap is one of the leaves, the second half of the array
+    std::size_t worst = this->heap.size() / 2;
+    for (std::size_t i = worst + 1; i < this->heap.size(); i++) {
+        if (cmp(this->heap[i], this->heap[worst])) {
+            worst = i;
+        }
+    }
+    std::swap(this->heap[worst], this->heap.back());
+    this->heap.pop_back();
+    // The element moved into the leaf may beat its new parent, [0, worst] is still a heap otherwise
+    if (worst < this->heap.size()) {
+        std::push_heap(this->heap.begin(), this->heap.begin() + worst + 1, cmp);
+    }
+    this->prunedCount++;
+}
+
+EquationEntry SearchFrontier::pop() {
+    if (this->options.strategy == SearchStrategy::BreadthFirst) {
+        EquationEntry entry = std::move(this->fifo.front());
+        this->fifo.pop_front();
+        return entry;
+    }
+
+    auto cmp = [this](const EquationEntry &a, const EquationEntry &b) {
+        return SearchFrontier::lowerPriority(a, b, this->options);
+    };
+    std::pop_heap(this->heap.begin(), this->heap.end(), cmp);
+    EquationEntry entry = std::move(this->heap.back());
+    this->heap.pop_back();
+    return entry;
+}
+
+bool SearchFrontier::empty() const {
+    return this->heap.empty() && this->fifo.empty();
+}
+
+std::size_t SearchFrontier::size() const {
+    return this->heap.size() + this->fifo.size();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <vector>
+#include "EquationEntry.h"
+#include "SolverOptions.h"
+
+/*
+* Open states of the solver search, ordered by SolverOptions
+* BestFirst/Beam keep a binary heap on the priority function, Beam drops the
+* worst state once more than beamWidth are open. BreadthFirst is a FIFO.
+*/
+class SearchFrontier {
+public:
+    SearchFrontier(const SolverOptions &options) : options(options) {}
+
+    void push(EquationEntry entry);
+    /* Move the next state out, the frontier must not be empty */
+    EquationEntry pop();
+
+    bool empty() const;
+    std::size_t size() const;
+    /* States discarded by the beam */
+    std::size_t pruned() const { return prunedCount; }
+
+    /* True when a should be expanded after b (same convention as operator<) */
+    static bool lowerPriority(const EquationEntry &a, const EquationEntry &b, const SolverOptions &options);
+
+private:
+    const SolverOptions &options;
+    std::vector<EquationEntry> heap;
+    std::deque<EquationEntry> fifo;
+    std::size_t prunedCount = 0;
+
+    void dropWorst();
+};
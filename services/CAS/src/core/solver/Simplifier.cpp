@@ -5,194 +5,307 @@
 // Define static member
 Evaluation Simplifier::evaluator;
 
+/*
+* Every rule walks the tree with an explicit stack instead of recursing, an expression
+* can be a million nodes deep (a long "x + 1 + 1 + ..." is a left-leaning chain)
+*/
+namespace {
+    /*
+    * A node a rule is in the middle of: the slot holding it, how far it got and
+    * whether one of its finished children changed something
+    */
+    struct Frame {
+        std::unique_ptr<ASTNode> *slot;
+        int stage = 0;
+        bool changed = false;
+    };
+
+    /* Pops the finished frame and hands its result to its parent, or to result at the root */
+    void finish(std::vector<Frame> &frames, bool changed, bool &result) {
+        frames.pop_back();
+        if (frames.empty()) {
+            result = changed;
+        } else {
+            frames.back().changed |= changed;
+        }
+    }
+
+    /* A number, or a sign on a number, that is not zero: what evaluateConstantBinary adds up */
+    bool isNonZeroConstant(const ASTNode *node) {
+        if (node->getNodeType() == NodeType::UnaryOp) {
+            node = static_cast<const UnaryOpNode *>(node)->getOperand();
+            if (node->getNodeType() != NodeType::Atom) {
+                return false;
+            }
+        }
+        return node->getNodeType() == NodeType::Atom &&
+            node->getToken().getType() == TokenType::NUMBER &&
+            !Token::getNumericValue(node->getToken()).isZero();
+    }
+}
+
 
 std::vector<flattenN> Simplifier::flattenNode(
-    std::unique_ptr<ASTNode>& node, 
+    std::unique_ptr<ASTNode>& node,
     bool negate
 ) {
     std::vector<flattenN> nodes;
-    if (node->getNodeType() == NodeType::Atom) {
-        nodes.push_back({&node, negate});
-    }
-    else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        ASTNode *child = unaryNode->getOperand();
-        if (child->getNodeType() == NodeType::Atom) {
-            nodes.push_back({&node, negate});
-        } else {
-            std::vector<flattenN> recur = 
-                Simplifier::flattenNode(
-                    unaryNode->getOperandRef(),
-                    unaryNode->getToken() == TokenType::MINUS ? !negate : negate
-                );
-            nodes.insert(
-                nodes.end(), 
-                recur.begin(),
-                recur.end()
-            );
+    // Pre-order, left before right
+    std::vector<flattenN> pending = {{&node, negate}};
+    while (!pending.empty()) {
+        flattenN current = pending.back();
+        pending.pop_back();
+        Stats::visit();
+        ASTNode *currentNode = current.node->get();
+        if (currentNode->getNodeType() == NodeType::Atom) {
+            nodes.push_back(current);
         }
-        
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        TokenType opType = binaryNode->getToken().getType();
-        if (Token::isAdditive(opType) || opType == TokenType::ASSIGN) {
-            bool newNegate = opType == TokenType::MINUS ||
-                                opType == TokenType::ASSIGN ? !negate : negate;
-            auto leftNodes = Simplifier::flattenNode(binaryNode->getLeftRef(), negate);
-            auto rightNodes = Simplifier::flattenNode(binaryNode->getRightRef(), newNegate);
-            nodes.insert(nodes.end(), 
-                leftNodes.begin(), 
-                leftNodes.end()
-            );
-            nodes.insert(nodes.end(), 
-                rightNodes.begin(), 
-                rightNodes.end()
-            );
-        } else {
-            nodes.push_back({&node, negate});
+        else if (currentNode->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(currentNode);
+            ASTNode *child = unaryNode->getOperand();
+            if (child->getNodeType() == NodeType::Atom) {
+                nodes.push_back(current);
+            } else {
+                pending.push_back({
+                    &unaryNode->getOperandRef(),
+                    unaryNode->getToken() == TokenType::MINUS ? !current.negate : current.negate
+                });
+            }
+
+        } else if (currentNode->getNodeType() == NodeType::BinaryOp) {
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(currentNode);
+            TokenType opType = binaryNode->getToken().getType();
+            if (Token::isAdditive(opType) || opType == TokenType::ASSIGN) {
+                bool newNegate = opType == TokenType::MINUS ||
+                                    opType == TokenType::ASSIGN ? !current.negate : current.negate;
+                pending.push_back({&binaryNode->getRightRef(), newNegate});
+                pending.push_back({&binaryNode->getLeftRef(), current.negate});
+            } else {
+                nodes.push_back(current);
+            }
         }
     }
     return nodes;
 }
 
 bool Simplifier::reduceUnary(std::unique_ptr<ASTNode> &node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    }
-    if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
+    // Post-order: a chain of signs is rebuilt once the tree under it is reduced
+    struct Chain {
+        std::unique_ptr<ASTNode> *slot;
+        bool expanded = false;
         bool changed = false;
+        // BinaryOp only: the right operand, visited once the left one is done
+        std::unique_ptr<ASTNode> *right = nullptr;
+        // UnaryOp only: the last sign of the chain and its counts
+        UnaryOpNode *innermost = nullptr;
+        bool isChain = false;
         int negativeCount = 0;
         int totalCount = 0;
-        while(Token::isAdditive(unaryNode->getToken().getType())) {
-            ASTNode *child = unaryNode->getOperand();
-            negativeCount += (unaryNode->getToken() == TokenType::MINUS) ? 1 : 0;
-            totalCount += 1;
-            changed = true;
-            if (child->getNodeType() == NodeType::UnaryOp) {
-                unaryNode = static_cast<UnaryOpNode *>(child);
-            } else {
-                break;
-            }
+    };
+    std::vector<Chain> frames = {{&node}};
+    bool result = false;
+    auto finishChain = [&](bool changed) {
+        frames.pop_back();
+        if (frames.empty()) {
+            result = changed;
+        } else {
+            frames.back().changed |= changed;
         }
-        bool recursed = Simplifier::reduceUnary(unaryNode->getOperandRef());
-        if (changed) {
-            // Rebuild the unary chain based on the count of negatives
-            if (negativeCount % 2 == 0) {
-                // Even number of negatives -> positive
-                node = std::move(unaryNode->getOperandRef());
-                return true;
-            } else {
-                // If its the only single negative, keep it as is 
+    };
+
+    while (!frames.empty()) {
+        Chain &frame = frames.back();
+        std::unique_ptr<ASTNode> &current = *frame.slot;
+        if (frame.right) {
+            std::unique_ptr<ASTNode> *right = frame.right;
+            frame.right = nullptr;
+            frames.push_back({right});
+            continue;
+        }
+        if (frame.expanded) {
+            if (current->getNodeType() == NodeType::UnaryOp && frame.isChain) {
+                UnaryOpNode *unaryNode = frame.innermost;
+                // Rebuild the unary chain based on the count of negatives
+                if (frame.negativeCount % 2 == 0) {
+                    // Even number of negatives -> positive
+                    current = std::move(unaryNode->getOperandRef());
+                    finishChain(true);
+                    continue;
+                }
+                // If its the only single negative, keep it as is
                 // Or it might cause infinite loop
-                if (negativeCount != totalCount && negativeCount != 1){
+                if (frame.negativeCount != frame.totalCount && frame.negativeCount != 1){
                     // Odd number of negatives -> single negative
-                    node = std::make_unique<UnaryOpNode>(
-                        Token(TokenType::MINUS, "-"), 
+                    current = std::make_unique<UnaryOpNode>(
+                        Token(TokenType::MINUS, "-"),
                         std::move(unaryNode->getOperandRef())
                     );
-                    return true;
+                    finishChain(true);
+                    continue;
+                }
+            }
+            finishChain(frame.changed);
+            continue;
+        }
+
+        Stats::visit();
+        frame.expanded = true;
+        if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current.get());
+            while(Token::isAdditive(unaryNode->getToken().getType())) {
+                ASTNode *child = unaryNode->getOperand();
+                frame.negativeCount += (unaryNode->getToken() == TokenType::MINUS) ? 1 : 0;
+                frame.totalCount += 1;
+                frame.isChain = true;
+                if (child->getNodeType() == NodeType::UnaryOp) {
+                    unaryNode = static_cast<UnaryOpNode *>(child);
+                } else {
+                    break;
                 }
             }
+            frame.innermost = unaryNode;
+            frames.push_back({&unaryNode->getOperandRef()});
+        } else if (current->getNodeType() == NodeType::BinaryOp) {
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+            frame.right = &binaryNode->getRightRef();
+            frames.push_back({&binaryNode->getLeftRef()});
+        } else {
+            finishChain(false);
         }
-        return recursed;
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        bool leftChanged = Simplifier::reduceUnary(binaryNode->getLeftRef());
-        bool rightChanged = Simplifier::reduceUnary(binaryNode->getRightRef());
-        return leftChanged || rightChanged;
     }
-    return false;
+    return result;
 }
 
 bool Simplifier::distributeMinusUnaryInBinary(std::unique_ptr<ASTNode> &node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    }
-    if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        Token unaryToken = unaryNode->getToken();
-        if (Token::isAdditive(unaryToken.getType())) {
+    // A rewrite replaces the node it is on and does not look below it,
+    // so the order the nodes are visited in does not matter
+    bool changed = false;
+    std::vector<std::unique_ptr<ASTNode> *> pending = {&node};
+    while (!pending.empty()) {
+        std::unique_ptr<ASTNode> &current = *pending.back();
+        pending.pop_back();
+        Stats::visit();
+        if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current.get());
+            Token unaryToken = unaryNode->getToken();
             ASTNode *child = unaryNode->getOperand();
-            if (child->getNodeType() == NodeType::BinaryOp) {
+            if (
+                Token::isAdditive(unaryToken.getType()) &&
+                child->getNodeType() == NodeType::BinaryOp &&
+                Token::isAdditive(child->getToken().getType())
+            ) {
                 BinaryOpNode *childBinary = static_cast<BinaryOpNode *>(child);
-                if (!Token::isAdditive(childBinary->getToken().getType())) {
-                    return Simplifier::distributeMinusUnaryInBinary(unaryNode->getOperandRef());
-                }
                 // Distribute the minus to both sides of the binary operation
                 Token plusToken(TokenType::PLUS, "+");
-                Token minusToken(TokenType::MINUS, "-");
 
                 auto newLeft = std::make_unique<UnaryOpNode>(unaryToken, std::move(childBinary->getLeftRef()));
                 auto newRight = std::make_unique<UnaryOpNode>(
                     Token::mergeUnaryToken(
-                        unaryToken, 
+                        unaryToken,
                         childBinary->getToken()
                     ),
                     std::move(childBinary->getRightRef())
                 );
-                node = std::make_unique<BinaryOpNode>(plusToken, std::move(newLeft), std::move(newRight));
-                return true;
+                current = std::make_unique<BinaryOpNode>(plusToken, std::move(newLeft), std::move(newRight));
+                changed = true;
+                continue;
             }
+            pending.push_back(&unaryNode->getOperandRef());
+        } else if (current->getNodeType() == NodeType::BinaryOp) {
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+            pending.push_back(&binaryNode->getRightRef());
+            pending.push_back(&binaryNode->getLeftRef());
         }
-        return Simplifier::distributeMinusUnaryInBinary(unaryNode->getOperandRef());
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        bool leftChanged = Simplifier::distributeMinusUnaryInBinary(binaryNode->getLeftRef());
-        bool rightChanged = Simplifier::distributeMinusUnaryInBinary(binaryNode->getRightRef());
-        return leftChanged || rightChanged;
     }
-    return false;
+    return changed;
 }
 
 bool Simplifier::mergeBinaryWithRightUnary(std::unique_ptr<ASTNode> &node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    }
-    if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        TokenType opType = binaryNode->getToken().getType();
-        if (!Token::isAdditive(opType)) {
-            return mergeBinaryWithRightUnary(binaryNode->getLeftRef()) || mergeBinaryWithRightUnary(binaryNode->getRightRef());
+    // Under a non-additive operator the right operand is only visited
+    // when nothing changed on the left, so this one keeps the recursive order
+    std::vector<Frame> frames = {{&node}};
+    bool result = false;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        std::unique_ptr<ASTNode> &current = *frame.slot;
+        if (current->getNodeType() == NodeType::Atom) {
+            Stats::visit();
+            finish(frames, false, result);
+            continue;
         }
-        ASTNode *right = binaryNode->getRight();
-        if (right->getNodeType() == NodeType::UnaryOp) {
-            UnaryOpNode *rightUnary = static_cast<UnaryOpNode *>(right);
-            TokenType mergedTokenType = 
-                Token::mergeUnaryToken(
-                    binaryNode->getToken().getType(),
-                    rightUnary->getToken().getType()
+        if (current->getNodeType() == NodeType::UnaryOp) {
+            if (frame.stage == 0) {
+                Stats::visit();
+                frame.stage = 1;
+                frames.push_back({&static_cast<UnaryOpNode *>(current.get())->getOperandRef()});
+            } else {
+                finish(frames, frame.changed, result);
+            }
+            continue;
+        }
+
+        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+        TokenType opType = binaryNode->getToken().getType();
+        if (frame.stage == 0) {
+            Stats::visit();
+            if (!Token::isAdditive(opType)) {
+                // Left first, the right one waits for its result
+                frame.stage = 1;
+                frames.push_back({&binaryNode->getLeftRef()});
+                continue;
+            }
+            ASTNode *right = binaryNode->getRight();
+            if (right->getNodeType() == NodeType::UnaryOp) {
+                UnaryOpNode *rightUnary = static_cast<UnaryOpNode *>(right);
+                TokenType mergedTokenType =
+                    Token::mergeUnaryToken(
+                        binaryNode->getToken().getType(),
+                        rightUnary->getToken().getType()
+                    );
+                // Create new binary node with merged operation and left operand unchanged
+                current = std::make_unique<BinaryOpNode>(
+                    Token(
+                        mergedTokenType,
+                        std::string(1, Token::operationToChr(mergedTokenType))
+                    ),
+                    std::move(binaryNode->getLeftRef()),
+                    std::move(rightUnary->getOperandRef())
                 );
-            // Create new binary node with merged operation and left operand unchanged
-            node = std::make_unique<BinaryOpNode>(
-                Token(
-                    mergedTokenType, 
-                    std::string(1, Token::operationToChr(mergedTokenType))
-                ), 
-                std::move(binaryNode->getLeftRef()), 
-                std::move(rightUnary->getOperandRef())
-            );
-            return true;
-        }
-        bool leftChanged = mergeBinaryWithRightUnary(binaryNode->getLeftRef());
-        bool rightChanged = mergeBinaryWithRightUnary(binaryNode->getRightRef());
-        return leftChanged || rightChanged;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return mergeBinaryWithRightUnary(unaryNode->getOperandRef());
+                finish(frames, true, result);
+                continue;
+            }
+            // Both sides, whatever the left one does
+            frame.stage = 3;
+            frames.push_back({&binaryNode->getLeftRef()});
+        } else if (frame.stage == 3 || (frame.stage == 1 && !frame.changed)) {
+            frame.stage = 2;
+            frames.push_back({&binaryNode->getRightRef()});
+        } else {
+            finish(frames, frame.changed, result);
+        }
     }
-    return false;
+    return result;
 }
 
 bool Simplifier::distributeMultiplyBinary(std::unique_ptr<ASTNode> &node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    }
-    if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
+    // A rewrite replaces the node it is on and does not look below it,
+    // so the order the nodes are visited in does not matter
+    bool changed = false;
+    std::vector<std::unique_ptr<ASTNode> *> pending = {&node};
+    while (!pending.empty()) {
+        std::unique_ptr<ASTNode> &current = *pending.back();
+        pending.pop_back();
+        Stats::visit();
+        if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current.get());
+            pending.push_back(&unaryNode->getOperandRef());
+            continue;
+        }
+        if (current->getNodeType() != NodeType::BinaryOp) {
+            continue;
+        }
+        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
         if (binaryNode->getToken() == TokenType::MULTIPLY) {
-            // ASTNode *side = binaryNode->getRight();
-
             // isRight: which side is the Binary One and the other one gonna distribute inside
             auto tryDistribute = [&](ASTNode *side, bool isRight) -> bool {
                 if (side->getNodeType() == NodeType::BinaryOp) {
@@ -202,11 +315,8 @@ bool Simplifier::distributeMultiplyBinary(std::unique_ptr<ASTNode> &node) {
                         Token opToken = sideBinary->getToken();
                         Token multiplyToken(TokenType::MULTIPLY, "*");
 
-                        std::unique_ptr<ASTNode> clonedLeft =  binaryNode->getLeft()->clone();
-                        std::unique_ptr<ASTNode> clonedRight = sideBinary->getRight()->clone();
-
-                        ASTNode *distributor = isRight ? 
-                            binaryNode->getLeft() : 
+                        ASTNode *distributor = isRight ?
+                            binaryNode->getLeft() :
                             binaryNode->getRight();
 
                         // Right
@@ -225,193 +335,251 @@ bool Simplifier::distributeMultiplyBinary(std::unique_ptr<ASTNode> &node) {
                             std::move(sideBinary->getRightRef())
                         );
 
-                        node = std::make_unique<BinaryOpNode>(opToken, std::move(newLeft), std::move(newRight));
+                        current = std::make_unique<BinaryOpNode>(opToken, std::move(newLeft), std::move(newRight));
                         return true;
                     }
                 }
                 return false;
             };
             if (
-                tryDistribute(binaryNode->getRight(), true) || 
+                tryDistribute(binaryNode->getRight(), true) ||
                 tryDistribute(binaryNode->getLeft(), false)
             ) {
-                return true;
+                changed = true;
+                continue;
             }
         }
-        bool leftChanged = Simplifier::distributeMultiplyBinary(binaryNode->getLeftRef());
-        bool rightChanged = Simplifier::distributeMultiplyBinary(binaryNode->getRightRef());
-        return leftChanged || rightChanged;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return Simplifier::distributeMultiplyBinary(unaryNode->getOperandRef());
+        pending.push_back(&binaryNode->getRightRef());
+        pending.push_back(&binaryNode->getLeftRef());
     }
-    return false;
+    return changed;
 }
 
+
 bool Simplifier::evaluateConstantBinary(std::unique_ptr<ASTNode> &node) {
-    // This will be run after the distribute step, 
+    // This will be run after the distribute step,
     // so we can assume all nodes are associative
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    }
-    if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
 
-        bool leftChanged = Simplifier::evaluateConstantBinary(binaryNode->getLeftRef());
-        bool rightChanged = Simplifier::evaluateConstantBinary(binaryNode->getRightRef());
+    // Post-order. Flattening both operands of every + and - again would be quadratic on a
+    // long chain, so each finished node leaves what its flattenNode list adds up instead:
+    // the entries that are non-zero constants, negate relative to the node, as
+    // constants[start, end) with its start on starts. A parent joins its operands' ranges.
+    std::vector<Frame> frames = {{&node}};
+    std::vector<flattenN> constants;
+    std::vector<std::size_t> starts;
+    bool changed = false;
+
+    auto negateFrom = [&](std::size_t start) {
+        for (std::size_t i = start; i < constants.size(); i++) {
+            constants[i].negate = !constants[i].negate;
+        }
+    };
+    // A finished operand that is still an operator did not evaluate and cannot now,
+    // only (signed) atoms are worth a try
+    auto isSignedAtom = [](ASTNode *side) {
+        while (side->getNodeType() == NodeType::UnaryOp) {
+            side = static_cast<UnaryOpNode *>(side)->getOperand();
+        }
+        return side->getNodeType() == NodeType::Atom;
+    };
+
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        std::unique_ptr<ASTNode> &current = *frame.slot;
+
+        if (current->getNodeType() == NodeType::Atom) {
+            Stats::visit();
+            starts.push_back(constants.size());
+            if (isNonZeroConstant(current.get())) {
+                constants.push_back({&current, false});
+            }
+            finish(frames, false, changed);
+            continue;
+        }
+
+        if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current.get());
+            if (frame.stage == 0) {
+                Stats::visit();
+                frame.stage = 1;
+                frames.push_back({&unaryNode->getOperandRef()});
+                continue;
+            }
+            // A sign on an atom is an entry itself, a sign on anything else negates the operand's
+            if (unaryNode->getOperand()->getNodeType() == NodeType::Atom) {
+                constants.resize(starts.back());
+                if (isNonZeroConstant(unaryNode)) {
+                    constants.push_back({&current, false});
+                }
+            } else if (unaryNode->getToken() == TokenType::MINUS) {
+                negateFrom(starts.back());
+            }
+            finish(frames, frame.changed, changed);
+            continue;
+        }
+
+        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+        if (frame.stage == 0) {
+            Stats::visit();
+            frame.stage = 1;
+            frames.push_back({&binaryNode->getLeftRef()});
+            continue;
+        }
+        if (frame.stage == 1) {
+            frame.stage = 2;
+            frames.push_back({&binaryNode->getRightRef()});
+            continue;
+        }
+        std::size_t rightStart = starts.back();
+        starts.pop_back();
+        std::size_t start = starts.back();
 
         ASTNode *left = binaryNode->getLeft();
         ASTNode *right = binaryNode->getRight();
 
         // Direct evaluation if both sides are numbers
         if (
-            left && right
+            isSignedAtom(left) && isSignedAtom(right)
         ) {
             try {
-                ASTNode* nodePtr = node.get();
-                double result = Simplifier::evaluator.evaluate(nodePtr);
-                if (result < 0){
-                    node = std::make_unique<UnaryOpNode>(
-                        Token(TokenType::MINUS, "-"), 
-                        std::make_unique<AtomNode>(
-                            Token(TokenType::NUMBER, std::to_string(-result))
-                        )
+                ASTNode* nodePtr = current.get();
+                Rational result = Simplifier::evaluator.evaluate(nodePtr);
+                if (result.isNegative()){
+                    current = std::make_unique<UnaryOpNode>(
+                        Token(TokenType::MINUS, "-"),
+                        std::make_unique<AtomNode>(Token::fromNumber(result))
                     );
                 } else {
-                    node = std::make_unique<AtomNode>(
-                        Token(TokenType::NUMBER, std::to_string(result))
-                    );
+                    current = std::make_unique<AtomNode>(Token::fromNumber(result));
                 }
                 // Node was replaced, binaryNode/left/right are now dangling pointers
-                // Return early to avoid use-after-free
-                return true;
+                constants.resize(start);
+                if (!result.isZero()) {
+                    constants.push_back({&current, false});
+                }
+                finish(frames, true, changed);
+                continue;
             } catch (const std::exception &e) {
                 // Might not be constants so skip
             }
         }
 
-        // Flatten nested operations of the same type
-        if (left && right && Token::isAdditive(binaryNode->getToken().getType())) {
-            std::vector<flattenN> flatLeft = Simplifier::flattenNode(binaryNode->getLeftRef());
-            std::vector<flattenN> flatRight = Simplifier::flattenNode(
-                binaryNode->getRightRef(), 
-                binaryNode->getToken() == TokenType::ASSIGN || binaryNode->getToken() == TokenType::MINUS
-            );
-            // for(flattenN &n : flatLeft){
-            //     dbg("left", (*n.node)->toString() + (n.negate ? " (neg)" : ""));
-            // }
-            // for(flattenN &n : flatRight){
-            //     dbg("right", (*n.node)->toString() + (n.negate ? " (neg)" : ""));
-            // }
-
-            double finalResult = 0.0;
-            std::unique_ptr<ASTNode>* randomAtom = nullptr;
-            bool randomNegate = false;
-            bool randomUnaryNegate = false;
-            std::vector<std::unique_ptr<ASTNode>*> removeNodes;
-            
-            auto sumUp = [&](std::vector<flattenN> &nodes){
-                for(flattenN &n: nodes){
-                    if (
-                        (*n.node)->getNodeType() == NodeType::Atom && 
-                        (*n.node)->getToken().getType() == TokenType::NUMBER
-                    ) {
-                        double val = Token::getNumericValue((*n.node)->getToken());
-                        finalResult += n.negate ? -val : val; 
-                        // (*n)->setToken(Token(TokenType::NUMBER, "0"));
-                        removeNodes.push_back(n.node);
-                        if (val != 0) {
-                            if (!randomAtom) {
-                                randomAtom = n.node;
-                                randomNegate = n.negate;
-                                removeNodes.pop_back();
-                            }
-                        } else {
-                            removeNodes.pop_back();
-                        }
-                    } else if ((*n.node)->getNodeType() == NodeType::UnaryOp){
-                        UnaryOpNode* unaryNode = static_cast<UnaryOpNode*>((*n.node).get());
-                        ASTNode *child = unaryNode->getOperand();
-                        if (
-                            child->getNodeType() == NodeType::Atom && 
-                            child->getToken().getType() == TokenType::NUMBER
-                        ) {
-                            AtomNode *childAtom = static_cast<AtomNode *>(child);
-                            double val = Token::getNumericValue(childAtom->getToken());
-                            val = n.negate ? -val : val;
-                            if (unaryNode->getToken() == TokenType::MINUS) {
-                                finalResult -= val;
-                            } else {
-                                finalResult += val;
-                            }
-                            // childAtom->setToken(Token(TokenType::NUMBER, "0"));
-                            removeNodes.push_back(n.node);
-                            if (val != 0) {
-                                if (!randomAtom) {
-                                    randomAtom = &unaryNode->getOperandRef();
-                                    randomNegate = n.negate;
-                                    randomUnaryNegate = unaryNode->getToken() == TokenType::MINUS;
-                                    removeNodes.pop_back();
-                                }
-                            } else {
-                                removeNodes.pop_back();
-                            }
-                        }
-                    }
-                }
-            };
-            sumUp(flatLeft);
-            sumUp(flatRight);
-
+        TokenType opType = binaryNode->getToken().getType();
+        if (opType == TokenType::MINUS || opType == TokenType::ASSIGN) {
             // The right is already negated
-            // So if we fixed the node on the negated side
-            // We have to convert it back
-            std::unique_ptr<ASTNode> newNode;
+            negateFrom(rightStart);
+        }
+        if (!Token::isAdditive(opType)) {
+            // An assignment only passes the entries of both sides up, any other operator is an entry itself
+            if (opType != TokenType::ASSIGN) {
+                constants.resize(start);
+            }
+            finish(frames, frame.changed, changed);
+            continue;
+        }
 
-            float absFinal = abs(finalResult);
+        // If there is more than 2 constants, we just replace one of them
+        if (constants.size() - start < 2) {
+            finish(frames, frame.changed, changed);
+            continue;
+        }
 
-            if (randomNegate ^ randomUnaryNegate ^ (finalResult < 0)) {
-                newNode = std::make_unique<UnaryOpNode>(
-                    Token(TokenType::MINUS, "-"), 
-                    std::make_unique<AtomNode>(Token(TokenType::NUMBER, std::to_string(absFinal)))
-                );
+        Rational finalResult;
+        for (std::size_t i = start; i < constants.size(); i++) {
+            const flattenN &n = constants[i];
+            ASTNode *term = n.node->get();
+            if (term->getNodeType() == NodeType::Atom) {
+                Rational val = Token::getNumericValue(term->getToken());
+                finalResult += n.negate ? -val : val;
             } else {
-                newNode = std::make_unique<AtomNode>(Token(TokenType::NUMBER, std::to_string(absFinal)));
+                UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(term);
+                Rational val = Token::getNumericValue(unaryNode->getOperand()->getToken());
+                val = n.negate ? -val : val;
+                if (unaryNode->getToken() == TokenType::MINUS) {
+                    finalResult -= val;
+                } else {
+                    finalResult += val;
+                }
             }
+        }
 
-            // If there is more than 2 constants, we just replace one of them
-            if (randomAtom && removeNodes.size() > 0) {
-                *randomAtom = std::move(newNode);
-                for(std::unique_ptr<ASTNode>* n: removeNodes) {
-                    *n = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
-                }
-                return true;
+        // The first constant takes the sum, a number replaces the atom and a sign on a
+        // number keeps its sign and has its operand replaced
+        flattenN representative = constants[start];
+        std::unique_ptr<ASTNode>* randomAtom = representative.node;
+        bool randomNegate = representative.negate;
+        bool randomUnaryNegate = false;
+        UnaryOpNode *randomUnary = nullptr;
+        if ((*randomAtom)->getNodeType() == NodeType::UnaryOp) {
+            randomUnary = static_cast<UnaryOpNode *>(randomAtom->get());
+            randomUnaryNegate = randomUnary->getToken() == TokenType::MINUS;
+            randomAtom = &randomUnary->getOperandRef();
+        }
+
+        // So if we fixed the node on the negated side
+        // We have to convert it back
+        std::unique_ptr<ASTNode> newNode;
+        bool newNegative = randomNegate ^ randomUnaryNegate ^ finalResult.isNegative();
+        if (newNegative) {
+            newNode = std::make_unique<UnaryOpNode>(
+                Token(TokenType::MINUS, "-"),
+                std::make_unique<AtomNode>(Token::fromNumber(finalResult))
+            );
+        } else {
+            newNode = std::make_unique<AtomNode>(Token::fromNumber(finalResult));
+        }
+
+        *randomAtom = std::move(newNode);
+        for (std::size_t i = start + 1; i < constants.size(); i++) {
+            *constants[i].node = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
+        }
+
+        // The sum is the only constant left, a sign placed on a signed number makes its
+        // operand the entry
+        constants.resize(start);
+        if (!finalResult.isZero()) {
+            if (randomUnary && newNegative) {
+                constants.push_back({randomAtom, randomUnaryNegate ? !randomNegate : randomNegate});
+            } else {
+                constants.push_back(representative);
             }
         }
-        
-        return leftChanged || rightChanged;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return Simplifier::evaluateConstantBinary(unaryNode->getOperandRef());
+        finish(frames, true, changed);
     }
-    return false;
+    return changed;
 }
 
 bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
-    // Remove at binary level only since 
+    // Remove at binary level only since
     // Deletion at unary and atom level cause ref issues
-    if (node->getNodeType() == NodeType::Atom) {
-        return false;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        return false;
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        bool leftChanged = Simplifier::evaluateSpecialCases(binaryNode->getLeftRef());
-        bool rightChanged = Simplifier::evaluateSpecialCases(binaryNode->getRightRef());
+    std::vector<Frame> frames = {{&node}};
+    bool result = false;
+    while (!frames.empty()) {
+        Frame &frame = frames.back();
+        std::unique_ptr<ASTNode> &current = *frame.slot;
+        if (current->getNodeType() != NodeType::BinaryOp) {
+            Stats::visit();
+            finish(frames, false, result);
+            continue;
+        }
+        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+        if (frame.stage == 0) {
+            // Both operands first
+            Stats::visit();
+            frame.stage = 1;
+            frames.push_back({&binaryNode->getLeftRef()});
+            continue;
+        }
+        if (frame.stage == 1) {
+            frame.stage = 2;
+            frames.push_back({&binaryNode->getRightRef()});
+            continue;
+        }
 
         // Do not remove anything in assignment
         if(binaryNode->getToken() == TokenType::ASSIGN){
-            return leftChanged || rightChanged;
+            finish(frames, frame.changed, result);
+            continue;
         }
 
         ASTNode *left = binaryNode->getLeft();
@@ -422,30 +590,31 @@ bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
                 AtomNode *atomNode = static_cast<AtomNode *>(target);
                 if (atomNode->getToken().getType() == TokenType::NUMBER){
                     // Deal with 0
-                    if (Token::getNumericValue(atomNode->getToken()) == 0.0) {
+                    Rational value = Token::getNumericValue(atomNode->getToken());
+                    if (value.isZero()) {
                         // Binary add 0
                         if (binaryNode->getToken() == TokenType::PLUS) {
                             // Replace the entire binary node with the other side
-                            node = isLeft ? 
-                                std::move(binaryNode->getRightRef()) : 
+                            current = isLeft ?
+                                std::move(binaryNode->getRightRef()) :
                                 std::move(binaryNode->getLeftRef());
                             return true;
                         // Binary multiply by 0
                         } else if (binaryNode->getToken() == TokenType::MULTIPLY) {
                             // Multiplication by zero results in zero
-                            node = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
+                            current = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
                             return true;
                         // Binary minus with 0
                         } else if (binaryNode->getToken() == TokenType::MINUS) {
                             if (isLeft) {
                                 // 0 - x -> -x
-                                node = std::make_unique<UnaryOpNode>(
+                                current = std::make_unique<UnaryOpNode>(
                                     Token(TokenType::MINUS, "-"),
                                     std::move(binaryNode->getRightRef())
                                 );
                             } else {
                                 // x - 0 -> x
-                                node = std::move(binaryNode->getLeftRef());
+                                current = std::move(binaryNode->getLeftRef());
                             }
                             return true;
                         }
@@ -453,7 +622,7 @@ bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
                         else if (binaryNode->getToken() == TokenType::DIVIDE) {
                             if (isLeft) {
                                 // 0 / x → 0 (only if x is definitely not zero)
-                                node = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
+                                current = std::make_unique<AtomNode>(Token(TokenType::NUMBER, "0"));
                                 return true;
                             } else {
                                 dbg(binaryNode->toString());
@@ -463,18 +632,18 @@ bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
                             }
                         }
                     // Deal with 1
-                   } else if (Token::getNumericValue(atomNode->getToken()) == 1.0) {
+                   } else if (value.isOne()) {
                         // Multiply 1
                         if (binaryNode->getToken() == TokenType::MULTIPLY) {
                             // Multiplication by one results in the other operand
-                            node = isLeft ? 
-                                std::move(binaryNode->getRightRef()) : 
+                            current = isLeft ?
+                                std::move(binaryNode->getRightRef()) :
                                 std::move(binaryNode->getLeftRef());
                             return true;
                         // Divide by 1
                         } else if (binaryNode->getToken() == TokenType::DIVIDE && !isLeft) {
                             // x / 1 → x (Division by one results in the numerator)
-                            node = std::move(binaryNode->getLeftRef());
+                            current = std::move(binaryNode->getLeftRef());
                             return true;
                         }
                     }
@@ -485,11 +654,11 @@ bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
                 ASTNode *child = unaryNode->getOperand();
                 if (child->getNodeType() == NodeType::Atom) {
                     AtomNode *childAtom = static_cast<AtomNode *>(child);
-                    if (childAtom->getToken().getType() == TokenType::NUMBER && 
-                        Token::getNumericValue(childAtom->getToken()) == 0.0) {
+                    if (childAtom->getToken().getType() == TokenType::NUMBER &&
+                        Token::getNumericValue(childAtom->getToken()).isZero()) {
                         if (Token::isAdditive(binaryNode->getToken().getType())) {
                             // Replace the entire binary node with the other side
-                            node = isLeft ? 
+                            current = isLeft ?
                                 std::make_unique<UnaryOpNode>(
                                     binaryNode->getToken(),
                                     std::move(binaryNode->getRightRef())
@@ -504,40 +673,42 @@ bool Simplifier::evaluateSpecialCases(std::unique_ptr<ASTNode> &node) {
             return false;
         };
 
-        if (removeNode(true, left) || removeNode(false, right)) {
-            return true;
-        }
-        
-        return leftChanged || rightChanged;
+        bool removed = removeNode(true, left) || removeNode(false, right);
+        finish(frames, removed || frame.changed, result);
     }
-    return false;
+    return result;
 }
 
 bool Simplifier::seperateIntoUnary(std::unique_ptr<ASTNode> &node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        AtomNode *atomNode = static_cast<AtomNode *>(node.get());
-        if (atomNode->getToken().getType() == TokenType::NUMBER) {
-            double val = Token::getNumericValue(atomNode->getToken());
-            if (val < 0) {
-                // Convert negative number to unary operation
-                node = std::make_unique<UnaryOpNode>(
-                    Token(TokenType::MINUS, "-"), 
-                    std::make_unique<AtomNode>(Token(TokenType::NUMBER, std::to_string(-val)))
-                );
-                return true;
+    bool changed = false;
+    std::vector<std::unique_ptr<ASTNode> *> pending = {&node};
+    while (!pending.empty()) {
+        std::unique_ptr<ASTNode> &current = *pending.back();
+        pending.pop_back();
+        Stats::visit();
+        if (current->getNodeType() == NodeType::Atom) {
+            AtomNode *atomNode = static_cast<AtomNode *>(current.get());
+            if (atomNode->getToken().getType() == TokenType::NUMBER) {
+                Rational val = Token::getNumericValue(atomNode->getToken());
+                if (val.isNegative()) {
+                    // Convert negative number to unary operation
+                    current = std::make_unique<UnaryOpNode>(
+                        Token(TokenType::MINUS, "-"),
+                        std::make_unique<AtomNode>(Token::fromNumber(val))
+                    );
+                    changed = true;
+                }
             }
+        } else if (current->getNodeType() == NodeType::UnaryOp) {
+            UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(current.get());
+            pending.push_back(&unaryNode->getOperandRef());
+        } else if (current->getNodeType() == NodeType::BinaryOp) {
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current.get());
+            pending.push_back(&binaryNode->getRightRef());
+            pending.push_back(&binaryNode->getLeftRef());
         }
-        return false;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return seperateIntoUnary(unaryNode->getOperandRef());
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        bool leftChanged = seperateIntoUnary(binaryNode->getLeftRef());
-        bool rightChanged = seperateIntoUnary(binaryNode->getRightRef());
-        return leftChanged || rightChanged;
     }
-    return false;
+    return changed;
 }
 
 bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
@@ -557,7 +728,7 @@ bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
         return false;
     };
 
-    std::unordered_map<std::string, double> termMap; // term string -> coefficient
+    std::unordered_map<std::string, Rational> termMap; // term string -> coefficient
     std::unordered_map<
         std::string, 
         std::pair<
@@ -580,9 +751,20 @@ bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
             return;
         }
 
+        // Only c * x, x * c and x / c are terms of x
+        TokenType op = parentPtr->getToken().getType();
+        bool divide = op == TokenType::DIVIDE;
+        if (op != TokenType::MULTIPLY && !(divide && numSide == &static_cast<BinaryOpNode *>(parentPtr)->getRightRef())) {
+            return;
+        }
+
         std::string termStr = termSidePtr->toString();
         AtomNode *numNode = static_cast<AtomNode *>(numSidePtr);
-        double coefficient = Token::getNumericValue(numNode->getToken());
+        Rational coefficient = Token::getNumericValue(numNode->getToken());
+        if (divide) {
+            if (coefficient.isZero()) return;
+            coefficient = Rational(1) / coefficient;
+        }
 
         if (parent.negate) {
             coefficient = -coefficient;
@@ -611,13 +793,14 @@ bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
                 if (child->getNodeType() == NodeType::Atom){
                     if (isVariable(child)) {
                         std::string termStr = child->toString();
-                        double coefficient = (unaryNode->getToken() == TokenType::MINUS)^n.negate ? -1.0 : 1.0;
+                        Rational coefficient = (unaryNode->getToken() == TokenType::MINUS)^n.negate ? -1 : 1;
                         termMap[termStr] += coefficient;
                         // termNodes[termStr] = &unaryNode->getOperandRef();
                         termNodes[termStr] = std::make_pair(
                             flattenN{&unaryNode->getOperandRef(), n.negate},
                             n.node
                         );
+                        termAllNodes[termStr].push_back(n.node);
                     }
                 }
             } else {
@@ -625,7 +808,7 @@ bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
                 ASTNode *nPtr = (*n.node).get();
                 if (isVariable(nPtr)) {
                     std::string termStr = (nPtr)->toString();
-                    termMap[termStr] += n.negate ? -1.0 : 1.0;
+                    termMap[termStr] += n.negate ? -1 : 1;
                     termNodes[termStr] = std::make_pair(
                         flattenN{n.node, n.negate}, 
                         n.node
@@ -650,21 +833,21 @@ bool Simplifier::combineLikeTerms(std::unique_ptr<ASTNode> &node){
         }
         // The representative node get the result
         auto [repNode, parentNode] = termNodes[termStr];
-        if (coeff != 0.0) {
-            double absCoeff = std::abs(coeff);
-            if ((coeff < 0) ^ (repNode.negate)) {
+        if (!coeff.isZero()) {
+            Token absCoeff = Token::fromNumber(coeff);
+            if (coeff.isNegative() ^ (repNode.negate)) {
                 *parentNode = std::make_unique<UnaryOpNode>(
                     Token(TokenType::MINUS, "-"), 
                     std::make_unique<BinaryOpNode>(
                         Token(TokenType::MULTIPLY, "*"), 
-                        std::make_unique<AtomNode>(Token(TokenType::NUMBER, std::to_string(absCoeff))), 
+                        std::make_unique<AtomNode>(absCoeff), 
                         repNode.node->get()->clone()
                     )
                 );
             } else {
                 *parentNode = std::make_unique<BinaryOpNode>(
                     Token(TokenType::MULTIPLY, "*"), 
-                    std::make_unique<AtomNode>(Token(TokenType::NUMBER, std::to_string(absCoeff))), 
+                    std::make_unique<AtomNode>(absCoeff), 
                     repNode.node->get()->clone()
                 );
             }
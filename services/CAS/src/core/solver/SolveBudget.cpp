@@ -0,0 +1,62 @@
+#include "SolveBudget.h"
+
+thread_local SolveBudget *SolveBudget::active = nullptr;
+
+void SolveBudget::start() {
+    SolveBudget::status = BudgetStatus::Ok;
+    SolveBudget::deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(SolveBudget::timeoutMs);
+}
+
+bool SolveBudget::trip(BudgetStatus newStatus) {
+    // Keep the first reason, later checks only confirm we are over budget
+    if (SolveBudget::status == BudgetStatus::Ok) {
+        SolveBudget::status = newStatus;
+    }
+    return true;
+}
+
+bool SolveBudget::interrupted() {
+    if (SolveBudget::exceeded()) {
+        return true;
+    }
+    if (SolveBudget::token.isCancelled()) {
+        return SolveBudget::trip(BudgetStatus::Cancelled);
+    }
+    if (SolveBudget::timeoutMs > 0 && std::chrono::steady_clock::now() >= SolveBudget::deadline) {
+        return SolveBudget::trip(BudgetStatus::DeadlineExceeded);
+    }
+    return false;
+}
+
+bool SolveBudget::checkNodes(std::size_t nodes) {
+    if (SolveBudget::maxNodes > 0 && nodes > SolveBudget::maxNodes) {
+        return SolveBudget::trip(BudgetStatus::NodeLimitExceeded);
+    }
+    return SolveBudget::exceeded();
+}
+
+bool SolveBudget::checkQueue(std::size_t queueSize) {
+    if (SolveBudget::maxQueueSize > 0 && queueSize > SolveBudget::maxQueueSize) {
+        return SolveBudget::trip(BudgetStatus::QueueLimitExceeded);
+    }
+    return SolveBudget::exceeded();
+}
+
+bool SolveBudget::checkMemory(std::size_t bytes) {
+    if (SolveBudget::maxMemoryBytes > 0 && bytes > SolveBudget::maxMemoryBytes) {
+        return SolveBudget::trip(BudgetStatus::MemoryLimitExceeded);
+    }
+    return SolveBudget::exceeded();
+}
+
+std::string SolveBudget::statusName(BudgetStatus status) {
+    switch (status) {
+        case BudgetStatus::Ok: return "ok";
+        case BudgetStatus::Cancelled: return "cancelled";
+        case BudgetStatus::DeadlineExceeded: return "deadline_exceeded";
+        case BudgetStatus::NodeLimitExceeded: return "node_limit_exceeded";
+        case BudgetStatus::QueueLimitExceeded: return "queue_limit_exceeded";
+        case BudgetStatus::MemoryLimitExceeded: return "memory_limit_exceeded";
+        default: return "unknown";
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/* Copies share the flag, so one copy can be handed to another thread (or Python) to cancel */
+class CancellationToken {
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() { flag->store(true, std::memory_order_relaxed); }
+    void reset() { flag->store(false, std::memory_order_relaxed); }
+    bool isCancelled() const { return flag->load(std::memory_order_relaxed); }
+};
+
+enum class BudgetStatus {
+    Ok,
+    Cancelled,
+    DeadlineExceeded,
+    NodeLimitExceeded,
+    QueueLimitExceeded,
+    MemoryLimitExceeded,
+};
+
+/*
+* Per-call resource limits, checked cooperatively by Debug::executeSteps (every
+* iteration) and EquationSolver::solve (every state). Once a limit trips the
+* status sticks and the work unwinds with a partial result instead of throwing.
+* A limit of 0 means unlimited.
+*/
+class SolveBudget {
+public:
+    std::uint64_t timeoutMs = 0;
+    std::size_t maxNodes = 0;
+    std::size_t maxQueueSize = 0;
+    std::size_t maxMemoryBytes = 0;
+    CancellationToken token;
+
+    /* Start the clock and clear the previous status */
+    void start();
+
+    /* Cancellation and deadline */
+    bool interrupted();
+    bool checkNodes(std::size_t nodes);
+    bool checkQueue(std::size_t queueSize);
+    bool checkMemory(std::size_t bytes);
+
+    bool exceeded() const { return status != BudgetStatus::Ok; }
+    BudgetStatus getStatus() const { return status; }
+    static std::string statusName(BudgetStatus status);
+
+    /* Budget installed on this thread by the innermost BudgetScope, or nullptr */
+    static SolveBudget *current() { return active; }
+
+private:
+    std::chrono::steady_clock::time_point deadline;
+    BudgetStatus status = BudgetStatus::Ok;
+
+    bool trip(BudgetStatus newStatus);
+
+    static thread_local SolveBudget *active;
+    friend class BudgetScope;
+};
+
+/* Install a budget for the current thread, restores the previous one when it goes out of scope */
+class BudgetScope {
+private:
+    SolveBudget *previous;
+public:
+    BudgetScope(SolveBudget *budget) : previous(SolveBudget::active) { SolveBudget::active = budget; }
+    ~BudgetScope() { SolveBudget::active = previous; }
+
+    BudgetScope(const BudgetScope &) = delete;
+    BudgetScope &operator=(const BudgetScope &) = delete;
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+enum class TerminationReason {
+    Solved,
+    // The search failed, SolverOptions::numericFallback found a numeric answer
+    SolvedNumerically,
+    // Every reachable state was explored without isolating the target
+    QueueExhausted,
+    // SolverOptions::maxIterations
+    MaxIterations,
+    // SolverOptions::maxIterationsWithoutImprovement
+    NoImprovement,
+    // SolveBudget limits, the result is empty
+    Cancelled,
+    DeadlineExceeded,
+    NodeLimitExceeded,
+    QueueLimitExceeded,
+    MemoryLimitExceeded,
+};
+
+/* Convergence report of the numeric fallback, see NewtonSolver */
+struct NumericReport {
+    // False when the search found an exact answer or the fallback is off
+    bool attempted = false;
+    bool converged = false;
+    // converged, max_iterations, stalled, singular, underdetermined, not_differentiable, too_large or budget
+    std::string reason;
+    // "variable = value" when converged
+    std::string answer;
+    // Starting points tried, the last one is where the answer came from
+    int starts = 0;
+    // Newton steps over all starts
+    int iterations = 0;
+    int residualEvaluations = 0;
+    // max |lhs - rhs| over the equations at the last point
+    double residualNorm = 0;
+    // max |change| of a variable in the last step
+    double lastStep = 0;
+    // Every variable connected to the target, at the last point
+    std::map<std::string, double> values;
+    std::uint64_t totalNs = 0;
+};
+
+/* Roots of a reduced equation that is a polynomial in the target, see PolynomialSolver */
+struct PolynomialReport {
+    // True when a one-variable polynomial of degree 2 or more was reached
+    bool attempted = false;
+    int degree = 0;
+    // Distinct real roots, ascending, exact where possible (e.g. 1 - 2 ^ (1/2)) else 15 digits
+    std::vector<std::string> roots;
+    // "x = -5 or x = 2", empty when there is no real root
+    std::string answer;
+    std::uint64_t totalNs = 0;
+};
+
+/* What the search did, returned with every SolveResult */
+struct SolveMetrics {
+    int iterations = 0;
+    // States popped and processed (not a duplicate)
+    int statesExpanded = 0;
+    int duplicatesSkipped = 0;
+    // States dropped by SearchStrategy::Beam
+    std::size_t statesPruned = 0;
+    std::size_t peakQueueSize = 0;
+    int clones = 0;
+    int isolations = 0;
+    int simplifyCalls = 0;
+    int substitutions = 0;
+    // Simplify/isolate answered by the ExpressionDag, SolverOptions::shareSubexpressions
+    int sharedRewrites = 0;
+    // Lowest distinct variable count reached by any state
+    int bestDistinctVariables = 0;
+
+    // Wall time per phase, simplify/isolate are also part of search
+    std::uint64_t normalizeNs = 0;
+    std::uint64_t searchNs = 0;
+    std::uint64_t simplifyNs = 0;
+    std::uint64_t isolateNs = 0;
+    std::uint64_t totalNs = 0;
+
+    TerminationReason termination = TerminationReason::QueueExhausted;
+    NumericReport numeric;
+    PolynomialReport polynomial;
+
+    static std::string terminationName(TerminationReason reason) {
+        switch (reason) {
+            case TerminationReason::Solved: return "solved";
+            case TerminationReason::SolvedNumerically: return "solved_numerically";
+            case TerminationReason::QueueExhausted: return "queue_exhausted";
+            case TerminationReason::MaxIterations: return "max_iterations";
+            case TerminationReason::NoImprovement: return "no_improvement";
+            case TerminationReason::Cancelled: return "cancelled";
+            case TerminationReason::DeadlineExceeded: return "deadline_exceeded";
+            case TerminationReason::NodeLimitExceeded: return "node_limit_exceeded";
+            case TerminationReason::QueueLimitExceeded: return "queue_limit_exceeded";
+            case TerminationReason::MemoryLimitExceeded: return "memory_limit_exceeded";
+            default: return "unknown";
+        }
+    }
+};
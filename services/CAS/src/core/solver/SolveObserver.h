@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "SolveMetrics.h"
+
+enum class SolveEventKind {
+    // An equation containing the target entered the search
+    Started,
+    // A search state was expanded, text is its latest step
+    Expanded,
+    // Last event of every solve
+    Finished,
+};
+
+struct SolveEvent {
+    SolveEventKind kind;
+    // Step text (Started/Expanded) or the result, empty if not solved (Finished)
+    std::string text;
+    int iteration = 0;
+    std::size_t queueSize = 0;
+    int bestDistinctVariables = 0;
+
+    // Finished only
+    std::vector<std::string> steps = {};
+    TerminationReason termination = TerminationReason::QueueExhausted;
+
+    static std::string kindName(SolveEventKind kind) {
+        switch (kind) {
+            case SolveEventKind::Started: return "started";
+            case SolveEventKind::Expanded: return "step";
+            case SolveEventKind::Finished: return "finished";
+            default: return "unknown";
+        }
+    }
+};
+
+/*
+* Called on the solving thread while the search runs, keep it cheap
+* To stop early, cancel the SolveBudget token given to the same solve
+*/
+using SolveObserver = std::function<void(const SolveEvent &)>;
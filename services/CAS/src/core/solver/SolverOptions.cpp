@@ -0,0 +1,93 @@
+#include "SolverOptions.h"
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+std::string SolverOptions::key() const {
+    std::ostringstream out;
+    // Round-trip precision, options that differ in the 7th digit must not share an entry
+    out << std::setprecision(17);
+    out << SolverOptions::strategyName(this->strategy)
+        << "/" << SolverOptions::priorityName(this->priority);
+    if (this->strategy == SearchStrategy::Beam) {
+        out << "/w" << this->beamWidth;
+    }
+    if (this->priority == PriorityFunction::Weighted) {
+        out << "/" << this->distinctWeight << "," << this->occurrenceWeight << "," << this->depthWeight;
+    }
+    out << "/" << this->maxIterations
+        << "/" << this->maxIterationsWithoutImprovement
+        << "/" << this->expansionRatio;
+    if (!this->recordSteps) {
+        out << "/nosteps";
+    }
+    if (this->shareSubexpressions) {
+        // Same answer, but the cached SolveMetrics differ (sharedRewrites, simplify/isolate counts)
+        out << "/shared";
+    }
+    if (!this->polynomialRoots) {
+        out << "/nopoly";
+    }
+    if (this->numericFallback) {
+        const NewtonOptions &newton = this->newton;
+        out << "/newton:" << SolverOptions::newtonMethodName(newton.method) << "," << newton.maxIterations
+            << "," << newton.tolerance << "," << newton.randomStarts << "," << newton.maxNodes;
+        for (const auto &point : newton.startingPoints) {
+            // Sorted, the map iterates in no fixed order
+            std::map<std::string, double> sorted(point.begin(), point.end());
+            out << ",{";
+            for (const auto &[variable, value] : sorted) {
+                out << variable << ":" << value << ";";
+            }
+            out << "}";
+        }
+    }
+    return out.str();
+}
+
+std::string SolverOptions::strategyName(SearchStrategy strategy) {
+    switch (strategy) {
+        case SearchStrategy::BestFirst: return "best_first";
+        case SearchStrategy::Beam: return "beam";
+        case SearchStrategy::BreadthFirst: return "bfs";
+        default: return "unknown";
+    }
+}
+
+std::string SolverOptions::priorityName(PriorityFunction priority) {
+    switch (priority) {
+        case PriorityFunction::DistinctVariables: return "distinct";
+        case PriorityFunction::Occurrences: return "occurrences";
+        case PriorityFunction::Weighted: return "weighted";
+        default: return "unknown";
+    }
+}
+
+std::string SolverOptions::newtonMethodName(NewtonMethod method) {
+    switch (method) {
+        case NewtonMethod::LineSearch: return "line_search";
+        case NewtonMethod::TrustRegion: return "trust_region";
+        default: return "unknown";
+    }
+}
+
+NewtonMethod SolverOptions::parseNewtonMethod(const std::string &name) {
+    if (name == "line_search") return NewtonMethod::LineSearch;
+    if (name == "trust_region") return NewtonMethod::TrustRegion;
+    throw std::runtime_error("Unknown Newton method: " + name);
+}
+
+SearchStrategy SolverOptions::parseStrategy(const std::string &name) {
+    if (name == "best_first") return SearchStrategy::BestFirst;
+    if (name == "beam") return SearchStrategy::Beam;
+    if (name == "bfs") return SearchStrategy::BreadthFirst;
+    throw std::runtime_error("Unknown search strategy: " + name);
+}
+
+PriorityFunction SolverOptions::parsePriority(const std::string &name) {
+    if (name == "distinct") return PriorityFunction::DistinctVariables;
+    if (name == "occurrences") return PriorityFunction::Occurrences;
+    if (name == "weighted") return PriorityFunction::Weighted;
+    throw std::runtime_error("Unknown priority function: " + name);
+}
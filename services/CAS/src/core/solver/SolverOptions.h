@@ -0,0 +1,91 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../../utils/Config.h"
+
+enum class SearchStrategy {
+    // Always expand the state with the best priority
+    BestFirst,
+    // Best-first, but only the beamWidth best states are kept in the frontier
+    Beam,
+    // Expand states in the order they were found, ignores the priority
+    BreadthFirst,
+};
+
+enum class PriorityFunction {
+    // Fewest distinct variables, then fewest occurrences (EquationEntry::operator<)
+    DistinctVariables,
+    // Fewest occurrences, then fewest distinct variables
+    Occurrences,
+    // Lowest distinctWeight * distinct + occurrenceWeight * occurrences + depthWeight * substitutions
+    Weighted,
+};
+
+enum class NewtonMethod {
+    // Full Newton step, halved until the residuals drop enough (Armijo)
+    LineSearch,
+    // Levenberg-Marquardt: the step bends towards steepest descent and shrinks until it helps
+    TrustRegion,
+};
+
+/* The numeric fallback, see NewtonSolver */
+struct NewtonOptions {
+    NewtonMethod method = NewtonMethod::LineSearch;
+    // Per starting point
+    int maxIterations = 50;
+    // Converged once every |lhs - rhs| is at most this
+    double tolerance = 1e-10;
+    // Tried first, in order, a variable missing from a point starts at 1. Empty: all ones
+    std::vector<std::unordered_map<std::string, double>> startingPoints;
+    // Seeded random starts in [-10, 10] tried after those, until one converges
+    int randomStarts = 4;
+    // Equations with more nodes in total are not differentiated (reason too_large), 0 for no limit
+    std::size_t maxNodes = 100000;
+};
+
+/*
+* Per-call solver tuning, defaults reproduce the Config constants
+* e.g., options.strategy = SearchStrategy::Beam; options.beamWidth = 8;
+*/
+struct SolverOptions {
+    SearchStrategy strategy = SearchStrategy::BestFirst;
+    PriorityFunction priority = PriorityFunction::DistinctVariables;
+    int beamWidth = 16;
+
+    // Only used by PriorityFunction::Weighted
+    float distinctWeight = 1.0f;
+    float occurrenceWeight = 0.1f;
+    float depthWeight = 0.0f;
+
+    int maxIterations = Config::MAX_ITERATIONS_CONVERGE_SOLVE;
+    int maxIterationsWithoutImprovement = Config::MAX_ITERATIONS_WITHOUT_IMPROVEMENT;
+    // Drop a substitution when new distinct vars / old distinct vars is above this
+    float expansionRatio = Config::LIMIT_RATIO_NEW_DISTINCT_VARS;
+
+    // Off skips every step snapshot, SolveResult::steps() is then empty
+    bool recordSteps = true;
+    // Keep the states in one ExpressionDag: equal trees are one node, and a tree that was
+    // already simplified or isolated is not worked on again. Same result, less work on
+    // systems that reach the same expressions along different paths
+    bool shareSubexpressions = false;
+    // A reduced equation that is a polynomial of degree 2 or more in the target alone is
+    // solved for all its real roots (PolynomialSolver), e.g. x ^ 2 = 4 -> x = -2 or x = 2
+    bool polynomialRoots = true;
+    // When the search ends without an answer (not by the budget), solve the equations
+    // connected to the target numerically with damped Newton, e.g. x * x = 2 -> x = 1.4142135623731
+    bool numericFallback = true;
+    NewtonOptions newton;
+
+    /* Every field that can change the result or its metrics, used in cache keys */
+    std::string key() const;
+
+    static std::string strategyName(SearchStrategy strategy);
+    static std::string priorityName(PriorityFunction priority);
+    /* Throws on unknown names */
+    static SearchStrategy parseStrategy(const std::string &name);
+    static PriorityFunction parsePriority(const std::string &name);
+    static std::string newtonMethodName(NewtonMethod method);
+    static NewtonMethod parseNewtonMethod(const std::string &name);
+};
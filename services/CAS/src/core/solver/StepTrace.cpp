@@ -0,0 +1,40 @@
+#include "StepTrace.h"
+#include <algorithm>
+#include "../parser/Printer.h"
+
+void StepTrace::record(StepKind kind, const std::string &variable, PTree equation) {
+    this->head = std::make_shared<const StepRecord>(StepRecord{kind, variable, std::move(equation), this->head, ""});
+    this->length++;
+}
+
+void StepTrace::record(StepKind kind, const std::string &variable, const std::string &text) {
+    this->head = std::make_shared<const StepRecord>(StepRecord{kind, variable, nullptr, this->head, text});
+    this->length++;
+}
+
+std::vector<std::string> StepTrace::render() const {
+    std::vector<std::string> steps;
+    steps.reserve(this->length);
+    for (const StepRecord *step = this->head.get(); step; step = step->previous.get()) {
+        steps.push_back(StepTrace::renderStep(*step));
+    }
+    std::reverse(steps.begin(), steps.end());
+    return steps;
+}
+
+std::string StepTrace::latest() const {
+    return this->head ? StepTrace::renderStep(*this->head) : "";
+}
+
+std::string StepTrace::renderStep(const StepRecord &step) {
+    std::string equation = step.equation ? Printer::print(step.equation->thaw().get()) : step.text;
+    switch (step.kind) {
+        case StepKind::Start:
+            return "Start: " + equation;
+        case StepKind::Substitute:
+            return "Substitute " + step.variable + ": " + equation;
+        case StepKind::Solved:
+            return "Solved: " + equation;
+    }
+    return "";
+}
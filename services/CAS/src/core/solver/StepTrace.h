@@ -0,0 +1,52 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../parser/PersistentNode.h"
+
+enum class StepKind {
+    Start,
+    Substitute,
+    Solved,
+};
+
+/* One step of a solve, the equation is shared with the solver state it came from */
+struct StepRecord {
+    StepKind kind;
+    std::string variable;
+    PTree equation;
+    std::shared_ptr<const StepRecord> previous;
+    /* Printed instead of the equation when set, e.g. several roots "x = -5 or x = 2" */
+    std::string text;
+};
+
+/*
+* Steps taken to reach an equation, as a persistent list (newest first)
+* Copying a trace only copies a pointer, branches of the search share their
+* common prefix. Text is produced by render(), usually once for the winning path.
+*/
+class StepTrace {
+private:
+    std::shared_ptr<const StepRecord> head;
+    std::size_t length = 0;
+public:
+    /* Append a step to this trace, copies made before are not affected */
+    void record(StepKind kind, const std::string &variable, PTree equation);
+    /* Same for a step that is only text */
+    void record(StepKind kind, const std::string &variable, const std::string &text);
+
+    std::size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+
+    /*
+    * Oldest step first, e.g.,
+    * "Start: (((x + a) - (b * c)) = 0)", "Substitute c: ...", "Solved: (x = 6)"
+    */
+    std::vector<std::string> render() const;
+
+    /* Newest step only, "" for an empty trace */
+    std::string latest() const;
+
+    static std::string renderStep(const StepRecord &step);
+};
@@ -0,0 +1,528 @@
+#include "SystemSolver.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+#include "Simplifier.h"
+#include "Isolator.h"
+#include "Evaluation.h"
+#include "EquationSolver.h"
+
+namespace {
+    int occurrences(const PTree &root, const std::string &variable) {
+        int count = 0;
+        std::vector<const PersistentNode *> stack = {root.get()};
+        while (!stack.empty()) {
+            const PersistentNode *node = stack.back();
+            stack.pop_back();
+            if (!node->mayContain(variable)) {
+                continue;
+            }
+            if (node->getNodeType() == NodeType::Atom) {
+                count += node->getToken().getValue() == variable ? 1 : 0;
+                continue;
+            }
+            stack.push_back(node->getLeft().get());
+            if (node->getRight()) {
+                stack.push_back(node->getRight().get());
+            }
+        }
+        return count;
+    }
+
+    /* constant + sum(coefficient * variable), zero coefficients are never stored */
+    struct LinearForm {
+        std::map<std::string, Rational> terms;
+        Rational constant;
+
+        void add(const LinearForm &other, const Rational &factor) {
+            this->constant += other.constant * factor;
+            for (const auto &[variable, coefficient] : other.terms) {
+                Rational &term = this->terms[variable];
+                term += coefficient * factor;
+                if (term.isZero()) {
+                    this->terms.erase(variable);
+                }
+            }
+        }
+
+        void scale(const Rational &factor) {
+            if (factor.isZero()) {
+                this->terms.clear();
+            }
+            this->constant = this->constant * factor;
+            for (auto &[variable, coefficient] : this->terms) {
+                coefficient = coefficient * factor;
+            }
+        }
+    };
+
+    /* left op right from the forms of its operands, false when it is not linear */
+    bool combineLinear(const Token &token, LinearForm &left, LinearForm &right, LinearForm &out) {
+        switch (token.getType()) {
+            case PLUS:
+            case MINUS:
+                out = std::move(left);
+                out.add(right, Rational(token.getType() == PLUS ? 1 : -1));
+                return true;
+            case MULTIPLY:
+                if (!left.terms.empty() && !right.terms.empty()) {
+                    return false;
+                }
+                if (left.terms.empty()) {
+                    out = std::move(right);
+                    out.scale(left.constant);
+                } else {
+                    out = std::move(left);
+                    out.scale(right.constant);
+                }
+                return true;
+            case DIVIDE:
+                if (!right.terms.empty() || right.constant.isZero()) {
+                    return false;
+                }
+                out = std::move(left);
+                out.scale(Rational(1) / right.constant);
+                return true;
+            case POWER:
+                if (!left.terms.empty() || !right.terms.empty()) {
+                    return false;
+                }
+                try {
+                    out.constant = left.constant.pow(right.constant);
+                } catch (const std::exception &) {
+                    return false;
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /* False when node is not linear, e.g. x * y, x / y or x ^ 2 */
+    bool toLinear(const PTree &root, LinearForm &out) {
+        // Post-order with an explicit stack, each finished node leaves its form on built
+        struct Frame {
+            const PersistentNode *node;
+            int stage;
+        };
+        std::vector<Frame> frames = {{root.get(), 0}};
+        std::vector<LinearForm> built;
+        while (!frames.empty()) {
+            Frame &frame = frames.back();
+            const PersistentNode *node = frame.node;
+            const PersistentNode *next = nullptr;
+            if (frame.stage == 0 && node->getNodeType() != NodeType::Atom) {
+                next = node->getLeft().get();
+            } else if (frame.stage == 1 && node->getNodeType() == NodeType::BinaryOp) {
+                next = node->getRight().get();
+            }
+            if (next) {
+                frame.stage++;
+                frames.push_back({next, 0});
+                continue;
+            }
+            frames.pop_back();
+
+            const Token &token = node->getToken();
+            LinearForm result;
+            switch (node->getNodeType()) {
+                case NodeType::Atom:
+                    if (token.getType() == NUMBER) {
+                        result.constant = Token::getNumericValue(token);
+                    } else {
+                        result.terms[token.getValue()] = Rational(1);
+                    }
+                    break;
+                case NodeType::UnaryOp:
+                    result = std::move(built.back());
+                    built.pop_back();
+                    if (token.getType() == MINUS) {
+                        result.scale(Rational(-1));
+                    }
+                    break;
+                case NodeType::BinaryOp: {
+                    LinearForm right = std::move(built.back());
+                    built.pop_back();
+                    LinearForm left = std::move(built.back());
+                    built.pop_back();
+                    if (!combineLinear(token, left, right, result)) {
+                        return false;
+                    }
+                    break;
+                }
+            }
+            built.push_back(std::move(result));
+        }
+        out = std::move(built.back());
+        return true;
+    }
+
+    PTree number(const Rational &value) {
+        PTree atom = PersistentNode::atom(Token::fromNumber(value));
+        return value.isNegative() ? PersistentNode::unary(Token(MINUS, "-"), atom) : atom;
+    }
+
+    /* e.g. 10 - 2 * z + 1/2 * w, constant first then the terms by name */
+    PTree fromLinear(const LinearForm &form) {
+        PTree result;
+        if (!form.constant.isZero() || form.terms.empty()) {
+            result = number(form.constant);
+        }
+        for (const auto &[variable, coefficient] : form.terms) {
+            PTree term = PersistentNode::atom(Token(VARIABLE, variable));
+            Rational magnitude = coefficient.abs();
+            if (!magnitude.isOne()) {
+                term = PersistentNode::binary(Token(MULTIPLY, "*"), PersistentNode::atom(Token::fromNumber(magnitude)), term);
+            }
+            if (!result) {
+                result = coefficient.isNegative() ? PersistentNode::unary(Token(MINUS, "-"), term) : term;
+            } else if (coefficient.isNegative()) {
+                result = PersistentNode::binary(Token(MINUS, "-"), result, term);
+            } else {
+                result = PersistentNode::binary(Token(PLUS, "+"), result, term);
+            }
+        }
+        return result;
+    }
+
+    struct Pending {
+        // lhs = rhs, only kept up to date for non-linear equations
+        PTree equation;
+        bool linear = false;
+        // form = 0, linear equations only
+        LinearForm form;
+        std::unordered_set<std::string> vars;
+        int numVariables = 0;
+        // Input positions this equation was derived from
+        std::set<int> sources;
+    };
+
+    void classify(Pending &entry) {
+        entry.vars.clear();
+        LinearForm left;
+        LinearForm right;
+        const PTree &equation = entry.equation;
+        entry.linear = equation->getNodeType() == NodeType::BinaryOp && equation->getToken().getType() == ASSIGN
+            && toLinear(equation->getLeft(), left) && toLinear(equation->getRight(), right);
+        if (entry.linear) {
+            entry.form = std::move(left);
+            entry.form.add(right, Rational(-1));
+            for (const auto &[variable, coefficient] : entry.form.terms) {
+                entry.vars.insert(variable);
+            }
+            entry.numVariables = static_cast<int>(entry.vars.size());
+        } else {
+            entry.numVariables = equation->collectVariables(entry.vars);
+        }
+    }
+
+    PTree treeOf(const Pending &entry) {
+        if (!entry.linear) {
+            return entry.equation;
+        }
+        return PersistentNode::binary(Token(ASSIGN, "="), fromLinear(entry.form), number(Rational(0)));
+    }
+
+    struct Value {
+        bool linear = false;
+        LinearForm form;
+        PTree tree;
+    };
+}
+
+PTree SystemSolver::isolate(const PTree &equation, const std::string &variable) {
+    std::unique_ptr<ASTNode> work = equation->thaw();
+    try {
+        if (!Isolator::isolateVariable(work, variable)) {
+            return nullptr;
+        }
+        Simplifier::simplify(work);
+    } catch (const std::exception &) {
+        return nullptr;
+    }
+    if (work->getNodeType() != NodeType::BinaryOp) {
+        return nullptr;
+    }
+    BinaryOpNode *assign = static_cast<BinaryOpNode *>(work.get());
+    ASTNode *left = assign->getLeft();
+    if (left->getNodeType() != NodeType::Atom || left->getToken().getValue() != variable) {
+        return nullptr;
+    }
+    PTree value = PersistentNode::freeze(assign->getRight());
+    // x = 2 - x is not a value for x
+    if (occurrences(value, variable) > 0) {
+        return nullptr;
+    }
+    return value;
+}
+
+bool SystemSolver::holds(const PTree &equation) {
+    if (equation->getNodeType() != NodeType::BinaryOp) {
+        return false;
+    }
+    try {
+        Evaluation evaluation;
+        Rational left = evaluation.evaluate(equation->getLeft()->thaw().get());
+        Rational right = evaluation.evaluate(equation->getRight()->thaw().get());
+        return left == right;
+    } catch (const std::exception &) {
+        // e.g. 1 / 0 = 0
+        return false;
+    }
+}
+
+SystemSolution SystemSolver::solveAll(const std::vector<PTree> &equations, SolveBudget *budget) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+    SystemSolution solution;
+    SolveMetrics &metrics = solution.metrics;
+    metrics.termination = TerminationReason::Solved;
+    auto finish = [&]() {
+        metrics.totalNs = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+        return solution;
+    };
+
+    if (budget) {
+        budget->start();
+    }
+    BudgetScope budgetScope(budget);
+    auto interrupted = [&]() {
+        if (budget && budget->interrupted()) {
+            metrics.termination = EquationSolver::terminationFor(budget->getStatus());
+            return true;
+        }
+        return false;
+    };
+    auto simplified = [&](const PTree &tree) {
+        std::unique_ptr<ASTNode> work = tree->thaw();
+        Simplifier::simplify(work);
+        metrics.simplifyCalls++;
+        return PersistentNode::freeze(work.get());
+    };
+
+    std::vector<std::unordered_set<std::string>> inputVars(equations.size());
+    std::set<std::string> allVars;
+    std::set<int> contradicted;
+    // An equation left without variables is either redundant or a contradiction
+    auto settle = [&](const Pending &entry) {
+        bool holds = entry.linear ? entry.form.constant.isZero() : SystemSolver::holds(entry.equation);
+        if (holds) {
+            solution.redundantEquations++;
+        } else {
+            contradicted.insert(entry.sources.begin(), entry.sources.end());
+        }
+    };
+
+    std::vector<Pending> pending;
+    for (size_t i = 0; i < equations.size(); i++) {
+        Pending entry;
+        entry.equation = equations[i];
+        entry.sources.insert(static_cast<int>(i));
+        classify(entry);
+        // Every variable written in the input, also those that cancel out (x - x = 0)
+        equations[i]->collectVariables(inputVars[i]);
+        allVars.insert(inputVars[i].begin(), inputVars[i].end());
+        if (entry.vars.empty()) {
+            settle(entry);
+            continue;
+        }
+        pending.push_back(std::move(entry));
+    }
+
+    // Forward elimination, each pivot is a value in the variables not eliminated yet
+    std::vector<std::pair<std::string, Value>> pivots;
+    while (!pending.empty() && !interrupted()) {
+        size_t pivotIndex = pending.size();
+        std::string pivotVar;
+        Value pivotValue;
+
+        // Exact Gaussian step when there is a linear equation: fewest variables first,
+        // pivot on the variable in the fewest other equations to keep the fill-in low
+        for (size_t i = 0; i < pending.size(); i++) {
+            if (pending[i].linear && (pivotIndex == pending.size() || pending[i].vars.size() < pending[pivotIndex].vars.size())) {
+                pivotIndex = i;
+            }
+        }
+        if (pivotIndex != pending.size()) {
+            size_t fewest = SIZE_MAX;
+            for (const auto &[variable, coefficient] : pending[pivotIndex].form.terms) {
+                size_t uses = 0;
+                for (const Pending &entry : pending) {
+                    uses += entry.vars.count(variable);
+                }
+                if (uses < fewest) {
+                    fewest = uses;
+                    pivotVar = variable;
+                }
+            }
+            // a * x + rest = 0 -> x = rest / -a
+            LinearForm rest = pending[pivotIndex].form;
+            Rational coefficient = rest.terms.at(pivotVar);
+            rest.terms.erase(pivotVar);
+            rest.scale(Rational(-1) / coefficient);
+            pivotValue.linear = true;
+            pivotValue.tree = fromLinear(rest);
+            pivotValue.form = std::move(rest);
+        } else {
+            // Non-linear only, isolate symbolically: fewest variables, then fewest occurrences
+            std::vector<size_t> byCost(pending.size());
+            for (size_t i = 0; i < byCost.size(); i++) {
+                byCost[i] = i;
+            }
+            std::stable_sort(byCost.begin(), byCost.end(), [&](size_t a, size_t b) {
+                if (pending[a].vars.size() != pending[b].vars.size()) {
+                    return pending[a].vars.size() < pending[b].vars.size();
+                }
+                return pending[a].numVariables < pending[b].numVariables;
+            });
+            for (size_t index : byCost) {
+                // Variables appearing once isolate cleanly
+                std::vector<std::pair<int, std::string>> candidates;
+                for (const std::string &var : pending[index].vars) {
+                    candidates.emplace_back(occurrences(pending[index].equation, var), var);
+                }
+                std::sort(candidates.begin(), candidates.end());
+                for (const auto &[count, var] : candidates) {
+                    metrics.isolations++;
+                    PTree value = SystemSolver::isolate(pending[index].equation, var);
+                    if (value) {
+                        pivotIndex = index;
+                        pivotVar = var;
+                        pivotValue.linear = toLinear(value, pivotValue.form);
+                        pivotValue.tree = std::move(value);
+                        break;
+                    }
+                }
+                if (pivotValue.tree) {
+                    break;
+                }
+            }
+            // Whatever is left cannot be isolated
+            if (!pivotValue.tree) {
+                break;
+            }
+        }
+
+        Pending pivot = std::move(pending[pivotIndex]);
+        pending.erase(pending.begin() + pivotIndex);
+
+        std::vector<Pending> remaining;
+        remaining.reserve(pending.size());
+        for (Pending &entry : pending) {
+            if (entry.vars.count(pivotVar) == 0) {
+                remaining.push_back(std::move(entry));
+                continue;
+            }
+            metrics.substitutions++;
+            if (entry.linear && pivotValue.linear) {
+                Rational coefficient = entry.form.terms.at(pivotVar);
+                entry.form.terms.erase(pivotVar);
+                entry.form.add(pivotValue.form, coefficient);
+                // Terms can cancel, take the variables from the new form
+                entry.vars.clear();
+                for (const auto &[variable, c] : entry.form.terms) {
+                    entry.vars.insert(variable);
+                }
+                entry.numVariables = static_cast<int>(entry.vars.size());
+            } else {
+                entry.equation = simplified(PersistentNode::substitute(treeOf(entry), pivotVar, pivotValue.tree));
+                classify(entry);
+            }
+            entry.sources.insert(pivot.sources.begin(), pivot.sources.end());
+            if (entry.vars.empty()) {
+                settle(entry);
+            } else {
+                remaining.push_back(std::move(entry));
+            }
+        }
+        pending = std::move(remaining);
+        pivots.emplace_back(std::move(pivotVar), std::move(pivotValue));
+    }
+    metrics.iterations = static_cast<int>(pivots.size());
+    if (metrics.termination != TerminationReason::Solved) {
+        return finish();
+    }
+
+    // Back substitution, latest pivot first: its value only uses variables eliminated after it
+    std::unordered_map<std::string, Value> resolved;
+    std::unordered_map<std::string, PTree> resolvedTrees;
+    for (auto it = pivots.rbegin(); it != pivots.rend(); ++it) {
+        Value value = std::move(it->second);
+        bool linear = value.linear;
+        if (linear) {
+            LinearForm form = value.form;
+            for (const auto &[variable, coefficient] : value.form.terms) {
+                auto known = resolved.find(variable);
+                if (known == resolved.end()) {
+                    continue;
+                }
+                if (!known->second.linear) {
+                    linear = false;
+                    break;
+                }
+                form.terms.erase(variable);
+                form.add(known->second.form, coefficient);
+            }
+            if (linear) {
+                value.form = std::move(form);
+                value.tree = fromLinear(value.form);
+            }
+        }
+        if (!linear) {
+            // All resolved values in one pass, then one simplify
+            PTree substituted = PersistentNode::substitute(value.tree, resolvedTrees);
+            if (substituted != value.tree) {
+                metrics.substitutions++;
+                value.tree = simplified(substituted);
+            }
+            value.form = LinearForm();
+            value.linear = toLinear(value.tree, value.form);
+        }
+        resolvedTrees[it->first] = value.tree;
+        resolved[it->first] = std::move(value);
+    }
+
+    std::unordered_set<std::string> unsolved;
+    for (const Pending &entry : pending) {
+        unsolved.insert(entry.vars.begin(), entry.vars.end());
+    }
+    std::unordered_set<std::string> inconsistent;
+    for (int index : contradicted) {
+        inconsistent.insert(inputVars[index].begin(), inputVars[index].end());
+    }
+    solution.inconsistentEquations.assign(contradicted.begin(), contradicted.end());
+
+    for (const std::string &var : allVars) {
+        VariableSolution &answer = solution.variables[var];
+        auto value = resolved.find(var);
+        if (inconsistent.count(var) > 0) {
+            answer.status = VariableStatus::Inconsistent;
+        } else if (value != resolved.end()) {
+            std::unordered_set<std::string> dependsOn;
+            value->second.tree->collectVariables(dependsOn);
+            answer.value = value->second.tree;
+            answer.dependsOn.assign(dependsOn.begin(), dependsOn.end());
+            std::sort(answer.dependsOn.begin(), answer.dependsOn.end());
+            answer.status = dependsOn.empty() ? VariableStatus::Solved : VariableStatus::Dependent;
+        } else if (unsolved.count(var) > 0) {
+            answer.status = VariableStatus::Unsolved;
+        } else {
+            answer.status = VariableStatus::Free;
+        }
+    }
+    return finish();
+}
+
+std::string SystemSolver::statusName(VariableStatus status) {
+    switch (status) {
+        case VariableStatus::Solved: return "solved";
+        case VariableStatus::Dependent: return "dependent";
+        case VariableStatus::Free: return "free";
+        case VariableStatus::Inconsistent: return "inconsistent";
+        case VariableStatus::Unsolved: return "unsolved";
+        default: return "unknown";
+    }
+}
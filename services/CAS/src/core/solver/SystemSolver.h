@@ -0,0 +1,60 @@
+#pragma once
+#include <map>
+#include <string>
+#include <vector>
+#include "../parser/PersistentNode.h"
+#include "SolveBudget.h"
+#include "SolveMetrics.h"
+
+enum class VariableStatus {
+    // Fixed to a number
+    Solved,
+    // An expression in free (or unsolved) variables, the system is underdetermined
+    Dependent,
+    // Not fixed by the system, Dependent values are given in terms of it
+    Free,
+    // In an equation that contradicts the others, e.g. x + y = 1 and x + y = 2
+    Inconsistent,
+    // Only in equations it cannot be isolated from, e.g. x * x = 2
+    Unsolved,
+};
+
+struct VariableSolution {
+    VariableStatus status = VariableStatus::Unsolved;
+    // Solved and Dependent only
+    PTree value;
+    // Variables left in value, sorted
+    std::vector<std::string> dependsOn;
+};
+
+struct SystemSolution {
+    std::map<std::string, VariableSolution> variables;
+    // Input positions of the equations that reduced to a false statement like 0 = 1
+    std::vector<int> inconsistentEquations;
+    // Equations that reduced to a true statement like 0 = 0
+    int redundantEquations = 0;
+    SolveMetrics metrics;
+};
+
+/*
+* Every variable of a system at once, by elimination then back substitution
+* e.g. {x + a = b * c, a = b + 2, c = 3, b = 4} -> x = 6, a = 6, b = 4, c = 3
+*
+* Elimination isolates one variable per step (from the equation with the fewest
+* variables left) and substitutes it into the equations still containing it. Each
+* isolated value is then resolved once, latest first, by substituting all values
+* resolved before it in one pass, so every target shares the same work.
+*/
+class SystemSolver {
+private:
+    /* var = value when variable can be isolated from equation, otherwise nullptr */
+    static PTree isolate(const PTree &equation, const std::string &variable);
+    /* For an equation without variables: true for 0 = 0, false for 0 = 1 */
+    static bool holds(const PTree &equation);
+
+public:
+    /* Equations as returned by EquationSolver::prepareEquation */
+    static SystemSolution solveAll(const std::vector<PTree> &equations, SolveBudget *budget = nullptr);
+
+    static std::string statusName(VariableStatus status);
+};
@@ -0,0 +1,366 @@
+#include "CasEndpoints.h"
+#include "../service/CasService.h"
+
+static HttpResponse json(int status, const std::string &body) {
+    return {status, "application/json", body, {}};
+}
+
+// Validation failures look like the ones pydantic reports through FastAPI
+static HttpResponse unprocessable(const std::string &message) {
+    return json(422, "{\"detail\": " + Json::quote(message) + "}");
+}
+
+// Every item must be a string, false otherwise
+static bool stringList(const JsonValue &value, std::vector<std::string> &out) {
+    for (const JsonValue &item : value.array) {
+        if (!item.isString()) {
+            return false;
+        }
+        out.push_back(item.string);
+    }
+    return true;
+}
+
+// Every item must be a number, false otherwise
+static bool numberList(const JsonValue &value, std::vector<double> &out) {
+    for (const JsonValue &item : value.array) {
+        if (!item.isNumber()) {
+            return false;
+        }
+        out.push_back(item.number);
+    }
+    return true;
+}
+
+static HttpHandler withCors(HttpHandler handler) {
+    return [handler](const HttpRequest &request) {
+        HttpResponse response = handler(request);
+        response.headers.emplace_back("Access-Control-Allow-Origin", "*");
+        return response;
+    };
+}
+
+static HttpResponse preflight(const HttpRequest &request) {
+    HttpResponse response{200, "text/plain", "OK", {}};
+    response.headers.emplace_back("Access-Control-Allow-Methods", "DELETE, GET, HEAD, OPTIONS, PATCH, POST, PUT");
+    std::string requested = request.header("access-control-request-headers");
+    response.headers.emplace_back("Access-Control-Allow-Headers", requested.empty() ? "*" : requested);
+    response.headers.emplace_back("Access-Control-Max-Age", "600");
+    return response;
+}
+
+void CasEndpoints::install(HttpServer &server, WorkerDispatcher *dispatcher) {
+    server.route("GET", "/", withCors([](const HttpRequest &) {
+        return json(200, "{\"message\": \"Welcome to the CAS backend!\"}");
+    }));
+    server.route("POST", "/simplify", withCors([dispatcher](const HttpRequest &request) {
+        return CasEndpoints::simplify(request, dispatcher);
+    }));
+    server.route("POST", "/solve-system", withCors([dispatcher](const HttpRequest &request) {
+        return CasEndpoints::solveSystem(request, dispatcher);
+    }));
+    server.route("POST", "/solve-system/all", withCors([dispatcher](const HttpRequest &request) {
+        return CasEndpoints::solveAll(request, dispatcher);
+    }));
+    server.route("POST", "/differentiate", withCors([dispatcher](const HttpRequest &request) {
+        return CasEndpoints::differentiate(request, dispatcher);
+    }));
+    server.route("POST", "/jacobian", withCors([dispatcher](const HttpRequest &request) {
+        return CasEndpoints::jacobian(request, dispatcher);
+    }));
+    for (const char *path : {"/", "/simplify", "/solve-system", "/solve-system/all", "/differentiate", "/jacobian"}) {
+        server.route("OPTIONS", path, withCors(preflight));
+    }
+}
+
+SolverOptions CasEndpoints::parseOptions(const JsonValue &options) {
+    SolverOptions out;
+    if (const JsonValue *strategy = options.get("strategy"); strategy && strategy->isString()) {
+        out.strategy = SolverOptions::parseStrategy(strategy->string);
+    }
+    if (const JsonValue *priority = options.get("priority"); priority && priority->isString()) {
+        out.priority = SolverOptions::parsePriority(priority->string);
+    }
+    if (const JsonValue *width = options.get("beam_width"); width && width->isNumber()) {
+        out.beamWidth = static_cast<int>(width->number);
+    }
+    // Unset limits keep the C++ defaults
+    if (const JsonValue *limit = options.get("max_iterations"); limit && limit->isNumber()) {
+        out.maxIterations = static_cast<int>(limit->number);
+    }
+    if (const JsonValue *limit = options.get("max_iterations_without_improvement"); limit && limit->isNumber()) {
+        out.maxIterationsWithoutImprovement = static_cast<int>(limit->number);
+    }
+    if (const JsonValue *ratio = options.get("expansion_ratio"); ratio && ratio->isNumber()) {
+        out.expansionRatio = static_cast<float>(ratio->number);
+    }
+    if (const JsonValue *roots = options.get("polynomial_roots"); roots && roots->isBool()) {
+        out.polynomialRoots = roots->boolean;
+    }
+    if (const JsonValue *fallback = options.get("numeric_fallback"); fallback && fallback->isBool()) {
+        out.numericFallback = fallback->boolean;
+    }
+    if (const JsonValue *method = options.get("newton_method"); method && method->isString()) {
+        out.newton.method = SolverOptions::parseNewtonMethod(method->string);
+    }
+    if (const JsonValue *points = options.get("starting_points"); points && points->isArray()) {
+        for (const JsonValue &point : points->array) {
+            std::unordered_map<std::string, double> &start = out.newton.startingPoints.emplace_back();
+            for (const auto &[variable, value] : point.object) {
+                if (value.isNumber()) {
+                    start[variable] = value.number;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+HttpResponse CasEndpoints::simplify(const HttpRequest &request, WorkerDispatcher *dispatcher) {
+    JsonValue body;
+    try {
+        body = Json::parse(request.body);
+    } catch (const std::exception &e) {
+        return unprocessable(e.what());
+    }
+    const JsonValue *expression = body.get("expression");
+    if (!expression || !expression->isString()) {
+        return unprocessable("expression: field required (string)");
+    }
+    // Parser errors propagate and become a 500, like an exception escaping the FastAPI route
+    SimplifyOutcome outcome;
+    if (dispatcher) {
+        WorkerRequest work;
+        work.op = WorkerOp::Simplify;
+        work.expression = expression->string;
+        WorkerResponse response = dispatcher->call(std::move(work));
+        if (!response.ok) {
+            throw std::runtime_error(response.error);
+        }
+        outcome = std::move(response.simplify);
+    } else {
+        outcome = CasService::simplify(expression->string);
+    }
+    return json(200, "{\"simplified\": " + Json::quote(outcome.simplified) + "}");
+}
+
+HttpResponse CasEndpoints::solveSystem(const HttpRequest &request, WorkerDispatcher *dispatcher) {
+    JsonValue body;
+    try {
+        body = Json::parse(request.body);
+    } catch (const std::exception &e) {
+        return unprocessable(e.what());
+    }
+    const JsonValue *equations = body.get("equations");
+    const JsonValue *variable = body.get("variable");
+    if (!equations || !equations->isArray()) {
+        return unprocessable("equations: field required (list of strings)");
+    }
+    if (!variable || !variable->isString()) {
+        return unprocessable("variable: field required (string)");
+    }
+    std::vector<std::string> equationStrings;
+    if (!stringList(*equations, equationStrings)) {
+        return unprocessable("equations: every item must be a string");
+    }
+
+    std::string result;
+    std::vector<std::string> steps;
+    std::string numeric = "null";
+    std::string polynomial = "null";
+    try {
+        const JsonValue *options = body.get("options");
+        SolverOptions solverOptions = options && options->isObject() ? CasEndpoints::parseOptions(*options) : SolverOptions();
+        SolveOutcome outcome;
+        if (dispatcher) {
+            WorkerRequest work;
+            work.op = WorkerOp::Solve;
+            work.equations = std::move(equationStrings);
+            work.variable = variable->string;
+            work.options = solverOptions;
+            WorkerResponse response = dispatcher->call(std::move(work));
+            if (!response.ok) {
+                throw std::runtime_error(response.error);
+            }
+            outcome = std::move(response.solve);
+        } else {
+            outcome = CasService::solve(equationStrings, variable->string, solverOptions);
+        }
+        steps = std::move(outcome.steps);
+        result = outcome.result.empty() ? "No solution found or system is inconsistent." : outcome.result;
+        if (const NumericReport &report = outcome.metrics.numeric; report.attempted) {
+            std::string values;
+            for (const auto &[name, value] : report.values) {
+                values += (values.empty() ? "" : ", ") + Json::quote(name) + ": " + Json::number(value);
+            }
+            numeric = "{\"converged\": " + std::string(report.converged ? "true" : "false") +
+                ", \"reason\": " + Json::quote(report.reason) + ", \"starts\": " + std::to_string(report.starts) +
+                ", \"iterations\": " + std::to_string(report.iterations) +
+                ", \"residual_norm\": " + Json::number(report.residualNorm) + ", \"values\": {" + values + "}}";
+        }
+        if (const PolynomialReport &report = outcome.metrics.polynomial; report.attempted) {
+            polynomial = "{\"degree\": " + std::to_string(report.degree) + ", \"roots\": " + Json::quoteArray(report.roots) + "}";
+        }
+    } catch (const std::exception &e) {
+        result = std::string("Error: ") + e.what();
+        steps.clear();
+        numeric = "null";
+        polynomial = "null";
+    }
+    return json(200, "{\"result\": " + Json::quote(result) + ", \"steps\": " + Json::quoteArray(steps) +
+        ", \"numeric\": " + numeric + ", \"polynomial\": " + polynomial + "}");
+}
+
+HttpResponse CasEndpoints::solveAll(const HttpRequest &request, WorkerDispatcher *dispatcher) {
+    JsonValue body;
+    try {
+        body = Json::parse(request.body);
+    } catch (const std::exception &e) {
+        return unprocessable(e.what());
+    }
+    const JsonValue *equations = body.get("equations");
+    if (!equations || !equations->isArray()) {
+        return unprocessable("equations: field required (list of strings)");
+    }
+    std::vector<std::string> equationStrings;
+    if (!stringList(*equations, equationStrings)) {
+        return unprocessable("equations: every item must be a string");
+    }
+
+    SolveAllOutcome outcome;
+    try {
+        if (dispatcher) {
+            WorkerRequest work;
+            work.op = WorkerOp::SolveAll;
+            work.equations = std::move(equationStrings);
+            WorkerResponse response = dispatcher->call(std::move(work));
+            if (!response.ok) {
+                throw std::runtime_error(response.error);
+            }
+            outcome = std::move(response.solveAll);
+        } else {
+            outcome = CasService::solveAll(equationStrings);
+        }
+    } catch (const std::exception &e) {
+        return json(200, "{\"variables\": {}, \"inconsistent_equations\": [], \"redundant_equations\": 0, \"error\": " +
+            Json::quote(std::string("Error: ") + e.what()) + "}");
+    }
+    std::string variables;
+    for (const auto &[variable, answer] : outcome.variables) {
+        variables += (variables.empty() ? "" : ", ") + Json::quote(variable) + ": {\"status\": " + Json::quote(answer.status) +
+            ", \"value\": " + Json::quote(answer.value) + ", \"depends_on\": " + Json::quoteArray(answer.dependsOn) + "}";
+    }
+    std::string inconsistent;
+    for (int equation : outcome.inconsistentEquations) {
+        inconsistent += (inconsistent.empty() ? "" : ", ") + std::to_string(equation);
+    }
+    return json(200, "{\"variables\": {" + variables + "}, \"inconsistent_equations\": [" + inconsistent +
+        "], \"redundant_equations\": " + std::to_string(outcome.redundantEquations) + ", \"error\": null}");
+}
+
+HttpResponse CasEndpoints::differentiate(const HttpRequest &request, WorkerDispatcher *dispatcher) {
+    JsonValue body;
+    try {
+        body = Json::parse(request.body);
+    } catch (const std::exception &e) {
+        return unprocessable(e.what());
+    }
+    const JsonValue *expression = body.get("expression");
+    const JsonValue *variable = body.get("variable");
+    if (!expression || !expression->isString()) {
+        return unprocessable("expression: field required (string)");
+    }
+    if (!variable || !variable->isString()) {
+        return unprocessable("variable: field required (string)");
+    }
+
+    std::string derivative;
+    try {
+        if (dispatcher) {
+            WorkerRequest work;
+            work.op = WorkerOp::Differentiate;
+            work.expression = expression->string;
+            work.variable = variable->string;
+            WorkerResponse response = dispatcher->call(std::move(work));
+            if (!response.ok) {
+                throw std::runtime_error(response.error);
+            }
+            derivative = std::move(response.derivative);
+        } else {
+            derivative = CasService::differentiate(expression->string, variable->string);
+        }
+    } catch (const std::exception &e) {
+        return json(200, "{\"derivative\": \"\", \"error\": " + Json::quote(std::string("Error: ") + e.what()) + "}");
+    }
+    return json(200, "{\"derivative\": " + Json::quote(derivative) + ", \"error\": null}");
+}
+
+HttpResponse CasEndpoints::jacobian(const HttpRequest &request, WorkerDispatcher *dispatcher) {
+    JsonValue body;
+    try {
+        body = Json::parse(request.body);
+    } catch (const std::exception &e) {
+        return unprocessable(e.what());
+    }
+    const JsonValue *equations = body.get("equations");
+    if (!equations || !equations->isArray()) {
+        return unprocessable("equations: field required (list of strings)");
+    }
+    std::vector<std::string> equationStrings;
+    if (!stringList(*equations, equationStrings)) {
+        return unprocessable("equations: every item must be a string");
+    }
+    std::vector<std::string> variableNames;
+    if (const JsonValue *variables = body.get("variables"); variables) {
+        if (!variables->isArray() || !stringList(*variables, variableNames)) {
+            return unprocessable("variables: must be a list of strings");
+        }
+    }
+    const JsonValue *point = body.get("point");
+    bool hasPoint = point && !point->isNull();
+    std::vector<double> pointValues;
+    if (hasPoint && (!point->isArray() || !numberList(*point, pointValues))) {
+        return unprocessable("point: must be a list of numbers");
+    }
+
+    JacobianOutcome outcome;
+    try {
+        if (dispatcher) {
+            WorkerRequest work;
+            work.op = WorkerOp::Jacobian;
+            work.equations = std::move(equationStrings);
+            work.variables = std::move(variableNames);
+            work.hasPoint = hasPoint;
+            work.point = std::move(pointValues);
+            WorkerResponse response = dispatcher->call(std::move(work));
+            if (!response.ok) {
+                throw std::runtime_error(response.error);
+            }
+            outcome = std::move(response.jacobian);
+        } else {
+            outcome = CasService::evaluateJacobian(equationStrings, variableNames, hasPoint ? &pointValues : nullptr);
+        }
+    } catch (const std::exception &e) {
+        return json(200, "{\"variables\": [], \"entries\": [], \"residuals\": null, \"error\": " +
+            Json::quote(std::string("Error: ") + e.what()) + "}");
+    }
+    std::string entries;
+    for (std::size_t row = 0; row + 1 < outcome.rowStart.size(); row++) {
+        for (int entry = outcome.rowStart[row]; entry < outcome.rowStart[row + 1]; entry++) {
+            entries += (entries.empty() ? "" : ", ") + std::string("{\"row\": ") + std::to_string(row) +
+                ", \"column\": " + std::to_string(outcome.columns[entry]) +
+                ", \"derivative\": " + Json::quote(outcome.derivatives[entry]) +
+                ", \"value\": " + (hasPoint ? Json::number(outcome.values[entry]) : "null") + "}";
+        }
+    }
+    std::string residuals = "null";
+    if (hasPoint) {
+        residuals = "[";
+        for (std::size_t row = 0; row < outcome.residuals.size(); row++) {
+            residuals += (row > 0 ? ", " : "") + Json::number(outcome.residuals[row]);
+        }
+        residuals += "]";
+    }
+    return json(200, "{\"variables\": " + Json::quoteArray(outcome.variables) + ", \"entries\": [" + entries +
+        "], \"residuals\": " + residuals + ", \"error\": null}");
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include "HttpServer.h"
+#include "../core/solver/SolverOptions.h"
+#include "../utils/Json.h"
+#include "../worker/WorkerDispatcher.h"
+
+/*
+* The JSON contract of webserver/backend/src/main.py on top of CasService
+*   POST /simplify      {"expression"} -> {"simplified"}
+*   POST /solve-system  {"equations", "variable", "options"?} -> {"result", "steps", "numeric", "polynomial"}
+*   POST /solve-system/all  {"equations"} -> {"variables", "inconsistent_equations", "redundant_equations", "error"}
+*   POST /differentiate {"expression", "variable"} -> {"derivative", "error"}
+*   POST /jacobian      {"equations", "variables"?, "point"?} -> {"variables", "entries", "residuals", "error"}
+*   GET  /              {"message"}
+* The WebSocket, /solve-system/stream and /session routes hold per-browser state and are not served here
+* Every response carries Access-Control-Allow-Origin: * like the FastAPI CORS middleware
+* With a dispatcher the work runs in the worker processes, otherwise in this process
+*/
+class CasEndpoints {
+public:
+    static void install(HttpServer &server, WorkerDispatcher *dispatcher = nullptr);
+
+    /* Same fields and defaults as structures.SolverOptions, throws on unknown names */
+    static SolverOptions parseOptions(const JsonValue &options);
+
+    static HttpResponse simplify(const HttpRequest &request, WorkerDispatcher *dispatcher = nullptr);
+    static HttpResponse solveSystem(const HttpRequest &request, WorkerDispatcher *dispatcher = nullptr);
+    static HttpResponse solveAll(const HttpRequest &request, WorkerDispatcher *dispatcher = nullptr);
+    static HttpResponse differentiate(const HttpRequest &request, WorkerDispatcher *dispatcher = nullptr);
+    static HttpResponse jacobian(const HttpRequest &request, WorkerDispatcher *dispatcher = nullptr);
+};
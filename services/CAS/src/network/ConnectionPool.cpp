@@ -0,0 +1,68 @@
+#include "ConnectionPool.h"
+
+PooledConnection::~PooledConnection() {
+    if (this->pool && this->client) {
+        this->pool->release(std::move(this->client));
+    }
+}
+
+void ConnectionPool::release(std::unique_ptr<SocketClient> client) {
+    if (!client->isConnected()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(ConnectionPool::mutex);
+    if (ConnectionPool::idle.size() < ConnectionPool::maxIdle) {
+        ConnectionPool::idle.push_back(std::move(client));
+    }
+}
+
+PooledConnection ConnectionPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(ConnectionPool::mutex);
+        if (!ConnectionPool::idle.empty()) {
+            std::unique_ptr<SocketClient> client = std::move(ConnectionPool::idle.back());
+            ConnectionPool::idle.pop_back();
+            ConnectionPool::reused++;
+            return PooledConnection(this, std::move(client), true);
+        }
+        ConnectionPool::created++;
+    }
+    // Connect outside the lock, it can take up to timeoutMs
+    auto client = std::make_unique<SocketClient>(ConnectionPool::host, ConnectionPool::port);
+    client->setTimeout(ConnectionPool::timeoutMs);
+    client->connectToServer();
+    return PooledConnection(this, std::move(client), false);
+}
+
+bool ConnectionPool::call(const std::string &request, std::string &response, std::string *error) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        PooledConnection connection = ConnectionPool::acquire();
+        if (!connection) {
+            if (error) *error = connection->lastError();
+            return false;
+        }
+        if (connection->call(request, response)) {
+            return true;
+        }
+        if (error) *error = connection->lastError();
+        if (!connection.wasReused()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+std::size_t ConnectionPool::idleCount() {
+    std::lock_guard<std::mutex> lock(ConnectionPool::mutex);
+    return ConnectionPool::idle.size();
+}
+
+std::size_t ConnectionPool::createdCount() {
+    std::lock_guard<std::mutex> lock(ConnectionPool::mutex);
+    return ConnectionPool::created;
+}
+
+std::size_t ConnectionPool::reusedCount() {
+    std::lock_guard<std::mutex> lock(ConnectionPool::mutex);
+    return ConnectionPool::reused;
+}
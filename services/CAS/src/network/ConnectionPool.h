@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SocketClient.h"
+
+class ConnectionPool;
+
+/* A borrowed connection, goes back to the pool on destruction if still connected */
+class PooledConnection {
+private:
+    ConnectionPool *pool;
+    std::unique_ptr<SocketClient> client;
+    bool reused;
+public:
+    PooledConnection(ConnectionPool *pool, std::unique_ptr<SocketClient> client, bool reused)
+        : pool(pool), client(std::move(client)), reused(reused) {}
+    PooledConnection(PooledConnection &&) = default;
+    ~PooledConnection();
+
+    /* nullptr when connecting failed */
+    SocketClient *operator->() { return client.get(); }
+    SocketClient *get() { return client.get(); }
+    explicit operator bool() const { return client && client->isConnected(); }
+    /* Came from the idle list rather than a fresh connect */
+    bool wasReused() const { return reused; }
+};
+
+/*
+* Keeps up to maxIdle open connections to one host:port for reuse
+* Connections that failed (SocketClient disconnects on any error) are dropped.
+*/
+class ConnectionPool {
+private:
+    std::string host;
+    int port;
+    std::size_t maxIdle;
+    int timeoutMs;
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<SocketClient>> idle;
+    std::size_t created = 0;
+    std::size_t reused = 0;
+
+    friend class PooledConnection;
+    void release(std::unique_ptr<SocketClient> client);
+public:
+    ConnectionPool(const std::string &host, int port, std::size_t maxIdle = 4, int timeoutMs = 5000)
+        : host(host), port(port), maxIdle(maxIdle), timeoutMs(timeoutMs) {}
+
+    /* An idle connection, or a new one. Check the result with operator bool */
+    PooledConnection acquire();
+
+    /*
+    * One request/response on a pooled connection
+    * A reused connection may have been closed by the server meanwhile, a failure on one
+    * is retried once on a fresh connection, so requests must be idempotent (solve/simplify are)
+    */
+    bool call(const std::string &request, std::string &response, std::string *error = nullptr);
+
+    std::size_t idleCount();
+    std::size_t createdCount();
+    std::size_t reusedCount();
+};
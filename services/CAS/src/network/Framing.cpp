@@ -0,0 +1,43 @@
+#include "Framing.h"
+
+std::string Framing::encode(const std::string &payload) {
+    std::uint32_t size = static_cast<std::uint32_t>(payload.size());
+    std::string out;
+    out.reserve(Framing::HEADER_BYTES + payload.size());
+    out += static_cast<char>((size >> 24) & 0xFF);
+    out += static_cast<char>((size >> 16) & 0xFF);
+    out += static_cast<char>((size >> 8) & 0xFF);
+    out += static_cast<char>(size & 0xFF);
+    out += payload;
+    return out;
+}
+
+void FrameDecoder::feed(const char *data, std::size_t size) {
+    if (this->invalid) {
+        return;
+    }
+    this->buffer.append(data, size);
+
+    std::size_t offset = 0;
+    while (this->buffer.size() - offset >= Framing::HEADER_BYTES) {
+        const unsigned char *header = reinterpret_cast<const unsigned char *>(this->buffer.data() + offset);
+        std::size_t length = (std::size_t(header[0]) << 24) | (std::size_t(header[1]) << 16) |
+                             (std::size_t(header[2]) << 8) | std::size_t(header[3]);
+        if (length > Framing::MAX_FRAME_BYTES) {
+            this->invalid = true;
+            break;
+        }
+        if (this->buffer.size() - offset - Framing::HEADER_BYTES < length) {
+            break;
+        }
+        this->frames.push_back(this->buffer.substr(offset + Framing::HEADER_BYTES, length));
+        offset += Framing::HEADER_BYTES + length;
+    }
+    this->buffer.erase(0, offset);
+}
+
+std::string FrameDecoder::pop() {
+    std::string frame = std::move(this->frames.front());
+    this->frames.pop_front();
+    return frame;
+}
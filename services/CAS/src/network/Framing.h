@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+
+/*
+* Length-prefixed messages: 4-byte big-endian payload size, then the payload
+* e.g., "hi" -> 00 00 00 02 'h' 'i'
+*/
+class Framing {
+public:
+    static const std::size_t HEADER_BYTES = 4;
+    static const std::size_t MAX_FRAME_BYTES = 64 * 1024 * 1024;
+
+    static std::string encode(const std::string &payload);
+};
+
+/* Incremental decoder, feed whatever recv returned and take complete frames out */
+class FrameDecoder {
+private:
+    std::string buffer;
+    std::deque<std::string> frames;
+    bool invalid = false;
+public:
+    void feed(const char *data, std::size_t size);
+
+    bool hasFrame() const { return !frames.empty(); }
+    /* Oldest complete frame, hasFrame() must be true */
+    std::string pop();
+
+    /* A length above Framing::MAX_FRAME_BYTES was received, the stream cannot be trusted anymore */
+    bool failed() const { return invalid; }
+    /* Bytes of an incomplete frame */
+    std::size_t buffered() const { return buffer.size(); }
+};
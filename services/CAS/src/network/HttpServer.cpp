@@ -0,0 +1,417 @@
+#include "HttpServer.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// epoll user data for the two non-connection descriptors
+static const std::uint64_t LISTEN_ID = 0;
+static const std::uint64_t WAKE_ID = 1;
+
+static std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+    return text;
+}
+
+static std::string trim(const std::string &text) {
+    size_t start = text.find_first_not_of(" \t");
+    if (start == std::string::npos) {
+        return "";
+    }
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(start, end - start + 1);
+}
+
+std::string HttpRequest::header(const std::string &name) const {
+    auto it = this->headers.find(name);
+    return it == this->headers.end() ? "" : it->second;
+}
+
+HttpServer::HttpServer(std::size_t threads) : pool(std::make_unique<ThreadPool>(threads)) {
+    HttpServer::epollFd = epoll_create1(EPOLL_CLOEXEC);
+    HttpServer::wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (HttpServer::epollFd < 0 || HttpServer::wakeFd < 0) {
+        throw std::runtime_error("Error creating epoll/eventfd: " + std::string(strerror(errno)));
+    }
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = WAKE_ID;
+    epoll_ctl(HttpServer::epollFd, EPOLL_CTL_ADD, HttpServer::wakeFd, &ev);
+}
+
+HttpServer::~HttpServer() {
+    HttpServer::pool.reset();
+    for (auto &[id, conn] : HttpServer::connections) {
+        close(conn->fd);
+    }
+    if (HttpServer::listenFd >= 0) close(HttpServer::listenFd);
+    if (HttpServer::wakeFd >= 0) close(HttpServer::wakeFd);
+    if (HttpServer::epollFd >= 0) close(HttpServer::epollFd);
+}
+
+void HttpServer::route(const std::string &method, const std::string &path, HttpHandler handler) {
+    HttpServer::routes[path][method] = std::move(handler);
+}
+
+int HttpServer::listen(const std::string &host, int port) {
+    HttpServer::listenFd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (HttpServer::listenFd < 0) {
+        throw std::runtime_error("Error creating socket: " + std::string(strerror(errno)));
+    }
+    int one = 1;
+    setsockopt(HttpServer::listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) {
+        throw std::runtime_error("Invalid listen address: " + host);
+    }
+    if (bind(HttpServer::listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        ::listen(HttpServer::listenFd, SOMAXCONN) < 0) {
+        throw std::runtime_error("Error listening on " + host + ":" + std::to_string(port) + ": " + strerror(errno));
+    }
+
+    socklen_t length = sizeof(addr);
+    getsockname(HttpServer::listenFd, reinterpret_cast<sockaddr *>(&addr), &length);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.u64 = LISTEN_ID;
+    epoll_ctl(HttpServer::epollFd, EPOLL_CTL_ADD, HttpServer::listenFd, &ev);
+    return ntohs(addr.sin_port);
+}
+
+void HttpServer::stop() {
+    HttpServer::stopping.store(true);
+    std::uint64_t one = 1;
+    ssize_t ignored = write(HttpServer::wakeFd, &one, sizeof(one));
+    (void)ignored;
+}
+
+void HttpServer::run() {
+    epoll_event events[128];
+    while (!HttpServer::stopping.load()) {
+        int n = epoll_wait(HttpServer::epollFd, events, 128, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("epoll_wait failed: " + std::string(strerror(errno)));
+        }
+        for (int i = 0; i < n; i++) {
+            std::uint64_t id = events[i].data.u64;
+            if (id == LISTEN_ID) {
+                HttpServer::acceptConnections();
+                continue;
+            }
+            if (id == WAKE_ID) {
+                std::uint64_t count;
+                while (read(HttpServer::wakeFd, &count, sizeof(count)) > 0) {}
+                HttpServer::drainCompletions();
+                continue;
+            }
+
+            auto it = HttpServer::connections.find(id);
+            if (it == HttpServer::connections.end()) {
+                continue;
+            }
+            Connection &conn = *it->second;
+            if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                HttpServer::closeConnection(id);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                HttpServer::readConnection(id, conn);
+                if (HttpServer::connections.count(id) == 0) continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                HttpServer::flush(id, conn);
+            }
+        }
+    }
+}
+
+void HttpServer::acceptConnections() {
+    while (true) {
+        int fd = accept4(HttpServer::listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            // EAGAIN: accepted everything pending. Anything else (EMFILE...) is retried on the next event
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        std::uint64_t id = HttpServer::nextConnectionId++;
+        auto conn = std::make_unique<Connection>();
+        conn->fd = fd;
+        conn->events = EPOLLIN | EPOLLRDHUP;
+        epoll_event ev{};
+        ev.events = conn->events;
+        ev.data.u64 = id;
+        epoll_ctl(HttpServer::epollFd, EPOLL_CTL_ADD, fd, &ev);
+        HttpServer::connections[id] = std::move(conn);
+    }
+}
+
+void HttpServer::readConnection(std::uint64_t id, Connection &conn) {
+    char buffer[16 * 1024];
+    while (true) {
+        ssize_t n = recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            conn.in.append(buffer, n);
+            continue;
+        }
+        if (n == 0) {
+            conn.readClosed = true;
+        } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            HttpServer::closeConnection(id);
+            return;
+        }
+        break;
+    }
+
+    HttpServer::parseRequests(id, conn);
+    if (HttpServer::connections.count(id) == 0) return;
+
+    // Peer is gone and nothing is in flight
+    if (conn.readClosed && conn.nextToWrite == conn.nextSeq && conn.out.empty()) {
+        HttpServer::closeConnection(id);
+        return;
+    }
+    HttpServer::updateInterest(id, conn);
+}
+
+void HttpServer::parseRequests(std::uint64_t id, Connection &conn) {
+    // Every complete request in the buffer is dispatched, this is what makes pipelining work
+    size_t offset = 0;
+    while (conn.closeAfter == UINT64_MAX) {
+        size_t headerEnd = conn.in.find("\r\n\r\n", offset);
+        if (headerEnd == std::string::npos) {
+            if (conn.in.size() - offset > HttpServer::MAX_HEADER_BYTES) {
+                conn.closeAfter = conn.nextSeq;
+                conn.ready[conn.nextSeq++] = HttpServer::serialize({431, "application/json", "{\"detail\": \"Header too large\"}", {}}, false);
+            }
+            break;
+        }
+
+        HttpRequest request;
+        std::string head = conn.in.substr(offset, headerEnd - offset);
+        size_t lineEnd = head.find("\r\n");
+        std::string requestLine = head.substr(0, lineEnd);
+
+        size_t firstSpace = requestLine.find(' ');
+        size_t secondSpace = requestLine.find(' ', firstSpace + 1);
+        if (firstSpace == std::string::npos || secondSpace == std::string::npos) {
+            conn.closeAfter = conn.nextSeq;
+            conn.ready[conn.nextSeq++] = HttpServer::serialize({400, "application/json", "{\"detail\": \"Bad request line\"}", {}}, false);
+            break;
+        }
+        request.method = requestLine.substr(0, firstSpace);
+        request.path = requestLine.substr(firstSpace + 1, secondSpace - firstSpace - 1);
+        std::string version = requestLine.substr(secondSpace + 1);
+        // Drop the query string, no route uses it
+        size_t query = request.path.find('?');
+        if (query != std::string::npos) {
+            request.path.resize(query);
+        }
+
+        size_t pos = lineEnd == std::string::npos ? head.size() : lineEnd + 2;
+        while (pos < head.size()) {
+            size_t next = head.find("\r\n", pos);
+            if (next == std::string::npos) next = head.size();
+            std::string line = head.substr(pos, next - pos);
+            size_t colon = line.find(':');
+            if (colon != std::string::npos) {
+                request.headers[toLower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+            }
+            pos = next + 2;
+        }
+
+        std::string connectionHeader = toLower(request.header("connection"));
+        request.keepAlive = version == "HTTP/1.0" ? connectionHeader == "keep-alive" : connectionHeader != "close";
+
+        size_t contentLength = 0;
+        std::string lengthHeader = request.header("content-length");
+        if (!lengthHeader.empty()) {
+            try {
+                contentLength = std::stoull(lengthHeader);
+            } catch (const std::exception &) {
+                contentLength = SIZE_MAX;
+            }
+        }
+        if (contentLength > HttpServer::MAX_BODY_BYTES || !request.header("transfer-encoding").empty()) {
+            // Chunked bodies are not supported, none of our clients send them
+            int status = contentLength > HttpServer::MAX_BODY_BYTES ? 413 : 411;
+            conn.closeAfter = conn.nextSeq;
+            conn.ready[conn.nextSeq++] = HttpServer::serialize({status, "application/json", "{\"detail\": \"" + HttpServer::statusText(status) + "\"}", {}}, false);
+            break;
+        }
+
+        size_t bodyStart = headerEnd + 4;
+        if (conn.in.size() - bodyStart < contentLength) {
+            break;
+        }
+        request.body = conn.in.substr(bodyStart, contentLength);
+        offset = bodyStart + contentLength;
+
+        std::uint64_t seq = conn.nextSeq++;
+        if (!request.keepAlive) {
+            conn.closeAfter = seq;
+        }
+        HttpServer::dispatch(id, seq, std::move(request));
+    }
+    conn.in.erase(0, offset);
+    HttpServer::flush(id, conn);
+}
+
+void HttpServer::dispatch(std::uint64_t id, std::uint64_t seq, HttpRequest request) {
+    HttpServer::pool->submit([this, id, seq, request = std::move(request)]() {
+        HttpResponse response = HttpServer::handle(request);
+        std::string bytes = HttpServer::serialize(response, request.keepAlive);
+        {
+            std::lock_guard<std::mutex> lock(HttpServer::completionMutex);
+            HttpServer::completions.push_back({id, seq, std::move(bytes)});
+        }
+        std::uint64_t one = 1;
+        ssize_t ignored = write(HttpServer::wakeFd, &one, sizeof(one));
+        (void)ignored;
+    });
+}
+
+HttpResponse HttpServer::handle(const HttpRequest &request) {
+    auto pathIt = HttpServer::routes.find(request.path);
+    if (pathIt == HttpServer::routes.end()) {
+        return {404, "application/json", "{\"detail\": \"Not Found\"}", {}};
+    }
+    auto methodIt = pathIt->second.find(request.method);
+    if (methodIt == pathIt->second.end()) {
+        return {405, "application/json", "{\"detail\": \"Method Not Allowed\"}", {}};
+    }
+    try {
+        return methodIt->second(request);
+    } catch (const std::exception &e) {
+        std::cerr << request.method << " " << request.path << ": " << e.what() << "\n";
+        return {500, "text/plain", "Internal Server Error", {}};
+    }
+}
+
+void HttpServer::drainCompletions() {
+    std::vector<Completion> done;
+    {
+        std::lock_guard<std::mutex> lock(HttpServer::completionMutex);
+        done.swap(HttpServer::completions);
+    }
+    for (Completion &completion : done) {
+        auto it = HttpServer::connections.find(completion.connectionId);
+        if (it == HttpServer::connections.end()) {
+            // Client went away while the handler was running
+            continue;
+        }
+        it->second->ready[completion.seq] = std::move(completion.bytes);
+    }
+    for (Completion &completion : done) {
+        auto it = HttpServer::connections.find(completion.connectionId);
+        if (it != HttpServer::connections.end()) {
+            HttpServer::flush(completion.connectionId, *it->second);
+        }
+    }
+}
+
+void HttpServer::flush(std::uint64_t id, Connection &conn) {
+    // Move responses to the output buffer in request order
+    bool closing = false;
+    while (!conn.ready.empty() && conn.ready.begin()->first == conn.nextToWrite) {
+        conn.out += conn.ready.begin()->second;
+        conn.ready.erase(conn.ready.begin());
+        if (conn.nextToWrite == conn.closeAfter) {
+            closing = true;
+        }
+        conn.nextToWrite++;
+    }
+    closing |= conn.closeAfter != UINT64_MAX && conn.nextToWrite > conn.closeAfter;
+
+    while (!conn.out.empty()) {
+        ssize_t n = send(conn.fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out.erase(0, n);
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        }
+        HttpServer::closeConnection(id);
+        return;
+    }
+
+    bool idle = conn.nextToWrite == conn.nextSeq;
+    if (conn.out.empty() && (closing || (conn.readClosed && idle))) {
+        HttpServer::closeConnection(id);
+        return;
+    }
+    HttpServer::updateInterest(id, conn);
+}
+
+void HttpServer::updateInterest(std::uint64_t id, Connection &conn) {
+    // Stop reading after EOF (level-triggered EPOLLIN would fire forever), write only with pending output
+    std::uint32_t events =
+        (conn.readClosed ? 0u : static_cast<std::uint32_t>(EPOLLIN | EPOLLRDHUP)) |
+        (conn.out.empty() ? 0u : static_cast<std::uint32_t>(EPOLLOUT));
+    if (events == conn.events) {
+        return;
+    }
+    conn.events = events;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.u64 = id;
+    epoll_ctl(HttpServer::epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+}
+
+void HttpServer::closeConnection(std::uint64_t id) {
+    auto it = HttpServer::connections.find(id);
+    if (it == HttpServer::connections.end()) {
+        return;
+    }
+    epoll_ctl(HttpServer::epollFd, EPOLL_CTL_DEL, it->second->fd, nullptr);
+    close(it->second->fd);
+    HttpServer::connections.erase(it);
+}
+
+std::string HttpServer::statusText(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 411: return "Length Required";
+        case 413: return "Payload Too Large";
+        case 422: return "Unprocessable Entity";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "Unknown";
+    }
+}
+
+std::string HttpServer::serialize(const HttpResponse &response, bool keepAlive) {
+    std::string out;
+    out.reserve(response.body.size() + 160);
+    out += "HTTP/1.1 " + std::to_string(response.status) + " " + HttpServer::statusText(response.status) + "\r\n";
+    out += "Content-Type: " + response.contentType + "\r\n";
+    out += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+    out += keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+    for (const auto &[name, value] : response.headers) {
+        out += name + ": " + value + "\r\n";
+    }
+    out += "\r\n";
+    out += response.body;
+    return out;
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../utils/ThreadPool.h"
+
+struct HttpRequest {
+    std::string method;
+    std::string path;
+    // Header names are lowercased
+    std::unordered_map<std::string, std::string> headers;
+    std::string body;
+    bool keepAlive = true;
+
+    std::string header(const std::string &name) const;
+};
+
+struct HttpResponse {
+    int status = 200;
+    std::string contentType = "application/json";
+    std::string body;
+    std::vector<std::pair<std::string, std::string>> headers;
+};
+
+using HttpHandler = std::function<HttpResponse(const HttpRequest &)>;
+
+/*
+* HTTP/1.1 server on a single epoll thread, handlers run on a ThreadPool
+* Connections are kept alive and may pipeline: every parsed request is dispatched
+* right away and the responses are written back in request order.
+*/
+class HttpServer {
+public:
+    static const std::size_t MAX_HEADER_BYTES = 64 * 1024;
+    static const std::size_t MAX_BODY_BYTES = 4 * 1024 * 1024;
+
+    /* 0 threads -> hardware concurrency */
+    HttpServer(std::size_t threads = 0);
+    ~HttpServer();
+
+    /* Exact match on method and path, unknown paths get 404 (405 for a known path) */
+    void route(const std::string &method, const std::string &path, HttpHandler handler);
+
+    /* Bind and listen, port 0 picks a free one. Returns the bound port, throws on failure */
+    int listen(const std::string &host, int port);
+    /* Event loop, returns after stop() */
+    void run();
+    /* Safe from any thread (and signal handlers) */
+    void stop();
+
+    static std::string statusText(int status);
+    static std::string serialize(const HttpResponse &response, bool keepAlive);
+
+private:
+    struct Connection {
+        int fd;
+        std::string in;
+        std::string out;
+        // Sequence number given to the next parsed request / expected by the writer
+        std::uint64_t nextSeq = 0;
+        std::uint64_t nextToWrite = 0;
+        // Finished responses waiting for an earlier one
+        std::map<std::uint64_t, std::string> ready;
+        // Close once this response is written (Connection: close or a protocol error)
+        std::uint64_t closeAfter = UINT64_MAX;
+        bool readClosed = false;
+        // Current epoll interest set
+        std::uint32_t events = 0;
+    };
+
+    struct Completion {
+        std::uint64_t connectionId;
+        std::uint64_t seq;
+        std::string bytes;
+    };
+
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;
+    std::atomic<bool> stopping{false};
+
+    std::unordered_map<std::string, std::unordered_map<std::string, HttpHandler>> routes;
+    std::unordered_map<std::uint64_t, std::unique_ptr<Connection>> connections;
+    std::uint64_t nextConnectionId = 2;
+
+    std::mutex completionMutex;
+    std::vector<Completion> completions;
+
+    // Joined first on destruction, workers still post completions and write wakeFd
+    std::unique_ptr<ThreadPool> pool;
+
+    void acceptConnections();
+    void readConnection(std::uint64_t id, Connection &conn);
+    void parseRequests(std::uint64_t id, Connection &conn);
+    void dispatch(std::uint64_t id, std::uint64_t seq, HttpRequest request);
+    void drainCompletions();
+    void flush(std::uint64_t id, Connection &conn);
+    void updateInterest(std::uint64_t id, Connection &conn);
+    void closeConnection(std::uint64_t id);
+    HttpResponse handle(const HttpRequest &request);
+};
@@ -1,8 +1,21 @@
 #include "SocketClient.h"
-#include <iostream>
+#include <cerrno>
+#include <chrono>
 #include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
-#include <arpa/inet.h>
+
+static long long nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
 
 SocketClient::SocketClient(const std::string& host, int port)
     : host(host), port(port), sockfd(-1), connected(false) {}
@@ -10,31 +23,96 @@ SocketClient::SocketClient(const std::string& host, int port)
 SocketClient::~SocketClient() {
     disconnect();
 }
+
+bool SocketClient::fail(const std::string &message) {
+    SocketClient::error = message;
+    SocketClient::disconnect();
+    return false;
+}
+
+bool SocketClient::waitFor(short events, long long deadlineMs) {
+    while (true) {
+        long long remaining = deadlineMs - nowMs();
+        if (remaining <= 0) {
+            return SocketClient::fail("Timed out after " + std::to_string(SocketClient::timeoutMs) + " ms");
+        }
+        pollfd pfd{SocketClient::sockfd, events, 0};
+        int ready = poll(&pfd, 1, static_cast<int>(remaining));
+        if (ready > 0) {
+            return true;
+        }
+        if (ready < 0 && errno != EINTR) {
+            return SocketClient::fail("poll failed: " + std::string(strerror(errno)));
+        }
+    }
+}
+
 bool SocketClient::connectToServer() {
     if (SocketClient::connected) {
-        std::cerr << "Already connected to server.\n";
+        SocketClient::error = "Already connected to server.";
         return false;
     }
+    SocketClient::decoder = FrameDecoder();
 
-    SocketClient::sockfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (SocketClient::sockfd < 0) {
-        std::cerr << "Error creating socket.\n";
-        return false;
+    // "unix:/path/to.sock" is a Unix domain socket, the port is ignored
+    if (SocketClient::host.rfind("unix:", 0) == 0) {
+        std::string path = SocketClient::host.substr(5);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            SocketClient::error = "Socket path too long: " + path;
+            return false;
+        }
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        SocketClient::sockfd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (SocketClient::sockfd < 0) {
+            SocketClient::error = "Error creating socket.";
+            return false;
+        }
+        SocketClient::connected = true;
+        if (connect(SocketClient::sockfd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            return SocketClient::fail("Error connecting to " + path + ": " + std::string(strerror(errno)));
+        }
+        return true;
     }
 
-    struct sockaddr_in server_addr;
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(SocketClient::port);
-    inet_pton(AF_INET, SocketClient::host.c_str(), &server_addr.sin_addr);
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *resolved = nullptr;
+    if (getaddrinfo(SocketClient::host.c_str(), std::to_string(SocketClient::port).c_str(), &hints, &resolved) != 0 || !resolved) {
+        SocketClient::error = "Cannot resolve " + SocketClient::host;
+        return false;
+    }
 
-    if (connect(SocketClient::sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        std::cerr << "Error connecting to server.\n";
-        close(SocketClient::sockfd);
-        SocketClient::sockfd = -1;
+    SocketClient::sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (SocketClient::sockfd < 0) {
+        freeaddrinfo(resolved);
+        SocketClient::error = "Error creating socket.";
         return false;
     }
+    int one = 1;
+    setsockopt(SocketClient::sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
 
+    int result = connect(SocketClient::sockfd, resolved->ai_addr, resolved->ai_addrlen);
+    freeaddrinfo(resolved);
+    // Mark connected so fail() closes the descriptor
     SocketClient::connected = true;
+
+    if (result < 0 && errno != EINPROGRESS) {
+        return SocketClient::fail("Error connecting to server: " + std::string(strerror(errno)));
+    }
+    if (result < 0) {
+        if (!SocketClient::waitFor(POLLOUT, nowMs() + SocketClient::timeoutMs)) {
+            return false;
+        }
+        int soError = 0;
+        socklen_t length = sizeof(soError);
+        getsockopt(SocketClient::sockfd, SOL_SOCKET, SO_ERROR, &soError, &length);
+        if (soError != 0) {
+            return SocketClient::fail("Error connecting to server: " + std::string(strerror(soError)));
+        }
+    }
     return true;
 }
 
@@ -46,41 +124,95 @@ void SocketClient::disconnect() {
     }
 }
 
-bool SocketClient::sendMessage(const std::string& message) {
+bool SocketClient::sendAll(const std::string &bytes) {
     if (!SocketClient::connected) {
-        std::cerr << "Not connected to server.\n";
+        SocketClient::error = "Not connected to server.";
         return false;
     }
+    long long deadline = nowMs() + SocketClient::timeoutMs;
+    size_t sent = 0;
+    while (sent < bytes.size()) {
+        ssize_t n = send(SocketClient::sockfd, bytes.data() + sent, bytes.size() - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            if (!SocketClient::waitFor(POLLOUT, deadline)) {
+                return false;
+            }
+            continue;
+        }
+        // A partial frame is already on the wire, the connection is unusable
+        return SocketClient::fail("Error sending message: " + std::string(strerror(errno)));
+    }
+    return true;
+}
 
-    ssize_t bytes_sent = send(SocketClient::sockfd, message.c_str(), message.size(), 0);
-    if (bytes_sent < 0) {
-        std::cerr << "Error sending message.\n";
-        return false;
-    } else if (static_cast<size_t>(bytes_sent) < message.size()) {
-        std::cerr << "Partial message sent.\n";
-        return false;
+bool SocketClient::sendMessage(const std::string& message) {
+    return SocketClient::sendAll(Framing::encode(message));
+}
+
+bool SocketClient::sendMessages(const std::vector<std::string>& messages) {
+    std::string bytes;
+    for (const std::string &message : messages) {
+        bytes += Framing::encode(message);
     }
+    return SocketClient::sendAll(bytes);
+}
 
+bool SocketClient::receiveMessage(std::string &message) {
+    if (!SocketClient::connected) {
+        SocketClient::error = "Not connected to server.";
+        return false;
+    }
+    long long deadline = nowMs() + SocketClient::timeoutMs;
+    char buffer[64 * 1024];
+    while (!SocketClient::decoder.hasFrame()) {
+        ssize_t n = recv(SocketClient::sockfd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            SocketClient::decoder.feed(buffer, n);
+            if (SocketClient::decoder.failed()) {
+                return SocketClient::fail("Invalid frame length received.");
+            }
+            continue;
+        }
+        if (n == 0) {
+            return SocketClient::fail("Connection closed by server.");
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+            if (!SocketClient::waitFor(POLLIN, deadline)) {
+                return false;
+            }
+            continue;
+        }
+        return SocketClient::fail("Error receiving message: " + std::string(strerror(errno)));
+    }
+    message = SocketClient::decoder.pop();
     return true;
 }
 
 std::string SocketClient::receiveMessage() {
-    if (!SocketClient::connected) {
-        std::cerr << "Not connected to server.\n";
-        return "";
-    }
+    std::string message;
+    return SocketClient::receiveMessage(message) ? message : "";
+}
 
-    char buffer[1024];
-    ssize_t bytes_received = recv(SocketClient::sockfd, buffer, sizeof(buffer) - 1, 0);
-    if (bytes_received < 0) {
-        std::cerr << "Error receiving message.\n";
-        return "";
-    } else if (bytes_received == 0) {
-        std::cerr << "Connection closed by server.\n";
-        disconnect();
-        return "";
-    }
+bool SocketClient::call(const std::string &request, std::string &response) {
+    return SocketClient::sendMessage(request) && SocketClient::receiveMessage(response);
+}
 
-    buffer[bytes_received] = '\0';
-    return std::string(buffer);
+bool SocketClient::pipeline(const std::vector<std::string> &requests, std::vector<std::string> &responses) {
+    if (!SocketClient::sendMessages(requests)) {
+        return false;
+    }
+    responses.clear();
+    responses.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); i++) {
+        std::string response;
+        if (!SocketClient::receiveMessage(response)) {
+            return false;
+        }
+        responses.push_back(std::move(response));
+    }
+    return true;
 }
@@ -1,22 +1,61 @@
 #pragma once
 #include <string>
+#include <vector>
+#include "Framing.h"
 
+/*
+* Client side of a length-prefixed (see Framing) request/response connection
+* over TCP, or a Unix domain socket when the host is "unix:/path/to.sock"
+* The socket is non-blocking, every operation waits at most timeoutMs. Several
+* requests can be in flight on one connection, responses come back in order.
+* Any error or timeout closes the connection, lastError() says why.
+*/
 class SocketClient {
 private:
     std::string host;
-    int port;
-    int sockfd;
-    bool connected;
+    int port = 0;
+    int sockfd = -1;
+    bool connected = false;
+    int timeoutMs = 5000;
+    FrameDecoder decoder;
+    std::string error;
+
+    bool fail(const std::string &message);
+    /* Wait for POLLIN/POLLOUT until the deadline, false on timeout or error */
+    bool waitFor(short events, long long deadlineMs);
+    bool sendAll(const std::string &bytes);
 public:
     SocketClient(){};
     SocketClient(const std::string& host, int port);
     ~SocketClient();
 
+    SocketClient(const SocketClient &) = delete;
+    SocketClient &operator=(const SocketClient &) = delete;
+
     void setHost(const std::string& host) { this->host = host; }
     void setPort(int port) { this->port = port; }
+    void setTimeout(int timeoutMs) { this->timeoutMs = timeoutMs; }
+
+    const std::string &getHost() const { return host; }
+    int getPort() const { return port; }
+    bool isConnected() const { return connected; }
+    const std::string &lastError() const { return error; }
 
     bool connectToServer();
     void disconnect();
+
+    /* Send one framed message, the whole frame or nothing usable (disconnects) */
     bool sendMessage(const std::string& message);
+    /* Pipeline: every frame in one write, read the answers with receiveMessage */
+    bool sendMessages(const std::vector<std::string>& messages);
+
+    /* Next frame, false on timeout/close/error */
+    bool receiveMessage(std::string &message);
+    /* Same, "" on failure */
     std::string receiveMessage();
+
+    /* send + receive */
+    bool call(const std::string &request, std::string &response);
+    /* Send every request before reading, responses[i] answers requests[i] */
+    bool pipeline(const std::vector<std::string> &requests, std::vector<std::string> &responses);
 };
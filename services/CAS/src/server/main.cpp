@@ -0,0 +1,76 @@
+#include "../network/HttpServer.h"
+#include "../network/CasEndpoints.h"
+#include "../worker/WorkerDispatcher.h"
+#include <csignal>
+#include <iostream>
+
+static HttpServer *runningServer = nullptr;
+
+static void handleSignal(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    std::string host = "0.0.0.0";
+    int port = 8000;
+    std::size_t threads = 0;
+    std::size_t workers = 0;
+    std::string workerBinary = WorkerDispatcher::defaultWorkerBinary();
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << "Options:\n";
+            std::cout << "  --host <addr>        Listen address (default 0.0.0.0)\n";
+            std::cout << "  --port <port>        Listen port, 0 for any (default 8000)\n";
+            std::cout << "  --threads <n>        Worker threads (default hardware concurrency)\n";
+            std::cout << "  --workers <n>        Solve in n AlgebraSolverWorker processes instead of in-process\n";
+            std::cout << "  --worker-binary <p>  Worker executable (default next to this one)\n";
+            return 0;
+        } else if (arg == "--host" && i + 1 < argc) {
+            host = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            port = std::stoi(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+        } else if (arg == "--workers" && i + 1 < argc) {
+            workers = std::stoul(argv[++i]);
+        } else if (arg == "--worker-binary" && i + 1 < argc) {
+            workerBinary = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    std::unique_ptr<WorkerDispatcher> dispatcher;
+    if (workers > 0) {
+        dispatcher = std::make_unique<WorkerDispatcher>(workerBinary, workers);
+        try {
+            dispatcher->start();
+        } catch (const std::exception &e) {
+            std::cerr << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    HttpServer server(threads);
+    CasEndpoints::install(server, dispatcher.get());
+    try {
+        port = server.listen(host, port);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, handleSignal);
+    std::signal(SIGTERM, handleSignal);
+    std::cerr << "Listening on http://" << host << ":" << port << "\n";
+    server.run();
+    runningServer = nullptr;
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include "CasService.h"
+#include <chrono>
+#include "../core/solver/Simplifier.h"
+#include "../core/solver/Isolator.h"
+#include "../core/solver/EquationSolver.h"
+#include "../core/solver/SystemSolver.h"
+#include "../core/cache/ResultCache.h"
+#include "../core/parser/Printer.h"
+#include "../core/parser/PersistentNode.h"
+
+SimplifyOutcome CasService::simplify(const std::string &expression, SolveBudget *budget) {
+    std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(expression);
+    Parser parser(std::move(lexer));
+    std::unique_ptr<ASTNode> root = parser.parse();
+
+    SimplifyOutcome outcome;
+    ResultCache &cache = ResultCache::instance();
+    std::string key = ResultCache::expressionKey(root);
+    CachedResult cached;
+    if (cache.lookup(key, cached)) {
+        outcome.simplified = cached.result;
+        outcome.cached = true;
+        return outcome;
+    }
+
+    if (budget) {
+        budget->start();
+    }
+    BudgetScope budgetScope(budget);
+    Simplifier::simplify(root);
+    outcome.simplified = Printer::print(root.get());
+
+    // A partially simplified expression must not be served to later calls
+    if (budget && budget->exceeded()) {
+        outcome.status = SolveBudget::statusName(budget->getStatus());
+    } else {
+        cache.insert(key, {outcome.simplified, {}, {}});
+    }
+    return outcome;
+}
+
+SimplifyOutcome CasService::substitute(
+    const std::string &expression,
+    const std::unordered_map<std::string, std::string> &values,
+    SolveBudget *budget
+) {
+    std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(expression);
+    Parser parser(std::move(lexer));
+    PTree root = PersistentNode::freeze(parser.parse().get());
+
+    std::unordered_map<std::string, PTree> bindings;
+    bindings.reserve(values.size());
+    for (const auto &[variable, value] : values) {
+        std::unique_ptr<Lexer> valueLexer = std::make_unique<Lexer>(value);
+        Parser valueParser(std::move(valueLexer));
+        bindings.emplace(variable, PersistentNode::freeze(valueParser.parse().get()));
+    }
+
+    if (budget) {
+        budget->start();
+    }
+    BudgetScope budgetScope(budget);
+    std::unique_ptr<ASTNode> result = PersistentNode::substitute(root, bindings)->thaw();
+    Simplifier::simplify(result);
+
+    SimplifyOutcome outcome;
+    outcome.simplified = Printer::print(result.get());
+    if (budget && budget->exceeded()) {
+        outcome.status = SolveBudget::statusName(budget->getStatus());
+    }
+    return outcome;
+}
+
+SolveAllOutcome CasService::solveAll(const std::vector<std::string> &equations, SolveBudget *budget) {
+    std::vector<PTree> prepared;
+    for (const auto &eq : equations) {
+        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(eq);
+        Parser parser(std::move(lexer));
+        prepared.push_back(EquationSolver::prepareEquation(parser.parse()));
+    }
+
+    SystemSolution solution = SystemSolver::solveAll(prepared, budget);
+    SolveAllOutcome outcome;
+    for (const auto &[variable, answer] : solution.variables) {
+        VariableAnswer &printed = outcome.variables[variable];
+        printed.status = SystemSolver::statusName(answer.status);
+        printed.value = answer.value ? Printer::print(answer.value->thaw().get()) : "";
+        printed.dependsOn = answer.dependsOn;
+    }
+    outcome.inconsistentEquations = solution.inconsistentEquations;
+    outcome.redundantEquations = solution.redundantEquations;
+    outcome.metrics = solution.metrics;
+    if (budget && budget->exceeded()) {
+        outcome.status = SolveBudget::statusName(budget->getStatus());
+    }
+    return outcome;
+}
+
+std::string CasService::differentiate(const std::string &expression, const std::string &variable) {
+    std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(expression);
+    Parser parser(std::move(lexer));
+    std::unique_ptr<ASTNode> derivative = Differentiator::derivative(parser.parse().get(), variable);
+    return Printer::print(derivative.get());
+}
+
+SparseJacobian CasService::jacobian(const std::vector<std::string> &equations, const std::vector<std::string> &variables) {
+    std::vector<PTree> parsed;
+    for (const auto &eq : equations) {
+        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(eq);
+        Parser parser(std::move(lexer));
+        parsed.push_back(PersistentNode::freeze(parser.parse().get()));
+    }
+    return Differentiator::jacobian(parsed, variables);
+}
+
+JacobianOutcome CasService::evaluateJacobian(
+    const std::vector<std::string> &equations,
+    const std::vector<std::string> &variables,
+    const std::vector<double> *point
+) {
+    SparseJacobian jacobian = CasService::jacobian(equations, variables);
+    JacobianOutcome outcome;
+    outcome.variables = jacobian.variables;
+    outcome.rowStart = jacobian.rowStart;
+    outcome.columns = jacobian.columns;
+    for (const PTree &derivative : jacobian.derivatives) {
+        outcome.derivatives.push_back(Printer::print(derivative->thaw().get()));
+    }
+    if (point) {
+        std::vector<double> values = jacobian.compiled.evaluate(*point);
+        outcome.residuals.assign(values.begin(), values.begin() + jacobian.rows());
+        outcome.values.assign(values.begin() + jacobian.rows(), values.end());
+    }
+    return outcome;
+}
+
+std::string CasService::isolate(const std::string &equation, const std::string &variable) {
+    std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(equation);
+    Parser parser(std::move(lexer));
+    std::unique_ptr<ASTNode> root = parser.parse();
+    if (root->getNodeType() != NodeType::BinaryOp || static_cast<BinaryOpNode*>(root.get())->getToken().getType() != ASSIGN) {
+        throw std::runtime_error("Input is not a valid equation");
+    }
+    Isolator::isolateVariable(root, variable, false);
+    return Printer::print(root.get());
+}
+
+SolveOutcome CasService::solve(
+    const std::vector<std::string> &equations,
+    const std::string &variable,
+    const SolverOptions &options,
+    SolveBudget *budget,
+    const SolveObserver &observer
+) {
+    // Prepared up front, the key and the search both work on the normalized forms
+    auto prepareStart = std::chrono::steady_clock::now();
+    std::vector<PTree> prepared;
+    for (const auto &eq : equations) {
+        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(eq);
+        Parser parser(std::move(lexer));
+        prepared.push_back(EquationSolver::prepareEquation(parser.parse()));
+    }
+    std::uint64_t prepareNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - prepareStart
+    ).count();
+
+    SolveOutcome outcome;
+    ResultCache &cache = ResultCache::instance();
+    std::string key = ResultCache::systemKey(prepared, variable, options.key());
+    CachedResult cached;
+    if (cache.lookup(key, cached)) {
+        outcome.result = cached.result;
+        outcome.steps = cached.steps;
+        outcome.metrics = cached.metrics;
+        outcome.cached = true;
+        if (observer) {
+            SolveEvent event{SolveEventKind::Finished, outcome.result};
+            event.iteration = outcome.metrics.iterations;
+            event.steps = outcome.steps;
+            event.termination = outcome.metrics.termination;
+            observer(event);
+        }
+        return outcome;
+    }
+
+    EquationSolver solver;
+    SolveResult solution = solver.solvePrepared(prepared, variable, options, budget, observer);
+    outcome.result = solution.answer();
+    outcome.metrics = solution.metrics;
+    outcome.metrics.normalizeNs += prepareNs;
+    outcome.metrics.totalNs += prepareNs;
+    outcome.steps = solution.steps();
+
+    // Running out of budget says nothing about the system, do not remember it
+    if (budget && budget->exceeded()) {
+        outcome.status = SolveBudget::statusName(budget->getStatus());
+    } else {
+        cache.insert(key, {outcome.result, outcome.steps, outcome.metrics});
+    }
+    return outcome;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../core/solver/Differentiator.h"
+#include "../core/solver/SolveBudget.h"
+#include "../core/solver/SolveMetrics.h"
+#include "../core/solver/SolverOptions.h"
+#include "../core/solver/SolveObserver.h"
+
+struct SimplifyOutcome {
+    std::string simplified;
+    // "ok" or SolveBudget::statusName of the budget that stopped it
+    std::string status = "ok";
+    bool cached = false;
+};
+
+struct SolveOutcome {
+    // Empty when no solution was found
+    std::string result;
+    std::vector<std::string> steps;
+    SolveMetrics metrics;
+    std::string status = "ok";
+    bool cached = false;
+};
+
+struct VariableAnswer {
+    // SystemSolver::statusName, e.g. "solved" or "free"
+    std::string status;
+    // Printed value, empty unless solved or dependent
+    std::string value;
+    std::vector<std::string> dependsOn;
+};
+
+struct JacobianOutcome {
+    std::vector<std::string> variables;
+    // Entries of row i are rowStart[i] .. rowStart[i + 1] - 1
+    std::vector<int> rowStart;
+    std::vector<int> columns;
+    std::vector<std::string> derivatives;
+    // lhs - rhs per row and the entries at the requested point, empty without one
+    std::vector<double> residuals;
+    std::vector<double> values;
+};
+
+struct SolveAllOutcome {
+    std::map<std::string, VariableAnswer> variables;
+    std::vector<int> inconsistentEquations;
+    int redundantEquations = 0;
+    SolveMetrics metrics;
+    std::string status = "ok";
+};
+
+/*
+* Parse -> cache -> simplify/solve -> printable output, shared by every front end
+* (the Python module and the HTTP server) so they return the same strings
+* Parse errors and unsolvable systems throw std::runtime_error
+*/
+class CasService {
+public:
+    static SimplifyOutcome simplify(const std::string &expression, SolveBudget *budget = nullptr);
+
+    /*
+    * Replace variables by expressions, e.g. {"a": "2", "b": "c + 1"}, then simplify
+    * All values go in with one traversal and the result is simplified once
+    */
+    static SimplifyOutcome substitute(
+        const std::string &expression,
+        const std::unordered_map<std::string, std::string> &values,
+        SolveBudget *budget = nullptr
+    );
+
+    /* Every variable of the system from one elimination, see SystemSolver */
+    static SolveAllOutcome solveAll(const std::vector<std::string> &equations, SolveBudget *budget = nullptr);
+
+    /* d expression / d variable, simplified, e.g. ("x ^ 2 * y", "x") -> "2 * x * y" */
+    static std::string differentiate(const std::string &expression, const std::string &variable);
+    /* Sparse Jacobian of lhs - rhs for each equation as written, see Differentiator::jacobian */
+    static SparseJacobian jacobian(const std::vector<std::string> &equations, const std::vector<std::string> &variables = {});
+    /* jacobian() printed, and evaluated when there is a point (one value per column) */
+    static JacobianOutcome evaluateJacobian(
+        const std::vector<std::string> &equations,
+        const std::vector<std::string> &variables,
+        const std::vector<double> *point = nullptr
+    );
+    static std::string isolate(const std::string &equation, const std::string &variable);
+
+    static SolveOutcome solve(
+        const std::vector<std::string> &equations,
+        const std::string &variable,
+        const SolverOptions &options = SolverOptions(),
+        SolveBudget *budget = nullptr,
+        const SolveObserver &observer = nullptr
+    );
+};
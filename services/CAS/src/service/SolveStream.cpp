@@ -0,0 +1,67 @@
+#include "SolveStream.h"
+
+SolveStream::SolveStream(
+    std::vector<std::string> equations,
+    std::string variable,
+    SolverOptions options,
+    SolveBudget budget
+) : budget(budget) {
+    SolveStream::worker = std::thread([this, equations = std::move(equations), variable = std::move(variable), options]() {
+        try {
+            CasService::solve(equations, variable, options, &this->budget, [this](const SolveEvent &event) {
+                {
+                    std::lock_guard<std::mutex> lock(this->mutex);
+                    this->events.push_back(event);
+                }
+                this->available.notify_one();
+            });
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->done = true;
+        }
+        this->available.notify_all();
+    });
+}
+
+SolveStream::~SolveStream() {
+    SolveStream::cancel();
+    if (SolveStream::worker.joinable()) {
+        SolveStream::worker.join();
+    }
+}
+
+bool SolveStream::next(SolveEvent &event) {
+    std::unique_lock<std::mutex> lock(SolveStream::mutex);
+    SolveStream::available.wait(lock, [this]() { return !this->events.empty() || this->done; });
+    if (!SolveStream::events.empty()) {
+        event = std::move(SolveStream::events.front());
+        SolveStream::events.pop_front();
+        return true;
+    }
+    if (SolveStream::error) {
+        std::exception_ptr error = SolveStream::error;
+        SolveStream::error = nullptr;
+        std::rethrow_exception(error);
+    }
+    return false;
+}
+
+std::vector<SolveEvent> SolveStream::nextBatch() {
+    std::unique_lock<std::mutex> lock(SolveStream::mutex);
+    SolveStream::available.wait(lock, [this]() { return !this->events.empty() || this->done; });
+    if (SolveStream::events.empty() && SolveStream::error) {
+        std::exception_ptr error = SolveStream::error;
+        SolveStream::error = nullptr;
+        std::rethrow_exception(error);
+    }
+    std::vector<SolveEvent> batch(
+        std::make_move_iterator(SolveStream::events.begin()),
+        std::make_move_iterator(SolveStream::events.end())
+    );
+    SolveStream::events.clear();
+    return batch;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "CasService.h"
+
+/*
+* Runs CasService::solve on its own thread and hands out SolveEvents as they happen
+* Events are buffered, so a slow reader never blocks the search. The last event
+* is always Finished (unless the solve threw, then next() rethrows).
+* cancel() and the destructor stop the search through the budget token.
+*/
+class SolveStream {
+private:
+    SolveBudget budget;
+    std::thread worker;
+
+    std::mutex mutex;
+    std::condition_variable available;
+    std::deque<SolveEvent> events;
+    bool done = false;
+    std::exception_ptr error;
+
+public:
+    SolveStream(
+        std::vector<std::string> equations,
+        std::string variable,
+        SolverOptions options = SolverOptions(),
+        SolveBudget budget = SolveBudget()
+    );
+    ~SolveStream();
+
+    SolveStream(const SolveStream &) = delete;
+    SolveStream &operator=(const SolveStream &) = delete;
+
+    /* Block until the next event, false once the stream is drained */
+    bool next(SolveEvent &event);
+    /* Take every buffered event, blocks only while none is buffered and the solve is running */
+    std::vector<SolveEvent> nextBatch();
+
+    void cancel() { budget.token.cancel(); }
+    bool cancelled() const { return budget.token.isCancelled(); }
+};
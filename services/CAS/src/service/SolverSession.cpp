@@ -0,0 +1,186 @@
+#include "SolverSession.h"
+#include <algorithm>
+#include "../core/solver/EquationSolver.h"
+
+void SolverSession::unlink(const std::string &id, const Equation &equation) {
+    for (const std::string &var : equation.vars) {
+        auto it = this->varToIds.find(var);
+        if (it == this->varToIds.end()) {
+            continue;
+        }
+        it->second.erase(id);
+        if (it->second.empty()) {
+            this->varToIds.erase(it);
+        }
+    }
+}
+
+std::vector<std::string> SolverSession::component(const std::string &variable) const {
+    std::unordered_set<std::string> seenVars{variable};
+    std::unordered_set<std::string> seenIds;
+    std::vector<std::string> pending{variable};
+    std::vector<std::string> ids;
+    while (!pending.empty()) {
+        std::string var = std::move(pending.back());
+        pending.pop_back();
+        auto it = this->varToIds.find(var);
+        if (it == this->varToIds.end()) {
+            continue;
+        }
+        for (const std::string &id : it->second) {
+            if (!seenIds.insert(id).second) {
+                continue;
+            }
+            ids.push_back(id);
+            for (const std::string &next : this->equations.at(id).vars) {
+                if (seenVars.insert(next).second) {
+                    pending.push_back(next);
+                }
+            }
+        }
+    }
+    // The solver's tie breaks depend on the input order
+    std::sort(ids.begin(), ids.end(), [this](const std::string &a, const std::string &b) {
+        return this->equations.at(a).order < this->equations.at(b).order;
+    });
+    return ids;
+}
+
+void SolverSession::set(const std::string &id, const std::string &equation) {
+    // Parse and normalize before touching the session, a bad equation changes nothing
+    std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(equation);
+    Parser parser(std::move(lexer));
+    PTree prepared = EquationSolver::prepareEquation(parser.parse());
+    std::unordered_set<std::string> vars;
+    prepared->collectVariables(vars);
+
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::uint64_t order;
+    auto it = this->equations.find(id);
+    if (it != this->equations.end()) {
+        order = it->second.order;
+        this->unlink(id, it->second);
+    } else {
+        order = this->nextOrder++;
+    }
+    for (const std::string &var : vars) {
+        this->varToIds[var].insert(id);
+    }
+    this->equations[id] = Equation{equation, std::move(prepared), std::move(vars), order, ++this->nextRevision};
+}
+
+std::string SolverSession::add(const std::string &equation) {
+    std::string id;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        do {
+            id = "eq" + std::to_string(++this->nextId);
+        } while (this->equations.count(id) > 0);
+    }
+    this->set(id, equation);
+    return id;
+}
+
+bool SolverSession::remove(const std::string &id) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->equations.find(id);
+    if (it == this->equations.end()) {
+        return false;
+    }
+    this->unlink(id, it->second);
+    this->equations.erase(it);
+    return true;
+}
+
+void SolverSession::clear() {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->equations.clear();
+    this->varToIds.clear();
+    this->answers.clear();
+}
+
+std::vector<std::pair<std::string, std::string>> SolverSession::list() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    std::vector<std::pair<std::uint64_t, std::pair<std::string, std::string>>> ordered;
+    for (const auto &[id, equation] : this->equations) {
+        ordered.push_back({equation.order, {id, equation.text}});
+    }
+    std::sort(ordered.begin(), ordered.end());
+    std::vector<std::pair<std::string, std::string>> result;
+    for (auto &entry : ordered) {
+        result.push_back(std::move(entry.second));
+    }
+    return result;
+}
+
+std::size_t SolverSession::size() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->equations.size();
+}
+
+SolveOutcome SolverSession::solve(
+    const std::string &variable,
+    const SolverOptions &options,
+    SolveBudget *budget,
+    const SolveObserver &observer
+) {
+    std::string optionsKey = options.key();
+    std::vector<PTree> prepared;
+    std::vector<std::pair<std::string, std::uint64_t>> used;
+    SolveOutcome outcome;
+    bool hit = false;
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (const std::string &id : this->component(variable)) {
+            const Equation &equation = this->equations.at(id);
+            used.emplace_back(id, equation.revision);
+            prepared.push_back(equation.prepared);
+        }
+        auto it = this->answers.find(variable);
+        if (it != this->answers.end() && it->second.used == used && it->second.optionsKey == optionsKey) {
+            outcome = it->second.outcome;
+            outcome.cached = true;
+            hit = true;
+            this->hitCount++;
+        } else {
+            this->missCount++;
+        }
+    }
+
+    if (hit) {
+        if (observer) {
+            SolveEvent event{SolveEventKind::Finished, outcome.result};
+            event.iteration = outcome.metrics.iterations;
+            event.steps = outcome.steps;
+            event.termination = outcome.metrics.termination;
+            observer(event);
+        }
+        return outcome;
+    }
+
+    // The trees are immutable, the search runs without the lock so edits are not held up
+    EquationSolver solver;
+    SolveResult solution = solver.solvePrepared(prepared, variable, options, budget, observer);
+    outcome.result = solution.answer();
+    outcome.metrics = solution.metrics;
+    outcome.steps = solution.steps();
+
+    if (budget && budget->exceeded()) {
+        outcome.status = SolveBudget::statusName(budget->getStatus());
+    } else {
+        // An edit made meanwhile changed a revision, so this answer is never served for it
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->answers[variable] = Answer{std::move(used), std::move(optionsKey), outcome};
+    }
+    return outcome;
+}
+
+std::uint64_t SolverSession::hits() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->hitCount;
+}
+
+std::uint64_t SolverSession::misses() const {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    return this->missCount;
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include "CasService.h"
+#include "../core/parser/PersistentNode.h"
+
+/*
+* A system of equations that is edited one equation at a time and queried many times
+* e.g. session.set("e1", "x + a = b"); session.set("e2", "a = 2"); session.solve("x");
+*      session.set("e2", "a = 3");  // only e2 is parsed and normalized again
+*
+* Each equation is parsed, normalized and simplified once, when it is set. A query only
+* hands the solver the equations connected to the target (through shared variables), and
+* its answer is kept until one of those equations changes, so editing an unrelated part of
+* the system keeps the answer. All methods are thread safe.
+*/
+class SolverSession {
+private:
+    struct Equation {
+        std::string text;
+        PTree prepared;
+        std::unordered_set<std::string> vars;
+        // Position in the system, kept when the equation is replaced
+        std::uint64_t order = 0;
+        // Changes on every set
+        std::uint64_t revision = 0;
+    };
+
+    struct Answer {
+        // (id, revision) of every equation the answer was computed from
+        std::vector<std::pair<std::string, std::uint64_t>> used;
+        std::string optionsKey;
+        SolveOutcome outcome;
+    };
+
+    std::unordered_map<std::string, Equation> equations;
+    std::unordered_map<std::string, std::unordered_set<std::string>> varToIds;
+    // By target variable
+    std::unordered_map<std::string, Answer> answers;
+    std::uint64_t nextOrder = 0;
+    std::uint64_t nextRevision = 0;
+    std::uint64_t nextId = 0;
+    std::uint64_t hitCount = 0;
+    std::uint64_t missCount = 0;
+    mutable std::mutex mutex;
+
+    void unlink(const std::string &id, const Equation &equation);
+    /* Ids connected to variable, in system order */
+    std::vector<std::string> component(const std::string &variable) const;
+
+public:
+    /* Adds or replaces the equation under id, throws on parse errors and leaves the session as it was */
+    void set(const std::string &id, const std::string &equation);
+    /* Adds under a new id and returns it */
+    std::string add(const std::string &equation);
+    /* False when there was no such id */
+    bool remove(const std::string &id);
+    void clear();
+
+    /* (id, text) in system order */
+    std::vector<std::pair<std::string, std::string>> list() const;
+    std::size_t size() const;
+
+    /*
+    * Same answer as CasService::solve on the current equations
+    * outcome.cached is set when nothing it depends on changed since the last query
+    */
+    SolveOutcome solve(
+        const std::string &variable,
+        const SolverOptions &options = SolverOptions(),
+        SolveBudget *budget = nullptr,
+        const SolveObserver &observer = nullptr
+    );
+
+    /* Queries answered without solving / by solving */
+    std::uint64_t hits() const;
+    std::uint64_t misses() const;
+};
@@ -1,5 +1,24 @@
 #include "Tester.h"
 #include "../network/SocketClient.h"
+#include "../core/cache/ResultCache.h"
+#include "../workload/WorkloadGenerator.h"
+#include "../utils/Stats.h"
+#include "../network/HttpServer.h"
+#include "../network/CasEndpoints.h"
+#include "../network/ConnectionPool.h"
+#include "../worker/WorkerDispatcher.h"
+#include "../service/SolveStream.h"
+#include "../service/SolverSession.h"
+#include "../core/parser/Printer.h"
+#include "../core/parser/PersistentNode.h"
+#include "../core/solver/ExpressionDag.h"
+#include "../core/solver/Differentiator.h"
+#include "../core/solver/PolynomialSolver.h"
+#include "../core/parser/FlatTree.h"
+#include <csignal>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <thread>
 
 void testLexer() {
     std::string sample = "(3 + 2) * 1";
@@ -70,9 +89,9 @@ void testEvaluation() {
     std::unique_ptr<ASTNode> root2 = parser1.parse();
 
     eval.assignment(root1.get());
-    double result = eval.evaluate(root2.get());
+    Rational result = eval.evaluate(root2.get());
     std::cout << expr1 << "\n";
-    std::cout << expr2 << " = " << result << "\n";
+    std::cout << expr2 << " = " << result.toString() << "\n";
 }
 
 void testSimplify() {
@@ -288,12 +307,1001 @@ void testSolve(){
     if (solution.result) {
         std::cout << "Solution for " << variable << ": " << solution.result->toString() << "\n";
         std::cout << "Steps:\n";
-        for (const auto& step : solution.steps) {
+        for (const auto& step : solution.steps()) {
             std::cout << "- " << step << "\n";
         }
     } else {
         std::cout << "No solution found for x.\n";
     }
+    const SolveMetrics &metrics = solution.metrics;
+    std::cout << "Metrics: termination=" << SolveMetrics::terminationName(metrics.termination)
+              << " iterations=" << metrics.iterations
+              << " expanded=" << metrics.statesExpanded
+              << " duplicates=" << metrics.duplicatesSkipped
+              << " peakQueue=" << metrics.peakQueueSize
+              << " clones=" << metrics.clones
+              << " isolations=" << metrics.isolations
+              << " simplifies=" << metrics.simplifyCalls
+              << " totalNs=" << metrics.totalNs << "\n";
+}
+
+void testResultCache(){
+    auto parseAll = [](const std::vector<std::string> &equations) {
+        std::vector<PTree> prepared;
+        for (const auto &eq : equations) {
+            Parser parser(std::make_unique<Lexer>(eq));
+            prepared.push_back(EquationSolver::prepareEquation(parser.parse()));
+        }
+        return prepared;
+    };
+    auto system1 = parseAll({"x + a = b * c", "a = b + 2", "c = 3", "b = 4"});
+    auto system2 = parseAll({"b=4", "c =3", "x+a=b*c", "a = b+2"});
+    std::string key1 = ResultCache::systemKey(system1, "x");
+    std::string key2 = ResultCache::systemKey(system2, "x");
+    std::cout << "Key: " << key1 << "\n";
+    std::cout << "Same key for reordered system: " << (key1 == key2 ? "true" : "false") << "\n";
+    // Equivalent textbook forms normalize to one key
+    std::string sum = ResultCache::systemKey(parseAll({"x + 1 = 2"}), "x");
+    std::string swapped = ResultCache::systemKey(parseAll({"1 + x = 2"}), "x");
+    std::string moved = ResultCache::systemKey(parseAll({"x = 2 - 1"}), "x");
+    std::cout << "Same key for x + 1 = 2, 1 + x = 2, x = 2 - 1: " << (sum == swapped && sum == moved ? "true" : "false")
+              << " (" << sum << ")\n";
+
+    // Every entry carries the SolveMetrics of its solve, room for a few
+    ResultCache cache(4 * (sizeof(CachedResult) + 256));
+    cache.insert(key1, {"x = 6", {"Start: x + a - b * c = 0", "Solved: x = 6"}, SolveMetrics()});
+    CachedResult cached;
+    bool hit = cache.lookup(key2, cached);
+    std::cout << "Hit: " << (hit ? "true" : "false") << " -> " << cached.result << "\n";
+    cache.lookup(ResultCache::systemKey(system1, "a"), cached);
+
+    // Fill past the byte limit to force evictions
+    for (int i = 0; i < 10; i++) {
+        cache.insert("simplify|" + std::to_string(i), {std::to_string(i), {}, SolveMetrics()});
+    }
+    CacheStats stats = cache.stats();
+    std::cout << "hits=" << stats.hits << " misses=" << stats.misses
+              << " evictions=" << stats.evictions << " entries=" << stats.entries
+              << " bytes=" << stats.bytes << "/" << stats.maxBytes << "\n";
+}
+
+void testWorkload(){
+    for (WorkloadKind kind : {WorkloadKind::LinearChain, WorkloadKind::DeepNested, WorkloadKind::LikeTerms}) {
+        Workload workload = WorkloadGenerator::generate({kind, 6, 2, 42});
+        std::cout << WorkloadGenerator::kindName(kind) << ":\n";
+        for (const auto &eq : workload.equations) {
+            std::cout << "  " << eq << "\n";
+        }
+        std::vector<std::unique_ptr<ASTNode>> equations = workload.parse();
+        Tester solver;
+        auto solution = solver.solve(equations, workload.target);
+        std::cout << "  expected " << workload.target << " = " << workload.expected()
+                  << ", got " << (solution.result ? solution.result->toString() : "nothing") << "\n";
+    }
+}
+
+void testStats(){
+    Stats::reset();
+    testSolve();
+    StatsSnapshot snapshot = Stats::snapshot();
+    for (const RuleStats &r : snapshot.rules) {
+        std::cout << r.name << ": invocations=" << r.invocations << " fires=" << r.fires
+                  << " ns=" << r.nanos << " nodes=" << r.nodesVisited << "\n";
+    }
+    for (const PipelineStats &p : snapshot.pipelines) {
+        std::cout << p.name << ": calls=" << p.calls << " iterations=" << p.iterations
+                  << " max=" << p.maxIterations << "\n";
+    }
+}
+
+void testBudget(){
+    auto solveWith = [](SolveBudget &budget) {
+        std::vector<std::unique_ptr<ASTNode>> equations;
+        for (const char *eq : {"x + a = b*c", "a = b + 2", "c = 3", "b = 4"}) {
+            Parser parser(std::make_unique<Lexer>(eq));
+            equations.push_back(parser.parse());
+        }
+        EquationSolver solver;
+        SolveResult solution = solver.solve(equations, "x", SolverOptions(), &budget);
+        std::cout << (solution.result ? solution.result->toString() : "<none>") << " -> "
+                  << SolveMetrics::terminationName(solution.metrics.termination)
+                  << " (" << SolveBudget::statusName(budget.getStatus()) << ")\n";
+    };
+
+    SolveBudget unlimited;
+    solveWith(unlimited);
+
+    SolveBudget small;
+    small.maxNodes = 3;
+    solveWith(small);
+
+    SolveBudget cancelled;
+    cancelled.token.cancel();
+    solveWith(cancelled);
+
+    // Cancel a long simplify from another thread
+    Workload workload = WorkloadGenerator::generate({WorkloadKind::LikeTerms, 2000});
+    std::vector<std::unique_ptr<ASTNode>> parsed = workload.parse();
+    SolveBudget budget;
+    budget.start();
+    std::thread canceller([token = budget.token]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        token.cancel();
+    });
+    {
+        BudgetScope scope(&budget);
+        Simplifier::simplify(parsed[0]);
+    }
+    canceller.join();
+    std::cout << "simplify: " << SolveBudget::statusName(budget.getStatus()) << "\n";
+}
+
+void testSolverOptions(){
+    Workload workload = WorkloadGenerator::generate({WorkloadKind::LinearChain, 8});
+    for (SearchStrategy strategy : {SearchStrategy::BestFirst, SearchStrategy::Beam, SearchStrategy::BreadthFirst}) {
+        for (PriorityFunction priority : {PriorityFunction::DistinctVariables, PriorityFunction::Occurrences, PriorityFunction::Weighted}) {
+            SolverOptions options;
+            options.strategy = strategy;
+            options.priority = priority;
+            options.beamWidth = 4;
+
+            std::vector<std::unique_ptr<ASTNode>> equations = workload.parse();
+            EquationSolver solver;
+            SolveResult solution = solver.solve(equations, workload.target, options);
+            std::cout << options.key() << ": "
+                      << (solution.result ? solution.result->toString() : "<none>") << " "
+                      << SolveMetrics::terminationName(solution.metrics.termination)
+                      << " iterations=" << solution.metrics.iterations
+                      << " pruned=" << solution.metrics.statesPruned
+                      << " ns=" << solution.metrics.totalNs << "\n";
+        }
+    }
+}
+
+void testHttpServer(){
+    HttpServer server(2);
+    CasEndpoints::install(server);
+    int port = server.listen("127.0.0.1", 0);
+    std::thread loop([&server]() { server.run(); });
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+
+    // Pipelined requests on one connection, the answers must come back in order
+    auto post = [](const std::string &path, const std::string &body, bool close) {
+        return "POST " + path + " HTTP/1.1\r\nHost: test\r\n" + (close ? "Connection: close\r\n" : "") +
+               "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    };
+    std::string requests =
+        post("/solve-system", "{\"equations\": [\"x + a = b*c\", \"a = b + 2\", \"c = 3\", \"b = 4\"], \"variable\": \"x\"}", false) +
+        post("/simplify", "{\"expression\": \"x + x + x\"}", false) +
+        post("/solve-system/all", "{\"equations\": [\"x + y = 3\", \"x - y = 1\", \"z = x + w\"]}", false) +
+        post("/solve-system", "{\"equations\": [\"x * x = -1\"], \"variable\": \"x\", \"options\": {\"starting_points\": [{\"x\": 2}]}}", false) +
+        post("/solve-system", "{\"equations\": [\"x ^ 2 - 2 * x = 1\"], \"variable\": \"x\"}", false) +
+        post("/jacobian", "{\"equations\": [\"x * y = 6\", \"x + y = 5\"], \"point\": [2, 3.5]}", false) +
+        post("/simplify", "{\"expression\": \"2*3\"}", true);
+    send(fd, requests.data(), requests.size(), 0);
+
+    std::string response;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        response.append(buffer, n);
+    }
+    close(fd);
+    std::cout << response << "\n";
+
+    server.stop();
+    loop.join();
+}
+
+/*
+* Loopback stand-in for a remote worker: answers every frame with "echo:" + payload
+* "silent" gets no answer, "bye" is answered and then the connection is closed
+*/
+class EchoServer {
+private:
+    int listenFd;
+    std::thread acceptor;
+    std::vector<std::thread> handlers;
+    std::atomic<bool> stopping{false};
+public:
+    int port;
+
+    EchoServer() {
+        listenFd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = 0;
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr));
+        listen(listenFd, 16);
+        socklen_t length = sizeof(addr);
+        getsockname(listenFd, reinterpret_cast<sockaddr *>(&addr), &length);
+        port = ntohs(addr.sin_port);
+
+        acceptor = std::thread([this]() {
+            while (!stopping) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd < 0) return;
+                handlers.emplace_back([fd]() {
+                    FrameDecoder decoder;
+                    char buffer[4096];
+                    ssize_t n;
+                    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+                        decoder.feed(buffer, n);
+                        while (decoder.hasFrame()) {
+                            std::string frame = decoder.pop();
+                            if (frame == "silent") continue;
+                            std::string reply = Framing::encode("echo:" + frame);
+                            send(fd, reply.data(), reply.size(), MSG_NOSIGNAL);
+                            if (frame == "bye") {
+                                close(fd);
+                                return;
+                            }
+                        }
+                    }
+                    close(fd);
+                });
+            }
+        });
+    }
+
+    ~EchoServer() {
+        stopping = true;
+        shutdown(listenFd, SHUT_RDWR);
+        close(listenFd);
+        acceptor.join();
+        for (std::thread &handler : handlers) handler.join();
+    }
+};
+
+void testRpcClient(){
+    EchoServer server;
+
+    SocketClient client("127.0.0.1", server.port);
+    client.setTimeout(500);
+    client.connectToServer();
+
+    // Well above the old 1 KB receive buffer
+    std::string big(200000, 'x');
+    std::string response;
+    client.call(big, response);
+    std::cout << "big: sent " << big.size() << " got " << response.size() << "\n";
+
+    std::vector<std::string> requests = {"a", "b", "c", "d", "e"};
+    std::vector<std::string> responses;
+    client.pipeline(requests, responses);
+    std::cout << "pipeline:";
+    for (const std::string &r : responses) std::cout << " " << r;
+    std::cout << "\n";
+
+    client.setTimeout(100);
+    bool answered = client.call("silent", response);
+    std::cout << "timeout: answered=" << answered << " error=\"" << client.lastError()
+              << "\" connected=" << client.isConnected() << "\n";
+
+    ConnectionPool pool("127.0.0.1", server.port, 2, 500);
+    for (int i = 0; i < 5; i++) {
+        pool.call("ping" + std::to_string(i), response);
+    }
+    std::cout << "pool: last=" << response << " created=" << pool.createdCount()
+              << " reused=" << pool.reusedCount() << " idle=" << pool.idleCount() << "\n";
+
+    // The server drops the pooled connection, the next call retries on a new one
+    pool.call("bye", response);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    std::string error;
+    bool ok = pool.call("after", response, &error);
+    std::cout << "stale: ok=" << ok << " response=" << response << " created=" << pool.createdCount() << "\n";
+}
+
+void testWorkerDispatcher(){
+    WorkerDispatcher dispatcher(WorkerDispatcher::defaultWorkerBinary(), 2);
+    dispatcher.start();
+
+    WorkerRequest solve;
+    solve.op = WorkerOp::Solve;
+    solve.equations = {"x + a = b*c", "a = b + 2", "c = 3", "b = 4"};
+    solve.variable = "x";
+    WorkerResponse response = dispatcher.call(solve);
+    std::cout << "solve: ok=" << response.ok << " result=" << response.solve.result
+              << " steps=" << response.solve.steps.size() << " worker=" << dispatcher.workerFor(solve) << "\n";
+
+    // Same system in another order goes to the same worker and hits its cache
+    WorkerRequest reordered = solve;
+    std::reverse(reordered.equations.begin(), reordered.equations.end());
+    response = dispatcher.call(reordered);
+    std::cout << "reordered: worker=" << dispatcher.workerFor(reordered) << " cached=" << response.solve.cached << "\n";
+
+    WorkerRequest all;
+    all.op = WorkerOp::SolveAll;
+    all.equations = solve.equations;
+    response = dispatcher.call(all);
+    std::cout << "solve all: ok=" << response.ok << " x=" << response.solveAll.variables["x"].value
+              << " variables=" << response.solveAll.variables.size() << "\n";
+
+    // Newton options go over the wire and the numeric report comes back
+    WorkerRequest numeric;
+    numeric.op = WorkerOp::Solve;
+    numeric.equations = {"x * x = -1"};
+    numeric.variable = "x";
+    numeric.options.newton.method = NewtonMethod::TrustRegion;
+    numeric.options.newton.startingPoints = {{{"x", 2}}};
+    response = dispatcher.call(numeric);
+    std::cout << "numeric: ok=" << response.ok << " result=" << response.solve.result
+              << " reason=" << response.solve.metrics.numeric.reason << " starts=" << response.solve.metrics.numeric.starts << "\n";
+
+    WorkerRequest roots;
+    roots.op = WorkerOp::Solve;
+    roots.equations = {"x * x * x + x = 10"};
+    roots.variable = "x";
+    response = dispatcher.call(roots);
+    std::cout << "polynomial: ok=" << response.ok << " answer=" << response.solve.metrics.polynomial.answer
+              << " degree=" << response.solve.metrics.polynomial.degree << "\n";
+    roots.options.polynomialRoots = false;
+    response = dispatcher.call(roots);
+    std::cout << "polynomial off: ok=" << response.ok << " attempted=" << response.solve.metrics.polynomial.attempted << "\n";
+
+    WorkerRequest derivative;
+    derivative.op = WorkerOp::Differentiate;
+    derivative.expression = "x ^ 3 + 2 * x * y";
+    derivative.variable = "x";
+    response = dispatcher.call(derivative);
+    std::cout << "differentiate: ok=" << response.ok << " derivative=" << response.derivative << "\n";
+
+    WorkerRequest bad;
+    bad.op = WorkerOp::Simplify;
+    bad.expression = "2**(";
+    response = dispatcher.call(bad);
+    std::cout << "bad: ok=" << response.ok << " error=" << response.error << "\n";
+
+    // Kill the worker that owns the system, the next call is served by its replacement
+    std::size_t index = dispatcher.workerFor(solve);
+    pid_t before = dispatcher.workerPid(index);
+    kill(before, SIGKILL);
+    response = dispatcher.call(solve);
+    std::cout << "after crash: ok=" << response.ok << " result=" << response.solve.result
+              << " restarted=" << (dispatcher.workerPid(index) != before)
+              << " restarts=" << dispatcher.restartCount() << "\n";
+}
+
+void testSolveStream(){
+    Workload workload = WorkloadGenerator::generate({WorkloadKind::LinearChain, 8});
+    SolveStream stream(workload.equations, workload.target);
+    SolveEvent event;
+    while (stream.next(event)) {
+        std::cout << SolveEvent::kindName(event.kind) << " #" << event.iteration
+                  << " queue=" << event.queueSize << ": " << event.text << "\n";
+        if (event.kind == SolveEventKind::Finished) {
+            std::cout << "termination=" << SolveMetrics::terminationName(event.termination)
+                      << " steps=" << event.steps.size() << "\n";
+        }
+    }
+
+    // Cancel right away, must still end with a finished event
+    ResultCache::instance().clear();
+    SolveStream cancelled({"x + a = b", "a = 2", "b = 8"}, "x");
+    cancelled.cancel();
+    while (cancelled.next(event)) {
+        if (event.kind == SolveEventKind::Finished) {
+            std::cout << "cancelled: " << SolveMetrics::terminationName(event.termination) << " '" << event.text << "'\n";
+        }
+    }
+}
+
+void testRational(){
+    Rational third = Rational(1) / Rational(3);
+    std::cout << "1/3 * 3 = " << (third * Rational(3)).toString() << "\n";
+    std::cout << "0.1 + 0.2 = " << (Rational::parse("0.1") + Rational::parse("0.2")).toString() << "\n";
+
+    // Leaves the 64-bit fast path and comes back
+    Rational big = Rational(INT64_MAX) * Rational(INT64_MAX);
+    std::cout << "max^2 = " << big.toString() << " small=" << big.isSmall() << "\n";
+    Rational back = big / Rational(INT64_MAX);
+    std::cout << "max^2 / max = " << back.toString() << " small=" << back.isSmall() << "\n";
+    std::cout << "2^100 = " << Rational(2).pow(100).toString() << "\n";
+    std::cout << "(2/3)^-3 = " << Rational(2, 3).pow(-3).toString() << "\n";
+
+    std::vector<std::string> exprs = {
+        "x = 1/3 + 1/6",
+        "3*x = 1",
+        "x / 3 + x / 6 = 1",
+    };
+    for (const std::string &expr : exprs) {
+        std::unique_ptr<Lexer> lexer = std::make_unique<Lexer>(expr);
+        Parser parser(std::move(lexer));
+        std::unique_ptr<ASTNode> root = parser.parse();
+        Simplifier::simplify(root);
+        std::cout << expr << " -> " << root->toString() << "\n";
+    }
+}
+
+void testPrinter(){
+    // Printing and parsing again must give back the same tree
+    std::vector<std::string> exprs = {
+        "(x + (2 * (y - 1))) = 0",
+        "a - (b - c)",
+        "(a - b) - c",
+        "a / (b * c)",
+        "(a ^ b) ^ c",
+        "a ^ (b ^ c)",
+        "-(a + b) * c",
+        "(-a) ^ 2",
+        "-(a ^ 2)",
+        "a ^ (-b) * c",
+        "x = 1/3 * y",
+        "y * (1/3)",
+        "(1/3) ^ 2",
+        "--a - -(b * c)",
+    };
+    for (const std::string &expr : exprs) {
+        std::unique_ptr<ASTNode> root = Parser(std::make_unique<Lexer>(expr)).parse();
+        std::string printed = Printer::print(root.get());
+        std::unique_ptr<ASTNode> again = Parser(std::make_unique<Lexer>(printed)).parse();
+        bool same = again->toString() == root->toString();
+        std::cout << root->toString() << " -> " << printed << " "
+                  << (same ? "ok" : "MISMATCH " + again->toString()) << "\n";
+    }
+}
+
+void testPersistentSubstitute(){
+    std::unique_ptr<ASTNode> equation = Parser(std::make_unique<Lexer>("(a * b + c * d) - (a + e) = 0")).parse();
+    std::unique_ptr<ASTNode> value = Parser(std::make_unique<Lexer>("x + 1")).parse();
+    PTree before = PersistentNode::freeze(equation.get());
+    PTree replacement = PersistentNode::freeze(value.get());
+    PTree after = PersistentNode::substitute(before, "a", replacement);
+
+    std::cout << "before: " << before->toString() << "\n";
+    std::cout << "after:  " << after->toString() << "\n";
+    // ((a * b) + (c * d)) - (a + e): c * d and e are untouched, both a share one copy
+    const PTree &lhsBefore = before->getLeft()->getLeft();
+    const PTree &lhsAfter = after->getLeft()->getLeft();
+    std::cout << "c * d shared: " << (lhsBefore->getRight() == lhsAfter->getRight()) << "\n";
+    std::cout << "0 shared: " << (before->getRight() == after->getRight()) << "\n";
+    std::cout << "replacement shared: "
+              << (lhsAfter->getLeft()->getLeft() == after->getLeft()->getRight()->getLeft()) << "\n";
+    std::cout << "no occurrence returns input: " << (PersistentNode::substitute(before, "z", replacement) == before) << "\n";
+    std::cout << "thaw round trip: " << (before->thaw()->toString() == equation->toString()) << "\n";
+}
+
+void testMultiSubstitute(){
+    // x0 + x1 + ... + x199 with xi = i
+    const int count = 200;
+    std::string expression = "x0";
+    std::unordered_map<std::string, std::string> values = {{"x0", "0"}};
+    for (int i = 1; i < count; i++) {
+        expression += " + x" + std::to_string(i);
+        values["x" + std::to_string(i)] = std::to_string(i);
+    }
+    PTree root = PersistentNode::freeze(Parser(std::make_unique<Lexer>(expression)).parse().get());
+    std::unordered_map<std::string, PTree> bindings;
+    for (const auto &[variable, value] : values) {
+        bindings[variable] = PersistentNode::freeze(Parser(std::make_unique<Lexer>(value)).parse().get());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    PTree together = PersistentNode::substitute(root, bindings);
+    auto middle = std::chrono::steady_clock::now();
+    PTree oneByOne = root;
+    for (const auto &[variable, value] : bindings) {
+        oneByOne = PersistentNode::substitute(oneByOne, variable, value);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    std::cout << "same tree: " << (together->toString() == oneByOne->toString()) << "\n";
+    std::cout << "one pass: " << std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count() << "us, "
+              << "one by one: " << std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count() << "us\n";
+    std::cout << "service: " << CasService::substitute(expression, values).simplified << " (expect " << count * (count - 1) / 2 << ")\n";
+    std::cout << "symbolic: " << CasService::substitute("a * b + c", {{"a", "2"}, {"b", "c + 1"}}).simplified << "\n";
+}
+
+void testExpressionDag(){
+    ExpressionDag dag;
+    PTree first = dag.intern(Parser(std::make_unique<Lexer>("(a + b) * (a + b) + (a + b) * c")).parse().get());
+    PTree second = dag.intern(Parser(std::make_unique<Lexer>("(a + b) * (a + b) + (a + b) * c")).parse().get());
+    std::cout << "equal is pointer equal: " << (first == second) << "\n";
+    std::cout << "expanded nodes: " << first->size() << ", unique: " << ExpressionDag::uniqueNodes(first) << "\n";
+    std::cout << "value at a=2 b=3 c=4: "
+              << dag.evaluate(first, {{"a", Rational(2)}, {"b", Rational(3)}, {"c", Rational(4)}}).toString() << " (expect 45)\n";
+
+    PTree substituted = dag.substitute(first, "c", dag.intern(Parser(std::make_unique<Lexer>("a + b")).parse().get()));
+    std::cout << "substituted: " << Printer::print(substituted->thaw().get())
+              << ", unique: " << ExpressionDag::uniqueNodes(substituted) << "\n";
+    auto simplify = [](std::unique_ptr<ASTNode> &node) { Simplifier::simplify(node); };
+    PTree once = dag.rewrite(substituted, "simplify", simplify);
+    PTree twice = dag.rewrite(substituted, "simplify", simplify);
+    std::cout << "simplified: " << Printer::print(once->thaw().get())
+              << ", second call reused: " << (once == twice) << " hits=" << dag.hits() << "\n";
+
+    // Same answers with and without sharing, fewer simplify calls with it
+    for (WorkloadSpec spec : std::vector<WorkloadSpec>{
+        {WorkloadKind::LinearChain, 16}, {WorkloadKind::DeepNested, 16},
+        {WorkloadKind::LikeTerms, 16}, {WorkloadKind::SparseBanded, 8}
+    }) {
+        Workload workload = WorkloadGenerator::generate(spec);
+        for (bool share : {false, true}) {
+            SolverOptions options;
+            options.shareSubexpressions = share;
+            std::vector<std::unique_ptr<ASTNode>> equations = workload.parse();
+            EquationSolver solver;
+            SolveResult solution = solver.solve(equations, workload.target, options);
+            std::cout << WorkloadGenerator::kindName(spec.kind) << (share ? " shared: " : ": ")
+                      << (solution.result ? Printer::print(solution.result.get()) : "<none>") << " "
+                      << SolveMetrics::terminationName(solution.metrics.termination)
+                      << " simplifies=" << solution.metrics.simplifyCalls
+                      << " isolations=" << solution.metrics.isolations
+                      << " reused=" << solution.metrics.sharedRewrites
+                      << " ns=" << solution.metrics.totalNs << "\n";
+        }
+    }
+}
+
+void testSolverSession(){
+    SolverSession session;
+    session.set("e1", "x + a = b * c");
+    session.set("e2", "a = b + 2");
+    session.set("e3", "c = 3");
+    session.set("e4", "b = 4");
+    // Not connected to x
+    session.set("e5", "y = 2 * z");
+    session.set("e6", "z = 5");
+
+    auto show = [&](const std::string &label, const std::string &variable) {
+        SolveOutcome outcome = session.solve(variable);
+        std::cout << label << ": " << (outcome.result.empty() ? "<none>" : outcome.result)
+                  << (outcome.cached ? " (cached)" : "") << "\n";
+    };
+    show("x", "x");
+    show("x again", "x");
+    session.set("e6", "z = 7");
+    show("x after editing z", "x");
+    show("y", "y");
+    session.set("e4", "b = 5");
+    show("x after editing b", "x");
+    try {
+        session.set("e4", "b = (5");
+    } catch (const std::exception &e) {
+        std::cout << "bad edit rejected: " << e.what() << "\n";
+    }
+    show("x after bad edit", "x");
+    session.remove("e3");
+    show("x without c", "x");
+    std::cout << "hits=" << session.hits() << " misses=" << session.misses() << " size=" << session.size() << "\n";
+
+    // Editing one equation of a long chain, against re-submitting the whole system
+    Workload workload = WorkloadGenerator::generate({WorkloadKind::LinearChain, 32});
+    SolverSession chain;
+    for (const std::string &equation : workload.equations) {
+        chain.add(equation);
+    }
+    chain.solve(workload.target);
+    auto start = std::chrono::steady_clock::now();
+    chain.set("eq1", workload.equations[0]);
+    std::string incremental = chain.solve(workload.target).result;
+    auto middle = std::chrono::steady_clock::now();
+    ResultCache::instance().clear();
+    std::string full = CasService::solve(workload.equations, workload.target).result;
+    auto end = std::chrono::steady_clock::now();
+    std::cout << "chain32: session " << incremental << " in "
+              << std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count() << "us, full "
+              << full << " in " << std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count() << "us\n";
+}
+
+void testSolveAll(){
+    auto show = [](const std::string &label, const std::vector<std::string> &equations) {
+        SolveAllOutcome outcome = CasService::solveAll(equations);
+        std::cout << label << ":";
+        for (const auto &[variable, answer] : outcome.variables) {
+            std::cout << " " << variable << "=" << (answer.value.empty() ? "" : answer.value) << "[" << answer.status << "]";
+        }
+        if (!outcome.inconsistentEquations.empty()) {
+            std::cout << " inconsistent equations:";
+            for (int index : outcome.inconsistentEquations) std::cout << " " << index;
+        }
+        std::cout << " redundant=" << outcome.redundantEquations << "\n";
+    };
+    show("basic", {"x + a = b * c", "a = b + 2", "c = 3", "b = 4"});
+    show("underdetermined", {"x + y = 10", "y = 2 * z"});
+    show("inconsistent", {"x + y = 1", "x + y = 2", "z = 3"});
+    show("redundant", {"x + y = 4", "2 * x + 2 * y = 8", "x - y = 2"});
+    show("nonlinear", {"x * x = 2", "y = 3", "w = y + 1"});
+
+    // One elimination against one solve per variable
+    for (WorkloadSpec spec : std::vector<WorkloadSpec>{
+        {WorkloadKind::LinearChain, 32}, {WorkloadKind::SparseBanded, 8}, {WorkloadKind::DenseLinear, 6}
+    }) {
+        Workload workload = WorkloadGenerator::generate(spec);
+        auto start = std::chrono::steady_clock::now();
+        SolveAllOutcome all = CasService::solveAll(workload.equations);
+        auto middle = std::chrono::steady_clock::now();
+        int solvedOneByOne = 0;
+        for (const auto &[variable, value] : workload.solution) {
+            ResultCache::instance().clear();
+            // The search gives up slowly on the denser systems
+            SolveBudget budget;
+            budget.timeoutMs = 500;
+            SolveOutcome single = CasService::solve(workload.equations, variable, SolverOptions(), &budget);
+            solvedOneByOne += !single.result.empty();
+        }
+        auto end = std::chrono::steady_clock::now();
+        int correct = 0;
+        for (const auto &[variable, value] : workload.solution) {
+            const VariableAnswer &answer = all.variables[variable];
+            correct += answer.status == "solved" && Rational::parse(answer.value) == Rational(value);
+        }
+        std::cout << WorkloadGenerator::kindName(spec.kind) << ": solve_all " << correct << "/" << workload.solution.size()
+                  << " correct in " << std::chrono::duration_cast<std::chrono::microseconds>(middle - start).count()
+                  << "us, per variable " << solvedOneByOne << " solved in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(end - middle).count() << "us\n";
+    }
+}
+
+void testDifferentiator(){
+    for (auto [expression, variable] : std::vector<std::pair<std::string, std::string>>{
+        {"x ^ 3 + 2 * x * y", "x"}, {"x ^ 3 + 2 * x * y", "y"}, {"(x + 1) / (x - 1)", "x"},
+        {"-(x * x) + 3", "x"}, {"(2 * x + 1) ^ 2", "x"}, {"x ^ (1/2)", "x"}, {"a * b + c", "x"},
+    }) {
+        std::cout << "d/d" << variable << " " << expression << " = " << CasService::differentiate(expression, variable) << "\n";
+    }
+    try {
+        CasService::differentiate("2 ^ x", "x");
+    } catch (const std::exception &e) {
+        std::cout << "2 ^ x: " << e.what() << "\n";
+    }
+
+    SparseJacobian small = CasService::jacobian({"x * y = 6", "x + z ^ 2 = 7", "w = 1"});
+    for (std::size_t row = 0; row < small.rows(); row++) {
+        std::cout << "row " << row << ":";
+        for (int entry = small.rowStart[row]; entry < small.rowStart[row + 1]; entry++) {
+            std::cout << " d/d" << small.variables[small.columns[entry]] << " = " << Printer::print(small.derivatives[entry]->thaw().get());
+        }
+        std::cout << "\n";
+    }
+    std::vector<double> values = small.compiled.evaluate({1, 2, 3, 4});  // w, x, y, z
+    std::cout << "at w=1 x=2 y=3 z=4:";
+    for (double value : values) std::cout << " " << value;
+    std::cout << "\n";
+
+    // Compiled entries against central differences and against exact evaluation
+    for (WorkloadSpec spec : std::vector<WorkloadSpec>{{WorkloadKind::SparseBanded, 40}, {WorkloadKind::DenseLinear, 12}}) {
+        Workload workload = WorkloadGenerator::generate(spec);
+        SparseJacobian jacobian = CasService::jacobian(workload.equations);
+        std::size_t expanded = 0;
+        for (const PTree &derivative : jacobian.derivatives) expanded += derivative->size();
+        for (const PTree &residual : jacobian.residuals) expanded += residual->size();
+
+        std::vector<double> point;
+        std::unordered_map<std::string, Rational> exactPoint;
+        for (std::size_t i = 0; i < jacobian.variables.size(); i++) {
+            point.push_back(0.5 + 0.25 * i);
+            exactPoint[jacobian.variables[i]] = Rational(2 + i, 4);
+        }
+        std::vector<double> base = jacobian.compiled.evaluate(point);
+        double worstDifference = 0;
+        for (std::size_t row = 0; row < jacobian.rows(); row++) {
+            for (int entry = jacobian.rowStart[row]; entry < jacobian.rowStart[row + 1]; entry++) {
+                const double h = 1e-6;
+                std::vector<double> up = point, down = point;
+                up[jacobian.columns[entry]] += h;
+                down[jacobian.columns[entry]] -= h;
+                double numeric = (jacobian.compiled.evaluate(up)[row] - jacobian.compiled.evaluate(down)[row]) / (2 * h);
+                worstDifference = std::max(worstDifference, std::fabs(numeric - base[jacobian.rows() + entry]));
+            }
+        }
+
+        const int rounds = 1000;
+        std::vector<double> out(jacobian.compiled.size());
+        std::vector<double> registers;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++) {
+            jacobian.compiled.evaluate(point.data(), out.data(), registers);
+        }
+        auto middle = std::chrono::steady_clock::now();
+        ExpressionDag dag;
+        for (int i = 0; i < rounds / 100; i++) {
+            for (const PTree &derivative : jacobian.derivatives) dag.evaluate(derivative, exactPoint);
+            for (const PTree &residual : jacobian.residuals) dag.evaluate(residual, exactPoint);
+        }
+        auto end = std::chrono::steady_clock::now();
+        std::cout << WorkloadGenerator::kindName(spec.kind) << ": " << jacobian.rows() << "x" << jacobian.variables.size()
+                  << " entries=" << jacobian.entries() << " expandedNodes=" << expanded
+                  << " instructions=" << jacobian.compiled.instructions()
+                  << " worstFiniteDifference=" << worstDifference
+                  << " compiled=" << std::chrono::duration_cast<std::chrono::nanoseconds>(middle - start).count() / rounds
+                  << "ns exact=" << std::chrono::duration_cast<std::chrono::nanoseconds>(end - middle).count() / (rounds / 100)
+                  << "ns per evaluation\n";
+    }
+}
+
+void testNewtonFallback(){
+    auto show = [](const std::vector<std::string> &equations, const std::string &variable, const SolverOptions &options) {
+        ResultCache::instance().clear();
+        auto start = std::chrono::steady_clock::now();
+        SolveOutcome outcome = CasService::solve(equations, variable, options);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        const NumericReport &report = outcome.metrics.numeric;
+        std::cout << equations[0] << (equations.size() > 1 ? ", ..." : "") << " -> '" << outcome.result << "' "
+                  << SolveMetrics::terminationName(outcome.metrics.termination) << " in " << us << "us";
+        // Every root of the answer is "variable = value" with the variable gone from the value
+        std::string prefix = variable + " = ";
+        bool isolated = true;
+        std::size_t begin = 0;
+        while (begin <= outcome.result.size()) {
+            std::size_t end = std::min(outcome.result.find(" or ", begin), outcome.result.size());
+            std::string root = outcome.result.substr(begin, end - begin);
+            isolated = isolated && root.compare(0, prefix.size(), prefix) == 0
+                && root.find(variable, prefix.size()) == std::string::npos;
+            begin = end + 4;
+        }
+        if (outcome.metrics.termination == TerminationReason::Solved
+            || outcome.metrics.termination == TerminationReason::SolvedNumerically) {
+            std::cout << (isolated ? " isolated" : " NOT ISOLATED");
+        }
+        if (report.attempted) {
+            std::cout << " [" << report.reason << " starts=" << report.starts << " iterations=" << report.iterations
+                      << " evaluations=" << report.residualEvaluations << " residual=" << report.residualNorm
+                      << " newton=" << report.totalNs / 1000 << "us]";
+        }
+        std::cout << "\n";
+    };
+    SolverOptions options;
+    show({"x * x + y = 3", "x * y = 2"}, "x", options);
+    show({"x ^ 2 + y ^ 2 = 25", "x - y = 1"}, "y", options);
+    show({"x ^ 3 + x = 10"}, "x", options);
+    show({"x * x = 2"}, "x", options);
+    show({"x * x = -1"}, "x", options);
+    show({"x * y = 6"}, "x", options);
+    show({"2 ^ x = 8"}, "x", options);
+    show({"x ^ (1/2) = 3"}, "x", options);
+    show({"x ^ x = 4"}, "x", options);
+    show({"2 ^ x + y = 10", "x * y = 4"}, "x", options);
+    show({"x + 1 = 3"}, "x", options);
+
+    // Other root from another start, and the trust region variant
+    SolverOptions negative;
+    negative.newton.startingPoints = {{{"x", -1.0}}};
+    show({"x * x = 2"}, "x", negative);
+    SolverOptions trust;
+    trust.newton.method = NewtonMethod::TrustRegion;
+    show({"x * x + y = 3", "x * y = 2"}, "x", trust);
+    show({"x ^ 3 + x = 10"}, "x", trust);
+    SolverOptions off;
+    off.numericFallback = false;
+    show({"x * x = 2"}, "x", off);
+
+    // Chain of quadratics, x0 = 1 .. x7 = 8: x_i ^ 2 + x_(i+1) = x_i ^ 2 + i + 2
+    std::vector<std::string> chain;
+    for (int i = 0; i < 7; i++) {
+        chain.push_back("x" + std::to_string(i) + " ^ 2 + x" + std::to_string(i + 1) + " = " + std::to_string((i + 1) * (i + 1) + i + 2));
+    }
+    chain.push_back("x0 * x7 = 8");
+    show(chain, "x3", options);
+    show(chain, "x3", trust);
+}
+
+void testPolynomialRoots(){
+    auto show = [](const std::vector<std::string> &equations, const SolverOptions &options) {
+        ResultCache::instance().clear();
+        auto start = std::chrono::steady_clock::now();
+        SolveOutcome outcome = CasService::solve(equations, "x", options);
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        const PolynomialReport &report = outcome.metrics.polynomial;
+        std::cout << equations[0] << (equations.size() > 1 ? ", ..." : "") << " -> '" << outcome.result << "' "
+                  << SolveMetrics::terminationName(outcome.metrics.termination) << " in " << us << "us";
+        if (report.attempted) {
+            std::cout << " [degree " << report.degree << ", " << report.roots.size() << " real, roots=" << report.totalNs / 1000 << "us]";
+        }
+        // The last step shows the same roots as the result
+        if (!outcome.steps.empty() && outcome.steps.back() != "Solved: " + outcome.result) {
+            std::cout << " STEP MISMATCH '" << outcome.steps.back() << "'";
+        }
+        std::cout << "\n";
+    };
+    SolverOptions options;
+    show({"x ^ 2 + 3 * x = 10"}, options);
+    show({"x * x = 2"}, options);
+    show({"x ^ 2 - 2 * x = 1"}, options);
+    show({"x ^ 2 = -1"}, options);
+    show({"x ^ 3 = 0"}, options);
+    show({"x ^ 3 - 6 * x ^ 2 + 11 * x = 6"}, options);
+    show({"x ^ 3 + x = 10"}, options);
+    show({"x ^ 4 - 5 * x ^ 2 + 4 = 0"}, options);
+    show({"x ^ 4 + x = 3"}, options);
+    show({"x ^ 5 - x - 1 = 0"}, options);
+    show({"x ^ 7 = 3 * x"}, options);
+    show({"(x - 1) * (x - 2) * (x - 3) * (x - 4) * (x - 5) * (x - 6) = 0"}, options);
+    show({"x * x = y", "y + 1 = 10"}, options);
+    SolverOptions off;
+    off.polynomialRoots = false;
+    show({"x ^ 2 + 3 * x = 10"}, off);
+
+    // Straight from coefficients, lowest power first
+    auto roots = [](const std::vector<Rational> &coefficients) {
+        std::cout << "  ";
+        for (const PolynomialRoot &root : PolynomialSolver::realRoots(coefficients)) {
+            std::cout << root.text << (root.exact ? "" : " (numeric)") << "; ";
+        }
+        std::cout << "\n";
+    };
+    roots({Rational(-6), Rational(11), Rational(-6), Rational(1)});
+    roots({Rational(1), Rational(-2), Rational(1)});
+    roots({Rational(4), Rational(0), Rational(-4), Rational(0), Rational(1)});
+    roots({Rational(-1, 4), Rational(0), Rational(1)});
+    roots({Rational(-3), Rational(0), Rational(0), Rational(0), Rational(0), Rational(0), Rational(1)});
+    // Wilkinson-like, degree 10 with roots 1 .. 10
+    std::vector<Rational> product{Rational(1)};
+    for (int root = 1; root <= 10; root++) {
+        std::vector<Rational> next(product.size() + 1);
+        for (std::size_t i = 0; i < product.size(); i++) {
+            next[i + 1] += product[i];
+            next[i] -= product[i] * Rational(root);
+        }
+        product = next;
+    }
+    roots(product);
+}
+
+void testFlatTree(){
+    std::cout << "sizeof FlatNode=" << sizeof(FlatNode) << " AtomNode=" << sizeof(AtomNode)
+              << " UnaryOpNode=" << sizeof(UnaryOpNode) << " BinaryOpNode=" << sizeof(BinaryOpNode) << "\n";
+    for (std::string expression : {"x + a = b * c", "-(x - 2.50) / 3 ^ 2", "a * 123456789012345678901234 + 7/2 - -y", "((a))"}) {
+        std::unique_ptr<ASTNode> tree = Parser(std::make_unique<Lexer>(expression)).parse();
+        FlatTree flat = FlatTree::fromAst(tree.get());
+        std::cout << expression << " -> " << flat.toString() << " (" << flat.size() << " nodes)"
+                  << " text=" << (flat.toString() == tree->toString()) << " hash=" << (flat.hash() == tree->hash())
+                  << " toAst=" << (*flat.toAst() == *tree)
+                  << " fromTree=" << (FlatTree::fromTree(PersistentNode::freeze(tree.get())) == flat)
+                  << " toTree=" << (flat.toTree()->toString() == tree->toString()) << "\n";
+    }
+    FlatTree equation = FlatTree::fromAst(Parser(std::make_unique<Lexer>("(a * b + c * d) - (a + e) = 0")).parse().get());
+    FlatTree value = FlatTree::fromAst(Parser(std::make_unique<Lexer>("x + 1")).parse().get());
+    FlatTree substituted = equation.substitute("a", value);
+    std::unordered_set<std::string> vars;
+    int occurrences = substituted.collectVariables(vars);
+    std::cout << "substituted: " << substituted.toString() << ", " << vars.size() << " variables, " << occurrences << " occurrences\n";
+    std::cout << "same as PersistentNode::substitute: " << (substituted == FlatTree::fromTree(PersistentNode::substitute(
+        equation.toTree(), "a", value.toTree()))) << "\n";
+
+    // Balanced tree of 2^17 leaves, every pass on both forms
+    std::function<std::string(int, int &)> generate = [&](int depth, int &leaf) -> std::string {
+        if (depth == 0) {
+            leaf++;
+            return leaf % 3 == 0 ? std::to_string(leaf % 97 + 1) : "v" + std::to_string(leaf % 50);
+        }
+        static const char *ops[] = {" + ", " - ", " * ", " + "};
+        return "(" + generate(depth - 1, leaf) + ops[depth % 4] + generate(depth - 1, leaf) + ")";
+    };
+    int leaf = 0;
+    std::unique_ptr<ASTNode> big = Parser(std::make_unique<Lexer>(generate(17, leaf))).parse();
+    auto time = [](const std::string &name, auto &&fn) {
+        auto start = std::chrono::steady_clock::now();
+        auto result = fn();
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << name << ": " << us << "us\n";
+        return result;
+    };
+    FlatTree flat = time("FlatTree::fromAst", [&]() { return FlatTree::fromAst(big.get()); });
+    std::size_t astBytes = 0;
+    std::function<void(const ASTNode *)> measure = [&](const ASTNode *node) {
+        const std::string value = node->getToken().getValue();
+        astBytes += value.size() > 15 ? value.size() + 1 : 0;
+        if (node->getNodeType() == NodeType::BinaryOp) {
+            astBytes += sizeof(BinaryOpNode);
+            measure(static_cast<const BinaryOpNode *>(node)->getLeft());
+            measure(static_cast<const BinaryOpNode *>(node)->getRight());
+        } else if (node->getNodeType() == NodeType::UnaryOp) {
+            astBytes += sizeof(UnaryOpNode);
+            measure(static_cast<const UnaryOpNode *>(node)->getOperand());
+        } else {
+            astBytes += sizeof(AtomNode);
+        }
+    };
+    measure(big.get());
+    std::cout << flat.size() << " nodes, ASTNode " << astBytes / flat.size() << " bytes/node, FlatTree "
+              << flat.bytes() / flat.size() << " bytes/node\n";
+    std::size_t astHash = time("ASTNode::hash", [&]() { return big->hash(); });
+    std::size_t flatHash = time("FlatTree::hash", [&]() { return flat.hash(); });
+    std::string astText = time("ASTNode::toString", [&]() { return big->toString(); });
+    std::string flatText = time("FlatTree::toString", [&]() { return flat.toString(); });
+    Evaluation evaluation;
+    for (int i = 0; i < 50; i++) {
+        std::unique_ptr<ASTNode> assignment = Parser(std::make_unique<Lexer>("v" + std::to_string(i) + " = " + std::to_string(i % 7 + 1))).parse();
+        evaluation.assignment(assignment.get());
+    }
+    Rational astValue = time("Evaluation::evaluate(ASTNode)", [&]() { return evaluation.evaluate(big.get()); });
+    Rational flatValue = time("Evaluation::evaluate(FlatTree)", [&]() { return evaluation.evaluate(flat); });
+    std::unordered_set<std::string> flatVars;
+    time("EquationSolver::extractVariables", [&]() { return EquationSolver::dependencies("x", big).size(); });
+    time("FlatTree::collectVariables", [&]() { return flat.collectVariables(flatVars); });
+    std::cout << "same hash: " << (astHash == flatHash) << ", same text: " << (astText == flatText)
+              << ", same value: " << (astValue == flatValue) << " (" << flatValue.toString().substr(0, 20) << "...)\n";
+}
+
+void testDeepExpressions(){
+    // Built as text and parsed like any input, every pass walks them iteratively
+    const int terms = 500000;
+    auto time = [](const std::string &name, auto &&fn) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "  " << name << ": " << ms << "ms\n";
+    };
+    auto run = [&](const std::string &name, const std::string &equation) {
+        std::cout << name << " (" << equation.size() << " chars)\n";
+        std::unique_ptr<ASTNode> tree;
+        time("parse", [&]() { tree = Parser(std::make_unique<Lexer>(equation)).parse(); });
+        std::cout << "  " << ASTUtils::countNodes(tree) << " nodes\n";
+        std::unique_ptr<ASTNode> simplified = tree->clone();
+        time("simplify", [&]() { Simplifier::simplify(simplified); });
+        std::cout << "  simplified: " << Printer::print(simplified.get()) << "\n";
+        std::vector<std::unique_ptr<ASTNode>> equations;
+        equations.push_back(std::move(tree));
+        Tester solver;
+        SolveResult solution;
+        time("solve", [&]() { solution = solver.solve(equations, "x"); });
+        std::cout << "  solved: " << solution.answer() << "\n";
+    };
+
+    // Left-leaning chain, x at the bottom: x + 1 + 1 + ... = terms
+    std::string chain = "x";
+    for (int i = 1; i < terms; i++) {
+        chain += " + 1";
+    }
+    run("x + 1 + 1 + ...", chain + " = " + std::to_string(terms));
+
+    // Right-nested parentheses, x at the bottom: 1 + (1 + (1 + ... (1 + x)))
+    std::string nested;
+    for (int i = 1; i < terms; i++) {
+        nested += "1 + (";
+    }
+    nested += "x" + std::string(terms - 1, ')');
+    run("1 + (1 + (1 + ...))", nested + " = " + std::to_string(terms));
+
+    // A million signs on x, an even number of minuses
+    std::string signs;
+    for (int i = 0; i < 2 * terms; i++) {
+        signs += i % 3 == 0 ? "-" : "+";
+    }
+    run("- + + - ... x", signs + "x = 5");
+
+    // The same variable in every term: x + x + ... = 2 * terms
+    std::string repeated = "x";
+    for (int i = 1; i < terms; i++) {
+        repeated += " + x";
+    }
+    run("x + x + ...", repeated + " = " + std::to_string(2 * terms));
+
+    // The passes that take the tree as written, before any simplification
+    std::cout << "passes on x + 1 + 1 + ...\n";
+    std::string equation = chain + " = " + std::to_string(terms);
+    std::string derivative;
+    time("differentiate", [&]() { derivative = CasService::differentiate(chain, "x"); });
+    SparseJacobian jacobian;
+    time("jacobian", [&]() { jacobian = CasService::jacobian({equation}); });
+    std::vector<Rational> coefficients;
+    time("coefficients", [&]() {
+        PTree frozen = PersistentNode::freeze(Parser(std::make_unique<Lexer>(equation)).parse().get());
+        PolynomialSolver::coefficients(frozen, "x", coefficients);
+    });
+    std::cout << "  d/dx: " << derivative << ", jacobian at x = 3: " << jacobian.compiled.evaluate({3})[1]
+              << ", coefficients: " << coefficients.size() << "\n";
+
+    // Through the service with default options: nothing isolates x ^ x, so the polynomial
+    // pass and the Newton fallback run too
+    std::string power = "x ^ x";
+    for (int i = 0; i < terms; i++) {
+        power += " + 1";
+    }
+    std::cout << "x ^ x + 1 + 1 + ... (" << power.size() << " chars)\n";
+    SolveOutcome outcome;
+    time("service", [&]() { outcome = CasService::solve({power + " = " + std::to_string(terms + 4)}, "x"); });
+    std::cout << "  solved: '" << outcome.result << "' " << SolveMetrics::terminationName(outcome.metrics.termination)
+              << " numeric=" << outcome.metrics.numeric.reason << "\n";
 }
 
 int main (int argc, char *argv[]) {
@@ -314,6 +1322,27 @@ int main (int argc, char *argv[]) {
     // testCombineLikeTerms();
     // testDistributeMultiplyBinary();
     // testSocketClient();
+    // testResultCache();
+    // testWorkload();
+    // testStats();
+    // testBudget();
+    // testSolverOptions();
+    // testHttpServer();
+    // testRpcClient();
+    // testWorkerDispatcher();
+    // testSolveStream();
+    // testRational();
+    // testPrinter();
+    // testPersistentSubstitute();
+    // testMultiSubstitute();
+    // testExpressionDag();
+    // testSolverSession();
+    // testSolveAll();
+    // testDifferentiator();
+    // testNewtonFallback();
+    // testPolynomialRoots();
+    // testFlatTree();
+    // testDeepExpressions();
     
     testSolve();
     return 0;
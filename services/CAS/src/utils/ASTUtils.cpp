@@ -1,53 +1,73 @@
 #include "ASTUtils.h"
+#include "Stats.h"
+#include <vector>
 
-bool ASTUtils::containsVariable(std::unique_ptr<ASTNode>& node, const std::string& variable) {
-    if (node->getNodeType() == NodeType::Atom) {
-        AtomNode *atomNode = static_cast<AtomNode *>(node.get());
-        return atomNode->getToken().getType() == TokenType::VARIABLE && 
-               atomNode->getToken().getValue() == variable;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return ASTUtils::containsVariable(unaryNode->getOperandRef(), variable);
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        return ASTUtils::containsVariable(static_cast<BinaryOpNode *>(node.get())->getLeftRef(), variable) || 
-               ASTUtils::containsVariable(static_cast<BinaryOpNode *>(node.get())->getRightRef(), variable);
+namespace {
+    /*
+    * Calls visit on every node, parents before children and left before right,
+    * with an explicit stack so a deep tree cannot overflow the call stack
+    * visit returns false to stop the walk
+    */
+    template <typename Visit>
+    void walk(ASTNode *root, Visit visit) {
+        std::vector<ASTNode *> pending = {root};
+        while (!pending.empty()) {
+            ASTNode *node = pending.back();
+            pending.pop_back();
+            Stats::visit();
+            if (!visit(node)) {
+                return;
+            }
+            if (node->getNodeType() == NodeType::UnaryOp) {
+                pending.push_back(static_cast<UnaryOpNode *>(node)->getOperand());
+            } else if (node->getNodeType() == NodeType::BinaryOp) {
+                BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node);
+                pending.push_back(binaryNode->getRight());
+                pending.push_back(binaryNode->getLeft());
+            }
+        }
     }
-    return false;   
 }
 
-int ASTUtils::countVariableOccurrences(std::unique_ptr<ASTNode>& node) {
-    if (node->getNodeType() == NodeType::Atom) {
-        AtomNode *atomNode = static_cast<AtomNode *>(node.get());
-        return atomNode->getToken().getType() == TokenType::VARIABLE ? 1 : 0;
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        return ASTUtils::countVariableOccurrences(unaryNode->getOperandRef());
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        return ASTUtils::countVariableOccurrences(binaryNode->getLeftRef()) + 
-               ASTUtils::countVariableOccurrences(binaryNode->getRightRef());
-    }
-    return 0;   
+bool ASTUtils::containsVariable(std::unique_ptr<ASTNode>& node, const std::string& variable) {
+    bool found = false;
+    walk(node.get(), [&](ASTNode *n) {
+        if (n->getNodeType() == NodeType::Atom) {
+            const Token token = n->getToken();
+            found = token.getType() == TokenType::VARIABLE && token.getValue() == variable;
+        }
+        return !found;
+    });
+    return found;
 }
 
-void countDisinctVariableHelper(std::unique_ptr<ASTNode>& node, std::unordered_set<std::string>& varSet) {
-    if (node->getNodeType() == NodeType::Atom) {
-        AtomNode *atomNode = static_cast<AtomNode *>(node.get());
-        if (atomNode->getToken().getType() == TokenType::VARIABLE) {
-            varSet.insert(atomNode->getToken().getValue());
+int ASTUtils::countVariableOccurrences(std::unique_ptr<ASTNode>& node) {
+    int count = 0;
+    walk(node.get(), [&](ASTNode *n) {
+        if (n->getNodeType() == NodeType::Atom && n->getToken().getType() == TokenType::VARIABLE) {
+            count++;
         }
-    } else if (node->getNodeType() == NodeType::UnaryOp) {
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        countDisinctVariableHelper(unaryNode->getOperandRef(), varSet);
-    } else if (node->getNodeType() == NodeType::BinaryOp) {
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        countDisinctVariableHelper(binaryNode->getLeftRef(), varSet);
-        countDisinctVariableHelper(binaryNode->getRightRef(), varSet);
-    }
+        return true;
+    });
+    return count;
 }
 
 int ASTUtils::countDistinctVariables(std::unique_ptr<ASTNode>& node) {
     std::unordered_set<std::string> varSet;
-    countDisinctVariableHelper(node, varSet);
+    walk(node.get(), [&](ASTNode *n) {
+        if (n->getNodeType() == NodeType::Atom && n->getToken().getType() == TokenType::VARIABLE) {
+            varSet.insert(n->getToken().getValue());
+        }
+        return true;
+    });
     return varSet.size();
 }
+
+int ASTUtils::countNodes(std::unique_ptr<ASTNode>& node) {
+    int count = 0;
+    walk(node.get(), [&](ASTNode *) {
+        count++;
+        return true;
+    });
+    return count;
+}
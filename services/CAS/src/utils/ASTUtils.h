@@ -26,4 +26,10 @@ public:
     *   the distinct variables are x, y, z, so the count is 3.
     */
     static int countDistinctVariables(std::unique_ptr<ASTNode>& node);
+
+    /*
+    * Count every node of the AST
+    * For example, "x + 2*x" has 5 nodes: +, x, *, 2, x
+    */
+    static int countNodes(std::unique_ptr<ASTNode>& node);
 };
@@ -1,5 +1,8 @@
 #include "Debug.h"
 #include "Config.h"
+#include "ASTUtils.h"
+#include "../core/solver/SolveBudget.h"
+#include <chrono>
 
 std::string Debug::padRight(const std::string &s, size_t width) {
     if (s.size() >= width) return s.substr(0, width);
@@ -7,19 +10,22 @@ std::string Debug::padRight(const std::string &s, size_t width) {
 };
 
 void Debug::validateNode(const std::unique_ptr<ASTNode>& node, const std::string& name) {
-    if (node->getNodeType() == NodeType::Atom){
-        string val = node->toString();
-        if (val.find("-") != std::string::npos){
-            throw std::runtime_error("Validation failed in " + name + ": Atom node contains negative number: " + val);
+    std::vector<ASTNode *> pending = {node.get()};
+    while (!pending.empty()) {
+        ASTNode *current = pending.back();
+        pending.pop_back();
+        if (current->getNodeType() == NodeType::Atom){
+            string val = current->toString();
+            if (val.find("-") != std::string::npos){
+                throw std::runtime_error("Validation failed in " + name + ": Atom node contains negative number: " + val);
+            }
+        } else if (current->getNodeType() == NodeType::UnaryOp){
+            pending.push_back(static_cast<UnaryOpNode *>(current)->getOperand());
+        } else if (current->getNodeType() == NodeType::BinaryOp){
+            BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(current);
+            pending.push_back(binaryNode->getRight());
+            pending.push_back(binaryNode->getLeft());
         }
-    } else if (node->getNodeType() == NodeType::UnaryOp){
-        UnaryOpNode *unaryNode = static_cast<UnaryOpNode *>(node.get());
-        ASTNode *child = unaryNode->getOperand();
-        Debug::validateNode(unaryNode->getOperandRef(), name);
-    } else if (node->getNodeType() == NodeType::BinaryOp){
-        BinaryOpNode *binaryNode = static_cast<BinaryOpNode *>(node.get());
-        Debug::validateNode(binaryNode->getLeftRef(), name);
-        Debug::validateNode(binaryNode->getRightRef(), name);
     }
 }
 
@@ -27,13 +33,27 @@ bool Debug::executeSteps(std::unique_ptr<ASTNode>& node, bool debug, std::vector
     int iterations = 0;
     bool changed = false;
 
+    PipelineCounters &pipeline = Stats::pipeline(name);
+    for (auto &s : steps) {
+        s.counters = &Stats::rule(s.name);
+    }
+
     std::vector<Table::Col> cols = {
         {"Step", 40},
         {"Changed", 7},
         {"Node changed", 50},
     };
 
+    SolveBudget *budget = SolveBudget::current();
+
     do {
+        // Stop cooperatively, the caller reads the reason from the budget
+        if (budget && (
+            budget->interrupted() ||
+            (budget->maxNodes > 0 && budget->checkNodes(ASTUtils::countNodes(node)))
+        )) {
+            break;
+        }
         if (iterations > Config::MAX_ITERATIONS_CONVERGE_SOLVE){
             dbg(node->toString());
             throw std::runtime_error(name + " did not converge after maximum iterations.");
@@ -45,13 +65,28 @@ bool Debug::executeSteps(std::unique_ptr<ASTNode>& node, bool debug, std::vector
 
         // aggregate overall change
         for (auto &s : steps) {
+            std::uint64_t visitedBefore = Stats::visited();
+            auto start = std::chrono::steady_clock::now();
             s.result = s.func();
+            auto end = std::chrono::steady_clock::now();
+
+            Stats::add(s.counters->invocations, 1);
+            Stats::add(s.counters->fires, s.result ? 1 : 0);
+            Stats::add(s.counters->nanos, std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+            Stats::add(s.counters->nodesVisited, Stats::visited() - visitedBefore);
+
             changed |= s.result;
-            s.nodeStrAfter = node->toString();
+            if (debug) {
+                s.nodeStrAfter = node->toString();
+            }
             if (validate){
                 Debug::validateNode(node, s.name);
             }
         }
+        iterations++;
+
+        // The table is only for debugging, do not pay for it otherwise
+        if (!debug) continue;
 
         // build separator like: +-----+------+------+
         std::string separator = "+";
@@ -68,7 +103,7 @@ bool Debug::executeSteps(std::unique_ptr<ASTNode>& node, bool debug, std::vector
         header += "\n";
 
         std::ostringstream out;
-        out << "Iteration " << iterations << ":\n";
+        out << "Iteration " << iterations - 1 << ":\n";
         out << separator;
         out << header;
         out << separator;
@@ -96,10 +131,12 @@ bool Debug::executeSteps(std::unique_ptr<ASTNode>& node, bool debug, std::vector
         std::string table = out.str();
 
 
-        if (debug) dbg(table);  // send the table to your debug macro
-        iterations++;
+        dbg(table);  // send the table to your debug macro
 
     } while (changed);
 
+    Stats::add(pipeline.calls, 1);
+    Stats::add(pipeline.iterations, iterations);
+    Stats::max(pipeline.maxIterations, iterations);
     return iterations > 1;
 }
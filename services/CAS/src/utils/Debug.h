@@ -3,6 +3,7 @@
 #include <functional>
 #include <sstream>
 #include "../core/parser/Nodes.h"
+#include "Stats.h"
 
 
 using namespace std;
@@ -28,8 +29,10 @@ namespace Table {
         bool result;
         std::string nodeStrAfter;
         std::function<bool()> func;
+        // Resolved by executeSteps for the running thread
+        RuleCounters *counters;
 
-        Step(const std::string n, std::function<bool()> f) : name(n), func(std::move(f)), result(false), nodeStrAfter(""){}
+        Step(const std::string n, std::function<bool()> f) : name(n), func(std::move(f)), result(false), nodeStrAfter(""), counters(nullptr){}
     };
     struct Col { 
         std::string title;
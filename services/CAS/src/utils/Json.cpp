@@ -0,0 +1,266 @@
+#include "Json.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+const JsonValue *JsonValue::get(const std::string &key) const {
+    if (this->type != JsonType::Object) {
+        return nullptr;
+    }
+    for (const auto &[name, value] : this->object) {
+        if (name == key) {
+            return &value;
+        }
+    }
+    return nullptr;
+}
+
+namespace {
+
+class JsonParser {
+private:
+    const std::string &text;
+    size_t pos = 0;
+
+    [[noreturn]] void fail(const std::string &message) {
+        throw std::runtime_error("Invalid JSON at " + std::to_string(this->pos) + ": " + message);
+    }
+
+    void skipWhitespace() {
+        while (this->pos < this->text.size() &&
+               (text[pos] == ' ' || text[pos] == '\t' || text[pos] == '\n' || text[pos] == '\r')) {
+            this->pos++;
+        }
+    }
+
+    void expect(char c) {
+        this->skipWhitespace();
+        if (this->pos >= this->text.size() || this->text[this->pos] != c) {
+            this->fail(std::string("expected '") + c + "'");
+        }
+        this->pos++;
+    }
+
+    bool consumeLiteral(const char *literal) {
+        size_t length = std::char_traits<char>::length(literal);
+        if (this->text.compare(this->pos, length, literal) == 0) {
+            this->pos += length;
+            return true;
+        }
+        return false;
+    }
+
+    static void appendUtf8(std::string &out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    unsigned parseHex4() {
+        if (this->pos + 4 > this->text.size()) {
+            this->fail("truncated \\u escape");
+        }
+        unsigned code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = this->text[this->pos++];
+            code <<= 4;
+            if (c >= '0' && c <= '9') code |= c - '0';
+            else if (c >= 'a' && c <= 'f') code |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') code |= c - 'A' + 10;
+            else this->fail("bad \\u escape");
+        }
+        return code;
+    }
+
+    std::string parseString() {
+        this->expect('"');
+        std::string out;
+        while (true) {
+            if (this->pos >= this->text.size()) {
+                this->fail("unterminated string");
+            }
+            char c = this->text[this->pos++];
+            if (c == '"') {
+                return out;
+            }
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (this->pos >= this->text.size()) {
+                this->fail("unterminated escape");
+            }
+            char e = this->text[this->pos++];
+            switch (e) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    unsigned code = this->parseHex4();
+                    // Surrogate pair
+                    if (code >= 0xD800 && code < 0xDC00 && this->consumeLiteral("\\u")) {
+                        unsigned low = this->parseHex4();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    JsonParser::appendUtf8(out, code);
+                    break;
+                }
+                default: this->fail("bad escape");
+            }
+        }
+    }
+
+    JsonValue parseNumber() {
+        const char *start = this->text.c_str() + this->pos;
+        char *end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start) {
+            this->fail("expected a value");
+        }
+        this->pos += end - start;
+        JsonValue out;
+        out.type = JsonType::Number;
+        out.number = value;
+        return out;
+    }
+
+public:
+    JsonParser(const std::string &text) : text(text) {}
+
+    JsonValue parseValue(int depth = 0) {
+        if (depth > 64) {
+            this->fail("nested too deep");
+        }
+        this->skipWhitespace();
+        if (this->pos >= this->text.size()) {
+            this->fail("unexpected end");
+        }
+        JsonValue out;
+        char c = this->text[this->pos];
+        if (c == '{') {
+            this->pos++;
+            out.type = JsonType::Object;
+            this->skipWhitespace();
+            if (this->pos < this->text.size() && this->text[this->pos] == '}') {
+                this->pos++;
+                return out;
+            }
+            do {
+                std::string key = this->parseString();
+                this->expect(':');
+                out.object.emplace_back(std::move(key), this->parseValue(depth + 1));
+                this->skipWhitespace();
+            } while (this->pos < this->text.size() && this->text[this->pos] == ',' && ++this->pos);
+            this->expect('}');
+        } else if (c == '[') {
+            this->pos++;
+            out.type = JsonType::Array;
+            this->skipWhitespace();
+            if (this->pos < this->text.size() && this->text[this->pos] == ']') {
+                this->pos++;
+                return out;
+            }
+            do {
+                out.array.push_back(this->parseValue(depth + 1));
+                this->skipWhitespace();
+            } while (this->pos < this->text.size() && this->text[this->pos] == ',' && ++this->pos);
+            this->expect(']');
+        } else if (c == '"') {
+            out.type = JsonType::String;
+            out.string = this->parseString();
+        } else if (this->consumeLiteral("true")) {
+            out.type = JsonType::Bool;
+            out.boolean = true;
+        } else if (this->consumeLiteral("false")) {
+            out.type = JsonType::Bool;
+        } else if (this->consumeLiteral("null")) {
+            out.type = JsonType::Null;
+        } else {
+            out = this->parseNumber();
+        }
+        return out;
+    }
+
+    void expectEnd() {
+        this->skipWhitespace();
+        if (this->pos != this->text.size()) {
+            this->fail("trailing characters");
+        }
+    }
+};
+
+}
+
+JsonValue Json::parse(const std::string &text) {
+    JsonParser parser(text);
+    JsonValue value = parser.parseValue();
+    parser.expectEnd();
+    return value;
+}
+
+std::string Json::quote(const std::string &text) {
+    std::string out;
+    out.reserve(text.size() + 2);
+    out += '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char buffer[8];
+                    std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                    out += buffer;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+    return out;
+}
+
+std::string Json::quoteArray(const std::vector<std::string> &items) {
+    std::string out = "[";
+    for (size_t i = 0; i < items.size(); i++) {
+        if (i > 0) out += ", ";
+        out += Json::quote(items[i]);
+    }
+    out += "]";
+    return out;
+}
+
+std::string Json::number(double value) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    char buffer[32];
+    for (int precision = 15; precision <= 17; precision++) {
+        std::snprintf(buffer, sizeof(buffer), "%.*g", precision, value);
+        if (std::strtod(buffer, nullptr) == value) {
+            break;
+        }
+    }
+    return buffer;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+enum class JsonType {
+    Null,
+    Bool,
+    Number,
+    String,
+    Array,
+    Object,
+};
+
+/* Parsed JSON document, objects keep their key order */
+struct JsonValue {
+    JsonType type = JsonType::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string, JsonValue>> object;
+
+    /* Member of an object, nullptr when missing or not an object */
+    const JsonValue *get(const std::string &key) const;
+
+    bool isNull() const { return type == JsonType::Null; }
+    bool isString() const { return type == JsonType::String; }
+    bool isNumber() const { return type == JsonType::Number; }
+    bool isBool() const { return type == JsonType::Bool; }
+    bool isArray() const { return type == JsonType::Array; }
+    bool isObject() const { return type == JsonType::Object; }
+};
+
+/* Just enough JSON for the HTTP/RPC request and response bodies */
+class Json {
+public:
+    /* Throws std::runtime_error with the offset on malformed input */
+    static JsonValue parse(const std::string &text);
+
+    /* "a\"b" -> "\"a\\\"b\"", quotes included */
+    static std::string quote(const std::string &text);
+    /* ["a", "b"] -> "[\"a\", \"b\"]" */
+    static std::string quoteArray(const std::vector<std::string> &items);
+    /* Fewest digits that read back as value, e.g. 0.1 -> "0.1", null when not finite */
+    static std::string number(double value);
+};
@@ -0,0 +1,90 @@
+#include "Stats.h"
+#include <algorithm>
+#include <map>
+
+thread_local std::uint64_t Stats::visitCount = 0;
+
+std::mutex Stats::registryMutex;
+
+std::vector<std::shared_ptr<Stats::ThreadStats>> &Stats::registry() {
+    static std::vector<std::shared_ptr<ThreadStats>> blocks;
+    return blocks;
+}
+
+Stats::ThreadStats &Stats::local() {
+    thread_local std::shared_ptr<ThreadStats> block = [] {
+        auto created = std::make_shared<ThreadStats>();
+        std::lock_guard<std::mutex> lock(Stats::registryMutex);
+        Stats::registry().push_back(created);
+        return created;
+    }();
+    return *block;
+}
+
+RuleCounters &Stats::rule(const std::string &name) {
+    ThreadStats &stats = Stats::local();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    std::unique_ptr<RuleCounters> &counters = stats.rules[name];
+    if (!counters) {
+        counters = std::make_unique<RuleCounters>();
+    }
+    return *counters;
+}
+
+PipelineCounters &Stats::pipeline(const std::string &name) {
+    ThreadStats &stats = Stats::local();
+    std::lock_guard<std::mutex> lock(stats.mutex);
+    std::unique_ptr<PipelineCounters> &counters = stats.pipelines[name];
+    if (!counters) {
+        counters = std::make_unique<PipelineCounters>();
+    }
+    return *counters;
+}
+
+StatsSnapshot Stats::snapshot() {
+    std::map<std::string, RuleStats> rules;
+    std::map<std::string, PipelineStats> pipelines;
+
+    std::lock_guard<std::mutex> registryLock(Stats::registryMutex);
+    for (auto &block : Stats::registry()) {
+        ThreadStats &stats = *block;
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        for (auto &[name, c] : stats.rules) {
+            RuleStats &r = rules.emplace(name, RuleStats{name, 0, 0, 0, 0}).first->second;
+            r.invocations += c->invocations.load(std::memory_order_relaxed);
+            r.fires += c->fires.load(std::memory_order_relaxed);
+            r.nanos += c->nanos.load(std::memory_order_relaxed);
+            r.nodesVisited += c->nodesVisited.load(std::memory_order_relaxed);
+        }
+        for (auto &[name, c] : stats.pipelines) {
+            PipelineStats &p = pipelines.emplace(name, PipelineStats{name, 0, 0, 0}).first->second;
+            p.calls += c->calls.load(std::memory_order_relaxed);
+            p.iterations += c->iterations.load(std::memory_order_relaxed);
+            p.maxIterations = std::max(p.maxIterations, (std::uint64_t)c->maxIterations.load(std::memory_order_relaxed));
+        }
+    }
+
+    StatsSnapshot snapshot;
+    for (auto &[name, r] : rules) snapshot.rules.push_back(r);
+    for (auto &[name, p] : pipelines) snapshot.pipelines.push_back(p);
+    return snapshot;
+}
+
+void Stats::reset() {
+    std::lock_guard<std::mutex> registryLock(Stats::registryMutex);
+    for (auto &block : Stats::registry()) {
+        ThreadStats &stats = *block;
+        std::lock_guard<std::mutex> lock(stats.mutex);
+        for (auto &[name, c] : stats.rules) {
+            c->invocations.store(0, std::memory_order_relaxed);
+            c->fires.store(0, std::memory_order_relaxed);
+            c->nanos.store(0, std::memory_order_relaxed);
+            c->nodesVisited.store(0, std::memory_order_relaxed);
+        }
+        for (auto &[name, c] : stats.pipelines) {
+            c->calls.store(0, std::memory_order_relaxed);
+            c->iterations.store(0, std::memory_order_relaxed);
+            c->maxIterations.store(0, std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+* Counters are only written by the thread that owns them (load + store, no lock prefix)
+* and read by anyone through relaxed atomics, so recording stays cheap
+*/
+struct RuleCounters {
+    std::atomic<std::uint64_t> invocations{0};
+    std::atomic<std::uint64_t> fires{0};
+    std::atomic<std::uint64_t> nanos{0};
+    std::atomic<std::uint64_t> nodesVisited{0};
+};
+
+/* One per executeSteps user (Simplifier, Isolator) */
+struct PipelineCounters {
+    std::atomic<std::uint64_t> calls{0};
+    std::atomic<std::uint64_t> iterations{0};
+    std::atomic<std::uint64_t> maxIterations{0};
+};
+
+struct RuleStats {
+    std::string name;
+    std::uint64_t invocations;
+    std::uint64_t fires;
+    std::uint64_t nanos;
+    std::uint64_t nodesVisited;
+};
+
+struct PipelineStats {
+    std::string name;
+    std::uint64_t calls;
+    std::uint64_t iterations;
+    std::uint64_t maxIterations;
+};
+
+struct StatsSnapshot {
+    std::vector<RuleStats> rules;
+    std::vector<PipelineStats> pipelines;
+};
+
+class Stats {
+private:
+    struct ThreadStats {
+        // Guards the maps (insertions and snapshots), not the counters
+        std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<RuleCounters>> rules;
+        std::unordered_map<std::string, std::unique_ptr<PipelineCounters>> pipelines;
+    };
+
+    static ThreadStats &local();
+    // Thread blocks outlive their thread so their totals stay in the snapshot
+    static std::vector<std::shared_ptr<ThreadStats>> &registry();
+    static std::mutex registryMutex;
+    static thread_local std::uint64_t visitCount;
+
+public:
+    /* Counters of the calling thread, resolve once and keep the reference */
+    static RuleCounters &rule(const std::string &name);
+    static PipelineCounters &pipeline(const std::string &name);
+
+    static void add(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    static void max(std::atomic<std::uint64_t> &counter, std::uint64_t value) {
+        if (value > counter.load(std::memory_order_relaxed)) {
+            counter.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /* Called once per node by every traversal, executeSteps attributes the delta to the running rule */
+    static void visit() { visitCount++; }
+    static std::uint64_t visited() { return visitCount; }
+
+    /* Sum over every thread that ever recorded something, sorted by name */
+    static StatsSnapshot snapshot();
+    static void reset();
+};
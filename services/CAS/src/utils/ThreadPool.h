@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* Fixed set of workers draining a FIFO of tasks, joins on destruction */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    void workerLoop();
+public:
+    /* 0 threads -> std::thread::hardware_concurrency() */
+    ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /* Tasks must not throw, an escaping exception terminates the worker thread */
+    void submit(std::function<void()> task);
+
+    std::size_t size() const { return workers.size(); }
+    /* Tasks waiting for a worker */
+    std::size_t pending();
+};
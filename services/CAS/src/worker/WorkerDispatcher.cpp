@@ -0,0 +1,213 @@
+#include "WorkerDispatcher.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <climits>
+#include <spawn.h>
+#include <stdexcept>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../core/cache/ResultCache.h"
+
+extern char **environ;
+
+WorkerDispatcher::WorkerDispatcher(
+    const std::string &workerBinary,
+    std::size_t workers,
+    const std::string &socketDir,
+    int timeoutMs
+) : workerBinary(workerBinary), socketDir(socketDir), timeoutMs(timeoutMs), workers(std::max<std::size_t>(1, workers)) {
+    for (std::size_t i = 0; i < WorkerDispatcher::workers.size(); i++) {
+        WorkerDispatcher::workers[i].socketPath = socketDir + "/cas-worker-" +
+            std::to_string(getpid()) + "-" + std::to_string(i) + ".sock";
+    }
+}
+
+WorkerDispatcher::~WorkerDispatcher() {
+    WorkerDispatcher::stopping.store(true);
+    if (WorkerDispatcher::monitor.joinable()) {
+        WorkerDispatcher::monitor.join();
+    }
+    std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+    for (Worker &worker : WorkerDispatcher::workers) {
+        worker.pool.reset();
+        if (worker.pid > 0) {
+            kill(worker.pid, SIGTERM);
+            waitpid(worker.pid, nullptr, 0);
+        }
+        unlink(worker.socketPath.c_str());
+    }
+}
+
+std::string WorkerDispatcher::defaultWorkerBinary() {
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length <= 0) {
+        return "AlgebraSolverWorker";
+    }
+    std::string self(path, length);
+    return self.substr(0, self.rfind('/') + 1) + "AlgebraSolverWorker";
+}
+
+void WorkerDispatcher::start() {
+    {
+        std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+        for (std::size_t i = 0; i < WorkerDispatcher::workers.size(); i++) {
+            WorkerDispatcher::spawn(i);
+        }
+        for (std::size_t i = 0; i < WorkerDispatcher::workers.size(); i++) {
+            if (!WorkerDispatcher::waitReady(i, 5000)) {
+                throw std::runtime_error("Worker " + std::to_string(i) + " (" + WorkerDispatcher::workerBinary + ") did not start");
+            }
+        }
+    }
+    WorkerDispatcher::monitor = std::thread([this]() { WorkerDispatcher::monitorLoop(); });
+}
+
+void WorkerDispatcher::spawn(std::size_t index) {
+    Worker &worker = WorkerDispatcher::workers[index];
+    std::vector<std::string> args = {WorkerDispatcher::workerBinary, "--socket", worker.socketPath};
+    std::vector<char *> argv;
+    for (std::string &arg : args) {
+        argv.push_back(arg.data());
+    }
+    argv.push_back(nullptr);
+
+    pid_t pid;
+    if (posix_spawn(&pid, WorkerDispatcher::workerBinary.c_str(), nullptr, nullptr, argv.data(), environ) != 0) {
+        worker.pid = -1;
+        return;
+    }
+    worker.pid = pid;
+    // Old connections point at the dead process
+    worker.pool = std::make_shared<ConnectionPool>(
+        "unix:" + worker.socketPath, 0, 8, WorkerDispatcher::timeoutMs + 1000
+    );
+}
+
+bool WorkerDispatcher::waitReady(std::size_t index, int waitMs) {
+    Worker &worker = WorkerDispatcher::workers[index];
+    if (worker.pid <= 0) {
+        return false;
+    }
+    WorkerRequest ping;
+    std::string payload = WorkerProtocol::encodeRequest(ping);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(waitMs);
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::string response;
+        if (worker.pool->call(payload, response)) {
+            return true;
+        }
+        if (waitpid(worker.pid, nullptr, WNOHANG) == worker.pid) {
+            worker.pid = -1;
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+void WorkerDispatcher::restart(std::size_t index) {
+    Worker &worker = WorkerDispatcher::workers[index];
+    if (worker.pid > 0) {
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+    }
+    WorkerDispatcher::restarts++;
+    WorkerDispatcher::spawn(index);
+    WorkerDispatcher::waitReady(index, 5000);
+}
+
+bool WorkerDispatcher::reviveIfDead(std::size_t index, int graceMs) {
+    Worker &worker = WorkerDispatcher::workers[index];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(graceMs);
+    while (worker.pid > 0 && waitpid(worker.pid, nullptr, WNOHANG) == 0) {
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    worker.pid = -1;
+    WorkerDispatcher::restart(index);
+    return true;
+}
+
+void WorkerDispatcher::monitorLoop() {
+    while (!WorkerDispatcher::stopping.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+        for (std::size_t i = 0; i < WorkerDispatcher::workers.size() && !WorkerDispatcher::stopping.load(); i++) {
+            WorkerDispatcher::reviveIfDead(i);
+        }
+    }
+}
+
+pid_t WorkerDispatcher::workerPid(std::size_t index) {
+    std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+    return WorkerDispatcher::workers[index].pid;
+}
+
+std::string WorkerDispatcher::affinityKey(const WorkerRequest &request) {
+    if (request.op == WorkerOp::Simplify) {
+        return "simplify|" + request.expression;
+    }
+    if (request.op == WorkerOp::Differentiate) {
+        return "differentiate|" + request.expression + "|" + request.variable;
+    }
+    std::vector<std::string> equations = request.equations;
+    std::sort(equations.begin(), equations.end());
+    std::string key = request.op == WorkerOp::SolveAll ? "solve-all|" : request.op == WorkerOp::Jacobian ? "jacobian|" : "solve|";
+    for (std::size_t i = 0; i < equations.size(); i++) {
+        if (i > 0) key += ";";
+        key += equations[i];
+    }
+    return key + "|" + request.variable;
+}
+
+std::size_t WorkerDispatcher::workerFor(const WorkerRequest &request) const {
+    return ResultCache::hashKey(WorkerDispatcher::affinityKey(request)) % WorkerDispatcher::workers.size();
+}
+
+WorkerResponse WorkerDispatcher::call(WorkerRequest request) {
+    // The worker stops itself at the deadline, the socket waits a bit longer for the answer
+    if (request.timeoutMs == 0 && WorkerDispatcher::timeoutMs > 0) {
+        request.timeoutMs = static_cast<std::uint32_t>(WorkerDispatcher::timeoutMs);
+    }
+    std::size_t index = WorkerDispatcher::workerFor(request);
+    std::string payload = WorkerProtocol::encodeRequest(request);
+
+    WorkerResponse failure;
+    failure.ok = false;
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::shared_ptr<ConnectionPool> pool;
+        {
+            std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+            pool = WorkerDispatcher::workers[index].pool;
+        }
+        std::string response;
+        if (pool && pool->call(payload, response, &failure.error)) {
+            try {
+                return WorkerProtocol::decodeResponse(request.op, response);
+            } catch (const std::exception &e) {
+                failure.error = e.what();
+                return failure;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(WorkerDispatcher::mutex);
+        // Someone else already restarted it, just retry on the new pool
+        if (WorkerDispatcher::workers[index].pool != pool) {
+            continue;
+        }
+        // A crashed worker closes the socket slightly before it can be reaped
+        if (WorkerDispatcher::reviveIfDead(index, 200)) {
+            failure.error = "Worker " + std::to_string(index) + " crashed";
+            continue;
+        }
+        // Alive but past the deadline: wedged, replace it and give up on this request
+        WorkerDispatcher::restart(index);
+        failure.error = "Worker " + std::to_string(index) + " timed out: " + failure.error;
+        return failure;
+    }
+    return failure;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/types.h>
+#include "WorkerProtocol.h"
+#include "../network/ConnectionPool.h"
+
+/*
+* Runs N AlgebraSolverWorker processes, each on its own Unix domain socket, and
+* sends requests to them through pooled SocketClients.
+* The same system (or expression) always goes to the same worker so its ResultCache
+* gets the hits. A worker that dies (crash in the core) is restarted by a monitor
+* thread; a worker that overruns the request deadline is killed and restarted.
+*/
+class WorkerDispatcher {
+public:
+    WorkerDispatcher(
+        const std::string &workerBinary,
+        std::size_t workers,
+        const std::string &socketDir = "/tmp",
+        int timeoutMs = 30000
+    );
+    ~WorkerDispatcher();
+
+    WorkerDispatcher(const WorkerDispatcher &) = delete;
+    WorkerDispatcher &operator=(const WorkerDispatcher &) = delete;
+
+    /* Spawn every worker and wait until they answer a ping, throws if one does not */
+    void start();
+
+    /* Never throws, failures come back as ok = false */
+    WorkerResponse call(WorkerRequest request);
+
+    /*
+    * Equations are sorted so the order does not matter, e.g.,
+    * solve ["b = 4", "x+a = b"] for x -> "solve|b = 4;x+a = b|x", solve all of them -> "solve-all|b = 4;x+a = b|"
+    */
+    static std::string affinityKey(const WorkerRequest &request);
+    std::size_t workerFor(const WorkerRequest &request) const;
+
+    std::size_t size() const { return workers.size(); }
+    pid_t workerPid(std::size_t index);
+    std::size_t restartCount() const { return restarts.load(); }
+
+    /* AlgebraSolverWorker next to the running executable */
+    static std::string defaultWorkerBinary();
+
+private:
+    struct Worker {
+        pid_t pid = -1;
+        std::string socketPath;
+        std::shared_ptr<ConnectionPool> pool;
+    };
+
+    std::string workerBinary;
+    std::string socketDir;
+    int timeoutMs;
+
+    std::mutex mutex;
+    std::vector<Worker> workers;
+    std::atomic<std::size_t> restarts{0};
+
+    std::atomic<bool> stopping{false};
+    std::thread monitor;
+
+    /* Callers hold mutex */
+    void spawn(std::size_t index);
+    bool waitReady(std::size_t index, int waitMs);
+    /* Reap the worker if it exited (waiting up to graceMs) and start a new one, true if it was restarted */
+    bool reviveIfDead(std::size_t index, int graceMs = 0);
+    void restart(std::size_t index);
+    void monitorLoop();
+};
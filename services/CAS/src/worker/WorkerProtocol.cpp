@@ -0,0 +1,454 @@
+#include "WorkerProtocol.h"
+#include <cstring>
+#include <unistd.h>
+
+void ByteWriter::u32(std::uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        this->out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void ByteWriter::u64(std::uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        this->out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+void ByteWriter::f32(float value) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    this->u32(bits);
+}
+
+void ByteWriter::f64(double value) {
+    std::uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    this->u64(bits);
+}
+
+void ByteWriter::str(const std::string &value) {
+    this->u32(static_cast<std::uint32_t>(value.size()));
+    this->out += value;
+}
+
+void ByteReader::need(std::size_t bytes) {
+    if (this->in.size() - this->pos < bytes) {
+        throw std::runtime_error("Truncated worker message");
+    }
+}
+
+std::uint8_t ByteReader::u8() {
+    this->need(1);
+    return static_cast<std::uint8_t>(this->in[this->pos++]);
+}
+
+std::uint32_t ByteReader::u32() {
+    this->need(4);
+    std::uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= std::uint32_t(static_cast<std::uint8_t>(this->in[this->pos++])) << (8 * i);
+    }
+    return value;
+}
+
+std::uint64_t ByteReader::u64() {
+    this->need(8);
+    std::uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= std::uint64_t(static_cast<std::uint8_t>(this->in[this->pos++])) << (8 * i);
+    }
+    return value;
+}
+
+float ByteReader::f32() {
+    std::uint32_t bits = this->u32();
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+double ByteReader::f64() {
+    std::uint64_t bits = this->u64();
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+std::string ByteReader::str() {
+    std::uint32_t size = this->u32();
+    this->need(size);
+    std::string value = this->in.substr(this->pos, size);
+    this->pos += size;
+    return value;
+}
+
+std::string WorkerProtocol::encodeRequest(const WorkerRequest &request) {
+    ByteWriter writer;
+    writer.u8(static_cast<std::uint8_t>(request.op));
+    if (request.op == WorkerOp::Simplify) {
+        writer.str(request.expression);
+        writer.u32(request.timeoutMs);
+    } else if (request.op == WorkerOp::Solve) {
+        writer.u32(static_cast<std::uint32_t>(request.equations.size()));
+        for (const std::string &eq : request.equations) {
+            writer.str(eq);
+        }
+        writer.str(request.variable);
+        writer.u8(static_cast<std::uint8_t>(request.options.strategy));
+        writer.u8(static_cast<std::uint8_t>(request.options.priority));
+        writer.i32(request.options.beamWidth);
+        writer.i32(request.options.maxIterations);
+        writer.i32(request.options.maxIterationsWithoutImprovement);
+        writer.f32(request.options.expansionRatio);
+        writer.u8(request.options.recordSteps ? 1 : 0);
+        writer.u8(request.options.polynomialRoots ? 1 : 0);
+        const NewtonOptions &newton = request.options.newton;
+        writer.u8(request.options.numericFallback ? 1 : 0);
+        writer.u8(static_cast<std::uint8_t>(newton.method));
+        writer.i32(newton.maxIterations);
+        writer.f64(newton.tolerance);
+        writer.i32(newton.randomStarts);
+        writer.u64(newton.maxNodes);
+        writer.u32(static_cast<std::uint32_t>(newton.startingPoints.size()));
+        for (const auto &point : newton.startingPoints) {
+            writer.u32(static_cast<std::uint32_t>(point.size()));
+            for (const auto &[variable, value] : point) {
+                writer.str(variable);
+                writer.f64(value);
+            }
+        }
+        writer.u32(request.timeoutMs);
+    } else if (request.op == WorkerOp::SolveAll) {
+        writer.u32(static_cast<std::uint32_t>(request.equations.size()));
+        for (const std::string &eq : request.equations) {
+            writer.str(eq);
+        }
+        writer.u32(request.timeoutMs);
+    } else if (request.op == WorkerOp::Differentiate) {
+        writer.str(request.expression);
+        writer.str(request.variable);
+    } else if (request.op == WorkerOp::Jacobian) {
+        writer.u32(static_cast<std::uint32_t>(request.equations.size()));
+        for (const std::string &eq : request.equations) {
+            writer.str(eq);
+        }
+        writer.u32(static_cast<std::uint32_t>(request.variables.size()));
+        for (const std::string &variable : request.variables) {
+            writer.str(variable);
+        }
+        writer.u8(request.hasPoint ? 1 : 0);
+        writer.u32(static_cast<std::uint32_t>(request.point.size()));
+        for (double value : request.point) {
+            writer.f64(value);
+        }
+    }
+    return writer.take();
+}
+
+WorkerRequest WorkerProtocol::decodeRequest(const std::string &payload) {
+    ByteReader reader(payload);
+    WorkerRequest request;
+    std::uint8_t op = reader.u8();
+    if (op < static_cast<std::uint8_t>(WorkerOp::Ping) || op > static_cast<std::uint8_t>(WorkerOp::Jacobian)) {
+        throw std::runtime_error("Unknown worker op: " + std::to_string(op));
+    }
+    request.op = static_cast<WorkerOp>(op);
+    if (request.op == WorkerOp::Simplify) {
+        request.expression = reader.str();
+        request.timeoutMs = reader.u32();
+    } else if (request.op == WorkerOp::Solve) {
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            request.equations.push_back(reader.str());
+        }
+        request.variable = reader.str();
+        std::uint8_t strategy = reader.u8();
+        std::uint8_t priority = reader.u8();
+        if (strategy > static_cast<std::uint8_t>(SearchStrategy::BreadthFirst) ||
+            priority > static_cast<std::uint8_t>(PriorityFunction::Weighted)) {
+            throw std::runtime_error("Invalid solver options");
+        }
+        request.options.strategy = static_cast<SearchStrategy>(strategy);
+        request.options.priority = static_cast<PriorityFunction>(priority);
+        request.options.beamWidth = reader.i32();
+        request.options.maxIterations = reader.i32();
+        request.options.maxIterationsWithoutImprovement = reader.i32();
+        request.options.expansionRatio = reader.f32();
+        request.options.recordSteps = reader.u8() != 0;
+        request.options.polynomialRoots = reader.u8() != 0;
+        NewtonOptions &newton = request.options.newton;
+        request.options.numericFallback = reader.u8() != 0;
+        std::uint8_t method = reader.u8();
+        if (method > static_cast<std::uint8_t>(NewtonMethod::TrustRegion)) {
+            throw std::runtime_error("Invalid solver options");
+        }
+        newton.method = static_cast<NewtonMethod>(method);
+        newton.maxIterations = reader.i32();
+        newton.tolerance = reader.f64();
+        newton.randomStarts = reader.i32();
+        newton.maxNodes = static_cast<std::size_t>(reader.u64());
+        std::uint32_t points = reader.u32();
+        for (std::uint32_t i = 0; i < points; i++) {
+            std::unordered_map<std::string, double> &point = newton.startingPoints.emplace_back();
+            std::uint32_t size = reader.u32();
+            for (std::uint32_t j = 0; j < size; j++) {
+                std::string variable = reader.str();
+                point[variable] = reader.f64();
+            }
+        }
+        request.timeoutMs = reader.u32();
+    } else if (request.op == WorkerOp::SolveAll) {
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            request.equations.push_back(reader.str());
+        }
+        request.timeoutMs = reader.u32();
+    } else if (request.op == WorkerOp::Differentiate) {
+        request.expression = reader.str();
+        request.variable = reader.str();
+    } else if (request.op == WorkerOp::Jacobian) {
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            request.equations.push_back(reader.str());
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            request.variables.push_back(reader.str());
+        }
+        request.hasPoint = reader.u8() != 0;
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            request.point.push_back(reader.f64());
+        }
+    }
+    return request;
+}
+
+std::string WorkerProtocol::encodeResponse(WorkerOp op, const WorkerResponse &response) {
+    ByteWriter writer;
+    writer.u8(response.ok ? 1 : 0);
+    if (!response.ok) {
+        writer.str(response.error);
+        return writer.take();
+    }
+    if (op == WorkerOp::Ping) {
+        writer.u32(response.pid);
+    } else if (op == WorkerOp::Simplify) {
+        writer.str(response.simplify.simplified);
+        writer.str(response.simplify.status);
+        writer.u8(response.simplify.cached ? 1 : 0);
+    } else if (op == WorkerOp::Solve) {
+        const SolveOutcome &solve = response.solve;
+        writer.str(solve.result);
+        writer.u32(static_cast<std::uint32_t>(solve.steps.size()));
+        for (const std::string &step : solve.steps) {
+            writer.str(step);
+        }
+        writer.str(SolveMetrics::terminationName(solve.metrics.termination));
+        writer.u32(static_cast<std::uint32_t>(solve.metrics.iterations));
+        writer.u64(solve.metrics.totalNs);
+        writer.str(solve.status);
+        writer.u8(solve.cached ? 1 : 0);
+        const NumericReport &numeric = solve.metrics.numeric;
+        writer.u8(numeric.attempted ? 1 : 0);
+        writer.u8(numeric.converged ? 1 : 0);
+        writer.str(numeric.reason);
+        writer.str(numeric.answer);
+        writer.i32(numeric.starts);
+        writer.i32(numeric.iterations);
+        writer.i32(numeric.residualEvaluations);
+        writer.f64(numeric.residualNorm);
+        writer.f64(numeric.lastStep);
+        writer.u32(static_cast<std::uint32_t>(numeric.values.size()));
+        for (const auto &[variable, value] : numeric.values) {
+            writer.str(variable);
+            writer.f64(value);
+        }
+        writer.u64(numeric.totalNs);
+        const PolynomialReport &polynomial = solve.metrics.polynomial;
+        writer.u8(polynomial.attempted ? 1 : 0);
+        writer.i32(polynomial.degree);
+        writer.u32(static_cast<std::uint32_t>(polynomial.roots.size()));
+        for (const std::string &root : polynomial.roots) {
+            writer.str(root);
+        }
+        writer.str(polynomial.answer);
+        writer.u64(polynomial.totalNs);
+    } else if (op == WorkerOp::SolveAll) {
+        const SolveAllOutcome &solveAll = response.solveAll;
+        writer.u32(static_cast<std::uint32_t>(solveAll.variables.size()));
+        for (const auto &[variable, answer] : solveAll.variables) {
+            writer.str(variable);
+            writer.str(answer.status);
+            writer.str(answer.value);
+            writer.u32(static_cast<std::uint32_t>(answer.dependsOn.size()));
+            for (const std::string &free : answer.dependsOn) {
+                writer.str(free);
+            }
+        }
+        writer.u32(static_cast<std::uint32_t>(solveAll.inconsistentEquations.size()));
+        for (int equation : solveAll.inconsistentEquations) {
+            writer.i32(equation);
+        }
+        writer.i32(solveAll.redundantEquations);
+        writer.str(solveAll.status);
+    } else if (op == WorkerOp::Differentiate) {
+        writer.str(response.derivative);
+    } else if (op == WorkerOp::Jacobian) {
+        const JacobianOutcome &jacobian = response.jacobian;
+        writer.u32(static_cast<std::uint32_t>(jacobian.variables.size()));
+        for (const std::string &variable : jacobian.variables) {
+            writer.str(variable);
+        }
+        writer.u32(static_cast<std::uint32_t>(jacobian.rowStart.size()));
+        for (int start : jacobian.rowStart) {
+            writer.i32(start);
+        }
+        writer.u32(static_cast<std::uint32_t>(jacobian.columns.size()));
+        for (std::size_t entry = 0; entry < jacobian.columns.size(); entry++) {
+            writer.i32(jacobian.columns[entry]);
+            writer.str(jacobian.derivatives[entry]);
+        }
+        writer.u32(static_cast<std::uint32_t>(jacobian.residuals.size()));
+        for (double residual : jacobian.residuals) {
+            writer.f64(residual);
+        }
+        writer.u32(static_cast<std::uint32_t>(jacobian.values.size()));
+        for (double value : jacobian.values) {
+            writer.f64(value);
+        }
+    }
+    return writer.take();
+}
+
+WorkerResponse WorkerProtocol::decodeResponse(WorkerOp op, const std::string &payload) {
+    ByteReader reader(payload);
+    WorkerResponse response;
+    response.ok = reader.u8() != 0;
+    if (!response.ok) {
+        response.error = reader.str();
+        return response;
+    }
+    if (op == WorkerOp::Ping) {
+        response.pid = reader.u32();
+    } else if (op == WorkerOp::Simplify) {
+        response.simplify.simplified = reader.str();
+        response.simplify.status = reader.str();
+        response.simplify.cached = reader.u8() != 0;
+    } else if (op == WorkerOp::Solve) {
+        SolveOutcome &solve = response.solve;
+        solve.result = reader.str();
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            solve.steps.push_back(reader.str());
+        }
+        // Only the name travels, map it back for callers that switch on the enum
+        std::string termination = reader.str();
+        for (int reason = 0; reason <= static_cast<int>(TerminationReason::MemoryLimitExceeded); reason++) {
+            if (SolveMetrics::terminationName(static_cast<TerminationReason>(reason)) == termination) {
+                solve.metrics.termination = static_cast<TerminationReason>(reason);
+            }
+        }
+        solve.metrics.iterations = static_cast<int>(reader.u32());
+        solve.metrics.totalNs = reader.u64();
+        solve.status = reader.str();
+        solve.cached = reader.u8() != 0;
+        NumericReport &numeric = solve.metrics.numeric;
+        numeric.attempted = reader.u8() != 0;
+        numeric.converged = reader.u8() != 0;
+        numeric.reason = reader.str();
+        numeric.answer = reader.str();
+        numeric.starts = reader.i32();
+        numeric.iterations = reader.i32();
+        numeric.residualEvaluations = reader.i32();
+        numeric.residualNorm = reader.f64();
+        numeric.lastStep = reader.f64();
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            std::string variable = reader.str();
+            numeric.values[variable] = reader.f64();
+        }
+        numeric.totalNs = reader.u64();
+        PolynomialReport &polynomial = solve.metrics.polynomial;
+        polynomial.attempted = reader.u8() != 0;
+        polynomial.degree = reader.i32();
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            polynomial.roots.push_back(reader.str());
+        }
+        polynomial.answer = reader.str();
+        polynomial.totalNs = reader.u64();
+    } else if (op == WorkerOp::SolveAll) {
+        SolveAllOutcome &solveAll = response.solveAll;
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            VariableAnswer &answer = solveAll.variables[reader.str()];
+            answer.status = reader.str();
+            answer.value = reader.str();
+            std::uint32_t free = reader.u32();
+            for (std::uint32_t j = 0; j < free; j++) {
+                answer.dependsOn.push_back(reader.str());
+            }
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            solveAll.inconsistentEquations.push_back(reader.i32());
+        }
+        solveAll.redundantEquations = reader.i32();
+        solveAll.status = reader.str();
+    } else if (op == WorkerOp::Differentiate) {
+        response.derivative = reader.str();
+    } else if (op == WorkerOp::Jacobian) {
+        JacobianOutcome &jacobian = response.jacobian;
+        std::uint32_t count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            jacobian.variables.push_back(reader.str());
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            jacobian.rowStart.push_back(reader.i32());
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            jacobian.columns.push_back(reader.i32());
+            jacobian.derivatives.push_back(reader.str());
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            jacobian.residuals.push_back(reader.f64());
+        }
+        count = reader.u32();
+        for (std::uint32_t i = 0; i < count; i++) {
+            jacobian.values.push_back(reader.f64());
+        }
+    }
+    return response;
+}
+
+WorkerResponse WorkerProtocol::execute(const WorkerRequest &request) {
+    WorkerResponse response;
+    try {
+        SolveBudget budget;
+        budget.timeoutMs = request.timeoutMs;
+        SolveBudget *budgetPtr = request.timeoutMs > 0 ? &budget : nullptr;
+        if (request.op == WorkerOp::Ping) {
+            response.pid = static_cast<std::uint32_t>(getpid());
+        } else if (request.op == WorkerOp::Simplify) {
+            response.simplify = CasService::simplify(request.expression, budgetPtr);
+        } else if (request.op == WorkerOp::Solve) {
+            response.solve = CasService::solve(request.equations, request.variable, request.options, budgetPtr);
+        } else if (request.op == WorkerOp::SolveAll) {
+            response.solveAll = CasService::solveAll(request.equations, budgetPtr);
+        } else if (request.op == WorkerOp::Differentiate) {
+            response.derivative = CasService::differentiate(request.expression, request.variable);
+        } else if (request.op == WorkerOp::Jacobian) {
+            response.jacobian = CasService::evaluateJacobian(
+                request.equations, request.variables, request.hasPoint ? &request.point : nullptr
+            );
+        }
+    } catch (const std::exception &e) {
+        response.ok = false;
+        response.error = e.what();
+    }
+    return response;
+}
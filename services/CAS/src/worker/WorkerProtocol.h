@@ -0,0 +1,114 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../core/solver/SolverOptions.h"
+#include "../service/CasService.h"
+
+/*
+* Binary payloads exchanged with AlgebraSolverWorker, one per frame (see Framing)
+* Integers are little-endian, strings are a u32 length followed by the bytes.
+*
+* Request:  u8 op, then
+*   Ping:     -
+*   Simplify: str expression, u32 timeoutMs
+*   Solve:    u32 n, n x str equation, str variable, options, u32 timeoutMs
+*             options = u8 strategy, u8 priority, i32 beamWidth, i32 maxIterations,
+*                       i32 maxIterationsWithoutImprovement, f32 expansionRatio, u8 recordSteps, u8 polynomialRoots, newton
+*             newton = u8 numericFallback, u8 method, i32 maxIterations, f64 tolerance, i32 randomStarts,
+*                      u64 maxNodes, u32 p, p x (u32 m, m x (str variable, f64 value)) startingPoints
+*   SolveAll: u32 n, n x str equation, u32 timeoutMs
+*   Differentiate: str expression, str variable
+*   Jacobian: u32 n, n x str equation, u32 m, m x str variable, u8 hasPoint, u32 k, k x f64 point
+* Response: u8 ok, then
+*   error:    str message
+*   Ping:     u32 pid
+*   Simplify: str simplified, str status, u8 cached
+*   Solve:    str result, u32 n, n x str step, str termination, u32 iterations, u64 totalNs, str status, u8 cached,
+*             numeric = u8 attempted, u8 converged, str reason, str answer, i32 starts, i32 iterations,
+*                       i32 residualEvaluations, f64 residualNorm, f64 lastStep, u32 v, v x (str variable, f64 value), u64 totalNs,
+*             polynomial = u8 attempted, i32 degree, u32 r, r x str root, str answer, u64 totalNs
+*   SolveAll: u32 n, n x (str variable, str status, str value, u32 m, m x str dependsOn),
+*             u32 k, k x i32 inconsistent equation, i32 redundantEquations, str status
+*   Differentiate: str derivative
+*   Jacobian: u32 n, n x str variable, u32 r, r x i32 rowStart, u32 e, e x (i32 column, str derivative),
+*             u32 p, p x f64 residual, u32 q, q x f64 value
+*/
+enum class WorkerOp : std::uint8_t {
+    Ping = 1,
+    Simplify = 2,
+    Solve = 3,
+    SolveAll = 4,
+    Differentiate = 5,
+    Jacobian = 6,
+};
+
+struct WorkerRequest {
+    WorkerOp op = WorkerOp::Ping;
+    std::string expression;
+    std::vector<std::string> equations;
+    std::string variable;
+    SolverOptions options;
+    // Jacobian columns, empty for every variable
+    std::vector<std::string> variables;
+    bool hasPoint = false;
+    std::vector<double> point;
+    // 0 means no deadline
+    std::uint32_t timeoutMs = 0;
+};
+
+struct WorkerResponse {
+    bool ok = true;
+    std::string error;
+    std::uint32_t pid = 0;
+    SimplifyOutcome simplify;
+    SolveOutcome solve;
+    SolveAllOutcome solveAll;
+    std::string derivative;
+    JacobianOutcome jacobian;
+};
+
+class ByteWriter {
+private:
+    std::string out;
+public:
+    void u8(std::uint8_t value) { out += static_cast<char>(value); }
+    void u32(std::uint32_t value);
+    void u64(std::uint64_t value);
+    void i32(std::int32_t value) { u32(static_cast<std::uint32_t>(value)); }
+    void f32(float value);
+    void f64(double value);
+    void str(const std::string &value);
+    std::string take() { return std::move(out); }
+};
+
+/* Throws std::runtime_error when reading past the end */
+class ByteReader {
+private:
+    const std::string &in;
+    std::size_t pos = 0;
+    void need(std::size_t bytes);
+public:
+    ByteReader(const std::string &in) : in(in) {}
+    std::uint8_t u8();
+    std::uint32_t u32();
+    std::uint64_t u64();
+    std::int32_t i32() { return static_cast<std::int32_t>(u32()); }
+    float f32();
+    double f64();
+    std::string str();
+};
+
+class WorkerProtocol {
+public:
+    static std::string encodeRequest(const WorkerRequest &request);
+    static WorkerRequest decodeRequest(const std::string &payload);
+
+    /* The op is not on the wire, the caller knows what it asked for */
+    static std::string encodeResponse(WorkerOp op, const WorkerResponse &response);
+    static WorkerResponse decodeResponse(WorkerOp op, const std::string &payload);
+
+    /* Run the request in this process (the worker side) */
+    static WorkerResponse execute(const WorkerRequest &request);
+};
@@ -0,0 +1,99 @@
+#include "WorkerProtocol.h"
+#include "../network/Framing.h"
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* One thread per connection, requests on a connection are answered in order */
+static void serveConnection(int fd) {
+    FrameDecoder decoder;
+    char buffer[64 * 1024];
+    ssize_t n;
+    while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+        decoder.feed(buffer, n);
+        if (decoder.failed()) {
+            break;
+        }
+        while (decoder.hasFrame()) {
+            std::string frame = decoder.pop();
+            WorkerOp op = WorkerOp::Ping;
+            WorkerResponse response;
+            try {
+                WorkerRequest request = WorkerProtocol::decodeRequest(frame);
+                op = request.op;
+                response = WorkerProtocol::execute(request);
+            } catch (const std::exception &e) {
+                response.ok = false;
+                response.error = e.what();
+            }
+            std::string reply = Framing::encode(WorkerProtocol::encodeResponse(op, response));
+            size_t sent = 0;
+            while (sent < reply.size()) {
+                ssize_t written = send(fd, reply.data() + sent, reply.size() - sent, MSG_NOSIGNAL);
+                if (written <= 0) {
+                    close(fd);
+                    return;
+                }
+                sent += written;
+            }
+        }
+    }
+    close(fd);
+}
+
+int main(int argc, char *argv[]) {
+    std::string socketPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " --socket <path>\n";
+            std::cout << "Serves simplify/solve requests (see WorkerProtocol.h) on a Unix domain socket\n";
+            return 0;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+    if (socketPath.empty()) {
+        std::cerr << "--socket is required\n";
+        return 1;
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << socketPath << "\n";
+        return 1;
+    }
+    std::memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    // A previous worker in this slot may have crashed and left the file behind
+    unlink(socketPath.c_str());
+    if (listenFd < 0 ||
+        bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+        listen(listenFd, SOMAXCONN) < 0) {
+        std::cerr << "Error listening on " << socketPath << ": " << strerror(errno) << "\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN);
+    // Do not outlive the dispatcher if it is killed without cleaning up
+    prctl(PR_SET_PDEATHSIG, SIGTERM);
+
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "accept failed: " << strerror(errno) << "\n";
+            return 1;
+        }
+        std::thread(serveConnection, fd).detach();
+    }
+}
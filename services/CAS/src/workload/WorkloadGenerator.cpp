@@ -0,0 +1,225 @@
+#include "WorkloadGenerator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+
+// std distributions are implementation defined, these keep the
+// output identical across standard libraries for the same seed
+static long long randInt(std::mt19937_64 &rng, long long lo, long long hi) {
+    return lo + static_cast<long long>(rng() % static_cast<std::uint64_t>(hi - lo + 1));
+}
+
+static long long randNonZero(std::mt19937_64 &rng, long long maxAbs) {
+    long long value = randInt(rng, 1, maxAbs);
+    return (rng() & 1) ? value : -value;
+}
+
+static void shuffle(std::vector<std::string> &items, std::mt19937_64 &rng) {
+    for (size_t i = items.size(); i > 1; i--) {
+        size_t j = static_cast<size_t>(randInt(rng, 0, static_cast<long long>(i) - 1));
+        std::swap(items[i - 1], items[j]);
+    }
+}
+
+static std::string var(const std::string &prefix, int index) {
+    return prefix + std::to_string(index);
+}
+
+// " + 3*x1" or " - 3*x1", the first term keeps a leading unary minus
+static void appendTerm(std::string &out, long long coeff, const std::string &name, bool first) {
+    if (first) {
+        if (coeff < 0) out += "-";
+    } else {
+        out += coeff < 0 ? " - " : " + ";
+    }
+    long long absCoeff = coeff < 0 ? -coeff : coeff;
+    if (absCoeff != 1) {
+        out += std::to_string(absCoeff) + "*";
+    }
+    out += name;
+}
+
+std::vector<std::unique_ptr<ASTNode>> Workload::parse() const {
+    std::vector<std::unique_ptr<ASTNode>> parsed;
+    parsed.reserve(Workload::equations.size());
+    for (const std::string &eq : Workload::equations) {
+        Parser parser(std::make_unique<Lexer>(eq));
+        parsed.push_back(parser.parse());
+    }
+    return parsed;
+}
+
+Workload WorkloadGenerator::linearChain(int size, std::mt19937_64 &rng) {
+    Workload workload;
+    long long value = randInt(rng, -9, 9);
+    workload.solution[var("x", 0)] = value;
+    workload.equations.push_back(var("x", 0) + " = " + std::to_string(value));
+
+    for (int i = 1; i < size; i++) {
+        long long step = randNonZero(rng, 9);
+        value += step;
+        workload.solution[var("x", i)] = value;
+
+        std::string absStep = std::to_string(step < 0 ? -step : step);
+        if (rng() & 1) {
+            // x2 = x1 + 3
+            workload.equations.push_back(
+                var("x", i) + " = " + var("x", i - 1) + (step < 0 ? " - " : " + ") + absStep
+            );
+        } else {
+            // x2 - 3 = x1
+            workload.equations.push_back(
+                var("x", i) + (step < 0 ? " + " : " - ") + absStep + " = " + var("x", i - 1)
+            );
+        }
+    }
+    workload.target = var("x", size - 1);
+    shuffle(workload.equations, rng);
+    return workload;
+}
+
+Workload WorkloadGenerator::sparseBanded(int size, int bandwidth, std::mt19937_64 &rng) {
+    Workload workload;
+    std::vector<long long> values(size);
+    for (int j = 0; j < size; j++) {
+        values[j] = randInt(rng, -9, 9);
+        workload.solution[var("x", j)] = values[j];
+    }
+
+    for (int i = 0; i < size; i++) {
+        int from = std::max(0, i - bandwidth);
+        int to = std::min(size - 1, i + bandwidth);
+
+        std::vector<long long> coeffs(to - from + 1);
+        long long offDiagonal = 0;
+        for (int j = from; j <= to; j++) {
+            if (j == i) continue;
+            coeffs[j - from] = randNonZero(rng, 5);
+            offDiagonal += std::abs(coeffs[j - from]);
+        }
+        // Strict diagonal dominance keeps the system non singular
+        coeffs[i - from] = (offDiagonal + randInt(rng, 1, 5)) * ((rng() & 1) ? 1 : -1);
+
+        std::string eq;
+        long long rhs = 0;
+        for (int j = from; j <= to; j++) {
+            appendTerm(eq, coeffs[j - from], var("x", j), j == from);
+            rhs += coeffs[j - from] * values[j];
+        }
+        eq += " = " + std::to_string(rhs);
+        workload.equations.push_back(eq);
+    }
+    workload.target = var("x", 0);
+    shuffle(workload.equations, rng);
+    return workload;
+}
+
+Workload WorkloadGenerator::denseLinear(int size, std::mt19937_64 &rng) {
+    // Dense is banded with a band covering the whole matrix
+    return WorkloadGenerator::sparseBanded(size, size, rng);
+}
+
+Workload WorkloadGenerator::deepNested(int depth, std::mt19937_64 &rng) {
+    Workload workload;
+    long long value = randInt(rng, -9, 9);
+    workload.solution["x"] = value;
+
+    // Level k wraps level k - 1, so opening parts are emitted outermost first
+    std::vector<std::string> prefixes;
+    std::vector<std::string> suffixes;
+    prefixes.reserve(depth);
+    suffixes.reserve(depth);
+    for (int k = 0; k < depth; k++) {
+        long long c = randInt(rng, 1, 9);
+        switch (randInt(rng, 0, 3)) {
+            case 0: // (e + c)
+                prefixes.push_back("(");
+                suffixes.push_back(" + " + std::to_string(c) + ")");
+                value += c;
+                break;
+            case 1: // (e - c)
+                prefixes.push_back("(");
+                suffixes.push_back(" - " + std::to_string(c) + ")");
+                value -= c;
+                break;
+            case 2: // (c - e)
+                prefixes.push_back("(" + std::to_string(c) + " - ");
+                suffixes.push_back(")");
+                value = c - value;
+                break;
+            default: // -(e)
+                prefixes.push_back("-(");
+                suffixes.push_back(")");
+                value = -value;
+                break;
+        }
+    }
+
+    std::string expr = "y = ";
+    for (int k = depth - 1; k >= 0; k--) expr += prefixes[k];
+    expr += "x";
+    for (int k = 0; k < depth; k++) expr += suffixes[k];
+
+    workload.solution["y"] = value;
+    workload.equations.push_back(expr);
+    workload.equations.push_back("x = " + std::to_string(workload.solution["x"]));
+    workload.target = "y";
+    return workload;
+}
+
+Workload WorkloadGenerator::likeTerms(int terms, std::mt19937_64 &rng) {
+    Workload workload;
+    long long x = randInt(rng, -9, 9);
+    long long constant = randInt(rng, -9, 9);
+    long long total = constant;
+
+    std::string expr = "y = ";
+    for (int i = 0; i < terms; i++) {
+        long long coeff = randNonZero(rng, 9);
+        appendTerm(expr, coeff, "x", i == 0);
+        total += coeff * x;
+    }
+    expr += (constant < 0 ? " - " : " + ") + std::to_string(constant < 0 ? -constant : constant);
+
+    workload.solution["x"] = x;
+    workload.solution["y"] = total;
+    workload.equations.push_back(expr);
+    workload.equations.push_back("x = " + std::to_string(x));
+    workload.target = "y";
+    return workload;
+}
+
+Workload WorkloadGenerator::generate(const WorkloadSpec &spec) {
+    if (spec.size < 1) {
+        throw std::runtime_error("Workload size must be at least 1");
+    }
+    std::mt19937_64 rng(spec.seed);
+    switch (spec.kind) {
+        case WorkloadKind::LinearChain: return WorkloadGenerator::linearChain(spec.size, rng);
+        case WorkloadKind::DenseLinear: return WorkloadGenerator::denseLinear(spec.size, rng);
+        case WorkloadKind::SparseBanded: return WorkloadGenerator::sparseBanded(spec.size, spec.bandwidth, rng);
+        case WorkloadKind::DeepNested: return WorkloadGenerator::deepNested(spec.size, rng);
+        case WorkloadKind::LikeTerms: return WorkloadGenerator::likeTerms(spec.size, rng);
+        default: throw std::runtime_error("Unknown workload kind");
+    }
+}
+
+WorkloadKind WorkloadGenerator::parseKind(const std::string &name) {
+    if (name == "chain") return WorkloadKind::LinearChain;
+    if (name == "dense") return WorkloadKind::DenseLinear;
+    if (name == "banded") return WorkloadKind::SparseBanded;
+    if (name == "nested") return WorkloadKind::DeepNested;
+    if (name == "liketerms") return WorkloadKind::LikeTerms;
+    throw std::runtime_error("Unknown workload kind: " + name);
+}
+
+std::string WorkloadGenerator::kindName(WorkloadKind kind) {
+    switch (kind) {
+        case WorkloadKind::LinearChain: return "chain";
+        case WorkloadKind::DenseLinear: return "dense";
+        case WorkloadKind::SparseBanded: return "banded";
+        case WorkloadKind::DeepNested: return "nested";
+        case WorkloadKind::LikeTerms: return "liketerms";
+        default: throw std::runtime_error("Unknown workload kind");
+    }
+}
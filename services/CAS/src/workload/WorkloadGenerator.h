@@ -0,0 +1,65 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../core/parser/Parser.h"
+
+enum class WorkloadKind {
+    LinearChain,
+    DenseLinear,
+    SparseBanded,
+    DeepNested,
+    LikeTerms,
+};
+
+struct WorkloadSpec {
+    WorkloadKind kind = WorkloadKind::LinearChain;
+    // Equations for chain/dense/banded, nesting depth for nested, terms for like terms
+    int size = 10;
+    // Variables on each side of the diagonal, banded systems only
+    int bandwidth = 2;
+    std::uint64_t seed = 1;
+};
+
+struct Workload {
+    std::vector<std::string> equations;
+    std::string target;
+    // Ground truth for every variable of the system, all values are integers
+    std::map<std::string, long long> solution;
+
+    long long expected() const { return solution.at(target); }
+
+    /* Parse into ASTs ready for EquationSolver::solve */
+    std::vector<std::unique_ptr<ASTNode>> parse() const;
+};
+
+/*
+* Reproducible equation systems with a known answer
+* Same spec (including seed) -> same equations, on every platform
+*/
+class WorkloadGenerator {
+protected:
+    /* x0 = v, x1 = x0 + c1, ..., solve for the last one */
+    static Workload linearChain(int size, std::mt19937_64 &rng);
+
+    /* Every equation uses every variable, diagonally dominant so it is never singular */
+    static Workload denseLinear(int size, std::mt19937_64 &rng);
+
+    /* Equation i only uses x(i-bandwidth) .. x(i+bandwidth) */
+    static Workload sparseBanded(int size, int bandwidth, std::mt19937_64 &rng);
+
+    /* y = (((x + c1) - c2) ...) nested depth times, x = v */
+    static Workload deepNested(int depth, std::mt19937_64 &rng);
+
+    /* y = c1*x + c2*x - ... + k with terms like terms, x = v */
+    static Workload likeTerms(int terms, std::mt19937_64 &rng);
+
+public:
+    static Workload generate(const WorkloadSpec &spec);
+
+    static WorkloadKind parseKind(const std::string &name);
+    static std::string kindName(WorkloadKind kind);
+};
@@ -0,0 +1,108 @@
+#include "WorkloadGenerator.h"
+#include "../core/solver/EquationSolver.h"
+#include <chrono>
+#include <iostream>
+
+static void printText(const Workload &workload) {
+    for (const std::string &eq : workload.equations) {
+        std::cout << eq << "\n";
+    }
+    std::cout << "# target: " << workload.target << "\n";
+    std::cout << "# expected: " << workload.expected() << "\n";
+}
+
+static void printJson(const Workload &workload, const WorkloadSpec &spec) {
+    std::cout << "{\"kind\": \"" << WorkloadGenerator::kindName(spec.kind) << "\""
+              << ", \"size\": " << spec.size
+              << ", \"seed\": " << spec.seed
+              << ", \"target\": \"" << workload.target << "\""
+              << ", \"expected\": " << workload.expected()
+              << ", \"equations\": [";
+    for (size_t i = 0; i < workload.equations.size(); i++) {
+        std::cout << (i > 0 ? ", " : "") << "\"" << workload.equations[i] << "\"";
+    }
+    std::cout << "], \"solution\": {";
+    bool first = true;
+    for (const auto &[name, value] : workload.solution) {
+        std::cout << (first ? "" : ", ") << "\"" << name << "\": " << value;
+        first = false;
+    }
+    std::cout << "}}\n";
+}
+
+/* Feed the ASTs straight into the solver and check against the ground truth */
+static int solveAndCheck(const Workload &workload, const SolverOptions &options) {
+    std::vector<std::unique_ptr<ASTNode>> equations = workload.parse();
+    EquationSolver solver;
+
+    auto start = std::chrono::steady_clock::now();
+    SolveResult solution = solver.solve(equations, workload.target, options);
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+    if (!solution.result) {
+        std::cerr << "solve: no solution (" << SolveMetrics::terminationName(solution.metrics.termination)
+                  << ") after " << ms << " ms, " << solution.metrics.iterations << " iterations\n";
+        return 1;
+    }
+    Evaluation evaluation;
+    Rational value = evaluation.evaluate(static_cast<BinaryOpNode *>(solution.result.get())->getRight());
+    bool correct = value == Rational(workload.expected());
+    std::cerr << "solve: " << solution.result->toString() << " in " << ms << " ms, "
+              << (correct ? "correct" : "WRONG, expected " + std::to_string(workload.expected())) << "\n";
+    return correct ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    WorkloadSpec spec;
+    SolverOptions options;
+    std::string format = "text";
+    bool solve = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: " << argv[0] << " [options]\n";
+            std::cout << "Options:\n";
+            std::cout << "  --kind <chain|dense|banded|nested|liketerms>   Workload shape (default chain)\n";
+            std::cout << "  --size <n>                 Equations, nesting depth or number of terms (default 10)\n";
+            std::cout << "  --bandwidth <k>            Band half-width for banded systems (default 2)\n";
+            std::cout << "  --seed <s>                 Random seed (default 1)\n";
+            std::cout << "  --format <text|json>       Output format (default text)\n";
+            std::cout << "  --solve                    Also solve it and check against the ground truth\n";
+            std::cout << "  --strategy <best_first|beam|bfs>              Search strategy for --solve\n";
+            std::cout << "  --priority <distinct|occurrences|weighted>    Priority function for --solve\n";
+            std::cout << "  --beam-width <k>           Open states kept by the beam (default 16)\n";
+            return 0;
+        } else if (arg == "--kind" && i + 1 < argc) {
+            spec.kind = WorkloadGenerator::parseKind(argv[++i]);
+        } else if (arg == "--size" && i + 1 < argc) {
+            spec.size = std::stoi(argv[++i]);
+        } else if (arg == "--bandwidth" && i + 1 < argc) {
+            spec.bandwidth = std::stoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            spec.seed = std::stoull(argv[++i]);
+        } else if (arg == "--format" && i + 1 < argc) {
+            format = argv[++i];
+        } else if (arg == "--solve") {
+            solve = true;
+        } else if (arg == "--strategy" && i + 1 < argc) {
+            options.strategy = SolverOptions::parseStrategy(argv[++i]);
+        } else if (arg == "--priority" && i + 1 < argc) {
+            options.priority = SolverOptions::parsePriority(argv[++i]);
+        } else if (arg == "--beam-width" && i + 1 < argc) {
+            options.beamWidth = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Unknown argument: " << arg << "\n";
+            return 1;
+        }
+    }
+
+    Workload workload = WorkloadGenerator::generate(spec);
+    if (format == "json") {
+        printJson(workload, spec);
+    } else {
+        printText(workload);
+    }
+    return solve ? solveAndCheck(workload, options) : 0;
+}
@@ -1,59 +1,237 @@
-import asyncio
-
-from fastapi import FastAPI, WebSocket
-from fastapi.middleware.cors import CORSMiddleware
-
-from structures import (
-    SimplifyRequest, 
-    SimplifyResponse,
-    SystemSolveRequest,
-    SystemSolveResponse
-)
-import cas
-
-sessions = {}
-app = FastAPI()
-
-app.add_middleware(
-    CORSMiddleware,
-    allow_origins=["*"],
-    allow_credentials=True,
-    allow_methods=["*"],
-    allow_headers=["*"],
-)
-
-@app.websocket("/connect/{session_id}")
-async def connect(ws: WebSocket, session_id: str):
-    await ws.accept()
-    sessions[session_id] = ws
-    try:
-        while True:
-            await asyncio.sleep(10)  # keep handler alive
-    finally:
-        # Browser closed -> cleanup
-        sessions.pop(session_id, None)
-        print(f"Frontend {session_id} disconnected")
-        await ws.close()
-
-@app.post("/simplify")
-def simplify(req: SimplifyRequest) -> SimplifyResponse:
-    cas_result = cas.simplify(req.expression)
-    return SimplifyResponse(simplified=cas_result)
-
-@app.post("/solve-system")
-def solve_system(req: SystemSolveRequest) -> SystemSolveResponse:
-    try:
-        response_dict = cas.solve(req.equations, req.variable)
-        result_str = response_dict.get("result", "")
-        steps = response_dict.get("steps", [])
-        
-        if result_str and result_str.strip():
-            return SystemSolveResponse(result=result_str, steps=steps)
-        else:
-            return SystemSolveResponse(result="No solution found or system is inconsistent.", steps=steps)
-    except Exception as e:
-        return SystemSolveResponse(result=f"Error: {str(e)}", steps=[])
-
-@app.get("/")
-def root():
-    return {"message": "Welcome to the CAS backend!"}
+import asyncio
+import uuid
+from typing import List
+
+from fastapi import FastAPI, HTTPException, WebSocket
+from fastapi.middleware.cors import CORSMiddleware
+
+from structures import (
+    SimplifyRequest, 
+    SimplifyResponse,
+    SolverOptions,
+    SystemSolveRequest,
+    SystemSolveResponse,
+    NumericReport,
+    PolynomialReport,
+    SystemSolveStreamRequest,
+    SolveStreamStarted,
+    SystemSolveAllRequest,
+    DifferentiateRequest,
+    DifferentiateResponse,
+    JacobianRequest,
+    JacobianResponse,
+    JacobianEntry,
+    SystemSolveAllResponse,
+    VariableSolution,
+    SessionEquation,
+    SessionEquationRequest,
+    SessionSolveRequest,
+    SessionSolveResponse
+)
+import cas
+
+sessions = {}
+streams = {}  # request_id -> cas.SolveStream
+pump_tasks = set()  # running pump_stream tasks, the event loop only holds weak references
+solver_sessions = {}  # session_id -> cas.SolverSession, lives as long as the WebSocket
+app = FastAPI()
+
+app.add_middleware(
+    CORSMiddleware,
+    allow_origins=["*"],
+    allow_credentials=True,
+    allow_methods=["*"],
+    allow_headers=["*"],
+)
+
+@app.websocket("/connect/{session_id}")
+async def connect(ws: WebSocket, session_id: str):
+    await ws.accept()
+    sessions[session_id] = ws
+    solver_sessions.setdefault(session_id, cas.SolverSession())
+    try:
+        while True:
+            await asyncio.sleep(10)  # keep handler alive
+    finally:
+        # Browser closed -> cleanup
+        sessions.pop(session_id, None)
+        solver_sessions.pop(session_id, None)
+        print(f"Frontend {session_id} disconnected")
+        await ws.close()
+
+@app.post("/simplify")
+async def simplify(req: SimplifyRequest) -> SimplifyResponse:
+    # Runs on the module's own pool, the event loop stays free meanwhile
+    cas_result = await cas.simplify_async(req.expression)
+    return SimplifyResponse(simplified=cas_result)
+
+def to_cas_options(options: SolverOptions) -> cas.SolverOptions:
+    cas_options = cas.SolverOptions()
+    cas_options.strategy = cas.SolverOptions.parse_strategy(options.strategy)
+    cas_options.priority = cas.SolverOptions.parse_priority(options.priority)
+    cas_options.beam_width = options.beam_width
+    # Unset limits keep the C++ defaults
+    if options.max_iterations is not None:
+        cas_options.max_iterations = options.max_iterations
+    if options.max_iterations_without_improvement is not None:
+        cas_options.max_iterations_without_improvement = options.max_iterations_without_improvement
+    if options.expansion_ratio is not None:
+        cas_options.expansion_ratio = options.expansion_ratio
+    cas_options.polynomial_roots = options.polynomial_roots
+    cas_options.numeric_fallback = options.numeric_fallback
+    cas_options.newton_method = options.newton_method
+    cas_options.starting_points = options.starting_points
+    return cas_options
+
+@app.post("/solve-system")
+async def solve_system(req: SystemSolveRequest) -> SystemSolveResponse:
+    try:
+        options = to_cas_options(req.options) if req.options else None
+        response_dict = await cas.solve_async(req.equations, req.variable, options)
+        result_str = response_dict.get("result", "")
+        steps = response_dict.get("steps", [])
+        numeric_dict = response_dict.get("metrics", {}).get("numeric")
+        numeric = NumericReport(**numeric_dict) if numeric_dict else None
+        polynomial_dict = response_dict.get("metrics", {}).get("polynomial")
+        polynomial = PolynomialReport(**polynomial_dict) if polynomial_dict else None
+        
+        if result_str and result_str.strip():
+            return SystemSolveResponse(result=result_str, steps=steps, numeric=numeric, polynomial=polynomial)
+        else:
+            return SystemSolveResponse(result="No solution found or system is inconsistent.", steps=steps, numeric=numeric, polynomial=polynomial)
+    except Exception as e:
+        return SystemSolveResponse(result=f"Error: {str(e)}", steps=[])
+
+@app.post("/solve-system/all")
+async def solve_system_all(req: SystemSolveAllRequest) -> SystemSolveAllResponse:
+    try:
+        response_dict = await asyncio.to_thread(cas.solve_all, req.equations)
+        variables = {
+            name: VariableSolution(**answer)
+            for name, answer in response_dict["variables"].items()
+        }
+        return SystemSolveAllResponse(
+            variables=variables,
+            inconsistent_equations=response_dict["inconsistent_equations"],
+            redundant_equations=response_dict["redundant_equations"]
+        )
+    except Exception as e:
+        return SystemSolveAllResponse(error=f"Error: {str(e)}")
+
+@app.post("/differentiate")
+def differentiate(req: DifferentiateRequest) -> DifferentiateResponse:
+    try:
+        return DifferentiateResponse(derivative=cas.differentiate(req.expression, req.variable))
+    except Exception as e:
+        return DifferentiateResponse(error=f"Error: {str(e)}")
+
+def jacobian_response(req: JacobianRequest) -> JacobianResponse:
+    jacobian = cas.Jacobian(req.equations, req.variables)
+    values = jacobian.evaluate(req.point) if req.point is not None else None
+    derivatives = jacobian.derivatives  # printed on every access
+    entries = []
+    for row in range(len(jacobian.row_start) - 1):
+        for entry in range(jacobian.row_start[row], jacobian.row_start[row + 1]):
+            entries.append(JacobianEntry(
+                row=row,
+                column=jacobian.columns[entry],
+                derivative=derivatives[entry],
+                value=values["entries"][entry] if values else None
+            ))
+    return JacobianResponse(
+        variables=jacobian.variables,
+        entries=entries,
+        residuals=values["residuals"] if values else None
+    )
+
+@app.post("/jacobian")
+async def jacobian(req: JacobianRequest) -> JacobianResponse:
+    try:
+        return await asyncio.to_thread(jacobian_response, req)
+    except Exception as e:
+        return JacobianResponse(error=f"Error: {str(e)}")
+
+async def pump_stream(request_id: str, session_id: str, stream):
+    try:
+        while True:
+            # next() blocks until the solver emits, keep it off the event loop
+            event = await asyncio.to_thread(next, stream, None)
+            if event is None:
+                break
+            ws = sessions.get(session_id)
+            if ws is None:
+                # Nobody is listening anymore
+                stream.cancel()
+                continue
+            await ws.send_json({"request_id": request_id, **event})
+    except Exception as e:
+        ws = sessions.get(session_id)
+        if ws is not None:
+            await ws.send_json({"request_id": request_id, "kind": "error", "text": f"Error: {str(e)}"})
+    finally:
+        streams.pop(request_id, None)
+        pump_tasks.discard(asyncio.current_task())
+
+@app.post("/solve-system/stream")
+async def solve_system_stream(req: SystemSolveStreamRequest) -> SolveStreamStarted:
+    if req.session_id not in sessions:
+        raise HTTPException(status_code=404, detail="Unknown session, connect the WebSocket first")
+    options = to_cas_options(req.options) if req.options else None
+    stream = cas.solve_stream(req.equations, req.variable, options)
+    request_id = uuid.uuid4().hex
+    streams[request_id] = stream
+    pump_tasks.add(asyncio.create_task(pump_stream(request_id, req.session_id, stream)))
+    return SolveStreamStarted(request_id=request_id)
+
+@app.post("/solve-system/stream/{request_id}/cancel")
+def cancel_solve_stream(request_id: str):
+    stream = streams.get(request_id)
+    if stream is None:
+        raise HTTPException(status_code=404, detail="Unknown or finished request")
+    stream.cancel()
+    return {"cancelled": True}
+
+def get_solver_session(session_id: str):
+    session = solver_sessions.get(session_id)
+    if session is None:
+        raise HTTPException(status_code=404, detail="Unknown session, connect the WebSocket first")
+    return session
+
+@app.get("/session/{session_id}/equations")
+def list_session_equations(session_id: str) -> List[SessionEquation]:
+    session = get_solver_session(session_id)
+    return [SessionEquation(id=id, equation=equation) for id, equation in session.list()]
+
+@app.put("/session/{session_id}/equations/{equation_id}")
+async def set_session_equation(session_id: str, equation_id: str, req: SessionEquationRequest) -> SessionEquation:
+    session = get_solver_session(session_id)
+    try:
+        await asyncio.to_thread(session.set, equation_id, req.equation)
+    except Exception as e:
+        raise HTTPException(status_code=400, detail=str(e))
+    return SessionEquation(id=equation_id, equation=req.equation)
+
+@app.delete("/session/{session_id}/equations/{equation_id}")
+def remove_session_equation(session_id: str, equation_id: str):
+    session = get_solver_session(session_id)
+    if not session.remove(equation_id):
+        raise HTTPException(status_code=404, detail="Unknown equation")
+    return {"removed": True}
+
+@app.post("/session/{session_id}/solve")
+async def solve_session(session_id: str, req: SessionSolveRequest) -> SessionSolveResponse:
+    session = get_solver_session(session_id)
+    try:
+        options = to_cas_options(req.options) if req.options else None
+        response_dict = await asyncio.to_thread(session.solve, req.variable, options)
+        result_str = response_dict.get("result", "")
+        steps = response_dict.get("steps", [])
+        if not result_str.strip():
+            result_str = "No solution found or system is inconsistent."
+        return SessionSolveResponse(result=result_str, steps=steps, cached=response_dict.get("cached", False))
+    except Exception as e:
+        return SessionSolveResponse(result=f"Error: {str(e)}", steps=[])
+
+@app.get("/")
+def root():
+    return {"message": "Welcome to the CAS backend!"}
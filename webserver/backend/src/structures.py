@@ -1,5 +1,5 @@
 from pydantic import BaseModel
-from typing import List, Dict
+from typing import List, Dict, Optional
 
 class SimplifyRequest(BaseModel):
     expression: str
@@ -7,10 +7,96 @@ class SimplifyRequest(BaseModel):
 class SimplifyResponse(BaseModel):
     simplified: str
 
+class SolverOptions(BaseModel):
+    strategy: str = "best_first"  # best_first | beam | bfs
+    priority: str = "distinct"  # distinct | occurrences | weighted
+    beam_width: int = 16
+    max_iterations: Optional[int] = None
+    max_iterations_without_improvement: Optional[int] = None
+    expansion_ratio: Optional[float] = None
+    polynomial_roots: bool = True  # every real root of a one-variable polynomial
+    numeric_fallback: bool = True  # damped Newton when the search finds nothing
+    newton_method: str = "line_search"  # line_search | trust_region
+    starting_points: List[Dict[str, float]] = []  # tried before the random starts
+
 class SystemSolveRequest(BaseModel):
     equations: List[str]
     variable: str
+    options: Optional[SolverOptions] = None
+
+class SystemSolveStreamRequest(SystemSolveRequest):
+    session_id: str  # events are pushed on /connect/{session_id}
+
+class SolveStreamStarted(BaseModel):
+    request_id: str
+
+class NumericReport(BaseModel):
+    converged: bool
+    reason: str  # converged | max_iterations | stalled | singular | underdetermined | not_differentiable | budget
+    starts: int
+    iterations: int
+    residual_norm: float  # max |lhs - rhs| at the answer
+    values: Dict[str, float] = {}
+
+class PolynomialReport(BaseModel):
+    degree: int
+    roots: List[str] = []  # ascending, exact where possible, e.g. "1 - 2 ^ (1/2)"
 
 class SystemSolveResponse(BaseModel):
     result: str
     steps: List[str] = []
+    numeric: Optional[NumericReport] = None  # set when the search failed and Newton was tried
+    polynomial: Optional[PolynomialReport] = None  # set when the target was left in a polynomial
+
+class SystemSolveAllRequest(BaseModel):
+    equations: List[str]
+
+class VariableSolution(BaseModel):
+    status: str  # solved | dependent | free | inconsistent | unsolved
+    value: str = ""  # solved and dependent only
+    depends_on: List[str] = []  # free variables a dependent value is written in
+
+class SystemSolveAllResponse(BaseModel):
+    variables: Dict[str, VariableSolution] = {}
+    inconsistent_equations: List[int] = []  # positions in the request
+    redundant_equations: int = 0
+    error: Optional[str] = None
+
+class DifferentiateRequest(BaseModel):
+    expression: str
+    variable: str
+
+class DifferentiateResponse(BaseModel):
+    derivative: str = ""
+    error: Optional[str] = None
+
+class JacobianRequest(BaseModel):
+    equations: List[str]
+    variables: List[str] = []  # column order, empty for every variable, sorted
+    point: Optional[List[float]] = None  # one value per column, to evaluate at
+
+class JacobianEntry(BaseModel):
+    row: int
+    column: int
+    derivative: str  # of lhs - rhs of equations[row] by variables[column]
+    value: Optional[float] = None
+
+class JacobianResponse(BaseModel):
+    variables: List[str] = []
+    entries: List[JacobianEntry] = []  # non-zero entries only
+    residuals: Optional[List[float]] = None  # lhs - rhs at point
+    error: Optional[str] = None
+
+class SessionEquation(BaseModel):
+    id: str
+    equation: str
+
+class SessionEquationRequest(BaseModel):
+    equation: str
+
+class SessionSolveRequest(BaseModel):
+    variable: str
+    options: Optional[SolverOptions] = None
+
+class SessionSolveResponse(SystemSolveResponse):
+    cached: bool = False  # nothing the answer depends on changed since the last query